@@ -0,0 +1,250 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+std::atomic<size_t> HeapAllocator::s_AllocationCount{0};
+std::atomic<size_t> HeapAllocator::s_FreeCount{0};
+
+static uint8_t* AlignUp(uint8_t* pMemory, size_t alignment)
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pMemory);
+    return reinterpret_cast<uint8_t*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void* HeapAllocator::Allocate(size_t bytes, size_t alignment)
+{
+    s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(bytes, std::align_val_t{alignment});
+}
+
+void HeapAllocator::Free(void* pMemory, size_t bytes, size_t alignment)
+{
+    if (pMemory)
+    {
+        s_FreeCount.fetch_add(1, std::memory_order_relaxed);
+        ::operator delete(pMemory, bytes, std::align_val_t{alignment});
+    }
+}
+
+size_t HeapAllocator::GetAllocationCount()
+{
+    return s_AllocationCount.load(std::memory_order_relaxed);
+}
+
+size_t HeapAllocator::GetFreeCount()
+{
+    return s_FreeCount.load(std::memory_order_relaxed);
+}
+
+ArenaAllocator::ArenaAllocator(size_t blockSize):
+    m_pBlocks{nullptr},
+    m_pCurrent{nullptr},
+    m_pEnd{nullptr},
+    m_pLast{nullptr},
+    m_pLastBase{nullptr},
+    m_BlockSize{blockSize},
+    m_Used{0},
+    m_Capacity{0}
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    FreeBlocks();
+}
+
+void* ArenaAllocator::Allocate(size_t bytes, size_t alignment)
+{
+    uint8_t* pMemory = AlignUp(m_pCurrent, alignment);
+    if (!m_pCurrent || pMemory + bytes > m_pEnd)
+    {
+        AddBlock(bytes + alignment);
+        pMemory = AlignUp(m_pCurrent, alignment);
+    }
+
+    m_Used += (pMemory + bytes) - m_pCurrent;
+    m_pLastBase = m_pCurrent;
+    m_pLast = pMemory;
+    m_pCurrent = pMemory + bytes;
+    return pMemory;
+}
+
+void ArenaAllocator::Free(void* pMemory, size_t bytes, size_t)
+{
+    // Only the most recent allocation can be given back. This makes growing
+    // a container that was the last thing allocated almost free.
+    if (pMemory && pMemory == m_pLast && m_pLast + bytes == m_pCurrent)
+    {
+        m_Used -= m_pCurrent - m_pLastBase;
+        m_pCurrent = m_pLastBase;
+        m_pLast = nullptr;
+    }
+}
+
+void ArenaAllocator::Reset()
+{
+    if (m_pBlocks && m_pBlocks->m_pNext)
+    {
+        const size_t capacity = m_Capacity;
+        FreeBlocks();
+        AddBlock(capacity);
+    }
+    else if (m_pBlocks)
+    {
+        m_pCurrent = reinterpret_cast<uint8_t*>(m_pBlocks + 1);
+    }
+
+    m_pLast = nullptr;
+    m_Used = 0;
+}
+
+void ArenaAllocator::AddBlock(size_t minimumSize)
+{
+    const size_t size = minimumSize > m_BlockSize ? minimumSize : m_BlockSize;
+
+    Block* pBlock = static_cast<Block*>(malloc(sizeof(Block) + size));
+    if (!pBlock)
+    {
+        throw std::bad_alloc();
+    }
+
+    pBlock->m_pNext = m_pBlocks;
+    pBlock->m_Size = size;
+    m_pBlocks = pBlock;
+
+    m_pCurrent = reinterpret_cast<uint8_t*>(pBlock + 1);
+    m_pEnd = m_pCurrent + size;
+    m_Capacity += size;
+}
+
+void ArenaAllocator::FreeBlocks()
+{
+    while (m_pBlocks)
+    {
+        Block* pNext = m_pBlocks->m_pNext;
+        free(m_pBlocks);
+        m_pBlocks = pNext;
+    }
+
+    m_pCurrent = nullptr;
+    m_pEnd = nullptr;
+    m_pLast = nullptr;
+    m_Capacity = 0;
+}
+
+FrameAllocator::FrameAllocator(size_t blockSize):
+    ArenaAllocator{blockSize},
+    m_PeakUsage{0}
+{
+}
+
+void FrameAllocator::EndFrame()
+{
+    if (GetUsed() > m_PeakUsage)
+    {
+        m_PeakUsage = GetUsed();
+    }
+
+    Reset();
+}
+
+PoolAllocator::PoolAllocator(size_t blockSize, size_t blockAlignment, size_t blocksPerPage):
+    m_pFreeList{nullptr},
+    m_pPages{nullptr},
+    m_BlockSize{blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize},
+    m_BlockAlignment{blockAlignment < alignof(FreeBlock) ? alignof(FreeBlock) : blockAlignment},
+    m_BlocksPerPage{blocksPerPage ? blocksPerPage : 1},
+    m_LiveCount{0}
+{
+    // Blocks are laid out back to back, so the stride must keep them aligned.
+    m_BlockSize = (m_BlockSize + m_BlockAlignment - 1) & ~(m_BlockAlignment - 1);
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    while (m_pPages)
+    {
+        Page* pNext = m_pPages->m_pNext;
+        free(m_pPages);
+        m_pPages = pNext;
+    }
+}
+
+void* PoolAllocator::Allocate()
+{
+    if (!m_pFreeList)
+    {
+        AddPage();
+    }
+
+    FreeBlock* pBlock = m_pFreeList;
+    m_pFreeList = pBlock->m_pNext;
+    m_LiveCount++;
+    return pBlock;
+}
+
+void PoolAllocator::Free(void* pMemory)
+{
+    if (pMemory)
+    {
+        FreeBlock* pBlock = static_cast<FreeBlock*>(pMemory);
+        pBlock->m_pNext = m_pFreeList;
+        m_pFreeList = pBlock;
+        m_LiveCount--;
+    }
+}
+
+void PoolAllocator::AddPage()
+{
+    const size_t pageSize = sizeof(Page) + m_BlockAlignment + m_BlockSize * m_BlocksPerPage;
+
+    Page* pPage = static_cast<Page*>(malloc(pageSize));
+    if (!pPage)
+    {
+        throw std::bad_alloc();
+    }
+
+    pPage->m_pNext = m_pPages;
+    m_pPages = pPage;
+
+    uint8_t* pBlocks = AlignUp(reinterpret_cast<uint8_t*>(pPage + 1), m_BlockAlignment);
+    for (size_t i = m_BlocksPerPage; i > 0; i--)
+    {
+        FreeBlock* pBlock = reinterpret_cast<FreeBlock*>(pBlocks + (i - 1) * m_BlockSize);
+        pBlock->m_pNext = m_pFreeList;
+        m_pFreeList = pBlock;
+    }
+}
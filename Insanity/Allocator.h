@@ -0,0 +1,210 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+// Every allocator exposes the same two functions so containers can take them
+// as a template parameter:
+//     void* Allocate(size_t bytes, size_t alignment);
+//     void Free(void* pMemory, size_t bytes, size_t alignment);
+
+// General purpose allocator. Counts every call so we can measure how many
+// heap allocations happen in a frame.
+class HeapAllocator
+{
+public:
+	void* Allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+	void Free(void* pMemory, size_t bytes, size_t alignment = alignof(max_align_t));
+
+	static size_t GetAllocationCount();
+	static size_t GetFreeCount();
+
+private:
+	static std::atomic<size_t> s_AllocationCount;
+	static std::atomic<size_t> s_FreeCount;
+};
+
+// Bump allocator. Memory comes from big blocks taken from the heap and is
+// only given back on Reset (or when freeing the most recent allocation).
+class ArenaAllocator
+{
+public:
+	explicit ArenaAllocator(size_t blockSize = 64 * 1024);
+	~ArenaAllocator();
+
+	ArenaAllocator(const ArenaAllocator&) = delete;
+	ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+	void Free(void* pMemory, size_t bytes, size_t alignment = alignof(max_align_t));
+
+	// Releases every allocation at once. If the arena had to chain more than
+	// one block, they are merged into a single bigger one so the next round
+	// fits without touching the heap.
+	void Reset();
+
+	size_t GetUsed() const { return m_Used; }
+	size_t GetCapacity() const { return m_Capacity; }
+
+private:
+	struct Block
+	{
+		Block* m_pNext;
+		size_t m_Size;
+	};
+
+	Block* m_pBlocks;
+	uint8_t* m_pCurrent;
+	uint8_t* m_pEnd;
+	uint8_t* m_pLast;
+	uint8_t* m_pLastBase;
+	size_t m_BlockSize;
+	size_t m_Used;
+	size_t m_Capacity;
+
+	void AddBlock(size_t minimumSize);
+	void FreeBlocks();
+};
+
+// Linear allocator for scratch data that only lives for one iteration of the
+// main loop. Call EndFrame() once the frame is finished.
+class FrameAllocator : public ArenaAllocator
+{
+public:
+	explicit FrameAllocator(size_t blockSize = 256 * 1024);
+
+	void EndFrame();
+
+	size_t GetPeakUsage() const { return m_PeakUsage; }
+
+private:
+	size_t m_PeakUsage;
+};
+
+// Fixed-size block allocator with an intrusive free list. Pages are allocated
+// on demand and never returned until the pool is destroyed.
+class PoolAllocator
+{
+public:
+	PoolAllocator(size_t blockSize, size_t blockAlignment, size_t blocksPerPage = 64);
+	~PoolAllocator();
+
+	PoolAllocator(const PoolAllocator&) = delete;
+	PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+	void* Allocate();
+	void Free(void* pMemory);
+
+	size_t GetLiveCount() const { return m_LiveCount; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* m_pNext;
+	};
+
+	struct Page
+	{
+		Page* m_pNext;
+	};
+
+	FreeBlock* m_pFreeList;
+	Page* m_pPages;
+	size_t m_BlockSize;
+	size_t m_BlockAlignment;
+	size_t m_BlocksPerPage;
+	size_t m_LiveCount;
+
+	void AddPage();
+};
+
+// Pool of engine objects (Mesh, Shader, ...).
+template<typename T>
+class TPool
+{
+public:
+	explicit TPool(size_t objectsPerPage = 64):
+		m_Allocator{sizeof(T), alignof(T), objectsPerPage}
+	{
+	}
+
+	template<typename... Args>
+	T* Create(Args&&... args)
+	{
+		return new (m_Allocator.Allocate()) T(std::forward<Args>(args)...);
+	}
+
+	void Destroy(T* pObject)
+	{
+		if (pObject)
+		{
+			pObject->~T();
+			m_Allocator.Free(pObject);
+		}
+	}
+
+	size_t GetLiveCount() const { return m_Allocator.GetLiveCount(); }
+
+private:
+	PoolAllocator m_Allocator;
+};
+
+// Lets a container use an allocator that lives somewhere else (an arena, the
+// frame allocator, ...).
+template<typename Allocator>
+class TAllocatorRef
+{
+public:
+	TAllocatorRef(Allocator& allocator):
+		m_pAllocator{&allocator}
+	{
+	}
+
+	void* Allocate(size_t bytes, size_t alignment)
+	{
+		return m_pAllocator->Allocate(bytes, alignment);
+	}
+
+	void Free(void* pMemory, size_t bytes, size_t alignment)
+	{
+		m_pAllocator->Free(pMemory, bytes, alignment);
+	}
+
+private:
+	Allocator* m_pAllocator;
+};
@@ -0,0 +1,827 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AssetManager.h"
+
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "Mesh.h"
+#include "MeshFormat.h"
+#include "Profiler.h"
+#include "Texture.h"
+#include "TextureEncoder.h"
+
+// Bytes handed to the GL per upload step. Small enough that one step never
+// blows the frame budget on its own.
+static const size_t UPLOAD_CHUNK_SIZE = 256 * 1024;
+
+// Textures used within this many frames are in use: their mips are never
+// dropped, and dropped ones come back.
+static const uint64_t TEXTURE_IN_USE_FRAMES = 2;
+
+// Mips stop being dropped once the largest level left is this small, there
+// is little to gain past that.
+static const uint32_t MIN_RESIDENT_TEXTURE_SIZE = 64;
+
+static bool HasExtension(const std::string& path, const char* pExtension)
+{
+    const size_t length = path.size(), extensionLength = strlen(pExtension);
+    return length > extensionLength && path.compare(length - extensionLength, extensionLength, pExtension) == 0;
+}
+
+AssetManager::AssetManager(uint32_t numIOThreads, uint32_t queueCapacity):
+    m_Requests{queueCapacity},
+    m_Results{queueCapacity},
+    m_Uploading{false},
+    m_UploadOffset{0},
+    m_pUploadMesh{nullptr},
+    m_pUploadSource{nullptr},
+    m_TextureUpload{},
+    m_TextureBudget{0},
+    m_TextureResidentBytes{0},
+    m_TextureFullBytes{0},
+    m_EvictedMips{0},
+    m_RestoredMips{0},
+    m_FrameIndex{0},
+    m_ChangingResidency{false},
+    m_ResidencyUpload{}
+{
+    for (uint32_t i = 0; i < numIOThreads; i++)
+    {
+        m_IOThreads.push_back(std::thread(&AssetManager::IOThreadMain, this));
+    }
+}
+
+AssetManager::~AssetManager()
+{
+    m_Requests.Close();
+    m_Results.Close();
+    for (std::thread& thread : m_IOThreads)
+    {
+        thread.join();
+    }
+
+    Clear();
+}
+
+AssetHandle AssetManager::LoadMesh(const std::string& path)
+{
+    return Request(ASSET_MESH, path);
+}
+
+AssetHandle AssetManager::LoadTexture(const std::string& path)
+{
+    return Request(ASSET_TEXTURE, path);
+}
+
+AssetHandle AssetManager::Request(AssetType type, const std::string& path)
+{
+    const AssetHandle handle = (AssetHandle)m_Assets.Size();
+    m_Assets.PushBack(Asset{ type, ASSET_QUEUED, path, Clock::now(), 0.0, 0.0, nullptr, 0, nullptr, nullptr, 0, 0 });
+    Queue(handle);
+    return handle;
+}
+
+void AssetManager::Reload(AssetHandle handle, std::chrono::steady_clock::time_point changeTime)
+{
+    Asset& asset = m_Assets[handle];
+    asset.m_RequestTime = changeTime;
+    if (asset.m_State == ASSET_FAILED)
+    {
+        asset.m_State = ASSET_QUEUED;
+    }
+    Queue(handle);
+}
+
+void AssetManager::Queue(AssetHandle handle)
+{
+    Asset& asset = m_Assets[handle];
+    asset.m_Version++;
+
+    // Never block the caller: what doesn't fit waits in the backlog.
+    m_Backlog.PushBack(LoadRequest{ handle, asset.m_Type, asset.m_Path, asset.m_Version });
+    FlushBacklog();
+}
+
+void AssetManager::FlushBacklog()
+{
+    size_t sent = 0;
+    while (sent < m_Backlog.Size())
+    {
+        const AssetHandle handle = m_Backlog[sent].m_Handle;
+        if (!m_Requests.TryPush(std::move(m_Backlog[sent])))
+        {
+            break;
+        }
+        // Reloads leave ready assets as they are.
+        if (m_Assets[handle].m_State == ASSET_QUEUED)
+        {
+            m_Assets[handle].m_State = ASSET_LOADING;
+        }
+        sent++;
+    }
+
+    if (sent)
+    {
+        TArray<LoadRequest> remaining;
+        for (size_t i = sent; i < m_Backlog.Size(); i++)
+        {
+            remaining.PushBack(std::move(m_Backlog[i]));
+        }
+        m_Backlog = std::move(remaining);
+    }
+}
+
+void AssetManager::IOThreadMain()
+{
+    Profiler::SetThreadName("Asset I/O");
+
+    LoadRequest request;
+    while (m_Requests.Pop(request))
+    {
+        PROFILE_SCOPE("AssetManager::Decode");
+        const Clock::time_point start = Clock::now();
+
+        LoadResult result{};
+        result.m_Handle = request.m_Handle;
+        result.m_Version = request.m_Version;
+        if (request.m_Type == ASSET_MESH)
+        {
+            if (HasExtension(request.m_Path, ".imesh"))
+            {
+                MapMeshFile(request.m_Path, result);
+            }
+            else
+            {
+                DecodeMesh(request.m_Path, m_Quantization, result);
+            }
+        }
+        else if (HasExtension(request.m_Path, ".itex"))
+        {
+            MapTextureFile(request.m_Path, result);
+        }
+        else
+        {
+            DecodeTexture(request.m_Path, result);
+        }
+        result.m_DecodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // Blocks when the render thread is behind on uploads, which keeps
+        // decoded data from piling up in memory.
+        if (!m_Results.Push(std::move(result)))
+        {
+            break;
+        }
+    }
+}
+
+void AssetManager::DecodeMesh(const std::string& path, const VertexQuantization& quantization, LoadResult& result)
+{
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices);
+    if (!pScene || !pScene->mNumMeshes)
+    {
+        std::cout << "ERROR: Loading mesh " << path << ": " << importer.GetErrorString() << std::endl;
+        result.m_Success = false;
+        return;
+    }
+
+    // An attribute is only kept if every sub-mesh has it.
+    bool hasNormals = true, hasTangents = true, hasTexCoords = true, hasColors = true;
+    for (unsigned int meshIndex = 0; meshIndex < pScene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[meshIndex];
+        hasNormals = hasNormals && pMesh->HasNormals();
+        hasTangents = hasTangents && pMesh->HasTangentsAndBitangents() && pMesh->HasNormals();
+        hasTexCoords = hasTexCoords && pMesh->HasTextureCoords(0);
+        hasColors = hasColors && pMesh->HasVertexColors(0);
+    }
+
+    // Every sub-mesh goes into one vertex/index buffer.
+    TArray<float> positions, normals, tangents, texCoords, colors;
+    TArray<unsigned int>& indices = result.m_Indices;
+    for (unsigned int meshIndex = 0; meshIndex < pScene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[meshIndex];
+        const unsigned int baseVertex = (unsigned int)(positions.Size() / 3);
+
+        for (unsigned int i = 0; i < pMesh->mNumVertices; i++)
+        {
+            const aiVector3D& position = pMesh->mVertices[i];
+            positions.PushBack(position.x);
+            positions.PushBack(position.y);
+            positions.PushBack(position.z);
+
+            if (hasNormals)
+            {
+                const aiVector3D& normal = pMesh->mNormals[i];
+                normals.PushBack(normal.x);
+                normals.PushBack(normal.y);
+                normals.PushBack(normal.z);
+            }
+
+            if (hasTangents)
+            {
+                // The shader rebuilds the bitangent from the normal and the
+                // tangent, it only needs to know which way it points.
+                const aiVector3D& tangent = pMesh->mTangents[i];
+                const aiVector3D cross = pMesh->mNormals[i] ^ tangent;
+                tangents.PushBack(tangent.x);
+                tangents.PushBack(tangent.y);
+                tangents.PushBack(tangent.z);
+                tangents.PushBack(cross * pMesh->mBitangents[i] < 0.0f ? -1.0f : 1.0f);
+            }
+
+            if (hasTexCoords)
+            {
+                texCoords.PushBack(pMesh->mTextureCoords[0][i].x);
+                texCoords.PushBack(pMesh->mTextureCoords[0][i].y);
+            }
+
+            if (hasColors)
+            {
+                const aiColor4D& color = pMesh->mColors[0][i];
+                colors.PushBack(color.r);
+                colors.PushBack(color.g);
+                colors.PushBack(color.b);
+                colors.PushBack(color.a);
+            }
+        }
+
+        for (unsigned int i = 0; i < pMesh->mNumFaces; i++)
+        {
+            const aiFace& face = pMesh->mFaces[i];
+            if (face.mNumIndices == 3)
+            {
+                indices.PushBack(baseVertex + face.mIndices[0]);
+                indices.PushBack(baseVertex + face.mIndices[1]);
+                indices.PushBack(baseVertex + face.mIndices[2]);
+            }
+        }
+    }
+
+    VertexSource source;
+    source.m_pPositions = positions.Data();
+    source.m_pNormals = hasNormals ? normals.Data() : nullptr;
+    source.m_pTangents = hasTangents ? tangents.Data() : nullptr;
+    source.m_pTexCoords = hasTexCoords ? texCoords.Data() : nullptr;
+    source.m_pColors = hasColors ? colors.Data() : nullptr;
+    source.m_NumVertices = (uint32_t)(positions.Size() / 3);
+
+    result.m_Layout = ChooseVertexLayout(source, quantization, VERTEX_INTERLEAVED);
+    result.m_VertexData.Resize((size_t)result.m_Layout.GetBufferSize(source.m_NumVertices));
+    EncodeVertices(source, result.m_Layout, result.m_VertexData.Data());
+
+    result.m_Bounds = AABB::FromPoints(positions.Data(), source.m_NumVertices);
+    result.m_pVertexData = result.m_VertexData.Data();
+    result.m_pIndexData = indices.Data();
+    result.m_VertexDataSize = result.m_VertexData.Size();
+    result.m_IndexDataSize = indices.Size() * sizeof(unsigned int);
+    result.m_NumVertices = source.m_NumVertices;
+    result.m_NumIndices = (uint32_t)indices.Size();
+    result.m_IndexSize = sizeof(unsigned int);
+    result.m_Success = true;
+}
+
+void AssetManager::MapMeshFile(const std::string& path, LoadResult& result)
+{
+    result.m_Success = false;
+    if (!result.m_File.Open(path))
+    {
+        return;
+    }
+
+    const MeshFileHeader* pHeader = ValidateMeshFile(result.m_File.GetData(), result.m_File.GetSize());
+    if (!pHeader)
+    {
+        std::cout << "ERROR: Loading mesh " << path << "." << std::endl;
+        result.m_File.Close();
+        return;
+    }
+
+    // Fault the pages in here so the uploads on the render thread never
+    // wait for the disk.
+    result.m_File.Prefetch();
+
+    result.m_pVertexData = GetMeshFileSection(result.m_File.GetData(), pHeader->m_VertexOffset);
+    result.m_pIndexData = GetMeshFileSection(result.m_File.GetData(), pHeader->m_IndexOffset);
+    result.m_VertexDataSize = (size_t)pHeader->m_VertexDataSize;
+    result.m_IndexDataSize = (size_t)pHeader->m_IndexDataSize;
+    result.m_NumVertices = pHeader->m_NumVertices;
+    result.m_NumIndices = pHeader->m_NumIndices;
+    result.m_IndexSize = pHeader->m_IndexSize;
+    result.m_Layout = pHeader->m_Layout;
+    result.m_Bounds.m_Min = glm::vec3(pHeader->m_BoundsMin[0], pHeader->m_BoundsMin[1], pHeader->m_BoundsMin[2]);
+    result.m_Bounds.m_Max = glm::vec3(pHeader->m_BoundsMax[0], pHeader->m_BoundsMax[1], pHeader->m_BoundsMax[2]);
+    result.m_Lods.m_NumLods = pHeader->m_NumLods;
+    memcpy(result.m_Lods.m_Lods, pHeader->m_Lods, sizeof(MeshLod) * pHeader->m_NumLods);
+    result.m_Success = true;
+}
+
+void AssetManager::DecodeTexture(const std::string& path, LoadResult& result)
+{
+    int width, height, channels;
+    unsigned char* pPixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pPixels)
+    {
+        std::cout << "ERROR: Loading texture " << path << ": " << stbi_failure_reason() << std::endl;
+        result.m_Success = false;
+        return;
+    }
+
+    // Uncooked images keep their full size: they are only there for
+    // convenience, cook them to save memory and upload time.
+    TextureSource& texture = result.m_Texture;
+    texture.m_Format = TEXTURE_RGBA8;
+    texture.m_Width = (uint32_t)width;
+    texture.m_Height = (uint32_t)height;
+    texture.m_NumMips = GenerateMipChain(pPixels, texture.m_Width, texture.m_Height, texture.m_Pixels, texture.m_Mips);
+    texture.m_pData = texture.m_Pixels.Data();
+    stbi_image_free(pPixels);
+
+    result.m_Success = true;
+}
+
+void AssetManager::MapTextureFile(const std::string& path, LoadResult& result)
+{
+    result.m_Success = false;
+    TextureSource& texture = result.m_Texture;
+    if (!texture.m_File.Open(path))
+    {
+        return;
+    }
+
+    const TextureFileHeader* pHeader = ValidateTextureFile(texture.m_File.GetData(), texture.m_File.GetSize());
+    if (!pHeader)
+    {
+        std::cout << "ERROR: Loading texture " << path << "." << std::endl;
+        texture.m_File.Close();
+        return;
+    }
+
+    // Only the lower mips are read again when dropped ones come back, and
+    // they stay mapped; the OS can page them out meanwhile.
+    texture.m_File.Prefetch();
+
+    texture.m_pData = static_cast<const unsigned char*>(texture.m_File.GetData());
+    texture.m_Format = pHeader->m_Format;
+    texture.m_Width = pHeader->m_Width;
+    texture.m_Height = pHeader->m_Height;
+    texture.m_NumMips = pHeader->m_NumMips;
+    memcpy(texture.m_Mips, pHeader->m_Mips, sizeof(TextureMip) * pHeader->m_NumMips);
+    result.m_Success = true;
+}
+
+void AssetManager::Update(double budgetMs)
+{
+    PROFILE_SCOPE("AssetManager::Update");
+    FlushBacklog();
+    m_FrameIndex++;
+
+    const Clock::time_point start = Clock::now();
+    do
+    {
+        if (!m_Uploading)
+        {
+            if (!m_Results.TryPop(m_Upload))
+            {
+                break;
+            }
+            BeginUpload();
+        }
+
+        if (m_Uploading && UploadChunk())
+        {
+            FinishUpload();
+        }
+    } while (std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs);
+
+    // Whatever time loading left goes to keeping textures within budget.
+    while (std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs)
+    {
+        if (!m_ChangingResidency && !BeginResidencyChange())
+        {
+            break;
+        }
+
+        if (UploadTextureChunk(m_ResidencyUpload))
+        {
+            FinishResidencyChange();
+        }
+    }
+}
+
+void AssetManager::BeginUpload()
+{
+    Asset& asset = m_Assets[m_Upload.m_Handle];
+    const bool reload = asset.m_State == ASSET_READY;
+
+    // A newer request for the same asset is on its way.
+    if (m_Upload.m_Version != asset.m_Version)
+    {
+        m_Upload = LoadResult{};
+        return;
+    }
+
+    asset.m_DecodeMs = m_Upload.m_DecodeMs;
+    if (m_Upload.m_Success)
+    {
+        // Only allocate here; the data goes in over the next UploadChunk calls.
+        if (asset.m_Type == ASSET_MESH)
+        {
+            m_pUploadMesh = m_MeshPool.Create();
+            m_pUploadMesh->CreateEmptyMesh(m_Upload.m_Layout, m_Upload.m_NumVertices, m_Upload.m_IndexSize, m_Upload.m_NumIndices, m_Upload.m_Bounds);
+            m_pUploadMesh->SetLods(m_Upload.m_Lods);
+            m_Uploading = true;
+        }
+        else
+        {
+            // The source stays with the asset, for when mips come back.
+            m_pUploadSource = m_TextureSourcePool.Create(std::move(m_Upload.m_Texture));
+            m_Uploading = BeginTextureUpload(m_TextureUpload, m_Upload.m_Handle, *m_pUploadSource, 0);
+            if (!m_Uploading)
+            {
+                m_TextureSourcePool.Destroy(m_pUploadSource);
+                m_pUploadSource = nullptr;
+            }
+        }
+    }
+
+    if (!m_Uploading)
+    {
+        if (reload)
+        {
+            std::cout << "ERROR: Reloading " << asset.m_Path << " failed, keeping the previous version." << std::endl;
+        }
+        else
+        {
+            asset.m_State = ASSET_FAILED;
+        }
+        m_Upload = LoadResult{};
+        return;
+    }
+
+    if (!reload)
+    {
+        asset.m_State = ASSET_UPLOADING;
+    }
+    m_UploadOffset = 0;
+}
+
+bool AssetManager::UploadChunk()
+{
+    if (m_pUploadMesh)
+    {
+        // Vertices first, then indices, all counted in bytes.
+        const size_t vertexBytes = m_Upload.m_VertexDataSize;
+        const size_t indexBytes = m_Upload.m_IndexDataSize;
+
+        size_t count = 0;
+        if (m_UploadOffset < vertexBytes)
+        {
+            count = UPLOAD_CHUNK_SIZE < vertexBytes - m_UploadOffset ? UPLOAD_CHUNK_SIZE : vertexBytes - m_UploadOffset;
+            m_pUploadMesh->UpdateVertices(m_UploadOffset, static_cast<const unsigned char*>(m_Upload.m_pVertexData) + m_UploadOffset, count);
+        }
+        else if (m_UploadOffset < vertexBytes + indexBytes)
+        {
+            const size_t first = m_UploadOffset - vertexBytes;
+            count = UPLOAD_CHUNK_SIZE < indexBytes - first ? UPLOAD_CHUNK_SIZE : indexBytes - first;
+            m_pUploadMesh->UpdateIndices(first, static_cast<const unsigned char*>(m_Upload.m_pIndexData) + first, count);
+        }
+
+        m_UploadOffset += count;
+        return m_UploadOffset >= vertexBytes + indexBytes;
+    }
+
+    return UploadTextureChunk(m_TextureUpload);
+}
+
+void AssetManager::FinishUpload()
+{
+    Asset& asset = m_Assets[m_Upload.m_Handle];
+    const bool reload = asset.m_State == ASSET_READY;
+
+    // Swap the new version in, the previous one (if any) goes.
+    if (asset.m_Type == ASSET_MESH)
+    {
+        m_MeshPool.Destroy(asset.m_pMesh);
+        asset.m_pMesh = m_pUploadMesh;
+        m_pUploadMesh = nullptr;
+    }
+    else
+    {
+        if (asset.m_pTexture)
+        {
+            if (m_ChangingResidency && m_ResidencyUpload.m_Handle == m_Upload.m_Handle)
+            {
+                CancelResidencyChange();
+            }
+            m_TextureResidentBytes -= asset.m_pTexture->GetResidentBytes();
+            m_TextureFullBytes -= GetTextureBytes(*asset.m_pTextureSource, 0);
+            m_TexturePool.Destroy(asset.m_pTexture);
+            m_TextureSourcePool.Destroy(asset.m_pTextureSource);
+        }
+
+        // A new version comes with every mip, the dropped ones are back.
+        m_RestoredMips += asset.m_FirstMip;
+
+        asset.m_pTexture = m_TextureUpload.m_pTexture;
+        asset.m_pTextureSource = m_pUploadSource;
+        asset.m_FirstMip = 0;
+        asset.m_LastUsedFrame = m_FrameIndex;
+        m_TextureUpload = TextureUpload{};
+        m_pUploadSource = nullptr;
+        m_TextureResidentBytes += asset.m_pTexture->GetResidentBytes();
+        m_TextureFullBytes += asset.m_pTexture->GetResidentBytes();
+    }
+
+    asset.m_State = ASSET_READY;
+    asset.m_LatencyMs = std::chrono::duration<double, std::milli>(Clock::now() - asset.m_RequestTime).count();
+    std::cout << (reload ? "Reloaded " : "Loaded ") << asset.m_Path << " in " << asset.m_LatencyMs << " ms (decode " << asset.m_DecodeMs << " ms)";
+    if (asset.m_pTexture)
+    {
+        std::cout << ", " << GetTextureFormatName(asset.m_pTexture->GetFormat()) << " " << asset.m_pTexture->GetWidth() << "x" << asset.m_pTexture->GetHeight()
+            << " with " << asset.m_pTexture->GetNumMips() << " mips, " << asset.m_pTexture->GetResidentBytes() / 1024 << " KB";
+    }
+    std::cout << "." << std::endl;
+
+    // Drop the CPU copy or the mapping.
+    m_Upload = LoadResult{};
+    m_Uploading = false;
+}
+
+Mesh* AssetManager::GetMesh(AssetHandle handle) const
+{
+    const Asset& asset = m_Assets[handle];
+    return asset.m_State == ASSET_READY ? asset.m_pMesh : nullptr;
+}
+
+GLuint AssetManager::GetTexture(AssetHandle handle)
+{
+    Asset& asset = m_Assets[handle];
+    if (asset.m_State != ASSET_READY)
+    {
+        return 0;
+    }
+
+    asset.m_LastUsedFrame = m_FrameIndex;
+    return asset.m_pTexture->GetId();
+}
+
+bool AssetManager::BeginTextureUpload(TextureUpload& upload, AssetHandle handle, const TextureSource& source, uint32_t firstMip)
+{
+    Texture* pTexture = m_TexturePool.Create();
+    if (!pTexture->Create(source.m_Format, GetTextureMipDimension(source.m_Width, firstMip), GetTextureMipDimension(source.m_Height, firstMip), source.m_NumMips - firstMip))
+    {
+        m_TexturePool.Destroy(pTexture);
+        return false;
+    }
+
+    upload = TextureUpload{ handle, &source, pTexture, firstMip, 0, 0 };
+    return true;
+}
+
+bool AssetManager::UploadTextureChunk(TextureUpload& upload)
+{
+    const TextureSource& source = *upload.m_pSource;
+    Texture& texture = *upload.m_pTexture;
+
+    // A band of rows of one level at a time; compressed rows are 4 pixels
+    // high.
+    const uint32_t width = GetTextureMipDimension(texture.GetWidth(), upload.m_Mip);
+    const uint32_t height = GetTextureMipDimension(texture.GetHeight(), upload.m_Mip);
+    const uint32_t rowHeight = GetTextureRowHeight(source.m_Format);
+    const size_t rowSize = GetTextureRowSize(source.m_Format, width);
+    size_t rows = UPLOAD_CHUNK_SIZE / rowSize;
+    rows = rows ? rows : 1;
+
+    const uint32_t firstRow = upload.m_Row;
+    const uint32_t numRows = (uint32_t)std::min<size_t>(rows * rowHeight, height - firstRow);
+    const unsigned char* pMip = source.m_pData + source.m_Mips[upload.m_FirstMip + upload.m_Mip].m_Offset;
+    texture.Upload(upload.m_Mip, firstRow, numRows, pMip + firstRow / rowHeight * rowSize);
+
+    upload.m_Row += numRows;
+    if (upload.m_Row >= height)
+    {
+        upload.m_Mip++;
+        upload.m_Row = 0;
+    }
+    return upload.m_Mip >= texture.GetNumMips();
+}
+
+size_t AssetManager::GetTextureBytes(const TextureSource& source, uint32_t firstMip) const
+{
+    size_t bytes = 0;
+    for (uint32_t mip = firstMip; mip < source.m_NumMips; mip++)
+    {
+        bytes += (size_t)source.m_Mips[mip].m_Size;
+    }
+    return bytes;
+}
+
+bool AssetManager::BeginResidencyChange()
+{
+    const size_t budget = m_TextureBudget ? m_TextureBudget : SIZE_MAX;
+
+    // The least recently used texture that can lose mips, and the most
+    // recently used one that lost some.
+    AssetHandle evict = INVALID_ASSET, restore = INVALID_ASSET;
+    for (AssetHandle handle = 0; handle < (AssetHandle)m_Assets.Size(); handle++)
+    {
+        const Asset& asset = m_Assets[handle];
+        if (asset.m_State != ASSET_READY || !asset.m_pTexture)
+        {
+            continue;
+        }
+
+        if (m_FrameIndex - asset.m_LastUsedFrame <= TEXTURE_IN_USE_FRAMES)
+        {
+            if (asset.m_FirstMip > 0 && (restore == INVALID_ASSET || asset.m_LastUsedFrame > m_Assets[restore].m_LastUsedFrame))
+            {
+                restore = handle;
+            }
+        }
+        else if (std::max(asset.m_pTexture->GetWidth(), asset.m_pTexture->GetHeight()) / 2 >= MIN_RESIDENT_TEXTURE_SIZE &&
+            (evict == INVALID_ASSET || asset.m_LastUsedFrame < m_Assets[evict].m_LastUsedFrame))
+        {
+            evict = handle;
+        }
+    }
+
+    // Make room for the texture that wants its mips back first.
+    size_t wanted = m_TextureResidentBytes;
+    if (restore != INVALID_ASSET)
+    {
+        const Asset& asset = m_Assets[restore];
+        wanted += GetTextureBytes(*asset.m_pTextureSource, asset.m_FirstMip - 1) - asset.m_pTexture->GetResidentBytes();
+    }
+
+    if (wanted > budget && evict != INVALID_ASSET)
+    {
+        // As many levels as it takes, while the largest one left is big
+        // enough.
+        const Asset& asset = m_Assets[evict];
+        const TextureSource& source = *asset.m_pTextureSource;
+        uint32_t firstMip = asset.m_FirstMip + 1;
+        while (wanted - asset.m_pTexture->GetResidentBytes() + GetTextureBytes(source, firstMip) > budget &&
+            std::max(GetTextureMipDimension(source.m_Width, firstMip), GetTextureMipDimension(source.m_Height, firstMip)) / 2 >= MIN_RESIDENT_TEXTURE_SIZE)
+        {
+            firstMip++;
+        }
+
+        if (!BeginTextureUpload(m_ResidencyUpload, evict, source, firstMip))
+        {
+            return false;
+        }
+        m_ChangingResidency = true;
+        return true;
+    }
+
+    if (restore != INVALID_ASSET && wanted <= budget)
+    {
+        // Every level that fits.
+        const Asset& asset = m_Assets[restore];
+        const TextureSource& source = *asset.m_pTextureSource;
+        const size_t others = m_TextureResidentBytes - asset.m_pTexture->GetResidentBytes();
+        uint32_t firstMip = asset.m_FirstMip - 1;
+        while (firstMip > 0 && others + GetTextureBytes(source, firstMip - 1) <= budget)
+        {
+            firstMip--;
+        }
+
+        if (!BeginTextureUpload(m_ResidencyUpload, restore, source, firstMip))
+        {
+            return false;
+        }
+        m_ChangingResidency = true;
+        return true;
+    }
+
+    return false;
+}
+
+void AssetManager::CancelResidencyChange()
+{
+    m_TexturePool.Destroy(m_ResidencyUpload.m_pTexture);
+    m_ResidencyUpload = TextureUpload{};
+    m_ChangingResidency = false;
+}
+
+void AssetManager::FinishResidencyChange()
+{
+    Asset& asset = m_Assets[m_ResidencyUpload.m_Handle];
+
+    m_TextureResidentBytes -= asset.m_pTexture->GetResidentBytes();
+    m_TexturePool.Destroy(asset.m_pTexture);
+
+    // Counted once the change is done, a cancelled one changes nothing.
+    if (m_ResidencyUpload.m_FirstMip > asset.m_FirstMip)
+    {
+        m_EvictedMips += m_ResidencyUpload.m_FirstMip - asset.m_FirstMip;
+    }
+    else
+    {
+        m_RestoredMips += asset.m_FirstMip - m_ResidencyUpload.m_FirstMip;
+    }
+
+    asset.m_pTexture = m_ResidencyUpload.m_pTexture;
+    asset.m_FirstMip = m_ResidencyUpload.m_FirstMip;
+    m_TextureResidentBytes += asset.m_pTexture->GetResidentBytes();
+
+    m_ResidencyUpload = TextureUpload{};
+    m_ChangingResidency = false;
+}
+
+bool AssetManager::CheckTextureAccounting() const
+{
+    size_t residentBytes = 0, fullBytes = 0;
+    uint64_t missingMips = 0;
+    for (const Asset& asset : m_Assets)
+    {
+        if (asset.m_pTexture)
+        {
+            residentBytes += asset.m_pTexture->GetResidentBytes();
+            fullBytes += GetTextureBytes(*asset.m_pTextureSource, 0);
+            missingMips += asset.m_FirstMip;
+        }
+    }
+
+    if (residentBytes != m_TextureResidentBytes || fullBytes != m_TextureFullBytes || missingMips != m_EvictedMips - m_RestoredMips)
+    {
+        std::cout << "ERROR: Texture accounting drifted: " << m_TextureResidentBytes << " bytes resident, " << m_TextureFullBytes << " with every mip, "
+            << m_EvictedMips - m_RestoredMips << " mips dropped, the textures have " << residentBytes << ", " << fullBytes << " and " << missingMips << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AssetManager::Clear()
+{
+    for (Asset& asset : m_Assets)
+    {
+        if (asset.m_pMesh)
+        {
+            m_MeshPool.Destroy(asset.m_pMesh);
+            asset.m_pMesh = nullptr;
+        }
+
+        m_TexturePool.Destroy(asset.m_pTexture);
+        asset.m_pTexture = nullptr;
+        m_TextureSourcePool.Destroy(asset.m_pTextureSource);
+        asset.m_pTextureSource = nullptr;
+    }
+
+    // What is still being uploaded isn't the assets' yet.
+    m_MeshPool.Destroy(m_pUploadMesh);
+    m_pUploadMesh = nullptr;
+    m_TextureSourcePool.Destroy(m_pUploadSource);
+    m_pUploadSource = nullptr;
+    m_TexturePool.Destroy(m_TextureUpload.m_pTexture);
+    m_TextureUpload = TextureUpload{};
+    CancelResidencyChange();
+
+    m_Assets.Clear();
+    m_Backlog.Clear();
+    m_Uploading = false;
+    m_Upload = LoadResult{};
+    m_TextureResidentBytes = 0;
+    m_TextureFullBytes = 0;
+}
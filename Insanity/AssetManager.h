@@ -0,0 +1,282 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Bounds.h"
+#include "BoundedQueue.h"
+#include "MappedFile.h"
+#include "MeshLod.h"
+#include "TArray.h"
+#include "TextureFormat.h"
+#include "VertexLayout.h"
+#include "VertexQuantization.h"
+
+class Mesh;
+class Texture;
+
+typedef uint32_t AssetHandle;
+static const AssetHandle INVALID_ASSET = 0xFFFFFFFF;
+
+enum AssetType
+{
+	ASSET_MESH,
+	ASSET_TEXTURE,
+};
+
+enum AssetState
+{
+	ASSET_QUEUED,
+	ASSET_LOADING,
+	ASSET_UPLOADING,
+	ASSET_READY,
+	ASSET_FAILED,
+};
+
+// Loads meshes (cooked .imesh files, anything else through Assimp) and
+// textures (cooked .itex files, anything else through stb_image with its
+// mips made on the I/O thread) on background I/O threads.
+// Decoded data is uploaded to the GL by Update, on the render thread, in
+// small chunks and only for as long as the frame budget allows, so loading
+// never causes a hitch. Everything except the I/O threads must be used from
+// the thread that owns the GL context.
+//
+// Textures can be held to a memory budget. While they are over it, the top
+// mips of the textures that haven't been used for a while are dropped, and
+// they come back once the texture is used again and fits. Textures in use
+// are never shrunk, so the budget can be exceeded when they alone don't
+// fit.
+class AssetManager
+{
+public:
+	explicit AssetManager(uint32_t numIOThreads = 2, uint32_t queueCapacity = 16);
+	~AssetManager();
+
+	AssetManager(const AssetManager&) = delete;
+	AssetManager& operator=(const AssetManager&) = delete;
+
+	// Tolerances used to pick compact vertex formats for meshes imported
+	// through Assimp (cooked ones were already quantized by the cooker).
+	// Set it before the first LoadMesh, the I/O threads read it unlocked.
+	void SetVertexQuantization(const VertexQuantization& quantization) { m_Quantization = quantization; }
+
+	AssetHandle LoadMesh(const std::string& path);
+	AssetHandle LoadTexture(const std::string& path);
+
+	// Bytes of GPU memory for textures, 0 for no limit.
+	void SetTextureBudget(size_t bytes) { m_TextureBudget = bytes; }
+
+	// GPU memory of the textures as they are now, and as they would be
+	// with every mip.
+	size_t GetTextureResidentBytes() const { return m_TextureResidentBytes; }
+	size_t GetTextureFullBytes() const { return m_TextureFullBytes; }
+
+	// Mip levels dropped and brought back since the start.
+	uint64_t GetEvictedMips() const { return m_EvictedMips; }
+	uint64_t GetRestoredMips() const { return m_RestoredMips; }
+
+	// Counts the textures' bytes and dropped mips again, one by one, and
+	// compares them with the totals above. False, with both printed, if
+	// they drifted apart.
+	bool CheckTextureAccounting() const;
+
+	// Reads the asset's file again, for hot reloading. The current version
+	// stays in use until the new one is uploaded, and is kept if the new
+	// one fails to load. The latency logged is counted from changeTime.
+	void Reload(AssetHandle handle, std::chrono::steady_clock::time_point changeTime);
+
+	// Call once per frame.
+	void Update(double budgetMs);
+
+	// Deletes every GL object. Must run while the context is still alive.
+	void Clear();
+
+	AssetState GetState(AssetHandle handle) const { return m_Assets[handle].m_State; }
+	// Reloading replaces the mesh: don't keep it across frames either.
+	Mesh* GetMesh(AssetHandle handle) const;
+
+	// Counts as a use of the texture this frame, for the budget. The name
+	// changes when mips are dropped or brought back, so don't keep it
+	// across frames.
+	GLuint GetTexture(AssetHandle handle);
+
+	// Time from the request until the asset was ready to use, in ms.
+	double GetLoadLatency(AssetHandle handle) const { return m_Assets[handle].m_LatencyMs; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// What a texture's mips are uploaded from, kept for as long as the
+	// texture lives so dropped mips can come back: the mapped file of a
+	// cooked texture, or the RGBA8 chain made for any other image. m_pData
+	// points into one of them; moving doesn't change where.
+	struct TextureSource
+	{
+		MappedFile m_File;
+		TArray<unsigned char> m_Pixels;
+		const unsigned char* m_pData;
+		TextureFormat m_Format;
+		uint32_t m_Width, m_Height;
+		uint32_t m_NumMips;
+		TextureMip m_Mips[MAX_TEXTURE_MIPS];
+	};
+
+	struct Asset
+	{
+		AssetType m_Type;
+		AssetState m_State;
+		std::string m_Path;
+		Clock::time_point m_RequestTime;
+		double m_DecodeMs;
+		double m_LatencyMs;
+		Mesh* m_pMesh;
+
+		// Bumped by every load request; only the result of the latest one
+		// is used, whatever order the I/O threads finish in.
+		uint32_t m_Version;
+
+		// Level 0 of m_pTexture is level m_FirstMip of the source.
+		Texture* m_pTexture;
+		TextureSource* m_pTextureSource;
+		uint32_t m_FirstMip;
+		uint64_t m_LastUsedFrame;
+	};
+
+	struct LoadRequest
+	{
+		AssetHandle m_Handle;
+		AssetType m_Type;
+		std::string m_Path;
+		uint32_t m_Version;
+	};
+
+	// Decoded data, produced by an I/O thread and consumed by Update.
+	struct LoadResult
+	{
+		AssetHandle m_Handle;
+		uint32_t m_Version;
+		bool m_Success;
+		double m_DecodeMs;
+
+		// What gets uploaded. Points either into m_VertexData/m_Indices or
+		// straight into m_File for cooked meshes, which may have 16-bit
+		// indices.
+		const void* m_pVertexData;
+		const void* m_pIndexData;
+		size_t m_VertexDataSize, m_IndexDataSize;
+		uint32_t m_NumVertices, m_NumIndices, m_IndexSize;
+		VertexLayout m_Layout;
+		AABB m_Bounds;
+		MeshLodChain m_Lods;
+
+		TArray<unsigned char> m_VertexData;
+		TArray<unsigned int> m_Indices;
+		MappedFile m_File;
+
+		TextureSource m_Texture;
+	};
+
+	// A texture being filled from a source, starting at m_FirstMip. It
+	// only replaces the asset's texture once every level is in.
+	struct TextureUpload
+	{
+		AssetHandle m_Handle;
+		const TextureSource* m_pSource;
+		Texture* m_pTexture;
+		uint32_t m_FirstMip;
+		uint32_t m_Mip;
+		uint32_t m_Row;
+	};
+
+	TArray<Asset> m_Assets;
+	TPool<Mesh> m_MeshPool;
+	TPool<Texture> m_TexturePool;
+	TPool<TextureSource> m_TextureSourcePool;
+	VertexQuantization m_Quantization;
+
+	// Requests that didn't fit in the I/O queue yet.
+	TArray<LoadRequest> m_Backlog;
+
+	TBoundedQueue<LoadRequest> m_Requests;
+	TBoundedQueue<LoadResult> m_Results;
+	std::vector<std::thread> m_IOThreads;
+
+	// Upload in progress, spread over as many frames as needed.
+	// Meshes and texture sources it creates only go to the asset once the
+	// upload is done, so a reload never shows half an asset.
+	bool m_Uploading;
+	LoadResult m_Upload;
+	size_t m_UploadOffset;
+	Mesh* m_pUploadMesh;
+	TextureSource* m_pUploadSource;
+	TextureUpload m_TextureUpload;
+
+	// Texture budget, and the one texture whose mips are being dropped or
+	// brought back.
+	size_t m_TextureBudget;
+	size_t m_TextureResidentBytes;
+	size_t m_TextureFullBytes;
+	uint64_t m_EvictedMips, m_RestoredMips;
+	uint64_t m_FrameIndex;
+	bool m_ChangingResidency;
+	TextureUpload m_ResidencyUpload;
+
+	AssetHandle Request(AssetType type, const std::string& path);
+	void Queue(AssetHandle handle);
+	void FlushBacklog();
+
+	void IOThreadMain();
+	static void DecodeMesh(const std::string& path, const VertexQuantization& quantization, LoadResult& result);
+	static void MapMeshFile(const std::string& path, LoadResult& result);
+	static void DecodeTexture(const std::string& path, LoadResult& result);
+	static void MapTextureFile(const std::string& path, LoadResult& result);
+
+	void BeginUpload();
+	bool UploadChunk();
+	void FinishUpload();
+
+	bool BeginTextureUpload(TextureUpload& upload, AssetHandle handle, const TextureSource& source, uint32_t firstMip);
+	void CancelResidencyChange();
+	bool UploadTextureChunk(TextureUpload& upload);
+	size_t GetTextureBytes(const TextureSource& source, uint32_t firstMip) const;
+
+	bool BeginResidencyChange();
+	void FinishResidencyChange();
+};
@@ -0,0 +1,1248 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Benchmark.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "MeshFormat.h"
+#include "MeshOptimizer.h"
+#include "SceneComponents.h"
+#include "SystemScheduler.h"
+#include "TArray.h"
+#include "TextureEncoder.h"
+#include "TransformSystem.h"
+#include "World.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// Frame time differences under this are noise, whatever the tolerance.
+static const double TIME_SLACK_MS = 0.05;
+
+// Whether a scene times shader creation, and with which cache.
+enum ShaderStartup
+{
+    SHADERS_UNTIMED,
+    SHADERS_COLD,   // Cache cleared, every shader compiled.
+    SHADERS_WARM,   // Every shader loaded from the cache left by earlier scenes.
+    SHADERS_ALL     // Cache cleared, every permutation of the shader features compiled.
+};
+
+struct BenchmarkScene
+{
+    const char* m_pName;
+    uint32_t m_NumObjects;
+    uint32_t m_NumMeshes;
+    bool m_PooledMeshes;
+    bool m_LodScene;
+    uint32_t m_StreamKB;
+    uint32_t m_NumTextures;
+    bool m_ShareResources;
+    bool m_Instancing;
+    ShaderStartup m_ShaderStartup;
+};
+
+// Each one stresses a different path of the renderer. Changing a scene
+// invalidates its baseline.
+static const BenchmarkScene s_Scenes[] = {
+    // Name, objects, meshes, pooled, LODs, streamed KB per frame, textures,
+    // shared resources, instancing, shader startup. meshes and pooled
+    // measure many distinct meshes, so theirs are kept apart; shared is the
+    // same scene with them shared. unbatched is instanced with a draw call
+    // per object. meshes_10k and pooled_10k draw each object with a mesh
+    // of its own, drawn one by one and from the geometry pool. shaders_warm
+    // follows shaders_cold, which fills the cache. shaders_permutations
+    // builds every variant of the scene shader, not only the two it draws
+    // with.
+    { "instanced", 4096, 1, false, false, 0, 0, true, true, SHADERS_UNTIMED },
+    { "unbatched", 4096, 1, false, false, 0, 0, true, false, SHADERS_UNTIMED },
+    { "meshes", 4096, 64, false, false, 0, 0, false, true, SHADERS_UNTIMED },
+    { "pooled", 4096, 64, true, false, 0, 0, false, true, SHADERS_UNTIMED },
+    { "shared", 4096, 64, false, false, 0, 0, true, true, SHADERS_UNTIMED },
+    { "meshes_10k", 10000, 10000, false, false, 0, 0, false, true, SHADERS_UNTIMED },
+    { "pooled_10k", 10000, 10000, true, false, 0, 0, false, true, SHADERS_UNTIMED },
+    { "lods", 4096, 1, false, true, 0, 0, true, true, SHADERS_UNTIMED },
+    { "streaming", 256, 1, false, false, 4096, 0, true, true, SHADERS_UNTIMED },
+    { "textures", 256, 1, false, false, 0, 32, true, true, SHADERS_UNTIMED },
+    { "shaders_cold", 256, 1, false, false, 0, 0, true, true, SHADERS_COLD },
+    { "shaders_warm", 256, 1, false, false, 0, 0, true, true, SHADERS_WARM },
+    { "shaders_permutations", 256, 1, false, false, 0, 0, true, true, SHADERS_ALL },
+};
+
+// Texture scene: cooked textures of this size, in BC1, BC3 and BC7 in
+// turn, a few used each frame and the rest dropping mips to fit a budget
+// smaller than all of them.
+static const uint32_t BENCHMARK_TEXTURE_SIZE = 512;
+static const uint32_t BENCHMARK_TEXTURES_PER_FRAME = 8;
+static const uint32_t BENCHMARK_TEXTURE_BUDGET_MB = 4;
+
+// CPU benchmarks time this many passes and keep the median.
+static const uint32_t BENCHMARK_PASSES = 20;
+
+// Container benchmark: elements appended one at a time with no Reserve, as
+// vertex and index lists are built, and strings long enough to live on
+// the heap, so growing has to move them.
+static const uint32_t CONTAINER_BENCHMARK_ELEMENTS = 1 << 20;
+static const uint32_t CONTAINER_BENCHMARK_STRINGS = 1 << 16;
+
+// Transform benchmark: objects whose model matrices are built.
+static const uint32_t TRANSFORM_BENCHMARK_OBJECTS = 100000;
+
+// ECS iteration benchmark: entities to move and age.
+static const uint32_t ECS_BENCHMARK_ENTITIES = 1 << 20;
+
+// Job system benchmark: items of a compute bound ParallelFor and its grain,
+// and one-item jobs, many more than fit in a worker's deque.
+static const uint32_t JOBS_BENCHMARK_ITEMS = 1 << 18;
+static const uint32_t JOBS_BENCHMARK_GRAIN = 4096;
+static const uint32_t JOBS_BENCHMARK_SMALL_JOBS = 20000;
+
+// Culling benchmark: boxes scattered around and in front of the camera,
+// and how many of them move between passes.
+static const uint32_t CULLING_BENCHMARK_BOXES = 1 << 20;
+static const uint32_t CULLING_BENCHMARK_MOVING = CULLING_BENCHMARK_BOXES / 10;
+
+// Texture codec benchmark: the benchmark textures are compressed, decoded
+// again and compared with the source. Root mean square error per channel
+// must stay under these, in 8-bit units; BC1 has no alpha to compare.
+struct CodecBound
+{
+    TextureFormat m_Format;
+    const char* m_pTimeMetric;
+    uint32_t m_NumChannels;
+    double m_MaxRmse;
+};
+
+static const CodecBound s_CodecBounds[] = {
+    { TEXTURE_BC1, "bc1_ms", 3, 2.5 },
+    { TEXTURE_BC3, "bc3_ms", 4, 2.5 },
+    { TEXTURE_BC7, "bc7_ms", 4, 1.25 },
+};
+
+// Mesh optimizer benchmark: quads per side of a grid, unindexed and its
+// triangles shuffled, just under the 16-bit index limit once deduped.
+static const uint32_t MESHOPT_BENCHMARK_GRID = 254;
+
+struct Velocity
+{
+    glm::vec3 m_Value;
+};
+
+struct Lifetime
+{
+    float m_Seconds;
+};
+
+// The layout the ECS replaces: a list of pointers to objects allocated
+// one by one, with their data behind more pointers.
+struct PointerObject
+{
+    Transform* m_pTransform;
+    Velocity* m_pVelocity;
+    Lifetime* m_pLifetime;
+};
+
+enum MetricKind
+{
+    METRIC_TIME,
+    METRIC_COUNT,
+    METRIC_MEMORY,
+    METRIC_INFO     // Reported, too noisy to compare.
+};
+
+struct BenchmarkMetric
+{
+    std::string m_Scene;
+    const char* m_pName;
+    MetricKind m_Kind;
+    double m_Value;
+};
+
+struct BaselineValue
+{
+    std::string m_Key;
+    double m_Value;
+};
+
+// Nearest rank on sorted values.
+static double GetPercentile(const TArray<double>& sorted, double percentile)
+{
+    if (sorted.IsEmpty())
+    {
+        return 0.0;
+    }
+
+    size_t rank = (size_t)ceil(percentile / 100.0 * sorted.Size());
+    rank = rank ? rank : 1;
+    return sorted[std::min(rank, sorted.Size()) - 1];
+}
+
+// Frame to frame jitter.
+static double GetStandardDeviation(const TArray<double>& values)
+{
+    if (values.IsEmpty())
+    {
+        return 0.0;
+    }
+
+    double sum = 0.0, sumSquares = 0.0;
+    for (double value : values)
+    {
+        sum += value;
+        sumSquares += value * value;
+    }
+    const double mean = sum / values.Size();
+    return sqrt(std::max(sumSquares / values.Size() - mean * mean, 0.0));
+}
+
+static void AddSceneMetrics(const char* pScene, const FrameStatistics& statistics, TArray<BenchmarkMetric>& metrics)
+{
+    TArray<double> frameTimes = statistics.m_FrameTimes;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    const double numFrames = (double)std::max<size_t>(frameTimes.Size(), 1);
+
+    metrics.PushBack(BenchmarkMetric{ pScene, "p50_ms", METRIC_TIME, GetPercentile(frameTimes, 50.0) });
+    metrics.PushBack(BenchmarkMetric{ pScene, "render_cpu_ms", METRIC_TIME, statistics.m_RenderCpuMs / numFrames });
+    metrics.PushBack(BenchmarkMetric{ pScene, "p95_ms", METRIC_TIME, GetPercentile(frameTimes, 95.0) });
+    metrics.PushBack(BenchmarkMetric{ pScene, "p99_ms", METRIC_INFO, GetPercentile(frameTimes, 99.0) });
+    metrics.PushBack(BenchmarkMetric{ pScene, "max_ms", METRIC_INFO, GetPercentile(frameTimes, 100.0) });
+    metrics.PushBack(BenchmarkMetric{ pScene, "jitter_ms", METRIC_INFO, GetStandardDeviation(frameTimes) });
+    metrics.PushBack(BenchmarkMetric{ pScene, "draw_calls", METRIC_COUNT, statistics.m_DrawCalls / numFrames });
+    metrics.PushBack(BenchmarkMetric{ pScene, "driver_calls", METRIC_COUNT, statistics.m_DriverCalls / numFrames });
+    metrics.PushBack(BenchmarkMetric{ pScene, "triangles", METRIC_COUNT, statistics.m_Triangles / numFrames });
+    metrics.PushBack(BenchmarkMetric{ pScene, "memory_mb", METRIC_MEMORY, statistics.m_ResidentBytes / (1024.0 * 1024.0) });
+
+    // Reported only: the loader and the profiler allocate on their own
+    // threads whenever they have work, which no frame count pins down.
+    metrics.PushBack(BenchmarkMetric{ pScene, "allocations", METRIC_INFO, statistics.m_HeapAllocations / numFrames });
+
+    if (statistics.m_MeshBytesSaved)
+    {
+        metrics.PushBack(BenchmarkMetric{ pScene, "mesh_mb", METRIC_MEMORY, statistics.m_MeshBytes / (1024.0 * 1024.0) });
+        metrics.PushBack(BenchmarkMetric{ pScene, "mesh_mb_saved", METRIC_INFO, statistics.m_MeshBytesSaved / (1024.0 * 1024.0) });
+    }
+
+    // Upload time is what regresses; throughput is the same number seen
+    // the other way round.
+    if (statistics.m_StreamBytes)
+    {
+        const double megabytes = statistics.m_StreamBytes / (1024.0 * 1024.0);
+        metrics.PushBack(BenchmarkMetric{ pScene, "stream_ms", METRIC_TIME, statistics.m_StreamMs / numFrames });
+        metrics.PushBack(BenchmarkMetric{ pScene, "stream_mb", METRIC_INFO, megabytes / numFrames });
+        metrics.PushBack(BenchmarkMetric{ pScene, "stream_mb_s", METRIC_INFO, statistics.m_StreamMs > 0.0 ? megabytes / (statistics.m_StreamMs / 1000.0) : 0.0 });
+    }
+
+    if (statistics.m_TextureFullBytes)
+    {
+        metrics.PushBack(BenchmarkMetric{ pScene, "texture_mb", METRIC_MEMORY, statistics.m_TextureBytes / (1024.0 * 1024.0) });
+        metrics.PushBack(BenchmarkMetric{ pScene, "mips_dropped", METRIC_INFO, (double)statistics.m_EvictedMips });
+        metrics.PushBack(BenchmarkMetric{ pScene, "mips_restored", METRIC_INFO, (double)statistics.m_RestoredMips });
+    }
+}
+
+// Rings and stripes, different for every index so no two compress the
+// same.
+static void CreateBenchmarkImage(uint32_t index, uint32_t size, TArray<unsigned char>& pixels)
+{
+    pixels.Resize((size_t)size * size * 4);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const float dx = (float)x - size * 0.5f, dy = (float)y - size * 0.5f;
+            unsigned char* pPixel = &pixels[((size_t)y * size + x) * 4];
+            pPixel[0] = (unsigned char)(127.5f + 127.5f * sinf(sqrtf(dx * dx + dy * dy) * (0.05f + 0.01f * index)));
+            pPixel[1] = (unsigned char)((x * (index + 1)) & 0xFF);
+            pPixel[2] = (unsigned char)((y + index * 37) & 0xFF);
+            pPixel[3] = (unsigned char)(255 - ((x ^ y) & 0x7F));
+        }
+    }
+}
+
+// Cooks count procedural images to .itex files in the working directory.
+static bool CreateBenchmarkTextures(uint32_t count, TArray<std::string>& files)
+{
+    static const TextureFormat s_Formats[] = { TEXTURE_BC1, TEXTURE_BC3, TEXTURE_BC7 };
+    const uint32_t size = BENCHMARK_TEXTURE_SIZE;
+
+    TArray<unsigned char> pixels, file;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CreateBenchmarkImage(i, size, pixels);
+        EncodeTextureFile(pixels.Data(), size, size, s_Formats[i % 3], file);
+
+        const std::string path = "benchmark_texture_" + std::to_string(i) + ".itex";
+        std::ofstream stream{ path, std::ios::binary | std::ios::trunc };
+        stream.write(reinterpret_cast<const char*>(file.Data()), (std::streamsize)file.Size());
+        if (!stream)
+        {
+            std::cout << "ERROR: Writing " << path << "." << std::endl;
+            return false;
+        }
+        files.PushBack(path);
+    }
+    return true;
+}
+
+template<typename Function>
+static double GetMedianPassTime(const Function& pass)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    TArray<double> times;
+    for (uint32_t i = 0; i < BENCHMARK_PASSES; i++)
+    {
+        const Clock::time_point start = Clock::now();
+        pass();
+        times.PushBack(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    return GetPercentile(times, 50.0);
+}
+
+static void MoveSystem(void*, World& world, JobSystem& jobSystem)
+{
+    world.ParallelForEachChunk<const Velocity, Transform>(jobSystem, [](uint32_t count, const Entity*, const Velocity* pVelocities, Transform* pTransforms)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pTransforms[i].m_Position += pVelocities[i].m_Value * (1.0f / 60.0f);
+        }
+    });
+}
+
+static void AgeSystem(void*, World& world, JobSystem& jobSystem)
+{
+    world.ParallelForEachChunk<Lifetime>(jobSystem, [](uint32_t count, const Entity*, Lifetime* pLifetimes)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pLifetimes[i].m_Seconds -= 1.0f / 60.0f;
+        }
+    });
+}
+
+// Times the same appends into a TArray and a std::vector, and checks both
+// end up with the same contents.
+template<typename T, typename Fill>
+static bool CompareContainers(const Fill& fill, double& arrayMs, double& vectorMs)
+{
+    TArray<T> array;
+    std::vector<T> vector;
+    arrayMs = GetMedianPassTime([&array, &fill]()
+    {
+        TArray<T> passArray;
+        fill([&passArray](T value) { passArray.PushBack(std::move(value)); });
+        array = std::move(passArray);
+    });
+    vectorMs = GetMedianPassTime([&vector, &fill]()
+    {
+        std::vector<T> passVector;
+        fill([&passVector](T value) { passVector.push_back(std::move(value)); });
+        vector = std::move(passVector);
+    });
+    return array.Size() == vector.size() && std::equal(array.begin(), array.end(), vector.begin());
+}
+
+static bool RunContainerBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    double arrayIntsMs, vectorIntsMs;
+    bool success = CompareContainers<uint32_t>([](const auto& push)
+    {
+        for (uint32_t i = 0; i < CONTAINER_BENCHMARK_ELEMENTS; i++)
+        {
+            push(i * 2654435761u);
+        }
+    }, arrayIntsMs, vectorIntsMs);
+
+    double arrayStringsMs, vectorStringsMs;
+    success &= CompareContainers<std::string>([](const auto& push)
+    {
+        for (uint32_t i = 0; i < CONTAINER_BENCHMARK_STRINGS; i++)
+        {
+            push("a string too long for the small buffer " + std::to_string(i));
+        }
+    }, arrayStringsMs, vectorStringsMs);
+
+    if (!success)
+    {
+        std::cout << "ERROR: TArray and std::vector ended up with different contents." << std::endl;
+    }
+
+    std::cout << "Appending " << CONTAINER_BENCHMARK_ELEMENTS << " integers: TArray " << arrayIntsMs << " ms, std::vector " << vectorIntsMs << " ms. "
+        << CONTAINER_BENCHMARK_STRINGS << " strings: TArray " << arrayStringsMs << " ms, std::vector " << vectorStringsMs << " ms." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "tarray_ints_ms", METRIC_TIME, arrayIntsMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "vector_ints_ms", METRIC_INFO, vectorIntsMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "tarray_strings_ms", METRIC_TIME, arrayStringsMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "vector_strings_ms", METRIC_INFO, vectorStringsMs });
+    return success;
+}
+
+// Moves and ages ECS_BENCHMARK_ENTITIES objects stored both ways: pointers
+// to separate allocations, visited in shuffled order as a heap looks after
+// objects have come and gone, and ECS chunks walked in order, on one
+// thread and as two systems the scheduler runs side by side.
+static bool RunEcsBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    const float dt = 1.0f / 60.0f;
+    uint32_t random = 0x9E3779B9u;
+    auto next = [&random]()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    };
+
+    TArray<PointerObject*> objects;
+    objects.Reserve(ECS_BENCHMARK_ENTITIES);
+    for (uint32_t i = 0; i < ECS_BENCHMARK_ENTITIES; i++)
+    {
+        const glm::vec3 position{ (float)(i % 1024), (float)(i / 1024), 0.0f };
+        objects.PushBack(new PointerObject{ new Transform{ position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) },
+            new Velocity{ glm::vec3(1.0f, 0.5f, 0.0f) }, new Lifetime{ 10.0f } });
+    }
+    for (uint32_t i = ECS_BENCHMARK_ENTITIES - 1; i > 0; i--)
+    {
+        std::swap(objects[i], objects[next() % (i + 1)]);
+    }
+
+    const double pointersMs = GetMedianPassTime([&objects, dt]()
+    {
+        for (PointerObject* pObject : objects)
+        {
+            pObject->m_pTransform->m_Position += pObject->m_pVelocity->m_Value * dt;
+            pObject->m_pLifetime->m_Seconds -= dt;
+        }
+    });
+
+    for (PointerObject* pObject : objects)
+    {
+        delete pObject->m_pTransform;
+        delete pObject->m_pVelocity;
+        delete pObject->m_pLifetime;
+        delete pObject;
+    }
+    objects.Clear();
+
+    World world;
+    for (uint32_t i = 0; i < ECS_BENCHMARK_ENTITIES; i++)
+    {
+        const glm::vec3 position{ (float)(i % 1024), (float)(i / 1024), 0.0f };
+        world.Create(Transform{ position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f) }, Velocity{ glm::vec3(1.0f, 0.5f, 0.0f) }, Lifetime{ 10.0f });
+    }
+
+    const double chunksMs = GetMedianPassTime([&world, dt]()
+    {
+        world.ForEachChunk<const Velocity, Transform, Lifetime>([dt](uint32_t count, const Entity*, const Velocity* pVelocities, Transform* pTransforms, Lifetime* pLifetimes)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                pTransforms[i].m_Position += pVelocities[i].m_Value * dt;
+                pLifetimes[i].m_Seconds -= dt;
+            }
+        });
+    });
+
+    JobSystem jobSystem;
+    SystemScheduler scheduler;
+    scheduler.AddSystem("Move", MakeComponentMask<Velocity>(), MakeComponentMask<Transform>(), &MoveSystem, nullptr);
+    scheduler.AddSystem("Age", 0, MakeComponentMask<Lifetime>(), &AgeSystem, nullptr);
+    const double systemsMs = GetMedianPassTime([&scheduler, &world, &jobSystem]()
+    {
+        scheduler.Run(world, jobSystem);
+    });
+
+    std::cout << "ECS iteration over " << ECS_BENCHMARK_ENTITIES << " entities: pointers " << pointersMs << " ms, chunks " << chunksMs << " ms ("
+        << pointersMs / chunksMs << "x), systems on " << jobSystem.GetNumThreads() << " threads " << systemsMs << " ms ("
+        << scheduler.GetNumPhases() << " phases)." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "pointers_ms", METRIC_INFO, pointersMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "chunks_ms", METRIC_TIME, chunksMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "systems_ms", METRIC_TIME, systemsMs });
+    return true;
+}
+
+// Times the same ParallelFor on 1, 2, 4... threads up to one per core, then
+// JOBS_BENCHMARK_SMALL_JOBS one-item jobs on all of them for the cost of a
+// job. Those also check that every index ran exactly once.
+static bool RunJobsBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    TArray<float> values;
+    values.Resize(JOBS_BENCHMARK_ITEMS);
+
+    uint32_t maxThreads = std::thread::hardware_concurrency();
+    maxThreads = maxThreads ? maxThreads : 1;
+
+    double serialMs = 0.0, parallelMs = 0.0, smallJobsMs = 0.0;
+    bool success = true;
+    std::cout << "Job system scaling over " << JOBS_BENCHMARK_ITEMS << " items:" << std::endl;
+    for (uint32_t numThreads = 1; ; numThreads = std::min(numThreads * 2, maxThreads))
+    {
+        JobSystem jobSystem{ numThreads };
+        for (uint32_t i = 0; i < JOBS_BENCHMARK_ITEMS; i++)
+        {
+            values[i] = (float)i;
+        }
+
+        float* pValues = values.Data();
+        const double passMs = GetMedianPassTime([&jobSystem, pValues]()
+        {
+            jobSystem.ParallelFor(JOBS_BENCHMARK_ITEMS, JOBS_BENCHMARK_GRAIN, [pValues](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    float value = pValues[i];
+                    for (uint32_t j = 0; j < 4; j++)
+                    {
+                        value = sinf(value * 1.0001f + 0.5f);
+                    }
+                    pValues[i] = value;
+                }
+            });
+        });
+
+        serialMs = numThreads == 1 ? passMs : serialMs;
+        parallelMs = passMs;
+        std::cout << "  " << numThreads << (numThreads == 1 ? " thread: " : " threads: ") << passMs << " ms (" << serialMs / passMs << "x)." << std::endl;
+
+        if (numThreads == maxThreads)
+        {
+            std::unique_ptr<std::atomic<uint32_t>[]> runs{ new std::atomic<uint32_t>[JOBS_BENCHMARK_SMALL_JOBS]() };
+            std::atomic<uint32_t>* pRuns = runs.get();
+            smallJobsMs = GetMedianPassTime([&jobSystem, pRuns]()
+            {
+                jobSystem.ParallelFor(JOBS_BENCHMARK_SMALL_JOBS, 1, [pRuns](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = begin; i < end; i++)
+                    {
+                        pRuns[i].fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            });
+
+            for (uint32_t i = 0; i < JOBS_BENCHMARK_SMALL_JOBS; i++)
+            {
+                if (pRuns[i].load() != BENCHMARK_PASSES)
+                {
+                    std::cout << "ERROR: Job " << i << " ran " << pRuns[i].load() << " times in " << BENCHMARK_PASSES << " passes." << std::endl;
+                    success = false;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    std::cout << JOBS_BENCHMARK_SMALL_JOBS << " one-item jobs on every thread: " << smallJobsMs << " ms." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "serial_ms", METRIC_TIME, serialMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "parallel_ms", METRIC_TIME, parallelMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "speedup", METRIC_INFO, serialMs / parallelMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "small_jobs_ms", METRIC_TIME, smallJobsMs });
+    return success;
+}
+
+// Builds a BVH over CULLING_BENCHMARK_BOXES boxes and culls them against a
+// frustum, then against the same frustum testing every box, and checks both
+// find the same ones. Then moves some of the boxes, refits and culls again.
+static bool RunCullingBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t random = 0x2545F491u;
+    auto next = [&random]()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return (random & 0xFFFFFF) / (float)0x1000000;
+    };
+
+    TArray<AABB> boxes;
+    boxes.Reserve(CULLING_BENCHMARK_BOXES);
+    for (uint32_t i = 0; i < CULLING_BENCHMARK_BOXES; i++)
+    {
+        const glm::vec3 center{ next() * 2000.0f - 1000.0f, next() * 2000.0f - 1000.0f, next() * 2000.0f - 1000.0f };
+        const glm::vec3 extent{ 0.5f + next() * 1.5f };
+        boxes.PushBack(AABB{ center - extent, center + extent });
+    }
+
+    // No camera: world space is view space, looking down -Z.
+    Frustum frustum;
+    frustum.Extract(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f));
+
+    const Clock::time_point buildStart = Clock::now();
+    Bvh bvh;
+    bvh.Build(boxes.Data(), CULLING_BENCHMARK_BOXES);
+    const double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+    TArray<uint32_t> visible, expected;
+    visible.Reserve(CULLING_BENCHMARK_BOXES);
+    expected.Reserve(CULLING_BENCHMARK_BOXES);
+    const double bvhMs = GetMedianPassTime([&bvh, &frustum, &visible]()
+    {
+        visible.Clear();
+        bvh.Cull(frustum, visible);
+    });
+    const double bruteMs = GetMedianPassTime([&boxes, &frustum, &expected]()
+    {
+        expected.Clear();
+        for (uint32_t i = 0; i < CULLING_BENCHMARK_BOXES; i++)
+        {
+            if (frustum.IsVisible(boxes[i]))
+            {
+                expected.PushBack(i);
+            }
+        }
+    });
+
+    std::sort(visible.begin(), visible.end());
+    bool success = visible.Size() == expected.Size() && std::equal(visible.begin(), visible.end(), expected.begin());
+
+    // Every pass moves a different few boxes by a small step, as a scene
+    // of moving objects would between frames.
+    uint32_t firstMoving = 0;
+    const double refitMs = GetMedianPassTime([&]()
+    {
+        for (uint32_t i = 0; i < CULLING_BENCHMARK_MOVING; i++)
+        {
+            const uint32_t box = (firstMoving + i) % CULLING_BENCHMARK_BOXES;
+            const glm::vec3 step{ next() * 2.0f - 1.0f, next() * 2.0f - 1.0f, next() * 2.0f - 1.0f };
+            boxes[box] = AABB{ boxes[box].m_Min + step, boxes[box].m_Max + step };
+            bvh.UpdateObject(box, boxes[box]);
+        }
+        firstMoving += CULLING_BENCHMARK_MOVING;
+        bvh.Refit();
+    });
+
+    visible.Clear();
+    bvh.Cull(frustum, visible);
+    size_t numExpected = 0;
+    for (const AABB& box : boxes)
+    {
+        numExpected += frustum.IsVisible(box) ? 1 : 0;
+    }
+    success &= visible.Size() == numExpected;
+
+    if (!success)
+    {
+        std::cout << "ERROR: The BVH found " << visible.Size() << " visible boxes, testing them all found " << numExpected << "." << std::endl;
+    }
+
+    std::cout << "Culling " << CULLING_BENCHMARK_BOXES << " boxes, " << expected.Size() << " visible: BVH " << bvhMs << " ms, every box " << bruteMs
+        << " ms (" << bruteMs / bvhMs << "x). Build " << buildMs << " ms, refit of " << CULLING_BENCHMARK_MOVING << " moved boxes " << refitMs
+        << " ms (" << bvh.GetNumRebuilds() << " rebuilds)." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "bvh_ms", METRIC_TIME, bvhMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "brute_force_ms", METRIC_INFO, bruteMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "build_ms", METRIC_TIME, buildMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "refit_ms", METRIC_TIME, refitMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "visible", METRIC_INFO, (double)expected.Size() });
+    return success;
+}
+
+// Model matrices of TRANSFORM_BENCHMARK_OBJECTS transforms, built one by
+// one through glm as the scene used to, with the SIMD kernel from the ECS
+// Transform components, and from the structure of arrays TransformSystem.
+// Then the same objects' MVP matrices, glm against the fused kernel. Each
+// SIMD result must agree with glm's.
+static bool RunTransformBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    TArray<Transform> transforms;
+    TransformSystem transformSystem;
+    transforms.Reserve(TRANSFORM_BENCHMARK_OBJECTS);
+    for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_OBJECTS; i++)
+    {
+        const glm::vec3 position{ (float)(i % 100), (float)((i / 100) % 100), -(float)(i / 10000) };
+        const glm::quat rotation = glm::angleAxis(i * 0.01f, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
+        const glm::vec3 scale(1.0f + (i % 7) * 0.25f);
+        transforms.PushBack(Transform{ position, rotation, scale });
+        transformSystem.Add(position, rotation, scale);
+    }
+
+    TArray<WorldTransform> glmMatrices, simdMatrices, soaMatrices, glmMvp, simdMvp;
+    glmMatrices.Resize(TRANSFORM_BENCHMARK_OBJECTS);
+    simdMatrices.Resize(TRANSFORM_BENCHMARK_OBJECTS);
+    soaMatrices.Resize(TRANSFORM_BENCHMARK_OBJECTS);
+    glmMvp.Resize(TRANSFORM_BENCHMARK_OBJECTS);
+    simdMvp.Resize(TRANSFORM_BENCHMARK_OBJECTS);
+
+    const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 500.0f) *
+        glm::lookAt(glm::vec3(50.0f, 50.0f, 100.0f), glm::vec3(50.0f, 50.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    const double glmMs = GetMedianPassTime([&transforms, &glmMatrices]()
+    {
+        for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_OBJECTS; i++)
+        {
+            const Transform& transform = transforms[i];
+            glmMatrices[i].m_Matrix = glm::scale(glm::translate(glm::mat4(1.0f), transform.m_Position) * glm::mat4_cast(transform.m_Rotation), transform.m_Scale);
+        }
+    });
+    const double simdMs = GetMedianPassTime([&transforms, &simdMatrices]()
+    {
+        ComputeModelMatrices(transforms.Data(), TRANSFORM_BENCHMARK_OBJECTS, &simdMatrices[0].m_Matrix, sizeof(WorldTransform));
+    });
+    const double soaMs = GetMedianPassTime([&transformSystem, &soaMatrices]()
+    {
+        transformSystem.ComputeModelMatrices(&soaMatrices[0].m_Matrix, sizeof(WorldTransform), 0, TRANSFORM_BENCHMARK_OBJECTS);
+    });
+    const double glmMvpMs = GetMedianPassTime([&transforms, &glmMvp, &viewProjection]()
+    {
+        for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_OBJECTS; i++)
+        {
+            const Transform& transform = transforms[i];
+            glmMvp[i].m_Matrix = viewProjection * glm::scale(glm::translate(glm::mat4(1.0f), transform.m_Position) * glm::mat4_cast(transform.m_Rotation), transform.m_Scale);
+        }
+    });
+    const double mvpMs = GetMedianPassTime([&transformSystem, &simdMvp, &viewProjection]()
+    {
+        transformSystem.ComputeMVPMatrices(viewProjection, &simdMvp[0].m_Matrix, sizeof(WorldTransform), 0, TRANSFORM_BENCHMARK_OBJECTS);
+    });
+
+    // Largest difference, relative to the element where it exceeds 1: MVP
+    // translations run into the hundreds.
+    auto getMaxError = [](const TArray<WorldTransform>& expected, const TArray<WorldTransform>& actual)
+    {
+        float maxError = 0.0f;
+        for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_OBJECTS; i++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    const float value = expected[i].m_Matrix[column][row];
+                    maxError = std::max(maxError, fabsf(value - actual[i].m_Matrix[column][row]) / std::max(1.0f, fabsf(value)));
+                }
+            }
+        }
+        return maxError;
+    };
+
+    const float simdError = getMaxError(glmMatrices, simdMatrices);
+    const float soaError = getMaxError(glmMatrices, soaMatrices);
+    const float mvpError = getMaxError(glmMvp, simdMvp);
+
+    bool success = true;
+    if (simdError >= 1e-4f || soaError >= 1e-4f)
+    {
+        std::cout << "ERROR: SIMD matrices differ from glm's by up to " << std::max(simdError, soaError) << "." << std::endl;
+        success = false;
+    }
+    if (mvpError >= 1e-4f)
+    {
+        std::cout << "ERROR: SIMD MVP matrices differ from glm's by up to " << mvpError << "." << std::endl;
+        success = false;
+    }
+
+    std::cout << "Model matrices of " << TRANSFORM_BENCHMARK_OBJECTS << " transforms: glm " << glmMs << " ms, SIMD " << simdMs << " ms ("
+        << glmMs / simdMs << "x), SIMD from SoA " << soaMs << " ms (" << glmMs / soaMs << "x)." << std::endl;
+    std::cout << "MVP matrices: glm " << glmMvpMs << " ms, SIMD from SoA " << mvpMs << " ms (" << glmMvpMs / mvpMs << "x)." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "glm_ms", METRIC_INFO, glmMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "simd_ms", METRIC_TIME, simdMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "soa_ms", METRIC_TIME, soaMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "glm_mvp_ms", METRIC_INFO, glmMvpMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "mvp_ms", METRIC_TIME, mvpMs });
+    return success;
+}
+
+// Compresses the benchmark image to each format in s_CodecBounds, timed,
+// and decodes it back to check the error stays within the format's bound.
+static bool RunTextureCodecBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    const uint32_t size = BENCHMARK_TEXTURE_SIZE;
+    TArray<unsigned char> pixels, compressed, decoded;
+    CreateBenchmarkImage(0, size, pixels);
+    decoded.Resize(pixels.Size());
+
+    bool success = true;
+    for (const CodecBound& bound : s_CodecBounds)
+    {
+        compressed.Resize(GetTextureMipSize(bound.m_Format, size, size));
+        const double compressMs = GetMedianPassTime([&]()
+        {
+            CompressTexture(bound.m_Format, pixels.Data(), size, size, compressed.Data());
+        });
+
+        if (!DecompressTexture(bound.m_Format, compressed.Data(), size, size, decoded.Data()))
+        {
+            std::cout << "ERROR: " << GetTextureFormatName(bound.m_Format) << " has blocks the decoder doesn't know." << std::endl;
+            success = false;
+        }
+
+        double squares = 0.0;
+        int maxError = 0;
+        for (size_t i = 0; i < pixels.Size(); i++)
+        {
+            if (i % 4 < bound.m_NumChannels)
+            {
+                const int error = abs((int)decoded[i] - (int)pixels[i]);
+                squares += (double)error * error;
+                maxError = std::max(maxError, error);
+            }
+        }
+        const double rmse = sqrt(squares / ((double)size * size * bound.m_NumChannels));
+        if (rmse > bound.m_MaxRmse)
+        {
+            std::cout << "ERROR: " << GetTextureFormatName(bound.m_Format) << " round trip error " << rmse << ", at most " << bound.m_MaxRmse << " expected." << std::endl;
+            success = false;
+        }
+
+        std::cout << GetTextureFormatName(bound.m_Format) << " " << size << "x" << size << ": compressed in " << compressMs << " ms, error " << rmse
+            << " RMS, " << maxError << " at most." << std::endl;
+
+        metrics.PushBack(BenchmarkMetric{ pName, bound.m_pTimeMetric, METRIC_TIME, compressMs });
+    }
+    return success;
+}
+
+// Index section of a mesh file read back as 32-bit indices.
+static bool DecodeMeshIndices(const TArray<unsigned char>& data, uint32_t indexSize, TArray<uint32_t>& indices)
+{
+    if (data.Size() != indices.Size() * indexSize)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < indices.Size(); i++)
+    {
+        uint16_t shortIndex;
+        if (indexSize == sizeof(uint16_t))
+        {
+            memcpy(&shortIndex, &data[i * indexSize], sizeof(uint16_t));
+            indices[i] = shortIndex;
+        }
+        else
+        {
+            memcpy(&indices[i], &data[i * indexSize], sizeof(uint32_t));
+        }
+    }
+    return true;
+}
+
+static bool RunMeshOptimizerBenchmark(const char* pName, TArray<BenchmarkMetric>& metrics)
+{
+    const uint32_t grid = MESHOPT_BENCHMARK_GRID;
+    const uint32_t numTriangles = grid * grid * 2;
+    const uint32_t numGridVertices = (grid + 1) * (grid + 1);
+
+    // Three vertices of its own per triangle, as a file without an index
+    // buffer would load.
+    TArray<float> positions;
+    positions.Reserve((size_t)numTriangles * 9);
+    for (uint32_t y = 0; y < grid; y++)
+    {
+        for (uint32_t x = 0; x < grid; x++)
+        {
+            const uint32_t corners[6][2] = { { x, y }, { x + 1, y }, { x, y + 1 }, { x + 1, y }, { x + 1, y + 1 }, { x, y + 1 } };
+            for (const uint32_t* pCorner : corners)
+            {
+                positions.PushBack((float)pCorner[0]);
+                positions.PushBack((float)pCorner[1]);
+                positions.PushBack(0.0f);
+            }
+        }
+    }
+
+    const uint32_t numVertices = numTriangles * 3;
+    TArray<uint32_t> indices;
+    indices.Resize(numVertices);
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        indices[i] = i;
+    }
+
+    TArray<uint32_t> remap;
+    remap.Resize(numVertices);
+    const MeshStream stream{ positions.Data(), sizeof(float) * 3 };
+    uint32_t numUnique = 0;
+    const double remapMs = GetMedianPassTime([&]()
+    {
+        numUnique = GenerateVertexRemap(remap.Data(), indices.Data(), indices.Size(), numVertices, &stream, 1);
+    });
+
+    bool success = numUnique == numGridVertices;
+    if (!success)
+    {
+        std::cout << "ERROR: Deduping found " << numUnique << " vertices, the grid has " << numGridVertices << "." << std::endl;
+    }
+
+    TArray<float> uniquePositions;
+    uniquePositions.Resize((size_t)numUnique * 3);
+    RemapVertices(uniquePositions.Data(), positions.Data(), numVertices, sizeof(float) * 3, remap.Data());
+    RemapIndices(indices.Data(), indices.Data(), indices.Size(), remap.Data());
+
+    // Shuffled triangles, the worst order the optimizer should have to fix.
+    uint32_t random = 0x2545F491u;
+    for (uint32_t i = numTriangles - 1; i > 0; i--)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        const uint32_t j = random % (i + 1);
+        std::swap_ranges(&indices[i * 3], &indices[i * 3] + 3, &indices[j * 3]);
+    }
+
+    TArray<uint32_t> optimized, scratch;
+    optimized.Resize(indices.Size());
+    scratch.Resize(indices.Size());
+    const double optimizeMs = GetMedianPassTime([&]()
+    {
+        OptimizeVertexCache(scratch.Data(), indices.Data(), indices.Size(), numUnique);
+        OptimizeOverdraw(optimized.Data(), scratch.Data(), scratch.Size(), uniquePositions.Data(), sizeof(float) * 3, numUnique, 1.05f);
+    });
+
+    const VertexCacheStats before = AnalyzeVertexCache(indices.Data(), indices.Size(), numUnique);
+    const VertexCacheStats after = AnalyzeVertexCache(optimized.Data(), optimized.Size(), numUnique);
+    if (after.m_ACMR > before.m_ACMR)
+    {
+        std::cout << "ERROR: Optimizing raised the ACMR from " << before.m_ACMR << " to " << after.m_ACMR << "." << std::endl;
+        success = false;
+    }
+
+    // Under 65536 vertices the file gets 16-bit indices, from 65536 on
+    // 32-bit, and either way they read back the same.
+    TArray<unsigned char> indexData;
+    TArray<uint32_t> decoded;
+    decoded.Resize(optimized.Size());
+    const uint32_t indexSize = EncodeMeshIndices(optimized.Data(), optimized.Size(), numUnique, indexData);
+    if (indexSize != sizeof(uint16_t) || !DecodeMeshIndices(indexData, indexSize, decoded) ||
+        memcmp(decoded.Data(), optimized.Data(), sizeof(uint32_t) * decoded.Size()) != 0)
+    {
+        std::cout << "ERROR: " << numUnique << " vertices got " << indexSize * 8 << "-bit indices, or they don't read back." << std::endl;
+        success = false;
+    }
+
+    const uint32_t limitIndices[] = { 0, 0xFFFE, 0xFFFF };
+    if (EncodeMeshIndices(limitIndices, 2, 0xFFFF, indexData) != sizeof(uint16_t) ||
+        EncodeMeshIndices(limitIndices, 3, 0x10000, indexData) != sizeof(uint32_t))
+    {
+        std::cout << "ERROR: Wrong index size at the 16-bit limit." << std::endl;
+        success = false;
+    }
+
+    std::cout << "Mesh optimizer, " << numTriangles << " triangles: dedupe of " << numVertices << " vertices to " << numUnique << " " << remapMs
+        << " ms, vertex cache and overdraw " << optimizeMs << " ms, ACMR " << before.m_ACMR << " to " << after.m_ACMR << "." << std::endl;
+
+    metrics.PushBack(BenchmarkMetric{ pName, "remap_ms", METRIC_TIME, remapMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "optimize_ms", METRIC_TIME, optimizeMs });
+    metrics.PushBack(BenchmarkMetric{ pName, "acmr", METRIC_INFO, after.m_ACMR });
+    return success;
+}
+
+struct CpuBenchmark
+{
+    const char* m_pName;
+    bool (*m_pRun)(const char* pName, TArray<BenchmarkMetric>& metrics);
+};
+
+// Benchmarks that only need the CPU, they run even where the scenes can't
+// get a context.
+static const CpuBenchmark s_CpuBenchmarks[] = {
+    { "containers", &RunContainerBenchmark },
+    { "transforms", &RunTransformBenchmark },
+    { "ecs", &RunEcsBenchmark },
+    { "jobs", &RunJobsBenchmark },
+    { "culling", &RunCullingBenchmark },
+    { "meshopt", &RunMeshOptimizerBenchmark },
+    { "texcodec", &RunTextureCodecBenchmark },
+};
+
+static bool LoadBaseline(const std::string& path, TArray<BaselineValue>& baseline)
+{
+    std::ifstream file{ path };
+    if (!file)
+    {
+        std::cout << "ERROR: Reading baseline " << path << "." << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream{ line };
+        std::string scene, metric;
+        double value;
+        if (stream >> scene >> metric >> value)
+        {
+            baseline.PushBack(BaselineValue{ scene + " " + metric, value });
+        }
+    }
+    return true;
+}
+
+static bool SaveBaseline(const std::string& path, const TArray<BenchmarkMetric>& metrics)
+{
+    std::ofstream file{ path };
+    file << "# Insanity benchmark baseline: scene metric value" << std::endl;
+    file << std::fixed << std::setprecision(4);
+    for (const BenchmarkMetric& metric : metrics)
+    {
+        file << metric.m_Scene << " " << metric.m_pName << " " << metric.m_Value << std::endl;
+    }
+
+    if (!file)
+    {
+        std::cout << "ERROR: Writing baseline " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool IsRegression(const BenchmarkMetric& metric, double baseline, double tolerance)
+{
+    switch (metric.m_Kind)
+    {
+    case METRIC_TIME:
+        return metric.m_Value > baseline * (1.0 + tolerance) + TIME_SLACK_MS;
+    case METRIC_COUNT:
+        // Averages per frame, half a unit absorbs rounding.
+        return metric.m_Value > baseline + 0.5;
+    case METRIC_MEMORY:
+        return metric.m_Value > baseline * (1.0 + tolerance);
+    default:
+        return false;
+    }
+}
+
+// Regressions found, every one of them reported.
+static uint32_t CompareWithBaseline(const TArray<BenchmarkMetric>& metrics, const TArray<BaselineValue>& baseline, double tolerance)
+{
+    uint32_t regressions = 0;
+    for (const BenchmarkMetric& metric : metrics)
+    {
+        const std::string key = metric.m_Scene + " " + metric.m_pName;
+        const BaselineValue* pBaseline = nullptr;
+        for (const BaselineValue& value : baseline)
+        {
+            if (value.m_Key == key)
+            {
+                pBaseline = &value;
+                break;
+            }
+        }
+
+        if (!pBaseline)
+        {
+            if (metric.m_Kind != METRIC_INFO)
+            {
+                std::cout << "WARNING: No baseline for " << key << "." << std::endl;
+            }
+            continue;
+        }
+
+        if (IsRegression(metric, pBaseline->m_Value, tolerance))
+        {
+            const double change = pBaseline->m_Value > 0.0 ? (metric.m_Value / pBaseline->m_Value - 1.0) * 100.0 : 100.0;
+            std::cout << "ERROR: " << key << " regressed: " << metric.m_Value << " against " << pBaseline->m_Value << " (+" << change << "%)." << std::endl;
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+int RunBenchmarks(const BenchmarkOptions& options)
+{
+    TArray<BaselineValue> baseline;
+    if (!options.m_BaselinePath.empty() && !LoadBaseline(options.m_BaselinePath, baseline))
+    {
+        return EXIT_FAILURE;
+    }
+
+    TArray<BenchmarkMetric> metrics;
+    bool success = true;
+    for (const BenchmarkScene& scene : s_Scenes)
+    {
+        if (!options.m_Filter.empty() && std::string{ scene.m_pName }.find(options.m_Filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        ApplicationConfig config;
+        config.m_Offscreen = true;
+        config.m_ContextApi = options.m_ContextApi;
+        config.m_MaxFrames = options.m_WarmupFrames + options.m_Frames;
+        config.m_WarmupFrames = options.m_WarmupFrames;
+        config.m_NumObjects = scene.m_NumObjects;
+        config.m_NumMeshes = scene.m_NumMeshes;
+        config.m_PooledMeshes = scene.m_PooledMeshes;
+        config.m_LodScene = scene.m_LodScene;
+        config.m_StreamKB = scene.m_StreamKB;
+        config.m_ShareResources = scene.m_ShareResources;
+        config.m_Instancing = scene.m_Instancing;
+        config.m_ClearShaderCache = scene.m_ShaderStartup == SHADERS_COLD || scene.m_ShaderStartup == SHADERS_ALL;
+        config.m_AllShaderVariants = scene.m_ShaderStartup == SHADERS_ALL;
+
+        // Nothing spins, since moving objects recompute every world
+        // transform each step and the scenes would stop measuring what they
+        // did. Frames stay uncapped, and offscreen ones are never presented
+        // so vsync doesn't apply.
+        config.m_SpinningObjects = 0;
+
+        std::cout << "Benchmark " << scene.m_pName << ":" << std::endl;
+
+        if (scene.m_NumTextures)
+        {
+            config.m_TextureBudgetMB = BENCHMARK_TEXTURE_BUDGET_MB;
+            config.m_TexturesPerFrame = BENCHMARK_TEXTURES_PER_FRAME;
+            if (!CreateBenchmarkTextures(scene.m_NumTextures, config.m_TextureFiles))
+            {
+                success = false;
+                continue;
+            }
+        }
+
+        // A new application per scene, so none inherits another's state.
+        std::unique_ptr<GameApplication> pApplication{ new GameApplication() };
+        const int result = pApplication->Run(config);
+        for (const std::string& textureFile : config.m_TextureFiles)
+        {
+            remove(textureFile.c_str());
+        }
+
+        if (result != EXIT_SUCCESS)
+        {
+            std::cout << "ERROR: Benchmark " << scene.m_pName << " failed (" << result << ")." << std::endl;
+            success = false;
+            continue;
+        }
+
+        const FrameStatistics& statistics = pApplication->GetFrameStatistics();
+        AddSceneMetrics(scene.m_pName, statistics, metrics);
+
+        // The budget is smaller than the textures and the ones in use move
+        // on every frame, so mips have to be dropped and brought back.
+        if (scene.m_NumTextures && (!statistics.m_TextureAccountingValid || !statistics.m_EvictedMips || !statistics.m_RestoredMips))
+        {
+            std::cout << "ERROR: Benchmark " << scene.m_pName << " texture budget: " << statistics.m_EvictedMips << " mips dropped, "
+                << statistics.m_RestoredMips << " brought back" << (statistics.m_TextureAccountingValid ? "." : ", accounting drifted.") << std::endl;
+            success = false;
+        }
+        if (scene.m_ShaderStartup != SHADERS_UNTIMED)
+        {
+            metrics.PushBack(BenchmarkMetric{ scene.m_pName, "shader_ms", METRIC_TIME, statistics.m_ShaderMs });
+            metrics.PushBack(BenchmarkMetric{ scene.m_pName, "shader_variants", METRIC_COUNT, (double)statistics.m_ShaderVariants });
+        }
+    }
+
+    for (const CpuBenchmark& benchmark : s_CpuBenchmarks)
+    {
+        if (options.m_Filter.empty() || std::string{ benchmark.m_pName }.find(options.m_Filter) != std::string::npos)
+        {
+            std::cout << "Benchmark " << benchmark.m_pName << ":" << std::endl;
+            if (!benchmark.m_pRun(benchmark.m_pName, metrics))
+            {
+                std::cout << "ERROR: Benchmark " << benchmark.m_pName << " failed." << std::endl;
+                success = false;
+            }
+        }
+    }
+
+    std::cout << std::endl << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < metrics.Size(); i++)
+    {
+        if (i == 0 || metrics[i].m_Scene != metrics[i - 1].m_Scene)
+        {
+            std::cout << (i ? "\n" : "") << std::left << std::setw(12) << metrics[i].m_Scene << std::right;
+        }
+        std::cout << "  " << metrics[i].m_pName << " " << metrics[i].m_Value;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6) << std::endl << std::endl;
+
+    if (!options.m_SavePath.empty() && success)
+    {
+        success = SaveBaseline(options.m_SavePath, metrics);
+        if (success)
+        {
+            std::cout << "Baseline written to " << options.m_SavePath << "." << std::endl;
+        }
+    }
+
+    if (!options.m_BaselinePath.empty())
+    {
+        const uint32_t regressions = CompareWithBaseline(metrics, baseline, options.m_Tolerance);
+        std::cout << regressions << " regressions against " << options.m_BaselinePath << " (tolerance " << options.m_Tolerance * 100.0 << "%)." << std::endl;
+        success &= regressions == 0;
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+size_t GetResidentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    // Second field of statm: resident pages.
+    std::ifstream file{ "/proc/self/statm" };
+    size_t totalPages = 0, residentPages = 0;
+    if (file >> totalPages >> residentPages)
+    {
+        return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,76 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "GameApplication.h"
+
+// Regression benchmark. Runs a fixed set of scenes offscreen, one after the
+// other, for a set number of frames each, and reports frame time
+// percentiles, draw calls, triangles and memory. With a baseline file the
+// results are checked against it and any regression fails the run, so it
+// can gate CI.
+//
+// Baselines are plain text, one "scene metric value" per line, as written
+// by m_SavePath. Scenes share the process and run in a fixed order, so
+// memory only compares between runs with the same filter.
+//
+// Mesh loading is measured by the cooker instead, as it cooks a mesh
+// (InsanityCooker --bench <input> <output.imesh>): it times Assimp import
+// against mapping the cooked file, cold after dropping both from the page
+// cache and then warm.
+struct BenchmarkOptions
+{
+	uint64_t m_Frames = 300;
+	uint64_t m_WarmupFrames = 30;
+	ContextApi m_ContextApi = CONTEXT_API_NATIVE;
+
+	// Only scenes whose name contains this, empty runs all of them.
+	std::string m_Filter;
+
+	std::string m_BaselinePath;
+	std::string m_SavePath;
+
+	// How much worse than the baseline timings and memory may get, as a
+	// fraction. Counts (draw calls, triangles) must not grow at all.
+	double m_Tolerance = 0.1;
+};
+
+// EXIT_FAILURE when a scene couldn't run or regressed.
+int RunBenchmarks(const BenchmarkOptions& options);
+
+// Resident memory of the process in bytes, 0 where unknown.
+size_t GetResidentMemory();
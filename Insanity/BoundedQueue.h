@@ -0,0 +1,128 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Multi producer, multi consumer FIFO with a fixed capacity. Producers can
+// either block until there is room (Push) or give up (TryPush).
+template<typename T>
+class TBoundedQueue
+{
+public:
+	explicit TBoundedQueue(size_t capacity):
+		m_Capacity{capacity},
+		m_Closed{false}
+	{
+	}
+
+	// Returns false once the queue is closed.
+	bool Push(T&& value)
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_NotFull.wait(lock, [this] { return m_Closed || m_Items.size() < m_Capacity; });
+		if (m_Closed)
+		{
+			return false;
+		}
+
+		m_Items.push_back(std::move(value));
+		m_NotEmpty.notify_one();
+		return true;
+	}
+
+	bool TryPush(T&& value)
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (m_Closed || m_Items.size() >= m_Capacity)
+		{
+			return false;
+		}
+
+		m_Items.push_back(std::move(value));
+		m_NotEmpty.notify_one();
+		return true;
+	}
+
+	// Blocks until there is an item. Returns false once the queue is closed
+	// and empty.
+	bool Pop(T& value)
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_NotEmpty.wait(lock, [this] { return m_Closed || !m_Items.empty(); });
+		if (m_Items.empty())
+		{
+			return false;
+		}
+
+		value = std::move(m_Items.front());
+		m_Items.pop_front();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	bool TryPop(T& value)
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (m_Items.empty())
+		{
+			return false;
+		}
+
+		value = std::move(m_Items.front());
+		m_Items.pop_front();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Closed = true;
+		m_NotEmpty.notify_all();
+		m_NotFull.notify_all();
+	}
+
+private:
+	std::deque<T> m_Items;
+	size_t m_Capacity;
+	bool m_Closed;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NotEmpty;
+	std::condition_variable m_NotFull;
+};
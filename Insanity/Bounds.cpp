@@ -0,0 +1,168 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Bounds.h"
+
+#include <math.h>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INSANITY_BOUNDS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+AABB AABB::FromPoints(const float* pPositions, unsigned int numPoints, unsigned int strideFloats)
+{
+    AABB box{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (unsigned int i = 0; i < numPoints; i++, pPositions += strideFloats)
+    {
+        const glm::vec3 point{ pPositions[0], pPositions[1], pPositions[2] };
+        box.m_Min = glm::min(box.m_Min, point);
+        box.m_Max = glm::max(box.m_Max, point);
+    }
+    return box;
+}
+
+void AABB::Merge(const AABB& other)
+{
+    m_Min = glm::min(m_Min, other.m_Min);
+    m_Max = glm::max(m_Max, other.m_Max);
+}
+
+AABB AABB::Transform(const glm::mat4& matrix) const
+{
+    // Arvo: the new extent is the old one through the absolute matrix.
+    const glm::vec3 center = GetCenter();
+    const glm::vec3 extent = GetExtent();
+
+    glm::vec3 newCenter{ matrix[3][0], matrix[3][1], matrix[3][2] };
+    glm::vec3 newExtent{ 0.0f };
+    for (int column = 0; column < 3; column++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            newCenter[row] += matrix[column][row] * center[column];
+            newExtent[row] += fabsf(matrix[column][row]) * extent[column];
+        }
+    }
+
+    return AABB{ newCenter - newExtent, newCenter + newExtent };
+}
+
+Frustum::Frustum()
+{
+    for (int i = 0; i < 8; i++)
+    {
+        m_NormalX[i] = m_NormalY[i] = m_NormalZ[i] = 0.0f;
+        m_Distance[i] = 1.0f;
+    }
+}
+
+void Frustum::Extract(const glm::mat4& viewProjection)
+{
+    // Rows of the matrix (glm is column-major).
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    const glm::vec4 planes[6] = {
+        row[3] + row[0], // Left
+        row[3] - row[0], // Right
+        row[3] + row[1], // Bottom
+        row[3] - row[1], // Top
+        row[3] + row[2], // Near
+        row[3] - row[2], // Far
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        const float length = sqrtf(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+        m_NormalX[i] = planes[i].x * invLength;
+        m_NormalY[i] = planes[i].y * invLength;
+        m_NormalZ[i] = planes[i].z * invLength;
+        m_Distance[i] = planes[i].w * invLength;
+    }
+}
+
+CullResult Frustum::Test(const AABB& box) const
+{
+    const glm::vec3 center = box.GetCenter();
+    const glm::vec3 extent = box.GetExtent();
+
+#if defined(INSANITY_BOUNDS_SSE)
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+
+    int outside = 0;
+    int intersects = 0;
+    for (int i = 0; i < 8; i += 4)
+    {
+        const __m128 nx = _mm_load_ps(m_NormalX + i);
+        const __m128 ny = _mm_load_ps(m_NormalY + i);
+        const __m128 nz = _mm_load_ps(m_NormalZ + i);
+
+        // Signed distance of the center and projected radius of the box.
+        __m128 distance = _mm_add_ps(_mm_mul_ps(nx, cx), _mm_load_ps(m_Distance + i));
+        distance = _mm_add_ps(distance, _mm_mul_ps(ny, cy));
+        distance = _mm_add_ps(distance, _mm_mul_ps(nz, cz));
+
+        __m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, nx), ex);
+        radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey));
+        radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        intersects |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps()));
+    }
+#else
+    int outside = 0;
+    int intersects = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        const float distance = m_NormalX[i] * center.x + m_NormalY[i] * center.y + m_NormalZ[i] * center.z + m_Distance[i];
+        const float radius = fabsf(m_NormalX[i]) * extent.x + fabsf(m_NormalY[i]) * extent.y + fabsf(m_NormalZ[i]) * extent.z;
+
+        outside |= distance + radius < 0.0f;
+        intersects |= distance - radius < 0.0f;
+    }
+#endif
+
+    if (outside)
+    {
+        return CULL_OUTSIDE;
+    }
+
+    return intersects ? CULL_INTERSECTS : CULL_INSIDE;
+}
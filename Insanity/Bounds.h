@@ -0,0 +1,85 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct AABB
+{
+	glm::vec3 m_Min;
+	glm::vec3 m_Max;
+
+	static AABB FromPoints(const float* pPositions, unsigned int numPoints, unsigned int strideFloats = 3);
+
+	glm::vec3 GetCenter() const { return (m_Min + m_Max) * 0.5f; }
+	glm::vec3 GetExtent() const { return (m_Max - m_Min) * 0.5f; }
+
+	float GetSurfaceArea() const
+	{
+		const glm::vec3 size = m_Max - m_Min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	void Merge(const AABB& other);
+
+	// Bounds of this box once transformed by matrix (still axis aligned).
+	AABB Transform(const glm::mat4& matrix) const;
+};
+
+enum CullResult
+{
+	CULL_OUTSIDE,
+	CULL_INTERSECTS,
+	CULL_INSIDE,
+};
+
+// Six clip planes, stored as structure of arrays (padded to eight with
+// planes that always pass) so a box is tested against four planes per
+// SSE instruction.
+class Frustum
+{
+public:
+	Frustum();
+
+	// Planes of the clip volume of viewProjection (Gribb/Hartmann).
+	void Extract(const glm::mat4& viewProjection);
+
+	CullResult Test(const AABB& box) const;
+	bool IsVisible(const AABB& box) const { return Test(box) != CULL_OUTSIDE; }
+
+private:
+	alignas(16) float m_NormalX[8];
+	alignas(16) float m_NormalY[8];
+	alignas(16) float m_NormalZ[8];
+	alignas(16) float m_Distance[8];
+};
@@ -0,0 +1,199 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Bvh.h"
+
+#include <float.h>
+#include <algorithm>
+#include <utility>
+
+void Bvh::Build(const AABB* pBounds, uint32_t numObjects)
+{
+    m_Nodes.Clear();
+    m_ObjectBounds.Clear();
+    m_ObjectOrder.Clear();
+    m_ObjectLeaf.Clear();
+    m_DirtyLeaves.Clear();
+
+    m_ObjectBounds.Reserve(numObjects);
+    m_ObjectOrder.Reserve(numObjects);
+    for (uint32_t i = 0; i < numObjects; i++)
+    {
+        m_ObjectBounds.PushBack(pBounds[i]);
+        m_ObjectOrder.PushBack(i);
+    }
+    m_ObjectLeaf.Resize(numObjects);
+
+    if (numObjects)
+    {
+        m_Nodes.Reserve(2 * (numObjects / MAX_LEAF_OBJECTS + 1));
+        BuildNode(0, 0, numObjects);
+    }
+
+    m_Cost = 0.0;
+    for (const Node& node : m_Nodes)
+    {
+        m_Cost += node.m_Bounds.GetSurfaceArea();
+    }
+    m_BuildCost = m_Cost;
+}
+
+uint32_t Bvh::BuildNode(uint32_t parent, uint32_t first, uint32_t count)
+{
+    const uint32_t nodeIndex = (uint32_t)m_Nodes.Size();
+    m_Nodes.PushBack(Node{ AABB{}, first, count, parent, 0, false });
+    FitNode(m_Nodes[nodeIndex]);
+
+    if (count <= MAX_LEAF_OBJECTS)
+    {
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            m_ObjectLeaf[m_ObjectOrder[i]] = nodeIndex;
+        }
+        return nodeIndex;
+    }
+
+    // Split at the median of the centers along the longest axis of the
+    // center bounds. Median splits keep the tree balanced, so the
+    // traversal stack is never deeper than log2 of the object count.
+    AABB centerBounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const glm::vec3 center = m_ObjectBounds[m_ObjectOrder[i]].GetCenter();
+        centerBounds.Merge(AABB{ center, center });
+    }
+
+    const glm::vec3 size = centerBounds.m_Max - centerBounds.m_Min;
+    int axis = 0;
+    if (size.y > size[axis])
+    {
+        axis = 1;
+    }
+    if (size.z > size[axis])
+    {
+        axis = 2;
+    }
+
+    const uint32_t half = count / 2;
+    uint32_t* pOrder = m_ObjectOrder.Data();
+    std::nth_element(pOrder + first, pOrder + first + half, pOrder + first + count, [this, axis](uint32_t a, uint32_t b)
+    {
+        return m_ObjectBounds[a].m_Min[axis] + m_ObjectBounds[a].m_Max[axis] < m_ObjectBounds[b].m_Min[axis] + m_ObjectBounds[b].m_Max[axis];
+    });
+
+    BuildNode(nodeIndex, first, half);
+    const uint32_t rightChild = BuildNode(nodeIndex, first + half, count - half);
+    m_Nodes[nodeIndex].m_RightChild = rightChild;
+
+    return nodeIndex;
+}
+
+void Bvh::FitNode(Node& node)
+{
+    node.m_Bounds = m_ObjectBounds[m_ObjectOrder[node.m_FirstObject]];
+    for (uint32_t i = 1; i < node.m_NumObjects; i++)
+    {
+        node.m_Bounds.Merge(m_ObjectBounds[m_ObjectOrder[node.m_FirstObject + i]]);
+    }
+}
+
+void Bvh::UpdateObject(uint32_t object, const AABB& bounds)
+{
+    m_ObjectBounds[object] = bounds;
+
+    const uint32_t leaf = m_ObjectLeaf[object];
+    if (!m_Nodes[leaf].m_Dirty)
+    {
+        m_Nodes[leaf].m_Dirty = true;
+        m_DirtyLeaves.PushBack(leaf);
+    }
+}
+
+void Bvh::Refit()
+{
+    if (m_DirtyLeaves.IsEmpty())
+    {
+        return;
+    }
+
+    // Flag every ancestor of a moved object...
+    uint32_t firstDirty = (uint32_t)m_Nodes.Size();
+    for (uint32_t leaf : m_DirtyLeaves)
+    {
+        firstDirty = std::min(firstDirty, leaf);
+
+        uint32_t node = leaf;
+        while (node != 0)
+        {
+            node = m_Nodes[node].m_Parent;
+            if (m_Nodes[node].m_Dirty)
+            {
+                break;
+            }
+            m_Nodes[node].m_Dirty = true;
+            firstDirty = std::min(firstDirty, node);
+        }
+    }
+    m_DirtyLeaves.Clear();
+
+    // ...and fix them children first: in depth first order that is simply
+    // walking the nodes backwards.
+    for (uint32_t i = (uint32_t)m_Nodes.Size(); i-- > firstDirty; )
+    {
+        Node& node = m_Nodes[i];
+        if (!node.m_Dirty)
+        {
+            continue;
+        }
+
+        m_Cost -= node.m_Bounds.GetSurfaceArea();
+        if (node.m_RightChild == 0)
+        {
+            FitNode(node);
+        }
+        else
+        {
+            node.m_Bounds = m_Nodes[i + 1].m_Bounds;
+            node.m_Bounds.Merge(m_Nodes[node.m_RightChild].m_Bounds);
+        }
+        m_Cost += node.m_Bounds.GetSurfaceArea();
+        node.m_Dirty = false;
+    }
+
+    if (m_Cost > m_BuildCost * REBUILD_COST_GROWTH)
+    {
+        // Build reads the bounds while it refills m_ObjectBounds.
+        const TArray<AABB> bounds{ std::move(m_ObjectBounds) };
+        Build(bounds.Data(), (uint32_t)bounds.Size());
+        m_NumRebuilds++;
+    }
+}
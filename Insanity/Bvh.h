@@ -0,0 +1,145 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Bounds.h"
+#include "TArray.h"
+
+// Bounding volume hierarchy over the world bounds of the scene objects.
+// Nodes are stored depth first, so every node covers a contiguous range of
+// m_ObjectOrder and a parent always comes before its children.
+class Bvh
+{
+public:
+	static const uint32_t MAX_LEAF_OBJECTS = 4;
+
+	// Refit keeps the tree shape, so as objects move apart the nodes grow
+	// and overlap. Once the summed surface area of the nodes, which is what
+	// culling pays for, exceeds the one of the last Build by this factor,
+	// Refit builds the tree again.
+	static constexpr double REBUILD_COST_GROWTH = 1.5;
+
+	void Build(const AABB* pBounds, uint32_t numObjects);
+
+	// Moves an object. The tree is fixed up on the next Refit, which only
+	// walks the nodes above objects that changed.
+	void UpdateObject(uint32_t object, const AABB& bounds);
+	void Refit();
+
+	uint32_t GetNumRebuilds() const { return m_NumRebuilds; }
+
+	// Appends the objects that intersect the frustum.
+	template<typename Allocator>
+	void Cull(const Frustum& frustum, TArray<uint32_t, Allocator>& visible) const;
+
+	uint32_t GetNumObjects() const { return (uint32_t)m_ObjectBounds.Size(); }
+
+private:
+	struct Node
+	{
+		AABB m_Bounds;
+		uint32_t m_FirstObject;
+		uint32_t m_NumObjects;
+		uint32_t m_Parent;
+		// 0 for leaves, the left child is always the next node.
+		uint32_t m_RightChild;
+		bool m_Dirty;
+	};
+
+	TArray<Node> m_Nodes;
+	TArray<AABB> m_ObjectBounds;
+	TArray<uint32_t> m_ObjectOrder;
+	TArray<uint32_t> m_ObjectLeaf;
+	TArray<uint32_t> m_DirtyLeaves;
+
+	// Summed surface area of the nodes, after the last Build and now.
+	double m_BuildCost = 0.0;
+	double m_Cost = 0.0;
+	uint32_t m_NumRebuilds = 0;
+
+	uint32_t BuildNode(uint32_t parent, uint32_t first, uint32_t count);
+	void FitNode(Node& node);
+};
+
+template<typename Allocator>
+void Bvh::Cull(const Frustum& frustum, TArray<uint32_t, Allocator>& visible) const
+{
+	if (m_Nodes.IsEmpty())
+	{
+		return;
+	}
+
+	uint32_t stack[64];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = m_Nodes[stack[--stackSize]];
+
+		const CullResult result = frustum.Test(node.m_Bounds);
+		if (result == CULL_OUTSIDE)
+		{
+			continue;
+		}
+
+		if (result == CULL_INSIDE)
+		{
+			// The whole subtree is visible, no need to test it.
+			for (uint32_t i = 0; i < node.m_NumObjects; i++)
+			{
+				visible.PushBack(m_ObjectOrder[node.m_FirstObject + i]);
+			}
+			continue;
+		}
+
+		if (node.m_RightChild == 0)
+		{
+			for (uint32_t i = 0; i < node.m_NumObjects; i++)
+			{
+				const uint32_t object = m_ObjectOrder[node.m_FirstObject + i];
+				if (frustum.IsVisible(m_ObjectBounds[object]))
+				{
+					visible.PushBack(object);
+				}
+			}
+			continue;
+		}
+
+		const uint32_t nodeIndex = (uint32_t)(&node - m_Nodes.Data());
+		stack[stackSize++] = node.m_RightChild;
+		stack[stackSize++] = nodeIndex + 1;
+	}
+}
@@ -0,0 +1,688 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// InsanityCooker: converts meshes that Assimp can import into .imesh files
+// (see MeshFormat.h) that the engine maps instead of parsing, and images
+// that stb_image can read into .itex files (see TextureFormat.h).
+//
+//   InsanityCooker [options] <input> <output.imesh>
+//   InsanityCooker [--texture-format F] <input> <output.itex>
+//
+// --bench times loading the source through Assimp against mapping the
+// cooked file, with a cold page cache and warm.
+//
+// Vertex attributes are stored in the smallest format within tolerance
+// (see VertexQuantization.h):
+//   --no-quantize          keep every attribute as floats
+//   --position-error F     fraction of the bounds diagonal
+//   --normal-error DEG     normals and tangents, in degrees
+//   --uv-error F           texture coordinates
+//   --split                positions in their own stream
+//
+// Then duplicate vertices are merged and triangles and vertices reordered
+// for the vertex cache, overdraw and vertex fetch (see MeshOptimizer.h),
+// reporting ACMR and fetch overhead before and after; --no-optimize skips
+// it. Meshes with fewer than 65536 vertices get 16-bit indices.
+//
+// The optimizer also makes the LODs, by simplifying the deduplicated mesh
+// to half the triangles of the previous LOD each time (see SimplifyMesh).
+// They are stored as index ranges over the same vertices:
+//   --lods N               up to N levels counting the full mesh, default 4,
+//                          1 for none
+//   --lod-error F          stop when the error passes this fraction of the
+//                          bounds diagonal, default 0.1
+//
+// Textures get their whole mip chain, box filtered, and every level block
+// compressed (see TextureEncoder.h):
+//   --texture-format F     bc1, bc3, bc7 or rgba8 to leave it uncompressed;
+//                          by default bc1 for opaque images, bc3 otherwise
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshFormat.h"
+#include "MeshOptimizer.h"
+#include "TArray.h"
+#include "TextureEncoder.h"
+#include "VertexAttributes.h"
+#include "VertexLayout.h"
+#include "VertexQuantization.h"
+
+static const int BENCH_WARM_RUNS = 10;
+
+// How much worse the vertex cache may get to let OptimizeOverdraw make
+// smaller clusters.
+static const float OVERDRAW_THRESHOLD = 1.05f;
+
+struct CookedMesh
+{
+	TArray<float> m_Positions;
+
+	// Empty when the source doesn't have them.
+	TArray<float> m_Normals;
+	TArray<float> m_Tangents;
+	TArray<float> m_TexCoords;
+	TArray<float> m_Colors;
+
+	TArray<uint32_t> m_Indices;
+	AABB m_Bounds;
+};
+
+// The mesh as it goes in the file. m_Positions is a float copy of the
+// positions that follows every vertex remap, for the optimizer. m_Indices
+// holds the ranges of every LOD in m_Lods.
+struct EncodedMesh
+{
+	VertexLayout m_Layout;
+	uint32_t m_NumVertices;
+	TArray<unsigned char> m_VertexData;
+	TArray<float> m_Positions;
+	TArray<uint32_t> m_Indices;
+	MeshLodChain m_Lods;
+};
+
+struct CookOptions
+{
+	VertexQuantization m_Quantization;
+	VertexStreamMode m_StreamMode = VERTEX_INTERLEAVED;
+	bool m_Optimize = true;
+	uint32_t m_NumLods = 4;
+	float m_LodError = 0.1f;
+
+	// Unless m_AutoTextureFormat, which picks by alpha.
+	bool m_AutoTextureFormat = true;
+	TextureFormat m_TextureFormat = TEXTURE_BC1;
+};
+
+// Same import the runtime did through AssetManager, so cooked and uncooked
+// meshes look the same once loaded.
+static bool ImportMesh(const std::string& path, CookedMesh& mesh)
+{
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices);
+    if (!pScene || !pScene->mNumMeshes)
+    {
+        std::cout << "ERROR: Importing " << path << ": " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    // An attribute is only kept if every sub-mesh has it.
+    bool hasNormals = true, hasTangents = true, hasTexCoords = true, hasColors = true;
+    for (unsigned int meshIndex = 0; meshIndex < pScene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[meshIndex];
+        hasNormals = hasNormals && pMesh->HasNormals();
+        hasTangents = hasTangents && pMesh->HasTangentsAndBitangents() && pMesh->HasNormals();
+        hasTexCoords = hasTexCoords && pMesh->HasTextureCoords(0);
+        hasColors = hasColors && pMesh->HasVertexColors(0);
+    }
+
+    mesh = CookedMesh{};
+    for (unsigned int meshIndex = 0; meshIndex < pScene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[meshIndex];
+        const uint32_t baseVertex = (uint32_t)(mesh.m_Positions.Size() / 3);
+
+        for (unsigned int i = 0; i < pMesh->mNumVertices; i++)
+        {
+            const aiVector3D& position = pMesh->mVertices[i];
+            mesh.m_Positions.PushBack(position.x);
+            mesh.m_Positions.PushBack(position.y);
+            mesh.m_Positions.PushBack(position.z);
+
+            if (hasNormals)
+            {
+                const aiVector3D& normal = pMesh->mNormals[i];
+                mesh.m_Normals.PushBack(normal.x);
+                mesh.m_Normals.PushBack(normal.y);
+                mesh.m_Normals.PushBack(normal.z);
+            }
+
+            if (hasTangents)
+            {
+                // Only the handedness of the bitangent is kept.
+                const aiVector3D& tangent = pMesh->mTangents[i];
+                const aiVector3D cross = pMesh->mNormals[i] ^ tangent;
+                mesh.m_Tangents.PushBack(tangent.x);
+                mesh.m_Tangents.PushBack(tangent.y);
+                mesh.m_Tangents.PushBack(tangent.z);
+                mesh.m_Tangents.PushBack(cross * pMesh->mBitangents[i] < 0.0f ? -1.0f : 1.0f);
+            }
+
+            if (hasTexCoords)
+            {
+                mesh.m_TexCoords.PushBack(pMesh->mTextureCoords[0][i].x);
+                mesh.m_TexCoords.PushBack(pMesh->mTextureCoords[0][i].y);
+            }
+
+            if (hasColors)
+            {
+                const aiColor4D& color = pMesh->mColors[0][i];
+                mesh.m_Colors.PushBack(color.r);
+                mesh.m_Colors.PushBack(color.g);
+                mesh.m_Colors.PushBack(color.b);
+                mesh.m_Colors.PushBack(color.a);
+            }
+        }
+
+        for (unsigned int i = 0; i < pMesh->mNumFaces; i++)
+        {
+            const aiFace& face = pMesh->mFaces[i];
+            if (face.mNumIndices == 3)
+            {
+                mesh.m_Indices.PushBack(baseVertex + face.mIndices[0]);
+                mesh.m_Indices.PushBack(baseVertex + face.mIndices[1]);
+                mesh.m_Indices.PushBack(baseVertex + face.mIndices[2]);
+            }
+        }
+    }
+
+    mesh.m_Bounds = AABB::FromPoints(mesh.m_Positions.Data(), (unsigned int)(mesh.m_Positions.Size() / 3));
+    return true;
+}
+
+static void WritePadding(std::ofstream& file, uint64_t& offset)
+{
+    static const char zeros[MESH_FILE_ALIGNMENT] = {};
+    const uint64_t aligned = AlignMeshFileOffset(offset);
+    file.write(zeros, (std::streamsize)(aligned - offset));
+    offset = aligned;
+}
+
+static VertexSource GetVertexSource(const CookedMesh& mesh)
+{
+    VertexSource source;
+    source.m_pPositions = mesh.m_Positions.Data();
+    source.m_pNormals = mesh.m_Normals.IsEmpty() ? nullptr : mesh.m_Normals.Data();
+    source.m_pTangents = mesh.m_Tangents.IsEmpty() ? nullptr : mesh.m_Tangents.Data();
+    source.m_pTexCoords = mesh.m_TexCoords.IsEmpty() ? nullptr : mesh.m_TexCoords.Data();
+    source.m_pColors = mesh.m_Colors.IsEmpty() ? nullptr : mesh.m_Colors.Data();
+    source.m_NumVertices = (uint32_t)(mesh.m_Positions.Size() / 3);
+    return source;
+}
+
+static void PrintLayout(const VertexLayout& layout, const VertexLayout& floatLayout)
+{
+    static const char* s_Names[] = { "position", "", "", "", "", "normal", "texcoord", "tangent", "color" };
+
+    std::cout << "Layout:";
+    for (uint32_t i = 0; i < layout.m_NumElements; i++)
+    {
+        const VertexElement& element = layout.m_Elements[i];
+        std::cout << " " << s_Names[element.m_Attribute] << "=" << GetVertexFormatInfo((VertexFormat)element.m_Format).m_pName;
+    }
+    std::cout << ", " << layout.GetVertexSize() << " bytes per vertex (" << floatLayout.GetVertexSize() << " as floats)." << std::endl;
+}
+
+static void EncodeMesh(const CookedMesh& mesh, const CookOptions& options, EncodedMesh& encoded)
+{
+    const VertexSource source = GetVertexSource(mesh);
+
+    VertexQuantization lossless;
+    lossless.m_Enabled = false;
+    encoded.m_Layout = ChooseVertexLayout(source, options.m_Quantization, options.m_StreamMode);
+    PrintLayout(encoded.m_Layout, ChooseVertexLayout(source, lossless, options.m_StreamMode));
+
+    encoded.m_NumVertices = source.m_NumVertices;
+    encoded.m_VertexData.Resize((size_t)encoded.m_Layout.GetBufferSize(source.m_NumVertices));
+    EncodeVertices(source, encoded.m_Layout, encoded.m_VertexData.Data());
+    encoded.m_Positions = mesh.m_Positions;
+    encoded.m_Indices = mesh.m_Indices;
+    encoded.m_Lods.m_NumLods = 1;
+    encoded.m_Lods.m_Lods[0] = MeshLod{ 0, (uint32_t)mesh.m_Indices.Size(), 0.0f };
+}
+
+// Moves every vertex to pRemap[vertex] and drops the unused ones.
+static void RemapMesh(EncodedMesh& mesh, const uint32_t* pRemap, uint32_t numVertices)
+{
+    const VertexLayout& layout = mesh.m_Layout;
+
+    TArray<unsigned char> vertexData;
+    vertexData.Resize((size_t)layout.GetBufferSize(numVertices));
+    for (uint32_t stream = 0; stream < layout.m_NumStreams; stream++)
+    {
+        RemapVertices(vertexData.Data() + layout.GetStreamOffset(stream, numVertices),
+            mesh.m_VertexData.Data() + layout.GetStreamOffset(stream, mesh.m_NumVertices), mesh.m_NumVertices, layout.m_Strides[stream], pRemap);
+    }
+
+    TArray<float> positions;
+    positions.Resize((size_t)numVertices * 3);
+    RemapVertices(positions.Data(), mesh.m_Positions.Data(), mesh.m_NumVertices, sizeof(float) * 3, pRemap);
+
+    RemapIndices(mesh.m_Indices.Data(), mesh.m_Indices.Data(), mesh.m_Indices.Size(), pRemap);
+    mesh.m_VertexData = std::move(vertexData);
+    mesh.m_Positions = std::move(positions);
+    mesh.m_NumVertices = numVertices;
+}
+
+// Stats of the full detail mesh, LOD 0.
+static void PrintMeshStats(const char* pLabel, const EncodedMesh& mesh)
+{
+    const uint32_t* pIndices = mesh.m_Indices.Data() + mesh.m_Lods.m_Lods[0].m_FirstIndex;
+    const size_t numIndices = mesh.m_Lods.m_Lods[0].m_NumIndices;
+    const VertexCacheStats cache = AnalyzeVertexCache(pIndices, numIndices, mesh.m_NumVertices);
+    const VertexFetchStats fetch = AnalyzeVertexFetch(pIndices, numIndices, mesh.m_NumVertices, mesh.m_Layout.GetVertexSize());
+    std::cout << pLabel << ": " << mesh.m_NumVertices << " vertices, ACMR " << cache.m_ACMR << ", ATVR " << cache.m_ATVR <<
+        ", fetched " << fetch.m_BytesFetched / 1024 << " KB, overfetch " << fetch.m_Overfetch << "." << std::endl;
+}
+
+// Hash of every triangle of LOD 0, by the bytes of its vertices and
+// starting from the smallest so rotations compare equal, sorted. Two meshes
+// that draw the same triangles have the same list whatever their order.
+static void GetTriangleHashes(const EncodedMesh& mesh, TArray<uint64_t>& hashes)
+{
+    TArray<uint64_t> vertexHashes;
+    vertexHashes.Resize(mesh.m_NumVertices);
+    for (uint32_t v = 0; v < mesh.m_NumVertices; v++)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t stream = 0; stream < mesh.m_Layout.m_NumStreams; stream++)
+        {
+            const uint32_t stride = mesh.m_Layout.m_Strides[stream];
+            const unsigned char* pVertex = mesh.m_VertexData.Data() + mesh.m_Layout.GetStreamOffset(stream, mesh.m_NumVertices) + (size_t)v * stride;
+            for (uint32_t i = 0; i < stride; i++)
+            {
+                hash = (hash ^ pVertex[i]) * 1099511628211ull;
+            }
+        }
+        vertexHashes[v] = hash;
+    }
+
+    const MeshLod& lod = mesh.m_Lods.m_Lods[0];
+    hashes.Clear();
+    for (size_t t = lod.m_FirstIndex; t + 2 < (size_t)lod.m_FirstIndex + lod.m_NumIndices; t += 3)
+    {
+        uint64_t corners[3] = { vertexHashes[mesh.m_Indices[t]], vertexHashes[mesh.m_Indices[t + 1]], vertexHashes[mesh.m_Indices[t + 2]] };
+        const int first = corners[0] <= corners[1] && corners[0] <= corners[2] ? 0 : (corners[1] <= corners[2] ? 1 : 2);
+        uint64_t hash = 14695981039346656037ull;
+        for (int i = 0; i < 3; i++)
+        {
+            hash = (hash ^ corners[(first + i) % 3]) * 1099511628211ull;
+        }
+        hashes.PushBack(hash);
+    }
+    std::sort(hashes.begin(), hashes.end());
+}
+
+static bool OptimizeMesh(EncodedMesh& mesh, const CookOptions& options)
+{
+    PrintMeshStats("Before", mesh);
+
+    TArray<uint64_t> trianglesBefore;
+    GetTriangleHashes(mesh, trianglesBefore);
+
+    TArray<uint32_t> remap;
+    remap.Resize(mesh.m_NumVertices);
+
+    // Quantization makes more vertices identical, so dedupe the encoded
+    // data rather than the floats.
+    MeshStream streams[MAX_VERTEX_STREAMS];
+    for (uint32_t stream = 0; stream < mesh.m_Layout.m_NumStreams; stream++)
+    {
+        streams[stream].m_pData = mesh.m_VertexData.Data() + mesh.m_Layout.GetStreamOffset(stream, mesh.m_NumVertices);
+        streams[stream].m_Stride = mesh.m_Layout.m_Strides[stream];
+    }
+    const uint32_t numUnique = GenerateVertexRemap(remap.Data(), mesh.m_Indices.Data(), mesh.m_Indices.Size(), mesh.m_NumVertices, streams, mesh.m_Layout.m_NumStreams);
+    RemapMesh(mesh, remap.Data(), numUnique);
+
+    // After the dedupe: vertices split only by their bytes would look like
+    // seams to the simplifier and stay locked.
+    GenerateLodChain(mesh.m_Indices, mesh.m_Lods, mesh.m_Positions.Data(), sizeof(float) * 3, mesh.m_NumVertices, options.m_NumLods, options.m_LodError);
+    for (uint32_t i = 0; i < mesh.m_Lods.m_NumLods; i++)
+    {
+        const MeshLod& lod = mesh.m_Lods.m_Lods[i];
+        std::cout << "LOD " << i << ": " << lod.m_NumIndices / 3 << " triangles, error " << lod.m_Error << "." << std::endl;
+    }
+
+    // Each LOD is drawn on its own, so each is ordered on its own. The
+    // vertex order below follows LOD 0 first, the rest reuse its vertices.
+    TArray<uint32_t> indices;
+    indices.Resize(mesh.m_Indices.Size());
+    for (uint32_t i = 0; i < mesh.m_Lods.m_NumLods; i++)
+    {
+        const MeshLod& lod = mesh.m_Lods.m_Lods[i];
+        uint32_t* pLodIndices = mesh.m_Indices.Data() + lod.m_FirstIndex;
+        OptimizeVertexCache(indices.Data(), pLodIndices, lod.m_NumIndices, mesh.m_NumVertices);
+        OptimizeOverdraw(pLodIndices, indices.Data(), lod.m_NumIndices, mesh.m_Positions.Data(), sizeof(float) * 3, mesh.m_NumVertices, OVERDRAW_THRESHOLD);
+    }
+
+    const uint32_t numUsed = GenerateVertexFetchRemap(remap.Data(), mesh.m_Indices.Data(), mesh.m_Indices.Size(), mesh.m_NumVertices);
+    RemapMesh(mesh, remap.Data(), numUsed);
+
+    PrintMeshStats("After", mesh);
+
+    // Reordering must never change what gets drawn.
+    TArray<uint64_t> trianglesAfter;
+    GetTriangleHashes(mesh, trianglesAfter);
+    if (trianglesAfter.Size() != trianglesBefore.Size() || memcmp(trianglesAfter.Data(), trianglesBefore.Data(), sizeof(uint64_t) * trianglesAfter.Size()) != 0)
+    {
+        std::cout << "ERROR: Optimized mesh doesn't match the source triangles." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool WriteMeshFile(const std::string& path, const EncodedMesh& mesh, const AABB& bounds)
+{
+    TArray<unsigned char> indexData;
+    const uint32_t indexSize = EncodeMeshIndices(mesh.m_Indices.Data(), mesh.m_Indices.Size(), mesh.m_NumVertices, indexData);
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.m_Magic = MESH_FILE_MAGIC;
+    header.m_Version = MESH_FILE_VERSION;
+    header.m_NumVertices = mesh.m_NumVertices;
+    header.m_NumIndices = (uint32_t)mesh.m_Indices.Size();
+    header.m_IndexSize = indexSize;
+    header.m_Layout = mesh.m_Layout;
+    header.m_NumLods = mesh.m_Lods.m_NumLods;
+    memcpy(header.m_Lods, mesh.m_Lods.m_Lods, sizeof(MeshLod) * mesh.m_Lods.m_NumLods);
+    for (int i = 0; i < 3; i++)
+    {
+        header.m_BoundsMin[i] = bounds.m_Min[i];
+        header.m_BoundsMax[i] = bounds.m_Max[i];
+    }
+
+    header.m_VertexOffset = AlignMeshFileOffset(sizeof(MeshFileHeader));
+    header.m_VertexDataSize = mesh.m_VertexData.Size();
+    header.m_IndexDataSize = (uint64_t)header.m_IndexSize * header.m_NumIndices;
+    header.m_IndexOffset = AlignMeshFileOffset(header.m_VertexOffset + header.m_VertexDataSize);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR: Creating " << path << "." << std::endl;
+        return false;
+    }
+
+    uint64_t offset = sizeof(header);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    WritePadding(file, offset);
+    file.write(reinterpret_cast<const char*>(mesh.m_VertexData.Data()), (std::streamsize)header.m_VertexDataSize);
+    offset += header.m_VertexDataSize;
+
+    WritePadding(file, offset);
+    file.write(reinterpret_cast<const char*>(indexData.Data()), (std::streamsize)header.m_IndexDataSize);
+
+    if (!file)
+    {
+        std::cout << "ERROR: Writing " << path << "." << std::endl;
+        return false;
+    }
+
+    std::cout << "Cooked " << path << ": " << header.m_NumVertices << " vertices, " << header.m_NumIndices << " " << header.m_IndexSize * 8 << "-bit indices." << std::endl;
+    return true;
+}
+
+static bool CookTexture(const std::string& input, const std::string& output, const CookOptions& options)
+{
+    int width, height, channels;
+    unsigned char* pPixels = stbi_load(input.c_str(), &width, &height, &channels, 4);
+    if (!pPixels)
+    {
+        std::cout << "ERROR: Loading texture " << input << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    TextureFormat format = options.m_TextureFormat;
+    if (options.m_AutoTextureFormat)
+    {
+        format = HasTranslucentPixels(pPixels, (size_t)width * height) ? TEXTURE_BC3 : TEXTURE_BC1;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TArray<unsigned char> file;
+    EncodeTextureFile(pPixels, (uint32_t)width, (uint32_t)height, format, file);
+    const double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stbi_image_free(pPixels);
+
+    std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(file.Data()), (std::streamsize)file.Size());
+    if (!stream)
+    {
+        std::cout << "ERROR: Writing " << output << "." << std::endl;
+        return false;
+    }
+
+    // Against what the runtime would upload for the image uncooked.
+    const TextureFileHeader* pHeader = reinterpret_cast<const TextureFileHeader*>(file.Data());
+    size_t dataSize = 0, rgbaSize = 0;
+    for (uint32_t mip = 0; mip < pHeader->m_NumMips; mip++)
+    {
+        dataSize += (size_t)pHeader->m_Mips[mip].m_Size;
+        rgbaSize += GetTextureMipSize(TEXTURE_RGBA8, GetTextureMipDimension(pHeader->m_Width, mip), GetTextureMipDimension(pHeader->m_Height, mip));
+    }
+
+    std::cout << "Cooked " << output << ": " << GetTextureFormatName(format) << " " << width << "x" << height << ", " << pHeader->m_NumMips << " mips, "
+        << dataSize / 1024 << " KB (" << (double)rgbaSize / dataSize << "x smaller than RGBA8) in " << encodeMs << " ms." << std::endl;
+    return true;
+}
+
+// Asks the OS to forget the cached pages of path so the next read comes
+// from disk. Best effort: dirty pages and other caches aren't affected.
+static bool DropFileCache(const std::string& path)
+{
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    fdatasync(fd);
+    const bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#endif
+}
+
+static double LoadWithAssimp(const std::string& path)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CookedMesh mesh;
+    ImportMesh(path, mesh);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Everything the runtime does before glBufferData, including faulting in
+// the pages the driver would read.
+static double LoadCooked(const std::string& path)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (file.Open(path))
+    {
+        const MeshFileHeader* pHeader = ValidateMeshFile(file.GetData(), file.GetSize());
+        if (pHeader)
+        {
+            file.Prefetch();
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunBenchmark(const std::string& source, const std::string& cooked)
+{
+    if (DropFileCache(source) && DropFileCache(cooked))
+    {
+        const double assimpMs = LoadWithAssimp(source);
+        const double cookedMs = LoadCooked(cooked);
+        std::cout << "Cold: Assimp " << assimpMs << " ms, cooked " << cookedMs << " ms." << std::endl;
+    }
+    else
+    {
+        std::cout << "Cold: can't drop the page cache on this platform, skipped." << std::endl;
+    }
+
+    double assimpMs = 0.0, cookedMs = 0.0;
+    for (int i = 0; i < BENCH_WARM_RUNS; i++)
+    {
+        assimpMs += LoadWithAssimp(source);
+        cookedMs += LoadCooked(cooked);
+    }
+    assimpMs /= BENCH_WARM_RUNS;
+    cookedMs /= BENCH_WARM_RUNS;
+    std::cout << "Warm (average of " << BENCH_WARM_RUNS << "): Assimp " << assimpMs << " ms, cooked " << cookedMs << " ms, " << assimpMs / cookedMs << "x faster." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    bool benchmark = false;
+    CookOptions options;
+    const char* pInput = nullptr;
+    const char* pOutput = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+        {
+            benchmark = true;
+        }
+        else if (strcmp(argv[i], "--no-quantize") == 0)
+        {
+            options.m_Quantization.m_Enabled = false;
+        }
+        else if (strcmp(argv[i], "--position-error") == 0 && i + 1 < argc)
+        {
+            options.m_Quantization.m_PositionError = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--normal-error") == 0 && i + 1 < argc)
+        {
+            options.m_Quantization.m_NormalError = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--uv-error") == 0 && i + 1 < argc)
+        {
+            options.m_Quantization.m_TexCoordError = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--split") == 0)
+        {
+            options.m_StreamMode = VERTEX_SPLIT_POSITIONS;
+        }
+        else if (strcmp(argv[i], "--no-optimize") == 0)
+        {
+            options.m_Optimize = false;
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+        {
+            options.m_NumLods = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc)
+        {
+            options.m_LodError = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--texture-format") == 0 && i + 1 < argc)
+        {
+            i++;
+            options.m_AutoTextureFormat = false;
+            if (strcmp(argv[i], "bc3") == 0)
+            {
+                options.m_TextureFormat = TEXTURE_BC3;
+            }
+            else if (strcmp(argv[i], "bc7") == 0)
+            {
+                options.m_TextureFormat = TEXTURE_BC7;
+            }
+            else if (strcmp(argv[i], "rgba8") == 0)
+            {
+                options.m_TextureFormat = TEXTURE_RGBA8;
+            }
+            else
+            {
+                options.m_TextureFormat = TEXTURE_BC1;
+            }
+        }
+        else if (!pInput)
+        {
+            pInput = argv[i];
+        }
+        else if (!pOutput)
+        {
+            pOutput = argv[i];
+        }
+    }
+
+    if (!pInput || !pOutput)
+    {
+        std::cout << "Usage: InsanityCooker [--bench] [--no-quantize] [--position-error F] [--normal-error DEG] [--uv-error F] [--split] [--no-optimize] [--lods N] [--lod-error F] <input> <output.imesh>" << std::endl;
+        std::cout << "       InsanityCooker [--texture-format bc1|bc3|bc7|rgba8] <input> <output.itex>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const size_t outputLength = strlen(pOutput);
+    if (outputLength > 5 && strcmp(pOutput + outputLength - 5, ".itex") == 0)
+    {
+        return CookTexture(pInput, pOutput, options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    CookedMesh mesh;
+    if (!ImportMesh(pInput, mesh))
+    {
+        return EXIT_FAILURE;
+    }
+
+    EncodedMesh encoded;
+    EncodeMesh(mesh, options, encoded);
+    if ((options.m_Optimize && !OptimizeMesh(encoded, options)) || !WriteMeshFile(pOutput, encoded, mesh.m_Bounds))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (benchmark)
+    {
+        RunBenchmark(pInput, pOutput);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DynamicBuffer.h"
+
+#include <iostream>
+
+// One second, a fence taking longer means the GPU is hung.
+static const GLuint64 FENCE_TIMEOUT_NS = 1000000000ull;
+
+DynamicBuffer::DynamicBuffer():
+    m_Buffer{0},
+    m_pMapped{nullptr},
+    m_FrameSize{0},
+    m_Used{0},
+    m_MapOffset{0},
+    m_NumFrames{0},
+    m_Frame{0},
+    m_Persistent{false},
+    m_InFrame{false},
+    m_FramePending{false},
+    m_Fences{},
+    m_Stalls{0}
+{
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+    Destroy();
+}
+
+bool DynamicBuffer::Create(size_t frameSize, uint32_t numFrames, bool forceFallback)
+{
+    Destroy();
+
+    m_FrameSize = frameSize;
+    m_NumFrames = numFrames < 1 ? 1 : (numFrames > MAX_FRAMES ? MAX_FRAMES : numFrames);
+    m_Frame = 0;
+    m_Persistent = !forceFallback && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+
+    if (m_Persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = (GLsizeiptr)(m_FrameSize * m_NumFrames);
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        m_pMapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (!m_pMapped)
+        {
+            // Storage is immutable, start over with a plain buffer.
+            std::cout << "ERROR: Persistent mapping failed, using the orphaning fallback." << std::endl;
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &m_Buffer);
+            glGenBuffers(1, &m_Buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+            m_Persistent = false;
+        }
+    }
+
+    if (!m_Persistent)
+    {
+        // Orphaning gives the driver the ring for free, one segment is enough.
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_FrameSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return m_Buffer != 0;
+}
+
+void DynamicBuffer::Destroy()
+{
+    if (!m_Buffer)
+    {
+        return;
+    }
+
+    for (GLsync& fence : m_Fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (m_pMapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_pMapped = nullptr;
+    }
+
+    glDeleteBuffers(1, &m_Buffer);
+    m_Buffer = 0;
+    m_InFrame = false;
+    m_FramePending = false;
+}
+
+void DynamicBuffer::BeginFrame()
+{
+    m_Used = 0;
+    m_InFrame = true;
+
+    if (m_Persistent)
+    {
+        // Everything reading the last segment has been issued by now.
+        if (m_FramePending)
+        {
+            m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        m_FramePending = true;
+
+        m_Frame = (m_Frame + 1) % m_NumFrames;
+
+        // Wait until the GPU is done with what we wrote here numFrames ago.
+        GLsync& fence = m_Fences[m_Frame];
+        if (fence)
+        {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                m_Stalls++;
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            }
+            if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED)
+            {
+                std::cout << "ERROR: Waiting for dynamic buffer fence." << std::endl;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        return;
+    }
+
+    // Orphan the storage: the GPU keeps the old one, we get a fresh one
+    // without waiting.
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_FrameSize, nullptr, GL_STREAM_DRAW);
+    m_pMapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_FrameSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    m_MapOffset = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!m_pMapped)
+    {
+        std::cout << "ERROR: Mapping dynamic buffer." << std::endl;
+    }
+}
+
+void* DynamicBuffer::Allocate(size_t size, size_t alignment, GLintptr& offset)
+{
+    if (!m_InFrame)
+    {
+        return nullptr;
+    }
+
+    const size_t start = (m_Used + alignment - 1) & ~(alignment - 1);
+    if (start + size > m_FrameSize)
+    {
+        return nullptr;
+    }
+
+    if (!m_pMapped && !m_Persistent)
+    {
+        // After FlushWrites. Nothing drawn so far this frame reads past
+        // m_Used, so there is nothing to wait for.
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+        m_pMapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)m_Used, (GLsizeiptr)(m_FrameSize - m_Used),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        m_MapOffset = m_Used;
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    if (!m_pMapped)
+    {
+        return nullptr;
+    }
+
+    m_Used = start + size;
+    offset = GetFrameOffset() + (GLintptr)start;
+    return m_pMapped + (offset - (GLintptr)m_MapOffset);
+}
+
+void DynamicBuffer::FlushWrites()
+{
+    // Persistent: the mapping is coherent, draws see the data already.
+    if (m_InFrame && !m_Persistent && m_pMapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_pMapped = nullptr;
+    }
+}
+
+void DynamicBuffer::EndFrame()
+{
+    if (!m_InFrame)
+    {
+        return;
+    }
+    m_InFrame = false;
+
+    // Persistent: nothing to do, the mapping is coherent. The fence goes in
+    // at the next BeginFrame, once the draws reading this data are issued.
+    if (!m_Persistent && m_pMapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_pMapped = nullptr;
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+// Buffer for data rewritten every frame (particles, debug lines, UI...).
+//
+// With GL 4.4 / ARB_buffer_storage it is one persistently mapped buffer
+// split in numFrames segments; a fence per segment makes sure the GPU is
+// done with it before the CPU writes there again. On plain GL 3.3 it falls
+// back to one segment that is orphaned and mapped again every frame.
+//
+// Usage per frame: BeginFrame, Allocate and fill, EndFrame, then draw. The
+// fallback mapping is only valid until EndFrame. Data drawn in several
+// batches during the frame calls FlushWrites before each batch's draws
+// instead, and EndFrame once after the last.
+class DynamicBuffer
+{
+public:
+	DynamicBuffer();
+	~DynamicBuffer();
+
+	DynamicBuffer(const DynamicBuffer&) = delete;
+	DynamicBuffer& operator=(const DynamicBuffer&) = delete;
+
+	// Needs a current context. forceFallback skips buffer storage, to
+	// compare both paths on the same driver.
+	bool Create(size_t frameSize, uint32_t numFrames = 3, bool forceFallback = false);
+	void Destroy();
+
+	void BeginFrame();
+
+	// size bytes to write, at offset in the buffer. nullptr when the frame
+	// segment is full.
+	void* Allocate(size_t size, size_t alignment, GLintptr& offset);
+
+	// Makes what was allocated so far readable by the draws issued next,
+	// without ending the frame. Later allocations go after it; the
+	// fallback maps the rest of its segment again, unsynchronized.
+	void FlushWrites();
+
+	void EndFrame();
+
+	GLuint GetBuffer() const { return m_Buffer; }
+	bool IsPersistent() const { return m_Persistent; }
+	size_t GetFrameSize() const { return m_FrameSize; }
+
+	// Where the current frame's segment starts in the buffer.
+	GLintptr GetFrameOffset() const { return m_Persistent ? (GLintptr)(m_FrameSize * m_Frame) : 0; }
+
+	// Bytes handed out since BeginFrame.
+	size_t GetBytesUsed() const { return m_Used; }
+
+	// Times BeginFrame had to wait for the GPU to release a segment.
+	uint64_t GetStalls() const { return m_Stalls; }
+
+private:
+	static const uint32_t MAX_FRAMES = 4;
+
+	GLuint m_Buffer;
+	unsigned char* m_pMapped;
+	size_t m_FrameSize;
+	size_t m_Used;
+	size_t m_MapOffset;	// Buffer offset m_pMapped points at.
+	uint32_t m_NumFrames;
+	uint32_t m_Frame;
+	bool m_Persistent;
+	bool m_InFrame;
+	bool m_FramePending;
+	GLsync m_Fences[MAX_FRAMES];
+	uint64_t m_Stalls;
+};
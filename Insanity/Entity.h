@@ -0,0 +1,88 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Generational handle. The index is a slot in the World, reused once the
+// entity is destroyed; the generation tells the new owner of a slot from
+// handles to the old one, which then simply stop resolving.
+struct Entity
+{
+	uint32_t m_Index = 0;
+	uint32_t m_Generation = 0;	// 0 is never alive.
+
+	bool IsValid() const { return m_Generation != 0; }
+
+	bool operator==(const Entity& other) const { return m_Index == other.m_Index && m_Generation == other.m_Generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// One bit per component type: archetypes are keyed by it and systems
+// declare what they read and write with it.
+typedef uint64_t ComponentMask;
+
+static const uint32_t MAX_COMPONENT_TYPES = 64;
+
+struct ComponentInfo
+{
+	size_t m_Size;
+	size_t m_Alignment;
+};
+
+// Ids are handed out the first time a type is used, so they depend on the
+// order of first use and mean nothing outside the process.
+class ComponentRegistry
+{
+public:
+	template<typename T>
+	static uint32_t GetId()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Components are moved between chunks with memcpy");
+		static const uint32_t s_Id = Register(sizeof(T), alignof(T));
+		return s_Id;
+	}
+
+	static const ComponentInfo& GetInfo(uint32_t id);
+
+private:
+	static uint32_t Register(size_t size, size_t alignment);
+};
+
+template<typename... Components>
+ComponentMask MakeComponentMask()
+{
+	return (ComponentMask{0} | ... | (ComponentMask{1} << ComponentRegistry::GetId<std::remove_const_t<Components>>()));
+}
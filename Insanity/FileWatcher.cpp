@@ -0,0 +1,209 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <filesystem>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Profiler.h"
+
+// How long the thread waits before checking whether it should stop, and
+// how often modification times are polled where there is no inotify.
+static const int WATCH_INTERVAL_MS = 100;
+
+static std::chrono::system_clock::time_point GetWriteTime(const std::string& path)
+{
+    std::error_code error;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return std::chrono::system_clock::time_point{};
+    }
+    return std::chrono::system_clock::time_point{ std::chrono::duration_cast<std::chrono::system_clock::duration>(time.time_since_epoch()) };
+}
+
+FileWatcher::FileWatcher():
+	m_Running{false},
+	m_Inotify{-1}
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+void FileWatcher::AddFile(const std::string& path)
+{
+    const std::filesystem::path filePath{ path };
+    std::string directory = filePath.parent_path().string();
+    m_Files.PushBack(WatchedFile{ path, directory.empty() ? "." : directory, filePath.filename().string(), -1, GetWriteTime(path) });
+}
+
+bool FileWatcher::Start()
+{
+    Stop();
+
+#ifdef __linux__
+    m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_Inotify < 0)
+    {
+        std::cout << "ERROR: inotify_init1 failed (" << errno << ")." << std::endl;
+        return false;
+    }
+
+    // One watch per directory, shared by the files in it.
+    for (WatchedFile& file : m_Files)
+    {
+        file.m_Watch = inotify_add_watch(m_Inotify, file.m_Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (file.m_Watch < 0)
+        {
+            std::cout << "WARNING: Can't watch " << file.m_Directory << " (" << errno << ")." << std::endl;
+        }
+    }
+#endif
+
+    m_Running = true;
+    m_Thread = std::thread(&FileWatcher::ThreadMain, this);
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    m_Running = false;
+    if (m_Thread.joinable())
+    {
+        m_Thread.join();
+    }
+
+#ifdef __linux__
+    if (m_Inotify >= 0)
+    {
+        close(m_Inotify);
+        m_Inotify = -1;
+    }
+#endif
+}
+
+void FileWatcher::PollChanges(TArray<FileChange>& changes)
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    for (FileChange& change : m_Changes)
+    {
+        changes.PushBack(std::move(change));
+    }
+    m_Changes.Clear();
+}
+
+void FileWatcher::AddChange(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    for (const FileChange& change : m_Changes)
+    {
+        if (change.m_Path == path)
+        {
+            return;
+        }
+    }
+    m_Changes.PushBack(FileChange{ path, std::chrono::steady_clock::now() });
+}
+
+#ifdef __linux__
+
+void FileWatcher::ThreadMain()
+{
+    Profiler::SetThreadName("File Watcher");
+
+    // Big enough for many events with names.
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (m_Running)
+    {
+        pollfd descriptor{ m_Inotify, POLLIN, 0 };
+        if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(m_Inotify, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + pEvent->len;
+                if (!pEvent->len)
+                {
+                    continue;
+                }
+
+                for (const WatchedFile& file : m_Files)
+                {
+                    if (file.m_Watch == pEvent->wd && file.m_Name == pEvent->name)
+                    {
+                        AddChange(file.m_Path);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#else
+
+void FileWatcher::ThreadMain()
+{
+    Profiler::SetThreadName("File Watcher");
+
+    while (m_Running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+        for (WatchedFile& file : m_Files)
+        {
+            const std::chrono::system_clock::time_point writeTime = GetWriteTime(file.m_Path);
+            if (writeTime != file.m_WriteTime)
+            {
+                file.m_WriteTime = writeTime;
+                AddChange(file.m_Path);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "TArray.h"
+
+struct FileChange
+{
+	std::string m_Path;
+
+	// When the watcher saw the file change, to measure reload latency from.
+	std::chrono::steady_clock::time_point m_Time;
+};
+
+// Tells which of a set of files changed on disk, from a background thread.
+// On Linux it waits on inotify for the directories holding them, which
+// catches editors that save by writing a new file and renaming it over the
+// old one. Elsewhere it polls modification times.
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Files must be added before Start. Paths are reported as given here.
+	void AddFile(const std::string& path);
+
+	bool Start();
+	void Stop();
+
+	// Files that changed since the last call, each one once however many
+	// times it was written.
+	void PollChanges(TArray<FileChange>& changes);
+
+private:
+	struct WatchedFile
+	{
+		std::string m_Path;
+		std::string m_Directory;
+		std::string m_Name;
+		int m_Watch;
+		std::chrono::system_clock::time_point m_WriteTime;
+	};
+
+	TArray<WatchedFile> m_Files;
+	std::thread m_Thread;
+	std::atomic<bool> m_Running;
+	int m_Inotify;
+
+	std::mutex m_Mutex;
+	TArray<FileChange> m_Changes;
+
+	void ThreadMain();
+	void AddChange(const std::string& path);
+};
@@ -0,0 +1,258 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FramePacer.h"
+
+#include <math.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "GameClock.h"
+#include "Profiler.h"
+
+// Windows 10 1803 and later; older SDKs don't have the flag and older
+// systems refuse it, then a normal timer is used.
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Bounds of the spin margin, where it starts, and how fast it forgets an
+// oversleep: by SPIN_MARGIN_DECAY per frame.
+static const double MIN_SPIN_MARGIN = 0.0002;
+static const double MAX_SPIN_MARGIN = 0.004;
+static const double INITIAL_SPIN_MARGIN = 0.001;
+static const double SPIN_MARGIN_DECAY = 0.95;
+
+// Width of the bars FrameTimeHistogram::Print draws for 100%.
+static const int HISTOGRAM_BAR_WIDTH = 50;
+
+FrameTimeHistogram::FrameTimeHistogram()
+{
+    Clear();
+}
+
+void FrameTimeHistogram::Add(double milliseconds)
+{
+    const uint32_t bucket = std::min((uint32_t)(std::max(milliseconds, 0.0) / BUCKET_MS), NUM_BUCKETS - 1);
+    m_Buckets[bucket]++;
+    m_Count++;
+    m_Sum += milliseconds;
+    m_SumSquares += milliseconds * milliseconds;
+    m_Max = std::max(m_Max, milliseconds);
+}
+
+void FrameTimeHistogram::Clear()
+{
+    std::fill(m_Buckets, m_Buckets + NUM_BUCKETS, 0);
+    m_Count = 0;
+    m_Sum = 0.0;
+    m_SumSquares = 0.0;
+    m_Max = 0.0;
+}
+
+double FrameTimeHistogram::GetMean() const
+{
+    return m_Count ? m_Sum / m_Count : 0.0;
+}
+
+double FrameTimeHistogram::GetJitter() const
+{
+    if (!m_Count)
+    {
+        return 0.0;
+    }
+
+    const double mean = GetMean();
+    return sqrt(std::max(m_SumSquares / m_Count - mean * mean, 0.0));
+}
+
+double FrameTimeHistogram::GetPercentile(double percentile) const
+{
+    const uint64_t rank = (uint64_t)ceil(percentile / 100.0 * m_Count);
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        count += m_Buckets[i];
+        if (count >= rank && count)
+        {
+            return i == NUM_BUCKETS - 1 ? m_Max : (i + 1) * BUCKET_MS;
+        }
+    }
+    return 0.0;
+}
+
+void FrameTimeHistogram::Print(std::ostream& stream) const
+{
+    const std::ios::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    stream << std::fixed << std::setprecision(1);
+
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        if (!m_Buckets[i])
+        {
+            continue;
+        }
+
+        const double share = (double)m_Buckets[i] / m_Count;
+        stream << std::setw(6) << i * BUCKET_MS;
+        if (i == NUM_BUCKETS - 1)
+        {
+            stream << " and up ";
+        }
+        else
+        {
+            stream << " - " << std::setw(4) << (i + 1) * BUCKET_MS << " ";
+        }
+        stream << "ms " << std::setw(5) << share * 100.0 << "% " << std::string((size_t)ceil(share * HISTOGRAM_BAR_WIDTH), '#') << std::endl;
+    }
+
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+FramePacer::FramePacer():
+	m_pClock{nullptr},
+	m_Period{0.0},
+	m_Deadline{0.0},
+	m_SpinMargin{INITIAL_SPIN_MARGIN},
+	m_SleepTime{0.0},
+	m_SpinTime{0.0},
+	m_MissedFrames{0}
+{
+#ifdef _WIN32
+    m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_Timer)
+    {
+        m_Timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+    if (m_Timer)
+    {
+        CloseHandle(m_Timer);
+    }
+#endif
+}
+
+void FramePacer::Init(const GameClock& clock, double maxFps)
+{
+    m_pClock = &clock;
+    m_Period = maxFps > 0.0 ? 1.0 / maxFps : 0.0;
+    m_Deadline = clock.GetRealTime();
+    m_SpinMargin = INITIAL_SPIN_MARGIN;
+    m_SleepTime = 0.0;
+    m_SpinTime = 0.0;
+    m_MissedFrames = 0;
+}
+
+void FramePacer::Wait()
+{
+    if (m_Period <= 0.0 || m_pClock->IsVirtual())
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("FramePacer::Wait");
+
+    m_Deadline += m_Period;
+    double now = m_pClock->GetRealTime();
+    if (now >= m_Deadline)
+    {
+        // Late: this frame goes out now and the next one gets a full period.
+        m_MissedFrames++;
+        m_Deadline = now;
+        return;
+    }
+
+    const double sleep = m_Deadline - now - m_SpinMargin;
+    if (sleep > 0.0)
+    {
+        const double sleepStart = now;
+        Sleep(sleep);
+        now = m_pClock->GetRealTime();
+        m_SleepTime += now - sleepStart;
+
+        // Waking past where the spin was meant to start means the margin is
+        // too short. Either way it shrinks back slowly once sleeps are on
+        // time again.
+        const double oversleep = now - (sleepStart + sleep);
+        m_SpinMargin = std::min(std::max(std::max(oversleep * 1.25, m_SpinMargin * SPIN_MARGIN_DECAY), MIN_SPIN_MARGIN), MAX_SPIN_MARGIN);
+    }
+
+    const double spinStart = now;
+    while (now < m_Deadline)
+    {
+        now = m_pClock->GetRealTime();
+    }
+    m_SpinTime += now - spinStart;
+}
+
+void FramePacer::Sleep(double seconds)
+{
+#ifdef _WIN32
+    if (m_Timer)
+    {
+        // Relative, in 100 ns units.
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(seconds * 1e7);
+        if (SetWaitableTimerEx(m_Timer, &due, 0, nullptr, nullptr, nullptr, 0))
+        {
+            WaitForSingleObject(m_Timer, INFINITE);
+            return;
+        }
+    }
+    ::Sleep((DWORD)(seconds * 1000.0));
+#elif defined(__linux__)
+    timespec duration;
+    duration.tv_sec = (time_t)seconds;
+    duration.tv_nsec = (long)((seconds - (double)duration.tv_sec) * 1e9);
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &duration, nullptr);
+#else
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#endif
+}
@@ -0,0 +1,121 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <iosfwd>
+
+class GameClock;
+
+// Frame times in buckets of FRAME_HISTOGRAM_BUCKET_MS, the last one
+// taking everything longer. Keeps running sums for the mean and the
+// jitter (standard deviation), so it costs the same however long the run.
+class FrameTimeHistogram
+{
+public:
+	static const uint32_t NUM_BUCKETS = 100;
+	static constexpr double BUCKET_MS = 0.5;
+
+	FrameTimeHistogram();
+
+	void Add(double milliseconds);
+	void Clear();
+
+	uint64_t GetCount() const { return m_Count; }
+	double GetMean() const;
+	double GetJitter() const;
+	double GetMax() const { return m_Max; }
+
+	// Upper edge of the bucket holding the percentile.
+	double GetPercentile(double percentile) const;
+
+	// One line per bucket with frames in it, with a bar of its share.
+	void Print(std::ostream& stream) const;
+
+private:
+	uint64_t m_Buckets[NUM_BUCKETS];
+	uint64_t m_Count;
+	double m_Sum;
+	double m_SumSquares;
+	double m_Max;
+};
+
+// Caps the frame rate. Wait is called once per frame, right before the
+// frame is presented, and returns once at least 1/maxFps has passed since
+// the last frame was due. It sleeps through most of the wait and spins the
+// last stretch, since sleeps wake up late by anything from tens of
+// microseconds to a millisecond or more: the spin margin follows the worst
+// recent oversleep, so little CPU is burnt spinning where sleeps are
+// precise. A frame that misses its slot moves the schedule instead of the
+// next frames rushing to catch up.
+//
+// With a virtual clock there is nothing to wait for, the clock already
+// gives every frame its full period.
+class FramePacer
+{
+public:
+	FramePacer();
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// maxFps 0 leaves the frame rate uncapped.
+	void Init(const GameClock& clock, double maxFps);
+
+	void Wait();
+
+	// Totals since Init, in seconds, and frames that came too late to
+	// wait at all.
+	double GetSleepTime() const { return m_SleepTime; }
+	double GetSpinTime() const { return m_SpinTime; }
+	uint64_t GetMissedFrames() const { return m_MissedFrames; }
+	double GetSpinMargin() const { return m_SpinMargin; }
+
+private:
+	const GameClock* m_pClock;
+	double m_Period;
+	double m_Deadline;
+	double m_SpinMargin;
+
+	double m_SleepTime;
+	double m_SpinTime;
+	uint64_t m_MissedFrames;
+
+#ifdef _WIN32
+	void* m_Timer;
+#endif
+
+	// Sleeps about seconds, maybe more, never much less.
+	void Sleep(double seconds);
+};
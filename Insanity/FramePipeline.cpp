@@ -0,0 +1,103 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FramePipeline.h"
+
+FramePipeline::FramePipeline():
+    m_WriteIndex{0},
+    m_ReadIndex{0},
+    m_ReadyCount{0},
+    m_Stopped{false}
+{
+}
+
+FramePacket* FramePipeline::BeginWrite()
+{
+    std::unique_lock<std::mutex> lock{ m_Mutex };
+
+    // The packet being written is never counted as ready, so it can't be
+    // the one the reader holds.
+    m_Changed.wait(lock, [this] { return m_Stopped || m_ReadyCount < NUM_PACKETS; });
+    if (m_Stopped)
+    {
+        return nullptr;
+    }
+
+    return &m_Packets[m_WriteIndex];
+}
+
+void FramePipeline::EndWrite()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_WriteIndex = (m_WriteIndex + 1) % NUM_PACKETS;
+        m_ReadyCount++;
+    }
+    m_Changed.notify_all();
+}
+
+const FramePacket* FramePipeline::BeginRead()
+{
+    std::unique_lock<std::mutex> lock{ m_Mutex };
+    m_Changed.wait(lock, [this] { return m_Stopped || m_ReadyCount > 0; });
+    if (m_ReadyCount == 0)
+    {
+        return nullptr;
+    }
+
+    return &m_Packets[m_ReadIndex];
+}
+
+void FramePipeline::EndRead()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_ReadIndex = (m_ReadIndex + 1) % NUM_PACKETS;
+        m_ReadyCount--;
+    }
+    m_Changed.notify_all();
+}
+
+void FramePipeline::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_Stopped = true;
+    }
+    m_Changed.notify_all();
+}
+
+bool FramePipeline::IsStopped()
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    return m_Stopped;
+}
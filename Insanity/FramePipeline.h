@@ -0,0 +1,99 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <glm/glm.hpp>
+
+#include "TArray.h"
+
+// A draw as produced by the simulation. Meshes and shaders are referenced by
+// index because the simulation thread never touches GL objects.
+struct DrawCommand
+{
+	uint32_t m_MeshIndex;
+	uint32_t m_ShaderIndex;
+	glm::mat4 m_Model;
+	uint32_t m_Lod;
+};
+
+// Everything the render thread needs to draw one frame. Once published it
+// is immutable until the render thread releases it.
+struct FramePacket
+{
+	uint64_t m_FrameIndex;
+	glm::mat4 m_Projection;
+	TArray<DrawCommand> m_Draws;
+
+	// Triangles of m_Draws at their LODs.
+	uint64_t m_Triangles;
+
+	// Fixed simulation steps run since the previous packet.
+	uint32_t m_SimulationSteps;
+};
+
+// Fixed ring of frame packets between the simulation thread (producer) and
+// the render thread (consumer). With three packets the simulation can work
+// on frame N+1 while the renderer draws frame N and frame N-1 is queued.
+class FramePipeline
+{
+public:
+	static const uint32_t NUM_PACKETS = 3;
+
+	FramePipeline();
+
+	// Producer side. Blocks while every packet is in use. Returns nullptr
+	// once the pipeline is stopped.
+	FramePacket* BeginWrite();
+	void EndWrite();
+
+	// Consumer side. Blocks until a packet is ready. Returns nullptr once
+	// the pipeline is stopped and drained.
+	const FramePacket* BeginRead();
+	void EndRead();
+
+	void Stop();
+	bool IsStopped();
+
+private:
+	FramePacket m_Packets[NUM_PACKETS];
+	uint32_t m_WriteIndex;
+	uint32_t m_ReadIndex;
+	uint32_t m_ReadyCount;
+	bool m_Stopped;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Changed;
+};
@@ -31,3 +31,996 @@
  */
 
 #include "GameApplication.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Benchmark.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "TransformSystem.h"
+
+static const GLint HEIGHT = 768, WIDTH = 1024;
+
+// Time per frame the render thread may spend uploading streamed assets.
+static const double ASSET_UPLOAD_BUDGET_MS = 2.0;
+
+// Simulation steps one frame may run before the rest of its time is
+// dropped, and how fast spinning objects turn.
+static const uint32_t MAX_SIMULATION_STEPS = 8;
+static const float SPIN_RADIANS_PER_SECOND = 1.0f;
+
+// Visible objects per job when filling the frame packet: each one is a few
+// component lookups and a LOD pick, so a job needs many to be worth it.
+static const uint32_t PACKET_OBJECTS_PER_JOB = 1024;
+
+// Vertex Shader
+static const char* vShader = "../Resources/Shaders/vShader.vert";
+
+// Features of vShader, in permutation mask bit order.
+static const char* s_ShaderFeatures[] = { "UNIFORM_BLOCKS", "INSTANCED" };
+static const uint32_t SHADER_UNIFORM_BLOCKS = 1u << 0;
+static const uint32_t SHADER_INSTANCED = 1u << 1;
+
+// Variants the scene draws with, in Renderable::m_ShaderIndex order.
+static const uint32_t s_SceneShaderVariants[] = { SHADER_UNIFORM_BLOCKS, SHADER_UNIFORM_BLOCKS | SHADER_INSTANCED };
+
+// Fragment Shader
+static const char* fShader = "../Resources/Shaders/fShader.frag";
+
+// Tessellation of the LOD benchmark sphere, and the coarsest LOD it may
+// get as a fraction of its diameter.
+static const unsigned int LOD_SPHERE_RINGS = 96, LOD_SPHERE_SEGMENTS = 192;
+static const float LOD_SPHERE_MAX_ERROR = 0.1f;
+
+// Linked program binaries from previous runs.
+static const char* s_ShaderCacheDirectory = "ShaderCache";
+
+static const unsigned int s_TriangleIndices[] = {
+    0, 3, 1,
+    1, 3, 2,
+    2, 3, 0,
+    0, 1, 2
+};
+
+static const GLfloat s_TriangleVertices[] = {
+    -1.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 1.0f,
+    1.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f
+};
+
+GameApplication::GameApplication():
+    m_Config{},
+    m_pWindow{nullptr},
+    m_BufferWidth{WIDTH},
+    m_BufferHeight{HEIGHT},
+    m_ShaderCache{s_ShaderCacheDirectory},
+    m_Renderer{m_FrameAllocator},
+    m_HotReloader{m_Assets, &m_ShaderCache},
+    m_TransformsDirty{false},
+    m_pStreamMesh{nullptr},
+    m_StreamTimeMs{0.0},
+    m_StreamBytes{0}
+{
+}
+
+GameApplication::~GameApplication()
+{
+    m_Pipeline.Stop();
+    if (m_SimulationThread.joinable())
+    {
+        m_SimulationThread.join();
+    }
+}
+
+int GameApplication::Run(const ApplicationConfig& config)
+{
+    m_Config = config;
+
+    CreateTestGeometry();
+
+    if (!m_Config.m_Headless)
+    {
+        const int error = InitWindow();
+        if (error)
+        {
+            return error;
+        }
+        Profiler::InitGpu();
+
+        CreateMeshes();
+        CreateShaders();
+
+        VertexQuantization quantization;
+        quantization.m_Enabled = m_Config.m_QuantizeVertices;
+        m_Assets.SetVertexQuantization(quantization);
+        for (const std::string& meshFile : m_Config.m_MeshFiles)
+        {
+            const AssetHandle handle = m_Assets.LoadMesh(meshFile);
+            if (m_Config.m_HotReload)
+            {
+                m_HotReloader.AddAsset(handle, meshFile);
+            }
+        }
+
+        m_Assets.SetTextureBudget((size_t)m_Config.m_TextureBudgetMB * 1024 * 1024);
+        for (const std::string& textureFile : m_Config.m_TextureFiles)
+        {
+            m_Textures.PushBack(m_Assets.LoadTexture(textureFile));
+            if (m_Config.m_HotReload)
+            {
+                m_HotReloader.AddAsset(m_Textures.Back(), textureFile);
+            }
+        }
+
+        if (m_Config.m_HotReload)
+        {
+            // Shaders that failed to load have nothing to swap a rebuild into.
+            for (size_t i = 0; i < m_Shaders.Size(); i++)
+            {
+                if (m_Shaders[i])
+                {
+                    m_HotReloader.AddShader(m_Shaders[i], vShader, fShader, m_ShaderPermutations.GetDefines(s_SceneShaderVariants[i]));
+                }
+            }
+            m_HotReloader.Start();
+        }
+
+        if (m_Config.m_StreamKB)
+        {
+            CreateStreamMesh();
+        }
+    }
+
+    CreateScene();
+
+    const double step = 1.0 / std::max(m_Config.m_SimulationHz, 1.0);
+    double virtualPeriod = 0.0;
+    if (m_Config.m_DeterministicClock)
+    {
+        virtualPeriod = std::max(m_Config.m_VirtualFrameMs / 1000.0, m_Config.m_MaxFps > 0.0 ? 1.0 / m_Config.m_MaxFps : 0.0);
+        virtualPeriod = virtualPeriod > 0.0 ? virtualPeriod : step;
+    }
+    m_Clock.Start(virtualPeriod);
+    m_Timestep.Init(step, MAX_SIMULATION_STEPS);
+
+    m_SimulationThread = std::thread(&GameApplication::SimulationMain, this);
+
+    RenderMain();
+
+    m_Pipeline.Stop();
+    m_SimulationThread.join();
+
+    DestroyScene();
+    m_HotReloader.Stop();
+    m_Assets.Clear();
+    m_Renderer.Clear();
+
+    if (m_pWindow)
+    {
+        m_OffscreenTarget.Destroy();
+        Profiler::ShutdownGpu();
+        glfwDestroyWindow(m_pWindow);
+        m_pWindow = nullptr;
+        glfwTerminate();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int GameApplication::InitWindow()
+{
+#ifdef GLFW_PLATFORM_NULL
+    // Without a window to show, EGL and OSMesa contexts don't need a
+    // display server either.
+    const bool nullPlatform = m_Config.m_Offscreen && m_Config.m_ContextApi != CONTEXT_API_NATIVE;
+    glfwInitHint(GLFW_PLATFORM, nullPlatform ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+#endif
+
+    if (glfwInit() == GLFW_FALSE)
+    {
+        // TODO: Handle error.
+        std::cout << "ERROR: GLFW initialization failed." << std::endl;
+        glfwTerminate();
+        return -3;
+    }
+
+    // Setup GLFW
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); 
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+    glfwWindowHint(GLFW_VISIBLE, m_Config.m_Offscreen ? GLFW_FALSE : GLFW_TRUE);
+    switch (m_Config.m_ContextApi)
+    {
+    case CONTEXT_API_EGL:
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        break;
+    case CONTEXT_API_OSMESA:
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        break;
+    default:
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+        break;
+    }
+
+    m_pWindow = glfwCreateWindow(WIDTH, HEIGHT, "Test OpenGL Windows", nullptr, nullptr);
+    if (m_pWindow == nullptr)
+    {
+        // TODO: Handle error.
+        std::cout << "ERROR: GLFW window creation failed." << std::endl;
+        glfwTerminate();
+        return -4;
+    }
+
+    // Get buffer size information
+    glfwGetFramebufferSize(m_pWindow, &m_BufferWidth, &m_BufferHeight);
+    
+    // Set context for GLEW
+    glfwMakeContextCurrent(m_pWindow);
+
+    int swapInterval = m_Config.m_SwapMode == SWAP_IMMEDIATE ? 0 : 1;
+    if (m_Config.m_SwapMode == SWAP_ADAPTIVE && (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+    {
+        swapInterval = -1;
+    }
+    glfwSwapInterval(swapInterval);
+
+    // Allow modern extension features
+    glewExperimental = GL_TRUE;
+    GLenum res = glewInit();
+    if (res != GLEW_OK)
+    {
+        // TODO: Handle Errors 
+        std::cout << "ERROR: " << glewGetErrorString(res) << std::endl;
+        glfwDestroyWindow(m_pWindow);
+        m_pWindow = nullptr;
+        glfwTerminate();
+        return -1;
+    }
+
+    // Framebuffer objects are core since 3.0. Core profiles, Mesa's among
+    // them, don't have to list the old EXT extension.
+    if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object)
+    {
+        std::cout << "ERROR: Framebuffer objects not supported." << std::endl;
+        glfwDestroyWindow(m_pWindow);
+        m_pWindow = nullptr;
+        glfwTerminate();
+        return -2;
+    }
+
+    if (m_Config.m_Offscreen)
+    {
+        // The hidden window's framebuffer may be tiny or not exist at all.
+        if (!m_OffscreenTarget.Create(WIDTH, HEIGHT))
+        {
+            glfwDestroyWindow(m_pWindow);
+            m_pWindow = nullptr;
+            glfwTerminate();
+            return -5;
+        }
+        m_BufferWidth = WIDTH;
+        m_BufferHeight = HEIGHT;
+    }
+
+    glEnable(GL_DEPTH_TEST);
+
+    glViewport(0, 0, m_BufferWidth, m_BufferHeight);
+
+    return 0;
+}
+
+void GameApplication::CreateTestGeometry()
+{
+    m_TestVertices.Clear();
+    m_TestIndices.Clear();
+
+    if (!m_Config.m_LodScene)
+    {
+        m_TestVertices.Resize(12);
+        m_TestIndices.Resize(12);
+        memcpy(m_TestVertices.Data(), s_TriangleVertices, sizeof(s_TriangleVertices));
+        memcpy(m_TestIndices.Data(), s_TriangleIndices, sizeof(s_TriangleIndices));
+        m_TestLods.m_NumLods = 1;
+        m_TestLods.m_Lods[0] = MeshLod{ 0, 12, 0.0f };
+        return;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Unit sphere, one vertex per pole.
+    m_TestVertices.PushBack(0.0f);
+    m_TestVertices.PushBack(1.0f);
+    m_TestVertices.PushBack(0.0f);
+    for (unsigned int ring = 1; ring < LOD_SPHERE_RINGS; ring++)
+    {
+        const float theta = glm::pi<float>() * (float)ring / (float)LOD_SPHERE_RINGS;
+        for (unsigned int segment = 0; segment < LOD_SPHERE_SEGMENTS; segment++)
+        {
+            const float phi = glm::two_pi<float>() * (float)segment / (float)LOD_SPHERE_SEGMENTS;
+            m_TestVertices.PushBack(sinf(theta) * cosf(phi));
+            m_TestVertices.PushBack(cosf(theta));
+            m_TestVertices.PushBack(-sinf(theta) * sinf(phi));
+        }
+    }
+    m_TestVertices.PushBack(0.0f);
+    m_TestVertices.PushBack(-1.0f);
+    m_TestVertices.PushBack(0.0f);
+
+    const unsigned int southPole = (LOD_SPHERE_RINGS - 1) * LOD_SPHERE_SEGMENTS + 1;
+    auto vertex = [](unsigned int ring, unsigned int segment)
+    {
+        return 1 + (ring - 1) * LOD_SPHERE_SEGMENTS + segment % LOD_SPHERE_SEGMENTS;
+    };
+
+    for (unsigned int segment = 0; segment < LOD_SPHERE_SEGMENTS; segment++)
+    {
+        m_TestIndices.PushBack(0);
+        m_TestIndices.PushBack(vertex(1, segment));
+        m_TestIndices.PushBack(vertex(1, segment + 1));
+
+        for (unsigned int ring = 1; ring + 1 < LOD_SPHERE_RINGS; ring++)
+        {
+            m_TestIndices.PushBack(vertex(ring, segment));
+            m_TestIndices.PushBack(vertex(ring + 1, segment));
+            m_TestIndices.PushBack(vertex(ring, segment + 1));
+
+            m_TestIndices.PushBack(vertex(ring, segment + 1));
+            m_TestIndices.PushBack(vertex(ring + 1, segment));
+            m_TestIndices.PushBack(vertex(ring + 1, segment + 1));
+        }
+
+        m_TestIndices.PushBack(southPole);
+        m_TestIndices.PushBack(vertex(LOD_SPHERE_RINGS - 1, segment + 1));
+        m_TestIndices.PushBack(vertex(LOD_SPHERE_RINGS - 1, segment));
+    }
+
+    // Same chain the cooker would make.
+    const uint32_t numVertices = (uint32_t)(m_TestVertices.Size() / 3);
+    GenerateLodChain(m_TestIndices, m_TestLods, m_TestVertices.Data(), sizeof(GLfloat) * 3, numVertices, MAX_MESH_LODS, LOD_SPHERE_MAX_ERROR);
+
+    TArray<unsigned int> lodIndices;
+    lodIndices.Resize(m_TestIndices.Size());
+    for (uint32_t i = 0; i < m_TestLods.m_NumLods; i++)
+    {
+        const MeshLod& lod = m_TestLods.m_Lods[i];
+        OptimizeVertexCache(lodIndices.Data(), m_TestIndices.Data() + lod.m_FirstIndex, lod.m_NumIndices, numVertices);
+        memcpy(m_TestIndices.Data() + lod.m_FirstIndex, lodIndices.Data(), sizeof(unsigned int) * lod.m_NumIndices);
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "LOD sphere: " << m_TestLods.m_NumLods << " LODs built in " << elapsedMs << " ms, triangles (error):";
+    for (uint32_t i = 0; i < m_TestLods.m_NumLods; i++)
+    {
+        std::cout << " " << m_TestLods.m_Lods[i].m_NumIndices / 3 << " (" << m_TestLods.m_Lods[i].m_Error << ")";
+    }
+    std::cout << "." << std::endl;
+}
+
+// VAO will hold multiple VBO
+void GameApplication::CreateMeshes()
+{
+    // Copies of the same geometry are drawn with instancing, so one mesh is
+    // enough. More are only requested for the mesh count benchmark, and
+    // only get buffers of their own with sharing off.
+    m_Resources.SetSharing(m_Config.m_ShareResources);
+
+    const unsigned int numVertexFloats = (unsigned int)m_TestVertices.Size();
+    const uint32_t numPooled = m_Config.m_ShareResources ? 1 : m_Config.m_NumMeshes;
+    if (m_Config.m_PooledMeshes)
+    {
+        // Pooled meshes draw one range, they only get LOD 0.
+        m_GeometryPool.Create(numVertexFloats / 3 * numPooled, m_TestLods.m_Lods[0].m_NumIndices * numPooled);
+    }
+
+    for (uint32_t i = 0; i < m_Config.m_NumMeshes; i++)
+    {
+        if (m_Config.m_PooledMeshes)
+        {
+            m_Meshes.PushBack(m_Resources.CreateMesh(m_TestVertices.Data(), m_TestIndices.Data(), numVertexFloats, m_TestLods.m_Lods[0].m_NumIndices, nullptr, &m_GeometryPool));
+        }
+        else
+        {
+            m_Meshes.PushBack(m_Resources.CreateMesh(m_TestVertices.Data(), m_TestIndices.Data(), numVertexFloats, (unsigned int)m_TestIndices.Size(), &m_TestLods));
+        }
+    }
+
+    const ResourceStats& stats = m_Resources.GetMeshStats();
+    std::cout << "Meshes: " << stats.m_Live << " for " << stats.m_Requests << " requests, " << stats.m_Bytes / (1024.0 * 1024.0) << " MB, "
+        << stats.m_BytesSaved / (1024.0 * 1024.0) << " MB saved by sharing." << std::endl;
+}
+
+void GameApplication::CreateShaders()
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    Shader::EnableParallelCompile();
+
+    m_ShaderCache.Init();
+    if (m_Config.m_ClearShaderCache)
+    {
+        m_ShaderCache.Clear();
+    }
+
+    // Every combination of the features when timing a full permutation
+    // build, otherwise only the variants the scene draws with.
+    TArray<std::string> features;
+    for (const char* pFeature : s_ShaderFeatures)
+    {
+        features.PushBack(pFeature);
+    }
+    TArray<uint32_t> masks;
+    if (!m_Config.m_AllShaderVariants)
+    {
+        for (uint32_t mask : s_SceneShaderVariants)
+        {
+            masks.PushBack(mask);
+        }
+    }
+    m_ShaderPermutations.Create(vShader, fShader, features, masks, &m_ShaderCache);
+
+    for (uint32_t mask : s_SceneShaderVariants)
+    {
+        m_Shaders.PushBack(m_ShaderPermutations.GetVariant(mask));
+    }
+
+    // glFinish so the time includes compiles the driver deferred.
+    glFinish();
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_Statistics.m_ShaderMs = elapsedMs;
+    m_Statistics.m_ShaderVariants = (uint32_t)m_ShaderPermutations.GetNumVariants();
+    std::cout << m_ShaderPermutations.GetNumVariants() << " shader variants ready in " << elapsedMs << " ms (" << m_ShaderCache.GetHits() << " from cache, " << m_ShaderCache.GetMisses() << " compiled)." << std::endl;
+}
+
+void GameApplication::CreateScene()
+{
+    m_SceneEntities.Reserve(m_Config.m_NumObjects);
+
+    // The simulation needs the mesh bounds even when there is no GL context
+    // (headless), so they come from the source data.
+    m_MeshBounds.Clear();
+    m_MeshLods.Clear();
+    MeshLodChain lods = m_TestLods;
+    if (m_Config.m_PooledMeshes)
+    {
+        lods.m_NumLods = 1;
+    }
+    for (uint32_t i = 0; i < m_Config.m_NumMeshes; i++)
+    {
+        m_MeshBounds.PushBack(AABB::FromPoints(m_TestVertices.Data(), (unsigned int)(m_TestVertices.Size() / 3)));
+        m_MeshLods.PushBack(lods);
+    }
+
+    // The first two objects are the usual pair, the rest are a grid to try
+    // large scenes. The LOD scene is all grid, rows of spheres going from
+    // near the camera to far away.
+    const glm::vec3 scale = m_Config.m_LodScene ? glm::vec3(1.0f) : glm::vec3{ 0.4f, 0.4f, 1.0f };
+    for (uint32_t i = 0; i < m_Config.m_NumObjects; i++)
+    {
+        glm::vec3 position;
+        if (m_Config.m_LodScene)
+        {
+            position = glm::vec3((float)(i % 16) * 2.5f - 20.0f, (float)((i / 16) % 8) * 2.5f - 10.0f, -6.0f - (float)(i / 128) * 4.0f);
+        }
+        else if (i < 2)
+        {
+            position = glm::vec3(0.0f, (float)i, -2.5f);
+        }
+        else
+        {
+            const uint32_t cell = i - 2;
+            position = glm::vec3((float)(cell % 100) - 50.0f, (float)((cell / 100) % 100) - 50.0f, -60.0f - (float)(cell / 10000) * 2.0f);
+        }
+
+        const Transform transform{ position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), scale };
+        const Renderable renderable{ i % m_Config.m_NumMeshes, m_Config.m_Instancing ? 1u : 0u };
+        if (i < m_Config.m_SpinningObjects)
+        {
+            // Alternating directions, around the vertical.
+            const Spin spin{ glm::vec3(0.0f, 1.0f, 0.0f), i % 2 ? -SPIN_RADIANS_PER_SECOND : SPIN_RADIANS_PER_SECOND };
+            m_SceneEntities.PushBack(m_World.Create(transform, renderable, WorldTransform{}, WorldBounds{}, spin, PreviousTransform{ transform }));
+        }
+        else
+        {
+            m_SceneEntities.PushBack(m_World.Create(transform, renderable, WorldTransform{}, WorldBounds{}));
+        }
+    }
+
+    // The world bounds feed the BVH, so it waits for them.
+    const ComponentMask transformReads = MakeComponentMask<Transform, Renderable>();
+    const ComponentMask transformWrites = MakeComponentMask<WorldTransform, WorldBounds>();
+    m_Systems.AddSystem("UpdateWorldTransforms", transformReads, transformWrites, &GameApplication::UpdateWorldTransforms, this);
+    m_Systems.AddSystem("UpdateBvh", MakeComponentMask<WorldBounds>(), 0, &GameApplication::UpdateBvh, this);
+
+    // The BVH is built once over the real world bounds, from then on the
+    // systems refit it. BVH objects are entity indices, which in a new
+    // world are the positions in m_SceneEntities.
+    UpdateWorldTransforms(this, m_World, m_JobSystem);
+    TArray<AABB> bounds;
+    bounds.Reserve(m_SceneEntities.Size());
+    for (Entity entity : m_SceneEntities)
+    {
+        bounds.PushBack(m_World.Get<WorldBounds>(entity)->m_Bounds);
+    }
+    m_Bvh.Build(bounds.Data(), (uint32_t)bounds.Size());
+    m_TransformsDirty = false;
+}
+
+void GameApplication::DestroyScene()
+{
+    m_Systems.Clear();
+    m_SceneEntities.Clear();
+    m_World.Clear();
+    m_VisibleObjects.Clear();
+    m_Bvh.Build(nullptr, 0);
+
+    for (MeshHandle mesh : m_Meshes)
+    {
+        m_Resources.Release(mesh);
+    }
+    m_Meshes.Clear();
+    m_Shaders.Clear();
+    m_ShaderPermutations.Clear();
+
+    // Nothing is drawn any more, no need to wait for the deferred frees.
+    m_Resources.Clear();
+
+    if (m_pStreamMesh)
+    {
+        m_MeshPool.Destroy(m_pStreamMesh);
+        m_pStreamMesh = nullptr;
+    }
+
+    // After the meshes, they free their ranges in it.
+    m_GeometryPool.Destroy();
+}
+
+void GameApplication::CreateStreamMesh()
+{
+    // Whole triangles of float3 positions, as many as fit in the budget.
+    const unsigned int numTriangles = (unsigned int)(m_Config.m_StreamKB * 1024ull / (sizeof(GLfloat) * 9 + sizeof(unsigned int) * 3));
+    m_StreamVertices.Resize(numTriangles * 9);
+    m_StreamIndices.Resize(numTriangles * 3);
+
+    // Past the far plane: the vertices are fetched and transformed but
+    // nothing shows up on screen.
+    for (unsigned int i = 0; i < numTriangles * 3; i++)
+    {
+        m_StreamVertices[i * 3 + 0] = (GLfloat)(i % 7);
+        m_StreamVertices[i * 3 + 1] = (GLfloat)(i % 5);
+        m_StreamVertices[i * 3 + 2] = -5000.0f;
+        m_StreamIndices[i] = i;
+    }
+
+    m_pStreamMesh = m_MeshPool.Create();
+    m_pStreamMesh->CreateDynamicMesh((unsigned int)m_StreamVertices.Size(), (unsigned int)m_StreamIndices.Size(), m_Config.m_StreamFallback);
+}
+
+void GameApplication::UpdateStreamMesh(uint64_t frameIndex)
+{
+    // Touch the data so every frame really is new.
+    m_StreamVertices[0] = (GLfloat)(frameIndex % 1024);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_pStreamMesh->SetDynamicData(m_StreamVertices.Data(), (unsigned int)m_StreamVertices.Size(), m_StreamIndices.Data(), (unsigned int)m_StreamIndices.Size());
+    m_StreamTimeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_StreamBytes += m_pStreamMesh->GetDynamicBuffer().GetBytesUsed();
+}
+
+void GameApplication::SimulationMain()
+{
+    Profiler::SetThreadName("Simulation");
+
+    double lastTime = m_Clock.GetFrameTime(0);
+    for (uint64_t frameIndex = 0; ; frameIndex++)
+    {
+        FramePacket* pPacket = m_Pipeline.BeginWrite();
+        if (!pPacket)
+        {
+            break;
+        }
+
+        // As many fixed steps as fit in the time since the last packet;
+        // Simulate then draws the frame where it falls between the last two.
+        const double time = m_Clock.GetFrameTime(frameIndex);
+        const uint32_t steps = m_Timestep.Advance(time - lastTime);
+        lastTime = time;
+        for (uint32_t i = 0; i < steps; i++)
+        {
+            StepSimulation(m_Timestep.GetStep());
+        }
+
+        Simulate(*pPacket, frameIndex);
+        pPacket->m_SimulationSteps = steps;
+        m_Pipeline.EndWrite();
+    }
+}
+
+void GameApplication::Simulate(FramePacket& packet, uint64_t frameIndex)
+{
+    PROFILE_SCOPE("Simulate");
+
+    packet.m_FrameIndex = frameIndex;
+    packet.m_Projection = glm::perspective(45.0f, (GLfloat)m_BufferWidth / (GLfloat)m_BufferHeight, 0.1f, 1000.0f);
+    m_LodSelector.Setup(packet.m_Projection, (float)m_BufferHeight, m_Config.m_LodPixelError, m_Config.m_UseLods);
+
+    if (m_TransformsDirty)
+    {
+        m_Systems.Run(m_World, m_JobSystem);
+        m_TransformsDirty = false;
+    }
+
+    // Only what the camera can see goes into the packet.
+    Frustum frustum;
+    frustum.Extract(packet.m_Projection);
+
+    m_VisibleObjects.Clear();
+    {
+        PROFILE_SCOPE("Cull");
+        m_Bvh.Cull(frustum, m_VisibleObjects);
+    }
+
+    const uint32_t numVisible = (uint32_t)m_VisibleObjects.Size();
+    packet.m_Draws.Resize(numVisible);
+
+    const float alpha = m_Timestep.GetAlpha();
+    m_JobSystem.ParallelFor(numVisible, PACKET_OBJECTS_PER_JOB, [this, &packet, alpha](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const Entity entity = m_SceneEntities[m_VisibleObjects[i]];
+            const Renderable& renderable = *m_World.Get<Renderable>(entity);
+
+            // No camera yet: world space is view space.
+            const uint32_t lod = m_LodSelector.Select(m_MeshLods[renderable.m_MeshIndex], m_World.Get<WorldBounds>(entity)->m_Bounds);
+            packet.m_Draws[i] = DrawCommand{ renderable.m_MeshIndex, renderable.m_ShaderIndex, m_World.Get<WorldTransform>(entity)->m_Matrix, lod };
+
+            // Moving objects are drawn between their last two steps, so
+            // motion stays smooth when frames and steps don't line up.
+            if (const PreviousTransform* pPrevious = m_World.Get<PreviousTransform>(entity))
+            {
+                const Transform& current = *m_World.Get<Transform>(entity);
+                const Transform interpolated{ glm::mix(pPrevious->m_Value.m_Position, current.m_Position, alpha),
+                    glm::slerp(pPrevious->m_Value.m_Rotation, current.m_Rotation, alpha), glm::mix(pPrevious->m_Value.m_Scale, current.m_Scale, alpha) };
+                packet.m_Draws[i].m_Model = MakeModelMatrix(interpolated);
+            }
+        }
+    });
+
+    packet.m_Triangles = 0;
+    for (const DrawCommand& draw : packet.m_Draws)
+    {
+        packet.m_Triangles += m_MeshLods[draw.m_MeshIndex].m_Lods[draw.m_Lod].m_NumIndices / 3;
+    }
+}
+
+void GameApplication::StepSimulation(double step)
+{
+    PROFILE_SCOPE("StepSimulation");
+
+    bool moved = false;
+    m_World.ForEachChunk<const Spin, Transform, PreviousTransform>([step, &moved](uint32_t count, const Entity*, const Spin* pSpins, Transform* pTransforms, PreviousTransform* pPrevious)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pPrevious[i].m_Value = pTransforms[i];
+            const glm::quat turn = glm::angleAxis(pSpins[i].m_RadiansPerSecond * (float)step, pSpins[i].m_Axis);
+            pTransforms[i].m_Rotation = glm::normalize(turn * pTransforms[i].m_Rotation);
+        }
+        moved |= count != 0;
+    });
+    m_TransformsDirty |= moved;
+}
+
+void GameApplication::UpdateWorldTransforms(void* pData, World& world, JobSystem& jobSystem)
+{
+    const GameApplication* pApplication = static_cast<const GameApplication*>(pData);
+
+    world.ParallelForEachChunk<const Transform, const Renderable, WorldTransform, WorldBounds>(jobSystem,
+        [pApplication](uint32_t count, const Entity*, const Transform* pTransforms, const Renderable* pRenderables, WorldTransform* pWorld, WorldBounds* pBounds)
+    {
+        ComputeModelMatrices(pTransforms, count, &pWorld[0].m_Matrix, sizeof(WorldTransform));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pBounds[i].m_Bounds = pApplication->m_MeshBounds[pRenderables[i].m_MeshIndex].Transform(pWorld[i].m_Matrix);
+        }
+    });
+}
+
+void GameApplication::UpdateBvh(void* pData, World& world, JobSystem&)
+{
+    GameApplication* pApplication = static_cast<GameApplication*>(pData);
+
+    world.ForEachChunk<const WorldBounds>([pApplication](uint32_t count, const Entity* pEntities, const WorldBounds* pBounds)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pApplication->m_Bvh.UpdateObject(pEntities[i].m_Index, pBounds[i].m_Bounds);
+        }
+    });
+    pApplication->m_Bvh.Refit();
+}
+
+void GameApplication::RenderMain()
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t frameCount = 0;
+    uint64_t totalDriverCalls = 0;
+    uint64_t totalTriangles = 0;
+    uint64_t totalSteps = 0;
+    double totalFrameTime = 0.0;
+    size_t lastAllocationCount = HeapAllocator::GetAllocationCount();
+    uint64_t lastStreamBytes = 0;
+    double lastStreamTimeMs = 0.0;
+    Clock::time_point lastFrame = Clock::now();
+    m_Pacer.Init(m_Clock, m_Config.m_MaxFps);
+    m_FrameHistogram.Clear();
+
+    // Reserved up front, so keeping the times allocates nothing per frame.
+    const bool keepFrameTimes = m_Config.m_MaxFrames > m_Config.m_WarmupFrames;
+    if (keepFrameTimes)
+    {
+        m_Statistics.m_FrameTimes.Reserve((size_t)(m_Config.m_MaxFrames - m_Config.m_WarmupFrames));
+    }
+
+    // The trace is written GPU_PROFILER_LATENCY frames after the capture
+    // stops, once the GPU timestamps of its last frames are back.
+    Profiler::SetThreadName("Render");
+    bool profileWritten = m_Config.m_ProfileFrames == 0;
+    if (!profileWritten)
+    {
+        Profiler::Start();
+    }
+
+    while (m_Config.m_MaxFrames == 0 || frameCount < m_Config.m_MaxFrames)
+    {
+        if (!profileWritten && frameCount == m_Config.m_ProfileFrames)
+        {
+            Profiler::Stop();
+        }
+        else if (!profileWritten && frameCount == m_Config.m_ProfileFrames + GPU_PROFILER_LATENCY)
+        {
+            Profiler::WriteChromeTrace(m_Config.m_ProfilePath);
+            profileWritten = true;
+        }
+
+        PROFILE_SCOPE("Frame");
+        Profiler::BeginGpuFrame();
+
+        if (m_pWindow)
+        {
+            if (glfwWindowShouldClose(m_pWindow))
+            {
+                break;
+            }
+
+            // Detect any external event (Mouse, Keyboard, ...)
+            glfwPollEvents();
+        }
+
+        const FramePacket* pPacket = m_Pipeline.BeginRead();
+        if (!pPacket)
+        {
+            break;
+        }
+
+        totalTriangles += pPacket->m_Triangles;
+        totalSteps += pPacket->m_SimulationSteps;
+        const uint64_t frameTriangles = pPacket->m_Triangles;
+
+        double renderCpuMs = 0.0;
+        if (m_pWindow)
+        {
+            const Clock::time_point renderStart = Clock::now();
+            RenderFrame(*pPacket);
+            renderCpuMs = std::chrono::duration<double, std::milli>(Clock::now() - renderStart).count();
+            totalDriverCalls += m_Renderer.GetStats().m_DriverCalls;
+        }
+
+        m_Pipeline.EndRead();
+
+        if (m_pWindow)
+        {
+            // Between frames, so nothing drawn this frame sees a shader or
+            // asset change under it.
+            m_HotReloader.Update();
+            m_Resources.CollectGarbage();
+            m_Assets.Update(ASSET_UPLOAD_BUDGET_MS);
+        }
+
+        if (m_OffscreenTarget.IsCreated())
+        {
+            // Nothing to present: wait for the GPU so frame times include
+            // its work, as they would with vsync off.
+            glFinish();
+            m_Pacer.Wait();
+        }
+        else if (m_pWindow)
+        {
+            // Draw the scene, no earlier than the frame cap allows.
+            m_Pacer.Wait();
+            glfwSwapBuffers(m_pWindow);
+        }
+        else
+        {
+            m_Pacer.Wait();
+        }
+
+        // Everything allocated during the frame goes away at once.
+        m_FrameAllocator.EndFrame();
+
+        // The virtual clock gives every frame the same time, whatever it took.
+        const Clock::time_point now = Clock::now();
+        const double frameTime = m_Clock.IsVirtual() ? m_Clock.GetVirtualPeriod() * 1000.0 : std::chrono::duration<double, std::milli>(now - lastFrame).count();
+        totalFrameTime += frameTime;
+        lastFrame = now;
+        frameCount++;
+
+        const size_t allocationCount = HeapAllocator::GetAllocationCount();
+        const uint64_t frameAllocations = allocationCount - lastAllocationCount;
+        lastAllocationCount = allocationCount;
+
+        const uint64_t frameStreamBytes = m_StreamBytes - lastStreamBytes;
+        const double frameStreamTimeMs = m_StreamTimeMs - lastStreamTimeMs;
+        lastStreamBytes = m_StreamBytes;
+        lastStreamTimeMs = m_StreamTimeMs;
+
+        if (frameCount > m_Config.m_WarmupFrames)
+        {
+            if (keepFrameTimes)
+            {
+                m_Statistics.m_FrameTimes.PushBack(frameTime);
+            }
+            m_FrameHistogram.Add(frameTime);
+            m_Statistics.m_Triangles += frameTriangles;
+            m_Statistics.m_HeapAllocations += frameAllocations;
+            m_Statistics.m_RenderCpuMs += renderCpuMs;
+            m_Statistics.m_StreamBytes += frameStreamBytes;
+            m_Statistics.m_StreamMs += frameStreamTimeMs;
+            if (m_pWindow)
+            {
+                m_Statistics.m_DrawCalls += m_Renderer.GetStats().m_DrawCalls;
+                m_Statistics.m_DriverCalls += m_Renderer.GetStats().m_DriverCalls;
+            }
+        }
+    }
+    m_Statistics.m_ResidentBytes = GetResidentMemory();
+    m_Statistics.m_TextureBytes = m_Assets.GetTextureResidentBytes();
+    m_Statistics.m_TextureFullBytes = m_Assets.GetTextureFullBytes();
+    m_Statistics.m_EvictedMips = m_Assets.GetEvictedMips();
+    m_Statistics.m_RestoredMips = m_Assets.GetRestoredMips();
+    m_Statistics.m_TextureAccountingValid = m_Assets.CheckTextureAccounting();
+    m_Statistics.m_MeshBytes = m_Resources.GetMeshStats().m_Bytes;
+    m_Statistics.m_MeshBytesSaved = m_Resources.GetMeshStats().m_BytesSaved;
+
+    if (!profileWritten)
+    {
+        Profiler::Stop();
+        Profiler::WriteChromeTrace(m_Config.m_ProfilePath);
+    }
+
+    if (frameCount)
+    {
+        std::cout << "Frames: " << frameCount << ", average frame time: " << totalFrameTime / frameCount << " ms." << std::endl;
+        std::cout << "Triangles per frame: " << (double)totalTriangles / frameCount << " average (LODs " << (m_Config.m_UseLods ? "on" : "off") << ")." << std::endl;
+    }
+
+    if (frameCount > m_Config.m_WarmupFrames)
+    {
+        std::cout << "Heap allocations per frame: " << (double)m_Statistics.m_HeapAllocations / (frameCount - m_Config.m_WarmupFrames) << " average." << std::endl;
+    }
+
+    // Steps of the frames drawn only: the simulation may have run a few
+    // packets ahead, how many depends on timing.
+    if (frameCount)
+    {
+        std::cout << "Simulation: " << totalSteps << " steps of " << m_Timestep.GetStep() * 1000.0 << " ms, " << (double)totalSteps / frameCount << " per frame." << std::endl;
+    }
+
+    if (m_FrameHistogram.GetCount())
+    {
+        std::cout << "Frame times" << (m_Clock.IsVirtual() ? " (virtual clock)" : "") << ": mean " << m_FrameHistogram.GetMean() << " ms, jitter "
+            << m_FrameHistogram.GetJitter() << " ms, p99 under " << m_FrameHistogram.GetPercentile(99.0) << " ms, max " << m_FrameHistogram.GetMax() << " ms." << std::endl;
+        m_FrameHistogram.Print(std::cout);
+    }
+
+    if (m_Config.m_MaxFps > 0.0 && !m_Clock.IsVirtual() && totalFrameTime > 0.0)
+    {
+        // Time asleep is what the cap saves in power, time spinning what it
+        // costs for precision.
+        std::cout << "Pacing (" << m_Config.m_MaxFps << " fps cap): " << m_Pacer.GetSleepTime() * 100000.0 / totalFrameTime << "% asleep, "
+            << m_Pacer.GetSpinTime() * 100000.0 / totalFrameTime << "% spinning, " << m_Pacer.GetMissedFrames() << " frames late, spin margin "
+            << m_Pacer.GetSpinMargin() * 1000.0 << " ms." << std::endl;
+    }
+
+    if (m_pWindow)
+    {
+        const RenderStats& stats = m_Renderer.GetStats();
+        std::cout << "Renderer (last frame): " << stats.m_DrawItems << " items, " << stats.m_DrawCalls << " draw calls, "
+            << stats.m_ProgramBindsSkipped << " program binds skipped, " << stats.m_VAOBindsSkipped << " VAO binds skipped, "
+            << stats.m_UniformUploadsSkipped << " uniform uploads skipped, " << stats.m_Triangles << " triangles." << std::endl;
+        if (frameCount)
+        {
+            std::cout << "Driver calls per frame: " << (double)totalDriverCalls / frameCount << " average, " << stats.m_DriverCalls << " last frame ("
+                << stats.m_UniformUploads << " glUniform, " << stats.m_BufferUploads << " buffer uploads, " << stats.m_BufferBinds << " range binds)." << std::endl;
+        }
+    }
+
+    if (m_pStreamMesh && frameCount && m_StreamTimeMs > 0.0)
+    {
+        const DynamicBuffer& buffer = m_pStreamMesh->GetDynamicBuffer();
+        const double megabytes = m_StreamBytes / (1024.0 * 1024.0);
+        std::cout << "Streaming (" << (buffer.IsPersistent() ? "persistent mapped" : "orphaning") << "): " << megabytes / frameCount << " MB per frame, "
+            << megabytes / (m_StreamTimeMs / 1000.0) << " MB/s, " << buffer.GetStalls() << " fence stalls." << std::endl;
+    }
+
+    if (!m_Textures.IsEmpty())
+    {
+        std::cout << "Textures: " << m_Statistics.m_TextureBytes / (1024.0 * 1024.0) << " MB resident, " << m_Statistics.m_TextureFullBytes / (1024.0 * 1024.0)
+            << " MB with every mip (budget " << m_Config.m_TextureBudgetMB << " MB), " << m_Statistics.m_EvictedMips << " mips dropped, "
+            << m_Statistics.m_RestoredMips << " brought back." << std::endl;
+    }
+}
+
+void GameApplication::RenderFrame(const FramePacket& packet)
+{
+    PROFILE_GPU_SCOPE("Scene");
+
+    if (m_OffscreenTarget.IsCreated())
+    {
+        m_OffscreenTarget.Bind();
+    }
+
+    // Clear the Window
+    glClearColor(0,0,0,0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Here we render the scene.
+    m_Renderer.BeginFrame(packet.m_Projection);
+    for (const DrawCommand& draw : packet.m_Draws)
+    {
+        m_Renderer.Submit(m_Resources.GetMesh(m_Meshes[draw.m_MeshIndex]), m_Shaders[draw.m_ShaderIndex], draw.m_Model, draw.m_Lod);
+    }
+
+    if (m_pStreamMesh)
+    {
+        UpdateStreamMesh(packet.m_FrameIndex);
+        m_Renderer.Submit(m_pStreamMesh, m_Shaders[0], glm::mat4(1.0f));
+    }
+
+    // Nothing samples the textures yet: fetching them is what marks them
+    // as used for the texture budget.
+    if (!m_Textures.IsEmpty())
+    {
+        const size_t numTextures = m_Textures.Size();
+        const size_t window = m_Config.m_TexturesPerFrame ? std::min<size_t>(m_Config.m_TexturesPerFrame, numTextures) : numTextures;
+        for (size_t i = 0; i < window; i++)
+        {
+            m_Assets.GetTexture(m_Textures[(packet.m_FrameIndex + i) % numTextures]);
+        }
+    }
+
+    m_Renderer.Flush();
+
+    const RenderStats& stats = m_Renderer.GetStats();
+    PROFILE_COUNTER("Draw calls", stats.m_DrawCalls);
+    PROFILE_COUNTER("State changes", stats.m_StateChanges);
+    PROFILE_COUNTER("Bytes uploaded", stats.m_BytesUploaded);
+    PROFILE_COUNTER("Triangles", stats.m_Triangles);
+}
@@ -31,7 +31,295 @@
  */
 
 #pragma once
-class GameApplication
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <glm/glm.hpp>
+
+#include "Allocator.h"
+#include "AssetManager.h"
+#include "Bounds.h"
+#include "Bvh.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "GameClock.h"
+#include "GeometryPool.h"
+#include "HotReloader.h"
+#include "JobSystem.h"
+#include "MeshLod.h"
+#include "OffscreenTarget.h"
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "SceneComponents.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "SystemScheduler.h"
+#include "TArray.h"
+#include "World.h"
+
+struct GLFWwindow;
+class Mesh;
+class Shader;
+
+// How the GL context is created. EGL and OSMesa, when GLFW has its null
+// platform (3.4), need no display at all: that is how machines without a
+// GPU render, on Mesa's llvmpipe.
+enum ContextApi
+{
+	CONTEXT_API_NATIVE,
+	CONTEXT_API_EGL,
+	CONTEXT_API_OSMESA
+};
+
+// Swap interval of the window. Adaptive waits for vblank like VSYNC but
+// presents a late frame at once, tearing, instead of holding it to the
+// next vblank and halving the frame rate. It needs EXT_swap_control_tear
+// and falls back to VSYNC without it.
+enum SwapMode
+{
+	SWAP_IMMEDIATE,
+	SWAP_VSYNC,
+	SWAP_ADAPTIVE
+};
+
+struct ApplicationConfig
+{
+	// Runs only the simulation thread: no window, no GL context.
+	bool m_Headless = false;
+
+	// Renders into an OffscreenTarget with the window hidden, and waits for
+	// the GPU at the end of each frame instead of presenting.
+	bool m_Offscreen = false;
+	ContextApi m_ContextApi = CONTEXT_API_NATIVE;
+
+	// Stop after this many frames, 0 runs until the window is closed.
+	uint64_t m_MaxFrames = 0;
+
+	// Frame pacing: m_MaxFps caps the frame rate (0 for no cap) on top of
+	// what m_SwapMode does. The simulation runs in fixed steps of
+	// 1/m_SimulationHz whatever the frame rate, and frames are drawn
+	// between the last two steps.
+	double m_MaxFps = 0.0;
+	SwapMode m_SwapMode = SWAP_ADAPTIVE;
+	double m_SimulationHz = 60.0;
+
+	// Virtual clock, for CI: every frame lasts m_VirtualFrameMs, or the
+	// frame cap's period if longer, or one simulation step if both are 0,
+	// so step counts and frame times repeat exactly from run to run.
+	bool m_DeterministicClock = false;
+	double m_VirtualFrameMs = 0.0;
+
+	// Copies of the test geometry in the scene, the first
+	// m_SpinningObjects of them turning.
+	uint32_t m_NumObjects = 2;
+	uint32_t m_SpinningObjects = 2;
+
+	// Separate meshes the objects are spread over (same geometry), and
+	// whether they live in one GeometryPool instead. Used to compare
+	// per-mesh drawing against multi-draw.
+	uint32_t m_NumMeshes = 1;
+	bool m_PooledMeshes = false;
+
+	// Off, the objects use the plain shader and every one is its own draw
+	// call, to compare against instancing.
+	bool m_Instancing = true;
+
+	// Meshes with the same content share their GPU objects.
+	// Off, each of the m_NumMeshes meshes gets its own buffers.
+	bool m_ShareResources = true;
+
+	// Mesh files streamed in by the AssetManager at startup, with their
+	// vertices quantized unless m_QuantizeVertices is off.
+	TArray<std::string> m_MeshFiles;
+	bool m_QuantizeVertices = true;
+
+	// Empties the shader cache before compiling, to time a cold start.
+	bool m_ClearShaderCache = false;
+
+	// Builds every permutation of the shader features, not only the ones
+	// the scene draws with, to time a full variant build.
+	bool m_AllShaderVariants = false;
+
+	// Streaming benchmark: KB of dynamic vertex data rewritten every frame,
+	// 0 disables it. m_StreamFallback forces the GL 3.3 orphaning path.
+	uint32_t m_StreamKB = 0;
+	bool m_StreamFallback = false;
+
+	// LOD benchmark: the test geometry becomes a finely tessellated sphere
+	// with a LOD chain, and the objects recede into the distance.
+	// m_UseLods off draws everything at full detail, to compare triangles
+	// per frame. LODs are picked so their error stays under
+	// m_LodPixelError pixels.
+	bool m_LodScene = false;
+	bool m_UseLods = true;
+	float m_LodPixelError = 1.0f;
+
+	// Profiles the first m_ProfileFrames frames and writes them to
+	// m_ProfilePath as a Chrome trace. 0 leaves the profiler off.
+	uint64_t m_ProfileFrames = 0;
+	std::string m_ProfilePath = "profile.json";
+
+	// Frames left out of FrameStatistics, while shaders compile and the
+	// first uploads happen.
+	uint64_t m_WarmupFrames = 0;
+
+	// Texture files loaded at startup, held to m_TextureBudgetMB of GPU
+	// memory (0 for no limit). Each frame uses m_TexturesPerFrame of them,
+	// a window that moves on by one every frame, or all of them with 0.
+	TArray<std::string> m_TextureFiles;
+	uint32_t m_TextureBudgetMB = 0;
+	uint32_t m_TexturesPerFrame = 0;
+
+	// Rebuilds the shaders, meshes and textures when their files change.
+	bool m_HotReload = false;
+};
+
+// Measured by the render thread over every frame after the warmup.
+struct FrameStatistics
 {
+	// Milliseconds between the end of a frame and the end of the next.
+	// Only kept with ApplicationConfig::m_MaxFrames set, an open ended run
+	// has the frame time histogram alone.
+	TArray<double> m_FrameTimes;
+
+	// Totals over the same frames. Draw and driver calls stay 0 without a
+	// GL context.
+	uint64_t m_DrawCalls = 0;
+	uint64_t m_DriverCalls = 0;
+	uint64_t m_Triangles = 0;
+
+	// Time the render thread spent building and submitting the frames,
+	// without waiting for the GPU.
+	double m_RenderCpuMs = 0.0;
+
+	// Time to create the shader variants at startup, from the cache or
+	// compiled, and how many there were.
+	double m_ShaderMs = 0.0;
+	uint32_t m_ShaderVariants = 0;
+
+	// HeapAllocator allocations made by every thread over the same frames.
+	// The frame's scratch data should come from the frame allocator, so
+	// this stays near zero once the scene is loaded.
+	uint64_t m_HeapAllocations = 0;
+
+	// Resident memory of the process once the last frame is done.
+	size_t m_ResidentBytes = 0;
+
+	// GPU memory of the textures once the last frame is done, against what
+	// they would take with every mip, and mip levels the budget dropped
+	// and brought back over the whole run.
+	size_t m_TextureBytes = 0;
+	size_t m_TextureFullBytes = 0;
+	uint64_t m_EvictedMips = 0;
+	uint64_t m_RestoredMips = 0;
+
+	// Whether those totals still matched the textures, see
+	// AssetManager::CheckTextureAccounting.
+	bool m_TextureAccountingValid = true;
+
+	// GPU memory of the scene meshes, and what sharing saved.
+	size_t m_MeshBytes = 0;
+	size_t m_MeshBytesSaved = 0;
+
+	// Dynamic vertex data uploaded over the frames, and the time the
+	// uploads took. Both stay 0 unless ApplicationConfig::m_StreamKB is set.
+	uint64_t m_StreamBytes = 0;
+	double m_StreamMs = 0.0;
 };
 
+// Owns the engine main loop. A simulation thread builds FramePackets while
+// the thread that called Run (which holds the GL context) renders them one
+// frame behind.
+class GameApplication
+{
+public:
+	GameApplication();
+	~GameApplication();
+
+	int Run(const ApplicationConfig& config);
+
+	const FrameStatistics& GetFrameStatistics() const { return m_Statistics; }
+
+private:
+	ApplicationConfig m_Config;
+	GLFWwindow* m_pWindow;
+	int m_BufferWidth, m_BufferHeight;
+	OffscreenTarget m_OffscreenTarget;
+	FrameStatistics m_Statistics;
+
+	TPool<Mesh> m_MeshPool;
+	GeometryPool m_GeometryPool;
+	ResourceManager m_Resources;
+	TArray<MeshHandle> m_Meshes;
+	ShaderPermutations m_ShaderPermutations;
+	TArray<Shader*> m_Shaders;
+	ShaderCache m_ShaderCache;
+
+	// Scratch memory for data that only lives during one rendered frame.
+	FrameAllocator m_FrameAllocator;
+	Renderer m_Renderer;
+
+	AssetManager m_Assets;
+	TArray<AssetHandle> m_Textures;
+	HotReloader m_HotReloader;
+	JobSystem m_JobSystem;
+	FramePipeline m_Pipeline;
+	std::thread m_SimulationThread;
+
+	// m_Timestep belongs to the simulation thread, m_Pacer and
+	// m_FrameHistogram to the render thread.
+	GameClock m_Clock;
+	FixedTimestep m_Timestep;
+	FramePacer m_Pacer;
+	FrameTimeHistogram m_FrameHistogram;
+
+	// Source data of the test geometry, every LOD after the other in
+	// m_TestIndices. Built before the scene since headless runs need it too.
+	TArray<GLfloat> m_TestVertices;
+	TArray<unsigned int> m_TestIndices;
+	MeshLodChain m_TestLods;
+
+	// Only touched by the simulation thread once it is running. The scene
+	// is created in an empty World, so entity indices are 0..N-1 and double
+	// as object ids in the BVH.
+	World m_World;
+	SystemScheduler m_Systems;
+	TArray<Entity> m_SceneEntities;
+	TArray<AABB> m_MeshBounds;
+	TArray<MeshLodChain> m_MeshLods;
+	LodSelector m_LodSelector;
+
+	// World matrices and bounds are only recomputed when a transform changes.
+	bool m_TransformsDirty;
+	Bvh m_Bvh;
+	TArray<uint32_t> m_VisibleObjects;
+
+	// Streaming benchmark, see ApplicationConfig::m_StreamKB.
+	Mesh* m_pStreamMesh;
+	TArray<GLfloat> m_StreamVertices;
+	TArray<unsigned int> m_StreamIndices;
+	double m_StreamTimeMs;
+	uint64_t m_StreamBytes;
+
+	int InitWindow();
+	void CreateTestGeometry();
+	void CreateMeshes();
+	void CreateShaders();
+	void CreateScene();
+	void DestroyScene();
+	void CreateStreamMesh();
+	void UpdateStreamMesh(uint64_t frameIndex);
+
+	void SimulationMain();
+	void Simulate(FramePacket& packet, uint64_t frameIndex);
+	void StepSimulation(double step);
+
+	// Systems, run by m_Systems when transforms change.
+	static void UpdateWorldTransforms(void* pData, World& world, JobSystem& jobSystem);
+	static void UpdateBvh(void* pData, World& world, JobSystem& jobSystem);
+
+	void RenderMain();
+	void RenderFrame(const FramePacket& packet);
+};
@@ -0,0 +1,87 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "GameClock.h"
+
+#include <math.h>
+
+GameClock::GameClock():
+	m_Start{std::chrono::steady_clock::now()},
+	m_VirtualPeriod{0.0}
+{
+}
+
+void GameClock::Start(double virtualPeriod)
+{
+    m_Start = std::chrono::steady_clock::now();
+    m_VirtualPeriod = virtualPeriod;
+}
+
+double GameClock::GetFrameTime(uint64_t frameIndex) const
+{
+    if (IsVirtual())
+    {
+        // Multiplied rather than summed, so no rounding piles up.
+        return (double)frameIndex * m_VirtualPeriod;
+    }
+    return GetRealTime();
+}
+
+double GameClock::GetRealTime() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+}
+
+FixedTimestep::FixedTimestep():
+	m_Step{1.0 / 60.0},
+	m_MaxSteps{8},
+	m_Accumulator{0.0}
+{
+}
+
+void FixedTimestep::Init(double step, uint32_t maxSteps)
+{
+    m_Step = step;
+    m_MaxSteps = maxSteps;
+    m_Accumulator = 0.0;
+}
+
+uint32_t FixedTimestep::Advance(double elapsed)
+{
+    m_Accumulator += elapsed > 0.0 ? elapsed : 0.0;
+
+    // fmod keeps the remainder exact where subtracting steps one at a time
+    // would not, and drops what went over maxSteps with it.
+    const uint32_t steps = (uint32_t)(m_Accumulator / m_Step);
+    m_Accumulator = fmod(m_Accumulator, m_Step);
+    return steps < m_MaxSteps ? steps : m_MaxSteps;
+}
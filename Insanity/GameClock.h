@@ -0,0 +1,90 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+// Time source of the game loop, in seconds. Either real time, or a virtual
+// clock for tests and CI: there every frame lasts exactly the virtual
+// period, whatever the machine does, so a run repeats exactly.
+class GameClock
+{
+public:
+	GameClock();
+
+	// A virtualPeriod above 0 makes the clock virtual.
+	void Start(double virtualPeriod = 0.0);
+
+	bool IsVirtual() const { return m_VirtualPeriod > 0.0; }
+	double GetVirtualPeriod() const { return m_VirtualPeriod; }
+
+	// When frame frameIndex starts: now for the real clock, frameIndex
+	// virtual periods after Start for the virtual one. Any thread.
+	double GetFrameTime(uint64_t frameIndex) const;
+
+	// Seconds since Start, real time whatever the mode.
+	double GetRealTime() const;
+
+private:
+	std::chrono::steady_clock::time_point m_Start;
+	double m_VirtualPeriod;
+};
+
+// Turns variable frame times into a whole number of fixed simulation
+// steps. What is left over carries to the next frame and gives the
+// fraction of a step the rendered frame is past the last one, to
+// interpolate with.
+class FixedTimestep
+{
+public:
+	FixedTimestep();
+
+	// maxSteps bounds the steps per frame: after a long stall the time past
+	// it is dropped instead of the simulation falling further behind trying
+	// to catch up.
+	void Init(double step, uint32_t maxSteps);
+
+	// Adds elapsed seconds, returns the steps to run for them.
+	uint32_t Advance(double elapsed);
+
+	// 0 at the last step, approaching 1 just before the next.
+	float GetAlpha() const { return (float)(m_Accumulator / m_Step); }
+
+	double GetStep() const { return m_Step; }
+
+private:
+	double m_Step;
+	uint32_t m_MaxSteps;
+	double m_Accumulator;
+};
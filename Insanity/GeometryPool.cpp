@@ -0,0 +1,479 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "GeometryPool.h"
+
+#include <iostream>
+
+#include "VertexAttributes.h"
+
+static const GLsizeiptr VERTEX_SIZE = sizeof(GLfloat) * 3;
+static const GLsizeiptr INDEX_SIZE = sizeof(unsigned int);
+
+void GeometryPool::RangeAllocator::Reset(uint32_t capacity)
+{
+    m_Free.Clear();
+    if (capacity)
+    {
+        m_Free.PushBack(Range{ 0, capacity });
+    }
+    m_Capacity = capacity;
+    m_Used = 0;
+}
+
+bool GeometryPool::RangeAllocator::Allocate(uint32_t count, uint32_t& offset)
+{
+    if (!count)
+    {
+        offset = 0;
+        return true;
+    }
+
+    for (size_t i = 0; i < m_Free.Size(); i++)
+    {
+        Range& range = m_Free[i];
+        if (range.m_Count < count)
+        {
+            continue;
+        }
+
+        offset = range.m_Offset;
+        range.m_Offset += count;
+        range.m_Count -= count;
+        if (!range.m_Count)
+        {
+            for (size_t j = i; j + 1 < m_Free.Size(); j++)
+            {
+                m_Free[j] = m_Free[j + 1];
+            }
+            m_Free.PopBack();
+        }
+
+        m_Used += count;
+        return true;
+    }
+
+    return false;
+}
+
+void GeometryPool::RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+    if (!count)
+    {
+        return;
+    }
+    m_Used -= count;
+
+    // Keep the list sorted by offset and merge with the neighbours.
+    size_t position = 0;
+    while (position < m_Free.Size() && m_Free[position].m_Offset < offset)
+    {
+        position++;
+    }
+
+    const bool mergePrevious = position > 0 && m_Free[position - 1].m_Offset + m_Free[position - 1].m_Count == offset;
+    const bool mergeNext = position < m_Free.Size() && offset + count == m_Free[position].m_Offset;
+
+    if (mergePrevious && mergeNext)
+    {
+        m_Free[position - 1].m_Count += count + m_Free[position].m_Count;
+        for (size_t j = position; j + 1 < m_Free.Size(); j++)
+        {
+            m_Free[j] = m_Free[j + 1];
+        }
+        m_Free.PopBack();
+    }
+    else if (mergePrevious)
+    {
+        m_Free[position - 1].m_Count += count;
+    }
+    else if (mergeNext)
+    {
+        m_Free[position].m_Offset = offset;
+        m_Free[position].m_Count += count;
+    }
+    else
+    {
+        m_Free.PushBack(Range{ 0, 0 });
+        for (size_t j = m_Free.Size() - 1; j > position; j--)
+        {
+            m_Free[j] = m_Free[j - 1];
+        }
+        m_Free[position] = Range{ offset, count };
+    }
+}
+
+uint32_t GeometryPool::RangeAllocator::GetEnd() const
+{
+    if (!m_Free.IsEmpty() && m_Free.Back().m_Offset + m_Free.Back().m_Count == m_Capacity)
+    {
+        return m_Free.Back().m_Offset;
+    }
+    return m_Capacity;
+}
+
+GeometryPool::GeometryPool():
+    m_VAO{0},
+    m_VBO{0},
+    m_IBO{0},
+    m_Vertices{},
+    m_Indices{},
+    m_Indirect{false},
+    m_MaxInstances{0}
+{
+    m_Vertices.Reset(0);
+    m_Indices.Reset(0);
+}
+
+GeometryPool::~GeometryPool()
+{
+    Destroy();
+}
+
+bool GeometryPool::Create(uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t maxInstancesPerFrame)
+{
+    Destroy();
+
+    m_Indirect = (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+    m_MaxInstances = maxInstancesPerFrame;
+
+    m_InstanceBuffer.Create(sizeof(glm::mat4) * (size_t)m_MaxInstances);
+    if (m_Indirect)
+    {
+        m_CommandBuffer.Create(sizeof(IndirectCommand) * (size_t)m_MaxInstances);
+    }
+
+    glGenVertexArrays(1, &m_VAO);
+    CreateBuffers(vertexCapacity, indexCapacity, m_VBO, m_IBO);
+    m_Vertices.Reset(vertexCapacity);
+    m_Indices.Reset(indexCapacity);
+    SetupVAO();
+
+    return m_VAO != 0;
+}
+
+void GeometryPool::Destroy()
+{
+    if (m_VAO)
+    {
+        glDeleteVertexArrays(1, &m_VAO);
+        glDeleteBuffers(1, &m_VBO);
+        glDeleteBuffers(1, &m_IBO);
+        m_VAO = m_VBO = m_IBO = 0;
+    }
+
+    m_InstanceBuffer.Destroy();
+    m_CommandBuffer.Destroy();
+    m_Vertices.Reset(0);
+    m_Indices.Reset(0);
+    m_Allocations.Clear();
+    m_FreeHandles.Clear();
+    m_Draws.Clear();
+}
+
+void GeometryPool::CreateBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, GLuint& vbo, GLuint& ibo)
+{
+    // Uploads go through the copy targets so no VAO state is touched.
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, VERTEX_SIZE * vertexCapacity, nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, INDEX_SIZE * indexCapacity, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryPool::SetupVAO()
+{
+    glBindVertexArray(m_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IBO);
+
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(ATTRIB_INSTANCE_MODEL + column);
+        glVertexAttribDivisor(ATTRIB_INSTANCE_MODEL + column, 1);
+    }
+    SetInstanceOffset(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Unbind the VAO first so it keeps the IBO binding.
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::SetInstanceOffset(GLintptr offset)
+{
+    // Expects the VAO to be bound.
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer.GetBuffer());
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(ATTRIB_INSTANCE_MODEL + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (const void*)(offset + sizeof(glm::vec4) * column));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryHandle GeometryPool::Allocate(const GLfloat* positions, uint32_t numVertices, const unsigned int* indices, uint32_t numIndices)
+{
+    if (!m_VAO)
+    {
+        return INVALID_GEOMETRY;
+    }
+
+    uint32_t firstVertex = 0, firstIndex = 0;
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        const bool vertexFits = m_Vertices.Allocate(numVertices, firstVertex);
+        const bool indexFits = vertexFits && m_Indices.Allocate(numIndices, firstIndex);
+        if (indexFits)
+        {
+            break;
+        }
+
+        if (vertexFits)
+        {
+            m_Vertices.Free(firstVertex, numVertices);
+        }
+
+        if (attempt == 1)
+        {
+            std::cout << "ERROR: Geometry pool can't fit " << numVertices << " vertices and " << numIndices << " indices." << std::endl;
+            return INVALID_GEOMETRY;
+        }
+
+        // Out of space, or too fragmented: pack and grow.
+        const uint32_t vertexCapacity = m_Vertices.m_Capacity * 2 > m_Vertices.m_Used + numVertices ? m_Vertices.m_Capacity * 2 : m_Vertices.m_Used + numVertices;
+        const uint32_t indexCapacity = m_Indices.m_Capacity * 2 > m_Indices.m_Used + numIndices ? m_Indices.m_Capacity * 2 : m_Indices.m_Used + numIndices;
+        Compact(vertexCapacity, indexCapacity);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, VERTEX_SIZE * firstVertex, VERTEX_SIZE * numVertices, positions);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_IBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, INDEX_SIZE * firstIndex, INDEX_SIZE * numIndices, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    const Allocation allocation{ firstVertex, numVertices, firstIndex, numIndices, true };
+    GeometryHandle handle;
+    if (!m_FreeHandles.IsEmpty())
+    {
+        handle = m_FreeHandles.Back();
+        m_FreeHandles.PopBack();
+        m_Allocations[handle] = allocation;
+    }
+    else
+    {
+        handle = (GeometryHandle)m_Allocations.Size();
+        m_Allocations.PushBack(allocation);
+    }
+    return handle;
+}
+
+void GeometryPool::Free(GeometryHandle handle)
+{
+    if (handle >= m_Allocations.Size() || !m_Allocations[handle].m_Live)
+    {
+        return;
+    }
+
+    Allocation& allocation = m_Allocations[handle];
+    m_Vertices.Free(allocation.m_FirstVertex, allocation.m_NumVertices);
+    m_Indices.Free(allocation.m_FirstIndex, allocation.m_NumIndices);
+    allocation.m_Live = false;
+    m_FreeHandles.PushBack(handle);
+}
+
+void GeometryPool::Compact(uint32_t minVertexCapacity, uint32_t minIndexCapacity)
+{
+    if (!m_VAO)
+    {
+        return;
+    }
+
+    const uint32_t vertexCapacity = m_Vertices.m_Capacity > minVertexCapacity ? m_Vertices.m_Capacity : minVertexCapacity;
+    const uint32_t indexCapacity = m_Indices.m_Capacity > minIndexCapacity ? m_Indices.m_Capacity : minIndexCapacity;
+
+    GLuint vbo, ibo;
+    CreateBuffers(vertexCapacity, indexCapacity, vbo, ibo);
+
+    // Live ranges go one after another in the new buffers. Handle order
+    // is as good as any, and it never needs a sort.
+    uint32_t nextVertex = 0, nextIndex = 0;
+    for (Allocation& allocation : m_Allocations)
+    {
+        if (!allocation.m_Live)
+        {
+            continue;
+        }
+
+        if (allocation.m_NumVertices)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_VBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, VERTEX_SIZE * allocation.m_FirstVertex, VERTEX_SIZE * nextVertex, VERTEX_SIZE * allocation.m_NumVertices);
+        }
+
+        if (allocation.m_NumIndices)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_IBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, INDEX_SIZE * allocation.m_FirstIndex, INDEX_SIZE * nextIndex, INDEX_SIZE * allocation.m_NumIndices);
+        }
+
+        allocation.m_FirstVertex = nextVertex;
+        allocation.m_FirstIndex = nextIndex;
+        nextVertex += allocation.m_NumVertices;
+        nextIndex += allocation.m_NumIndices;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Draws already issued keep the old storage alive until they finish.
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_IBO);
+    m_VBO = vbo;
+    m_IBO = ibo;
+
+    m_Vertices.Reset(vertexCapacity);
+    m_Indices.Reset(indexCapacity);
+    uint32_t offset;
+    m_Vertices.Allocate(nextVertex, offset);
+    m_Indices.Allocate(nextIndex, offset);
+
+    SetupVAO();
+}
+
+float GeometryPool::GetFragmentation() const
+{
+    const uint64_t usedBytes = (uint64_t)m_Vertices.GetEnd() * VERTEX_SIZE + (uint64_t)m_Indices.GetEnd() * INDEX_SIZE;
+    const uint64_t liveBytes = (uint64_t)m_Vertices.m_Used * VERTEX_SIZE + (uint64_t)m_Indices.m_Used * INDEX_SIZE;
+    return usedBytes ? (float)(usedBytes - liveBytes) / (float)usedBytes : 0.0f;
+}
+
+void GeometryPool::Draw(GeometryHandle handle) const
+{
+    const Allocation& allocation = m_Allocations[handle];
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)allocation.m_NumIndices, GL_UNSIGNED_INT, (const void*)(INDEX_SIZE * allocation.m_FirstIndex), (GLint)allocation.m_FirstVertex);
+}
+
+void GeometryPool::BeginFrame()
+{
+    if (!m_VAO)
+    {
+        return;
+    }
+
+    m_InstanceBuffer.BeginFrame();
+    if (m_Indirect)
+    {
+        m_CommandBuffer.BeginFrame();
+    }
+}
+
+void GeometryPool::EndFrame()
+{
+    m_InstanceBuffer.EndFrame();
+    m_CommandBuffer.EndFrame();
+}
+
+void GeometryPool::BeginDraws()
+{
+    m_Draws.Clear();
+}
+
+glm::mat4* GeometryPool::AddDraw(GeometryHandle handle, uint32_t instanceCount)
+{
+    GLintptr offset;
+    void* pInstances = m_InstanceBuffer.Allocate(sizeof(glm::mat4) * instanceCount, sizeof(glm::mat4), offset);
+    if (!pInstances)
+    {
+        return nullptr;
+    }
+
+    const uint32_t baseInstance = (uint32_t)((offset - m_InstanceBuffer.GetFrameOffset()) / (GLintptr)sizeof(glm::mat4));
+    m_Draws.PushBack(PendingDraw{ handle, instanceCount, baseInstance });
+    return static_cast<glm::mat4*>(pInstances);
+}
+
+uint32_t GeometryPool::SubmitDraws()
+{
+    m_InstanceBuffer.FlushWrites();
+    if (m_Draws.IsEmpty())
+    {
+        return 0;
+    }
+
+    glBindVertexArray(m_VAO);
+    const GLintptr frameOffset = m_InstanceBuffer.GetFrameOffset();
+    SetInstanceOffset(frameOffset);
+
+    if (m_Indirect)
+    {
+        GLintptr commandOffset;
+        IndirectCommand* pCommands = static_cast<IndirectCommand*>(m_CommandBuffer.Allocate(sizeof(IndirectCommand) * m_Draws.Size(), sizeof(GLuint), commandOffset));
+        if (pCommands)
+        {
+            for (const PendingDraw& draw : m_Draws)
+            {
+                const Allocation& allocation = m_Allocations[draw.m_Handle];
+                *pCommands++ = IndirectCommand{ allocation.m_NumIndices, draw.m_InstanceCount, allocation.m_FirstIndex, (GLint)allocation.m_FirstVertex, draw.m_BaseInstance };
+            }
+            m_CommandBuffer.FlushWrites();
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer.GetBuffer());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandOffset, (GLsizei)m_Draws.Size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            return 1;
+        }
+    }
+
+    // GL 3.3 has no base instance, so every draw moves the instance
+    // attributes to its own transforms. The VAO and buffers stay bound.
+    for (const PendingDraw& draw : m_Draws)
+    {
+        const Allocation& allocation = m_Allocations[draw.m_Handle];
+        if (draw.m_BaseInstance)
+        {
+            SetInstanceOffset(frameOffset + (GLintptr)sizeof(glm::mat4) * draw.m_BaseInstance);
+        }
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)allocation.m_NumIndices, GL_UNSIGNED_INT,
+            (const void*)(INDEX_SIZE * allocation.m_FirstIndex), (GLsizei)draw.m_InstanceCount, (GLint)allocation.m_FirstVertex);
+    }
+    return (uint32_t)m_Draws.Size();
+}
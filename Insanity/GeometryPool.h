@@ -0,0 +1,158 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "DynamicBuffer.h"
+#include "TArray.h"
+
+typedef uint32_t GeometryHandle;
+static const GeometryHandle INVALID_GEOMETRY = 0xFFFFFFFF;
+
+// Suballocates the vertices and indices of many meshes out of one shared
+// vertex buffer and one shared index buffer, all behind a single VAO (one
+// pool per vertex format; float3 positions for now). Drawing a batch of
+// pooled meshes then needs one VAO bind and, with GL 4.3 /
+// ARB_multi_draw_indirect, one glMultiDrawElementsIndirect.
+//
+// Handles stay valid across Compact, which moves the ranges around.
+class GeometryPool
+{
+public:
+	GeometryPool();
+	~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// Needs a current context. Capacities grow on demand.
+	bool Create(uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t maxInstancesPerFrame = 65536);
+	void Destroy();
+
+	// numVertices counts positions (three floats each). INVALID_GEOMETRY
+	// when the data can't be stored.
+	GeometryHandle Allocate(const GLfloat* positions, uint32_t numVertices, const unsigned int* indices, uint32_t numIndices);
+	void Free(GeometryHandle handle);
+
+	// Packs every live range at the start of new buffers, with room for
+	// at least the given capacities. Copies GPU to GPU.
+	void Compact(uint32_t minVertexCapacity = 0, uint32_t minIndexCapacity = 0);
+
+	// Share of the used part of the buffers lost in holes, 0 to 1.
+	float GetFragmentation() const;
+
+	GLuint GetVAO() const { return m_VAO; }
+	bool UsesIndirect() const { return m_Indirect; }
+
+	// Single draw of one pooled mesh, for programs without instancing.
+	// The VAO must be bound.
+	void Draw(GeometryHandle handle) const;
+
+	// Once per frame, around every batch drawn in it. The instance and
+	// command rings move on by one frame here, batches take their ranges
+	// from the frame's segment.
+	void BeginFrame();
+	void EndFrame();
+
+	// Batched drawing: BeginDraws, AddDraw for every mesh (fill the
+	// returned instance transforms), SubmitDraws. Returns the number of
+	// draw calls issued. Any number of batches per frame.
+	void BeginDraws();
+	glm::mat4* AddDraw(GeometryHandle handle, uint32_t instanceCount);
+	uint32_t SubmitDraws();
+
+private:
+	struct Range
+	{
+		uint32_t m_Offset;
+		uint32_t m_Count;
+	};
+
+	// First fit over a sorted list of free ranges.
+	struct RangeAllocator
+	{
+		TArray<Range> m_Free;
+		uint32_t m_Capacity;
+		uint32_t m_Used;
+
+		void Reset(uint32_t capacity);
+		bool Allocate(uint32_t count, uint32_t& offset);
+		void Free(uint32_t offset, uint32_t count);
+		uint32_t GetEnd() const;
+	};
+
+	struct Allocation
+	{
+		uint32_t m_FirstVertex;
+		uint32_t m_NumVertices;
+		uint32_t m_FirstIndex;
+		uint32_t m_NumIndices;
+		bool m_Live;
+	};
+
+	// Layout of GL's DrawElementsIndirectCommand.
+	struct IndirectCommand
+	{
+		GLuint m_Count;
+		GLuint m_InstanceCount;
+		GLuint m_FirstIndex;
+		GLint m_BaseVertex;
+		GLuint m_BaseInstance;
+	};
+
+	struct PendingDraw
+	{
+		GeometryHandle m_Handle;
+		uint32_t m_InstanceCount;
+		uint32_t m_BaseInstance;
+	};
+
+	GLuint m_VAO, m_VBO, m_IBO;
+	RangeAllocator m_Vertices;
+	RangeAllocator m_Indices;
+	TArray<Allocation> m_Allocations;
+	TArray<GeometryHandle> m_FreeHandles;
+
+	bool m_Indirect;
+	DynamicBuffer m_InstanceBuffer;
+	DynamicBuffer m_CommandBuffer;
+	TArray<PendingDraw> m_Draws;
+	uint32_t m_MaxInstances;
+
+	void CreateBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, GLuint& vbo, GLuint& ibo);
+	void SetupVAO();
+	void SetInstanceOffset(GLintptr offset);
+};
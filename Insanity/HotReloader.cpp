@@ -0,0 +1,197 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HotReloader.h"
+
+#include <iostream>
+
+#include "Profiler.h"
+#include "Shader.h"
+
+HotReloader::HotReloader(AssetManager& assets, ShaderCache* pCache):
+	m_Assets{assets},
+	m_pCache{pCache},
+	m_Running{false}
+{
+}
+
+HotReloader::~HotReloader()
+{
+    Stop();
+}
+
+void HotReloader::AddShader(ResourceManager& resources, ShaderHandle handle, const std::string& vertexFile, const std::string& fragmentFile,
+    const std::string& defines)
+{
+    if (Shader* pShader = resources.GetShader(handle))
+    {
+        AddShader(pShader, vertexFile, fragmentFile, defines);
+        m_Shaders.Back().m_pResources = &resources;
+        m_Shaders.Back().m_Handle = handle;
+    }
+}
+
+void HotReloader::AddShader(Shader* pShader, const std::string& vertexFile, const std::string& fragmentFile, const std::string& defines)
+{
+    m_Shaders.PushBack(ShaderEntry{ pShader, nullptr, ShaderHandle{}, vertexFile, fragmentFile, defines, false, Clock::time_point{}, Clock::time_point{}, nullptr,
+        std::string{}, std::string{} });
+
+    // A fragment shader shared by several programs is only watched once;
+    // every program using it is rebuilt.
+    bool vertexWatched = false, fragmentWatched = false;
+    for (size_t i = 0; i + 1 < m_Shaders.Size(); i++)
+    {
+        vertexWatched |= m_Shaders[i].m_VertexFile == vertexFile || m_Shaders[i].m_FragmentFile == vertexFile;
+        fragmentWatched |= m_Shaders[i].m_VertexFile == fragmentFile || m_Shaders[i].m_FragmentFile == fragmentFile;
+    }
+    if (!vertexWatched)
+    {
+        m_Watcher.AddFile(vertexFile);
+    }
+    if (!fragmentWatched && fragmentFile != vertexFile)
+    {
+        m_Watcher.AddFile(fragmentFile);
+    }
+}
+
+void HotReloader::AddAsset(AssetHandle handle, const std::string& path)
+{
+    m_AssetEntries.PushBack(AssetEntry{ handle, path });
+    m_Watcher.AddFile(path);
+}
+
+bool HotReloader::Start()
+{
+    m_Running = m_Watcher.Start();
+    if (m_Running)
+    {
+        std::cout << "Hot reload watching " << m_Shaders.Size() << " shaders and " << m_AssetEntries.Size() << " assets." << std::endl;
+    }
+    return m_Running;
+}
+
+void HotReloader::Stop()
+{
+    m_Watcher.Stop();
+    m_Running = false;
+
+    // Deletes the programs of rebuilds nobody will wait for.
+    for (ShaderEntry& entry : m_Shaders)
+    {
+        m_ShaderPool.Destroy(entry.m_pPending);
+        entry.m_pPending = nullptr;
+    }
+}
+
+void HotReloader::Update()
+{
+    if (!m_Running)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("HotReloader::Update");
+
+    m_Changes.Clear();
+    m_Watcher.PollChanges(m_Changes);
+    for (const FileChange& change : m_Changes)
+    {
+        for (ShaderEntry& entry : m_Shaders)
+        {
+            if ((entry.m_VertexFile == change.m_Path || entry.m_FragmentFile == change.m_Path) && !entry.m_Dirty)
+            {
+                entry.m_Dirty = true;
+                entry.m_ChangeTime = change.m_Time;
+            }
+        }
+
+        for (const AssetEntry& entry : m_AssetEntries)
+        {
+            if (entry.m_Path == change.m_Path)
+            {
+                m_Assets.Reload(entry.m_Handle, change.m_Time);
+            }
+        }
+    }
+
+    for (ShaderEntry& entry : m_Shaders)
+    {
+        if (entry.m_pPending && entry.m_pPending->IsCompileDone())
+        {
+            FinishShader(entry);
+        }
+
+        // Changes made while a rebuild was compiling start another one
+        // once it is done.
+        if (entry.m_Dirty && !entry.m_pPending)
+        {
+            entry.m_Dirty = false;
+            entry.m_BuildChangeTime = entry.m_ChangeTime;
+            // The sources are kept until the rebuild finishes, to update
+            // the resource content with.
+            if (Shader::ReadFile(entry.m_VertexFile, entry.m_VertexCode) && Shader::ReadFile(entry.m_FragmentFile, entry.m_FragmentCode))
+            {
+                entry.m_pPending = m_ShaderPool.Create();
+                entry.m_pPending->BeginCreate(entry.m_VertexCode, entry.m_FragmentCode, m_pCache, entry.m_Defines);
+            }
+            else
+            {
+                std::cout << "ERROR: Reading " << entry.m_VertexFile << " or " << entry.m_FragmentFile << "." << std::endl;
+            }
+        }
+    }
+}
+
+void HotReloader::FinishShader(ShaderEntry& entry)
+{
+    const bool built = entry.m_pPending->FinishCreate();
+    const double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - entry.m_BuildChangeTime).count();
+    if (built)
+    {
+        // The old program ends up in the scratch Shader and goes with it.
+        entry.m_pShader->Swap(*entry.m_pPending);
+        if (entry.m_pResources)
+        {
+            entry.m_pResources->UpdateShader(entry.m_Handle, entry.m_VertexCode, entry.m_FragmentCode, entry.m_Defines);
+        }
+        std::cout << "Reloaded " << entry.m_VertexFile << " + " << entry.m_FragmentFile << " in " << latencyMs << " ms." << std::endl;
+    }
+    else
+    {
+        std::cout << "ERROR: Rebuilding " << entry.m_VertexFile << " + " << entry.m_FragmentFile << " failed, keeping the previous program." << std::endl;
+    }
+
+    m_ShaderPool.Destroy(entry.m_pPending);
+    entry.m_pPending = nullptr;
+    entry.m_VertexCode = std::string{};
+    entry.m_FragmentCode = std::string{};
+}
@@ -0,0 +1,121 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "Allocator.h"
+#include "AssetManager.h"
+#include "FileWatcher.h"
+#include "ResourceManager.h"
+#include "TArray.h"
+
+class Shader;
+class ShaderCache;
+
+// Rebuilds the shaders and assets whose files change while the engine
+// runs, without a restart. Shaders are compiled from the new sources into
+// scratch programs, on the driver's threads where it has
+// GL_KHR_parallel_shader_compile, and swapped into the running Shader at a
+// frame boundary once linked; one that fails to build leaves the running
+// program alone. Assets are read again by the AssetManager's I/O threads
+// and swapped in once uploaded (see AssetManager::Reload). Apart from the
+// FileWatcher's thread, everything happens on the render thread.
+class HotReloader
+{
+public:
+	HotReloader(AssetManager& assets, ShaderCache* pCache);
+	~HotReloader();
+
+	HotReloader(const HotReloader&) = delete;
+	HotReloader& operator=(const HotReloader&) = delete;
+
+	// Everything to watch must be added before Start.
+	void AddShader(Shader* pShader, const std::string& vertexFile, const std::string& fragmentFile, const std::string& defines = "");
+
+	// A shader owned by resources. Each rebuild that succeeds also updates
+	// the content it is shared by.
+	void AddShader(ResourceManager& resources, ShaderHandle handle, const std::string& vertexFile, const std::string& fragmentFile,
+		const std::string& defines = "");
+	void AddAsset(AssetHandle handle, const std::string& path);
+
+	bool Start();
+	void Stop();
+
+	// Call once per frame, when nothing is being drawn with the shaders,
+	// with the context current.
+	void Update();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct ShaderEntry
+	{
+		Shader* m_pShader;
+		ResourceManager* m_pResources;
+		ShaderHandle m_Handle;
+		std::string m_VertexFile;
+		std::string m_FragmentFile;
+		std::string m_Defines;
+
+		// A file changed since the last rebuild started, and when it first
+		// did. m_pPending is the rebuild in progress.
+		bool m_Dirty;
+		Clock::time_point m_ChangeTime;
+		Clock::time_point m_BuildChangeTime;
+		Shader* m_pPending;
+
+		// Sources of the rebuild in progress.
+		std::string m_VertexCode;
+		std::string m_FragmentCode;
+	};
+
+	struct AssetEntry
+	{
+		AssetHandle m_Handle;
+		std::string m_Path;
+	};
+
+	AssetManager& m_Assets;
+	ShaderCache* m_pCache;
+	FileWatcher m_Watcher;
+	bool m_Running;
+
+	TArray<ShaderEntry> m_Shaders;
+	TArray<AssetEntry> m_AssetEntries;
+	TPool<Shader> m_ShaderPool;
+	TArray<FileChange> m_Changes;
+
+	void FinishShader(ShaderEntry& entry);
+};
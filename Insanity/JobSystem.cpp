@@ -0,0 +1,345 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "JobSystem.h"
+
+#include <chrono>
+
+#include "Profiler.h"
+
+static thread_local void* s_pCurrentWorker = nullptr;
+static thread_local const JobSystem* s_pCurrentSystem = nullptr;
+
+JobDeque::JobDeque():
+    m_Top{0},
+    m_Bottom{0}
+{
+    for (int64_t i = 0; i < CAPACITY; i++)
+    {
+        m_Jobs[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool JobDeque::HasRoom() const
+{
+    return m_Bottom.load(std::memory_order_relaxed) - m_Top.load(std::memory_order_acquire) < CAPACITY;
+}
+
+bool JobDeque::Push(Job* pJob)
+{
+    const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_Top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY)
+    {
+        return false;
+    }
+
+    m_Jobs[bottom & (CAPACITY - 1)].store(pJob, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+    m_Bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_Top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty.
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* pJob = m_Jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last job, race against the thieves for it.
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            pJob = nullptr;
+        }
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return pJob;
+}
+
+Job* JobDeque::Steal()
+{
+    int64_t top = m_Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* pJob = m_Jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+
+    return pJob;
+}
+
+JobSystem::JobSystem(uint32_t numThreads):
+    m_Workers{},
+    m_Running{true},
+    m_Sleeping{0}
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0)
+        {
+            numThreads = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < numThreads; i++)
+    {
+        Worker* pWorker = new Worker();
+        pWorker->m_NextJob = 0;
+        for (std::atomic<bool>& busy : pWorker->m_SlotBusy)
+        {
+            busy.store(false, std::memory_order_relaxed);
+        }
+        pWorker->m_RandomState = 0x9E3779B9u * (i + 1);
+        m_Workers.push_back(pWorker);
+    }
+
+    // Worker 0 is the calling thread.
+    s_pCurrentWorker = m_Workers[0];
+    s_pCurrentSystem = this;
+
+    for (uint32_t i = 1; i < numThreads; i++)
+    {
+        m_Workers[i]->m_Thread = std::thread(&JobSystem::WorkerMain, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    m_Running.store(false);
+    {
+        std::lock_guard<std::mutex> lock{ m_SleepMutex };
+        m_WakeUp.notify_all();
+    }
+
+    for (Worker* pWorker : m_Workers)
+    {
+        if (pWorker->m_Thread.joinable())
+        {
+            pWorker->m_Thread.join();
+        }
+        delete pWorker;
+    }
+
+    if (s_pCurrentSystem == this)
+    {
+        s_pCurrentWorker = nullptr;
+        s_pCurrentSystem = nullptr;
+    }
+}
+
+JobSystem::Worker* JobSystem::GetCurrentWorker() const
+{
+    return s_pCurrentSystem == this ? static_cast<Worker*>(s_pCurrentWorker) : nullptr;
+}
+
+void JobSystem::Run(JobFunction function, void* pData, JobCounter* pCounter, uint32_t begin, uint32_t end)
+{
+    if (pCounter)
+    {
+        pCounter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Worker* pWorker = GetCurrentWorker();
+    if (pWorker)
+    {
+        // A job still queued, or taken but not finished, keeps its slot, so
+        // the next one in the ring may be busy. With that or a full deque
+        // the job runs here instead of blocking.
+        const uint32_t slot = pWorker->m_NextJob & (JobDeque::CAPACITY - 1);
+        if (!pWorker->m_Deque.HasRoom() || pWorker->m_SlotBusy[slot].load(std::memory_order_acquire))
+        {
+            Job job{ function, pData, begin, end, pCounter, nullptr };
+            Execute(job);
+            return;
+        }
+
+        pWorker->m_NextJob++;
+        pWorker->m_SlotBusy[slot].store(true, std::memory_order_relaxed);
+        Job* pJob = &pWorker->m_JobPool[slot];
+        *pJob = Job{ function, pData, begin, end, pCounter, &pWorker->m_SlotBusy[slot] };
+        pWorker->m_Deque.Push(pJob);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock{ m_ExternalMutex };
+        m_ExternalJobs.push_back(Job{ function, pData, begin, end, pCounter, nullptr });
+    }
+
+    if (m_Sleeping.load(std::memory_order_relaxed) > 0)
+    {
+        m_WakeUp.notify_one();
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    Worker* pWorker = GetCurrentWorker();
+    while (!counter.IsDone())
+    {
+        if (!RunOneJob(pWorker))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::Execute(Job& job)
+{
+    PROFILE_SCOPE("Job");
+    job.m_Function(job.m_pData, job.m_Begin, job.m_End);
+
+    // The counter first: its owner may be waiting on it while it fills
+    // the pool. Nothing reads job once the slot is free.
+    JobCounter* pCounter = job.m_pCounter;
+    std::atomic<bool>* pSlotBusy = job.m_pSlotBusy;
+    if (pCounter)
+    {
+        pCounter->m_Pending.fetch_sub(1, std::memory_order_release);
+    }
+    if (pSlotBusy)
+    {
+        pSlotBusy->store(false, std::memory_order_release);
+    }
+}
+
+Job* JobSystem::FindJob(Worker* pWorker, Job& externalJob)
+{
+    Job* pJob = pWorker ? pWorker->m_Deque.Pop() : nullptr;
+    if (pJob)
+    {
+        return pJob;
+    }
+
+    // Steal from a random victim first, then try everybody else in order.
+    const uint32_t numWorkers = (uint32_t)m_Workers.size();
+    uint32_t victim = 0;
+    if (pWorker)
+    {
+        uint32_t& state = pWorker->m_RandomState;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        victim = state % numWorkers;
+    }
+
+    for (uint32_t i = 0; i < numWorkers; i++)
+    {
+        Worker* pVictim = m_Workers[(victim + i) % numWorkers];
+        if (pVictim != pWorker)
+        {
+            pJob = pVictim->m_Deque.Steal();
+            if (pJob)
+            {
+                return pJob;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{ m_ExternalMutex };
+    if (!m_ExternalJobs.empty())
+    {
+        externalJob = m_ExternalJobs.front();
+        m_ExternalJobs.pop_front();
+        return &externalJob;
+    }
+
+    return nullptr;
+}
+
+bool JobSystem::RunOneJob(Worker* pWorker)
+{
+    Job externalJob;
+    Job* pJob = FindJob(pWorker, externalJob);
+    if (!pJob)
+    {
+        return false;
+    }
+
+    // Pool slots stay taken until Execute is done with them.
+    Execute(*pJob);
+    return true;
+}
+
+void JobSystem::WorkerMain(uint32_t index)
+{
+    Worker* pWorker = m_Workers[index];
+    s_pCurrentWorker = pWorker;
+    s_pCurrentSystem = this;
+    Profiler::SetThreadName("Worker");
+
+    uint32_t idleLoops = 0;
+    while (m_Running.load(std::memory_order_relaxed))
+    {
+        if (RunOneJob(pWorker))
+        {
+            idleLoops = 0;
+            continue;
+        }
+
+        if (++idleLoops < 64)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nothing to do for a while. The timeout covers a wake up sent just
+        // before we started waiting.
+        m_Sleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock{ m_SleepMutex };
+            m_WakeUp.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        m_Sleeping.fetch_sub(1);
+        idleLoops = 0;
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*JobFunction)(void* pData, uint32_t begin, uint32_t end);
+
+// Counts jobs still running. Jobs decrement it when they finish, so waiting
+// for it to reach zero is how dependencies are expressed.
+struct JobCounter
+{
+	std::atomic<uint32_t> m_Pending{0};
+
+	bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job
+{
+	JobFunction m_Function;
+	void* m_pData;
+	uint32_t m_Begin;
+	uint32_t m_End;
+	JobCounter* m_pCounter;
+
+	// Busy flag of the pool slot holding the job, cleared once it has run.
+	// nullptr for jobs that don't live in a pool.
+	std::atomic<bool>* m_pSlotBusy;
+};
+
+// Chase-Lev work-stealing deque. The owner thread pushes and pops at the
+// bottom, any other thread steals from the top.
+class JobDeque
+{
+public:
+	static const int64_t CAPACITY = 4096;
+
+	JobDeque();
+
+	// Only the owner may call these three. Push fails when the deque is
+	// full, which HasRoom tells beforehand: thieves only ever make room.
+	bool HasRoom() const;
+	bool Push(Job* pJob);
+	Job* Pop();
+
+	Job* Steal();
+
+private:
+	std::atomic<int64_t> m_Top;
+	std::atomic<int64_t> m_Bottom;
+	std::atomic<Job*> m_Jobs[CAPACITY];
+};
+
+// One worker per core. The thread that creates the JobSystem becomes worker 0
+// and runs jobs while it waits on a counter.
+class JobSystem
+{
+public:
+	explicit JobSystem(uint32_t numThreads = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Run(JobFunction function, void* pData, JobCounter* pCounter, uint32_t begin = 0, uint32_t end = 0);
+
+	// Runs jobs (or sleeps, on threads that aren't workers) until the counter
+	// reaches zero.
+	void Wait(JobCounter& counter);
+
+	// Calls function(begin, end) over [0, count) in chunks of grainSize,
+	// spread over every worker, and returns once all of them are done.
+	template<typename Function>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function);
+
+	uint32_t GetNumThreads() const { return (uint32_t)m_Workers.size(); }
+
+private:
+	// Jobs pushed by a worker live in its pool until they have run, stolen
+	// or not. A slot is taken in order and only if its last job is done.
+	struct Worker
+	{
+		JobDeque m_Deque;
+		Job m_JobPool[JobDeque::CAPACITY];
+		std::atomic<bool> m_SlotBusy[JobDeque::CAPACITY];
+		uint32_t m_NextJob;
+		uint32_t m_RandomState;
+		std::thread m_Thread;
+	};
+
+	std::vector<Worker*> m_Workers;
+	std::atomic<bool> m_Running;
+
+	// Jobs submitted from threads that are not workers.
+	std::mutex m_ExternalMutex;
+	std::deque<Job> m_ExternalJobs;
+
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeUp;
+	std::atomic<uint32_t> m_Sleeping;
+
+	void WorkerMain(uint32_t index);
+	Job* FindJob(Worker* pWorker, Job& externalJob);
+	bool RunOneJob(Worker* pWorker);
+	void Execute(Job& job);
+	Worker* GetCurrentWorker() const;
+
+	template<typename Function>
+	static void ParallelForJob(void* pData, uint32_t begin, uint32_t end)
+	{
+		(*static_cast<const Function*>(pData))(begin, end);
+	}
+};
+
+template<typename Function>
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const Function& function)
+{
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+
+	JobCounter counter;
+	for (uint32_t begin = 0; begin < count; begin += grainSize)
+	{
+		const uint32_t end = count - begin > grainSize ? begin + grainSize : count;
+		Run(&ParallelForJob<Function>, (void*)&function, &counter, begin, end);
+	}
+
+	Wait(counter);
+}
@@ -30,176 +30,199 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <string>
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
+#include <stdlib.h>
+#include <string.h>
 
-#include "TArray.h"
-#include "Mesh.h"
-#include "Shader.h"
+#include "Benchmark.h"
+#include "GameApplication.h"
 
-const GLint HEIGHT = 768, WIDTH = 1024;
-const float toRadians = 3.14159265f / 180.0f;
-
-// Vertex Shader
-static const char* vShader = "../Resources/Shaders/vShader.vert";
-
-// Fragment Shader
-static const char* fShader = "../Resources/Shaders/fShader.frag";
-
-std::vector<Mesh*> m_MeshList;
-std::vector<Shader*> m_ShaderList;
-
-// VAO will hold multiple VBO
-void CreateTriangle()
-{
-    unsigned int indices[] = {
-        0, 3, 1,
-        1, 3, 2,
-        2, 3, 0,
-        0, 1, 2
-    };
-
-    GLfloat vertices[] = {
-        -1.0f, -1.0f, 0.0f,
-        0.0f, -1.0f, 1.0f,
-        1.0f, -1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f
-    };
-
-    Mesh* pMesh = new Mesh();
-    pMesh->CreateMesh(vertices, indices, 12, 12);
-    m_MeshList.push_back(pMesh);
-
-    pMesh = new Mesh();
-    pMesh->CreateMesh(vertices, indices, 12, 12);
-    m_MeshList.push_back(pMesh);
-}
-
-void CreateShaders()
+int main(int argc, char** argv)
 {
-    Shader* pShader = new Shader();
-    pShader->CreateFromFile(vShader, fShader);
-    m_ShaderList.push_back(pShader);
-}
-
-int main()
-{
-    TArray<int> arrayOfInt{ 10 };
-    arrayOfInt.Append(15,15);
-
-    for (int i = 0; i < 10; i++)
-    {
-        arrayOfInt[i] = i;
-    }
-
-    if (glfwInit() == GLFW_FALSE)
-    {
-        // TODO: Handle error.
-        std::cout << "ERROR: GLFW initialization failed." << std::endl;
-        glfwTerminate();
-        return -3;
-    }
-
-    // Setup GLFW
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    ApplicationConfig config;
+    BenchmarkOptions benchmark;
+    bool runBenchmark = false;
 
-    GLFWwindow* pWindow = glfwCreateWindow(WIDTH, HEIGHT, "Test OpenGL Windows", nullptr, nullptr);
-    if (pWindow == nullptr)
+    for (int i = 1; i < argc; i++)
     {
-        // TODO: Handle error.
-        std::cout << "ERROR: GLFW window creation failed." << std::endl;
-        glfwTerminate();
-        return -4;
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            config.m_Headless = true;
+        }
+        else if (strcmp(argv[i], "--offscreen") == 0)
+        {
+            config.m_Offscreen = true;
+        }
+        else if (strcmp(argv[i], "--context-api") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "egl") == 0)
+            {
+                config.m_ContextApi = CONTEXT_API_EGL;
+            }
+            else if (strcmp(argv[i], "osmesa") == 0)
+            {
+                config.m_ContextApi = CONTEXT_API_OSMESA;
+            }
+            else
+            {
+                config.m_ContextApi = CONTEXT_API_NATIVE;
+            }
+        }
+        else if (strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc)
+        {
+            config.m_MaxFps = strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "off") == 0)
+            {
+                config.m_SwapMode = SWAP_IMMEDIATE;
+            }
+            else if (strcmp(argv[i], "on") == 0)
+            {
+                config.m_SwapMode = SWAP_VSYNC;
+            }
+            else
+            {
+                config.m_SwapMode = SWAP_ADAPTIVE;
+            }
+        }
+        else if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc)
+        {
+            config.m_SimulationHz = strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--spinning") == 0 && i + 1 < argc)
+        {
+            config.m_SpinningObjects = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--deterministic") == 0)
+        {
+            config.m_DeterministicClock = true;
+        }
+        else if (strcmp(argv[i], "--virtual-frame-ms") == 0 && i + 1 < argc)
+        {
+            config.m_DeterministicClock = true;
+            config.m_VirtualFrameMs = strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            runBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--benchmark-frames") == 0 && i + 1 < argc)
+        {
+            benchmark.m_Frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--benchmark-warmup") == 0 && i + 1 < argc)
+        {
+            benchmark.m_WarmupFrames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--benchmark-filter") == 0 && i + 1 < argc)
+        {
+            benchmark.m_Filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            benchmark.m_BaselinePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+        {
+            benchmark.m_SavePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+        {
+            // Percent on the command line.
+            benchmark.m_Tolerance = strtod(argv[++i], nullptr) / 100.0;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            config.m_MaxFrames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            config.m_NumObjects = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--meshes") == 0 && i + 1 < argc)
+        {
+            config.m_NumMeshes = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            config.m_NumMeshes = config.m_NumMeshes ? config.m_NumMeshes : 1;
+        }
+        else if (strcmp(argv[i], "--no-sharing") == 0)
+        {
+            config.m_ShareResources = false;
+        }
+        else if (strcmp(argv[i], "--pooled") == 0)
+        {
+            config.m_PooledMeshes = true;
+        }
+        else if (strcmp(argv[i], "--no-instancing") == 0)
+        {
+            config.m_Instancing = false;
+        }
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+        {
+            config.m_MeshFiles.PushBack(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-quantize") == 0)
+        {
+            config.m_QuantizeVertices = false;
+        }
+        else if (strcmp(argv[i], "--cold-shader-cache") == 0)
+        {
+            config.m_ClearShaderCache = true;
+        }
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+        {
+            config.m_StreamKB = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--stream-fallback") == 0)
+        {
+            config.m_StreamFallback = true;
+        }
+        else if (strcmp(argv[i], "--lod-scene") == 0)
+        {
+            config.m_LodScene = true;
+        }
+        else if (strcmp(argv[i], "--no-lods") == 0)
+        {
+            config.m_UseLods = false;
+        }
+        else if (strcmp(argv[i], "--lod-pixel-error") == 0 && i + 1 < argc)
+        {
+            config.m_LodPixelError = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+        {
+            config.m_TextureFiles.PushBack(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            config.m_TextureBudgetMB = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--textures-per-frame") == 0 && i + 1 < argc)
+        {
+            config.m_TexturesPerFrame = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--hot-reload") == 0)
+        {
+            config.m_HotReload = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            config.m_ProfileFrames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc)
+        {
+            config.m_ProfilePath = argv[++i];
+        }
     }
 
-    // Get buffer size information
-    int bufferWidth, bufferHeight;
-    glfwGetFramebufferSize(pWindow, &bufferWidth, &bufferHeight);
-    
-    // Set context for GLEW
-    glfwMakeContextCurrent(pWindow);
-
-    // Allow modern extension features
-    glewExperimental = GL_TRUE;
-    GLenum res = glewInit();
-    if (res != GLEW_OK)
-    {
-        // TODO: Handle Errors 
-        std::cout << "ERROR: " << glewGetErrorString(res) << std::endl;
-        glfwDestroyWindow(pWindow);
-        glfwTerminate();
-        return -1;
-    }
-
-    if (!GLEW_EXT_framebuffer_object)
-    {
-        // TODO: Handle error.
-        std::cout << "ERROR: There is no Extension: GLEW_EXT_framebuffer_object" << std::endl;
-        return -2;
-    }
-
-    glEnable(GL_DEPTH_TEST);
-
-    glViewport(0,0,bufferWidth, bufferHeight);
-
-    CreateTriangle();
-    CreateShaders();
-
-    glm::mat4 projection = glm::perspective(45.0f, (GLfloat)bufferWidth/(GLfloat)bufferHeight, 0.1f, 1000.0f);
-
-    while (!glfwWindowShouldClose(pWindow))
+    if (runBenchmark)
     {
-        // Detect any external event (Mouse, Keyboard, ...)
-        glfwPollEvents();
-
-        // Clear the Window
-        glClearColor(0,0,0,0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Here we render the scene.
-        m_ShaderList[0]->UseShader();
-        GLuint uniformModel = m_ShaderList[0]->GetModelLocation();
-        GLuint uniformProjection = m_ShaderList[0]->GetProjectionLocation();
-
-        // Renderizamos el primer objeto
-        // Aplicamos Transform
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f ,-2.5f));
-        model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-        // Establecemos el valor al shader.
-        glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projection));
-
-        m_MeshList[0]->RenderMesh();
-
-        // Renderizamos el segundo objeto.
-        // Aplicamos el transform
-        model = glm::mat4(1.0);
-        model = glm::translate(model, glm::vec3(0.0f, 1.0f, -2.5f));
-        model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-        glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-        m_MeshList[1]->RenderMesh();
-
-        glUseProgram(0);
-
-        // Draw the scene.
-        glfwSwapBuffers(pWindow);
+        benchmark.m_ContextApi = config.m_ContextApi;
+        return RunBenchmarks(benchmark);
     }
 
-    glfwTerminate();
-
-    return EXIT_SUCCESS;
+    GameApplication application;
+    return application.Run(config);
 }
-
@@ -32,11 +32,26 @@
 
 #include "Mesh.h"
 
+#include <string.h>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "MeshFormat.h"
+
 Mesh::Mesh():
 	m_VAO{0},
 	m_VBO{0},
     m_IBO{0},
-	m_IndexCount{0}
+	m_IndexCount{0},
+	m_IndexType{GL_UNSIGNED_INT},
+	m_Bounds{glm::vec3(0.0f), glm::vec3(0.0f)},
+	m_Layout(VertexLayout::PositionOnly()),
+	m_IndexOffset{0},
+	m_Dynamic{false},
+	m_pPool{nullptr},
+	m_PoolHandle{INVALID_GEOMETRY},
+	m_InstanceVBO{0},
+	m_InstanceCapacity{0}
 {
 }
 
@@ -45,41 +60,351 @@ Mesh::~Mesh()
     ClearMesh();
 }
 
-void Mesh::CreateMesh(const GLfloat* vertices, unsigned int* indices, unsigned int numVertices, unsigned int numIndices)
+// GL type, component count and normalization of each VertexFormat.
+struct VertexFormatGL
+{
+    GLenum m_Type;
+    GLint m_Size;
+    GLboolean m_Normalized;
+};
+
+static const VertexFormatGL s_FormatGL[NUM_VERTEX_FORMATS] =
+{
+    { GL_FLOAT, 2, GL_FALSE },
+    { GL_FLOAT, 3, GL_FALSE },
+    { GL_FLOAT, 4, GL_FALSE },
+    { GL_HALF_FLOAT, 2, GL_FALSE },
+    { GL_HALF_FLOAT, 4, GL_FALSE },
+    { GL_UNSIGNED_SHORT, 2, GL_TRUE },
+    { GL_UNSIGNED_BYTE, 4, GL_TRUE },
+    { GL_INT_2_10_10_10_REV, 4, GL_TRUE },
+};
+
+void Mesh::CreateMesh(const GLfloat* vertices, const unsigned int* indices, unsigned int numVertices, unsigned int numIndices)
+{
+    // numVertices counts floats, three per position.
+    if (vertices)
+    {
+        m_Bounds = AABB::FromPoints(vertices, numVertices / 3);
+    }
+
+    CreateBuffers(VertexLayout::PositionOnly(), vertices, numVertices / 3, indices, sizeof(unsigned int), numIndices);
+}
+
+void Mesh::CreateMesh(const VertexLayout& layout, const void* pVertexData, unsigned int numVertices,
+    const void* pIndexData, unsigned int indexSize, unsigned int numIndices, const AABB& bounds)
+{
+    m_Bounds = bounds;
+    CreateBuffers(layout, pVertexData, numVertices, pIndexData, indexSize, numIndices);
+}
+
+void Mesh::CreateBuffers(const VertexLayout& layout, const void* pVertexData, unsigned int numVertices, const void* pIndexData, unsigned int indexSize, unsigned int numIndices)
 {
     m_IndexCount = numIndices;
+    m_IndexType = indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m_Layout = layout;
+    m_Lods = MeshLodChain{};
 
     glGenVertexArrays(1, &m_VAO);
     glBindVertexArray(m_VAO);
 
     glGenBuffers(1, &m_IBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numIndices, indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexSize * numIndices, pIndexData, GL_STATIC_DRAW);
 
+    // Every stream goes in the same buffer.
     glGenBuffers(1, &m_VBO);
     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numVertices, vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)layout.GetBufferSize(numVertices), pVertexData, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    SetupLayout(layout, numVertices, 0);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Unbind the VAO first so it keeps the IBO binding.
+    glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Mesh::SetupLayout(const VertexLayout& layout, unsigned int numVertices, GLintptr baseOffset)
+{
+    for (uint32_t i = 0; i < layout.m_NumElements; i++)
+    {
+        const VertexElement& element = layout.m_Elements[i];
+        const VertexFormatGL& format = s_FormatGL[element.m_Format];
+        const GLintptr offset = baseOffset + (GLintptr)layout.GetStreamOffset(element.m_Stream, numVertices) + element.m_Offset;
+
+        glVertexAttribPointer(element.m_Attribute, format.m_Size, format.m_Type, format.m_Normalized, layout.m_Strides[element.m_Stream], (const void*)offset);
+        glEnableVertexAttribArray(element.m_Attribute);
+    }
+}
+
+bool Mesh::LoadMeshFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const MeshFileHeader* pHeader = ValidateMeshFile(file.GetData(), file.GetSize());
+    if (!pHeader)
+    {
+        std::cout << "ERROR: Loading mesh " << path << "." << std::endl;
+        return false;
+    }
+
+    // The cooker stored the bounds, no need to walk the vertices.
+    m_Bounds.m_Min = glm::vec3(pHeader->m_BoundsMin[0], pHeader->m_BoundsMin[1], pHeader->m_BoundsMin[2]);
+    m_Bounds.m_Max = glm::vec3(pHeader->m_BoundsMax[0], pHeader->m_BoundsMax[1], pHeader->m_BoundsMax[2]);
+
+    // Already in the layout the cooker picked, it goes up as is.
+    const void* pVertices = GetMeshFileSection(file.GetData(), pHeader->m_VertexOffset);
+    const void* pIndices = GetMeshFileSection(file.GetData(), pHeader->m_IndexOffset);
+    CreateBuffers(pHeader->m_Layout, pVertices, pHeader->m_NumVertices, pIndices, pHeader->m_IndexSize, pHeader->m_NumIndices);
+
+    MeshLodChain lods;
+    lods.m_NumLods = pHeader->m_NumLods;
+    memcpy(lods.m_Lods, pHeader->m_Lods, sizeof(MeshLod) * pHeader->m_NumLods);
+    SetLods(lods);
 
+    // glBufferData has its own copy now, the mapping can go.
+    return true;
+}
+
+void Mesh::CreateEmptyMesh(const VertexLayout& layout, unsigned int numVertices, unsigned int indexSize, unsigned int numIndices, const AABB& bounds)
+{
+    // glBufferData with no data just allocates.
+    CreateBuffers(layout, nullptr, numVertices, nullptr, indexSize, numIndices);
+    m_Bounds = bounds;
+}
+
+void Mesh::UpdateVertices(size_t offset, const void* pData, size_t size)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)size, pData);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::UpdateIndices(size_t offset, const void* pData, size_t size)
+{
+    // Bind through the VAO so the GL_ELEMENT_ARRAY_BUFFER binding of
+    // whatever VAO is current isn't changed.
+    glBindVertexArray(m_VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)size, pData);
     glBindVertexArray(0);
 }
 
-void Mesh::RenderMesh()
+void Mesh::CreateDynamicMesh(unsigned int maxVertices, unsigned int maxIndices, bool forceFallback)
 {
+    m_Dynamic = true;
+    m_IndexCount = 0;
+    m_IndexType = GL_UNSIGNED_INT;
+    m_Layout = VertexLayout::PositionOnly();
+
+    const size_t frameSize = sizeof(GLfloat) * maxVertices + sizeof(unsigned int) * maxIndices + sizeof(GLfloat) * 4;
+    m_DynamicBuffer.Create(frameSize, 3, forceFallback);
+
+    // Vertices and indices share the buffer. The attribute offset and the
+    // element buffer are set by SetDynamicData.
+    glGenVertexArrays(1, &m_VAO);
     glBindVertexArray(m_VAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IBO);
-    glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_DynamicBuffer.GetBuffer());
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+bool Mesh::SetDynamicData(const GLfloat* vertices, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices)
+{
+    m_DynamicBuffer.BeginFrame();
+
+    GLintptr vertexOffset = 0, indexOffset = 0;
+    void* pVertices = m_DynamicBuffer.Allocate(sizeof(GLfloat) * numVertices, sizeof(GLfloat) * 4, vertexOffset);
+    void* pIndices = m_DynamicBuffer.Allocate(sizeof(unsigned int) * numIndices, sizeof(unsigned int), indexOffset);
+    if (!pVertices || !pIndices)
+    {
+        std::cout << "ERROR: Dynamic mesh data doesn't fit (" << numVertices << " vertices, " << numIndices << " indices)." << std::endl;
+        m_DynamicBuffer.EndFrame();
+        m_IndexCount = 0;
+        return false;
+    }
+
+    memcpy(pVertices, vertices, sizeof(GLfloat) * numVertices);
+    memcpy(pIndices, indices, sizeof(unsigned int) * numIndices);
+    m_DynamicBuffer.EndFrame();
+
+    // Point the VAO at this frame's segment.
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_DynamicBuffer.GetBuffer());
+    SetupLayout(m_Layout, numVertices / 3, vertexOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    m_IndexOffset = indexOffset;
+    m_IndexCount = numIndices;
+    return true;
+}
+
+bool Mesh::CreateMeshInPool(GeometryPool& pool, const GLfloat* vertices, const unsigned int* indices, unsigned int numVertices, unsigned int numIndices)
+{
+    // numVertices counts floats, three per position.
+    m_PoolHandle = pool.Allocate(vertices, numVertices / 3, indices, numIndices);
+    if (m_PoolHandle == INVALID_GEOMETRY)
+    {
+        return false;
+    }
+
+    m_pPool = &pool;
+    m_IndexCount = numIndices;
+    m_Layout = VertexLayout::PositionOnly();
+    m_Bounds = AABB::FromPoints(vertices, numVertices / 3);
+    return true;
+}
+
+void Mesh::RenderMesh()
+{
+    // The IBO binding is part of the VAO state, binding the VAO is enough.
+    Bind();
+    Draw();
+    glBindVertexArray(0);
+}
+
+void Mesh::Bind()
+{
+    glBindVertexArray(GetVAO());
+}
+
+void Mesh::Draw(unsigned int lod)
+{
+    if (m_pPool)
+    {
+        m_pPool->Draw(m_PoolHandle);
+        return;
+    }
+
+    GLsizei indexCount;
+    GLintptr indexOffset;
+    GetLodRange(lod, indexCount, indexOffset);
+    glDrawElements(GL_TRIANGLES, indexCount, m_IndexType, (const void*)indexOffset);
+}
+
+void Mesh::DrawInstanced(unsigned int count, unsigned int lod)
+{
+    GLsizei indexCount;
+    GLintptr indexOffset;
+    GetLodRange(lod, indexCount, indexOffset);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, m_IndexType, (const void*)indexOffset, count);
+}
+
+void Mesh::SetLods(const MeshLodChain& lods)
+{
+    m_Lods = lods;
+}
+
+unsigned int Mesh::GetLodIndexCount(unsigned int lod) const
+{
+    GLsizei indexCount;
+    GLintptr indexOffset;
+    GetLodRange(lod, indexCount, indexOffset);
+    return (unsigned int)indexCount;
+}
+
+void Mesh::GetLodRange(unsigned int lod, GLsizei& count, GLintptr& offset) const
+{
+    if (m_Lods.m_NumLods == 0)
+    {
+        count = m_IndexCount;
+        offset = m_IndexOffset;
+        return;
+    }
+
+    const MeshLod& range = m_Lods.m_Lods[lod < m_Lods.m_NumLods ? lod : m_Lods.m_NumLods - 1];
+    const GLintptr indexSize = m_IndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    count = (GLsizei)range.m_NumIndices;
+    offset = m_IndexOffset + (GLintptr)range.m_FirstIndex * indexSize;
+}
+
+void Mesh::BindInstanceBuffer(unsigned int count)
+{
+    if (!m_InstanceVBO)
+    {
+        glGenBuffers(1, &m_InstanceVBO);
+
+        // A mat4 attribute takes four consecutive locations, one per column.
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            const GLuint location = ATTRIB_INSTANCE_MODEL + column;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (const void*)(sizeof(glm::vec4) * column));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+    }
+    else
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+    }
+
+    if (count > m_InstanceCapacity)
+    {
+        m_InstanceCapacity = count;
+    }
+
+    // Orphan the old storage so we don't wait for the previous frame's draws.
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_InstanceCapacity, nullptr, GL_STREAM_DRAW);
+}
+
+void Mesh::SetInstanceTransforms(const glm::mat4* pTransforms, unsigned int count)
+{
+    BindInstanceBuffer(count);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * count, pTransforms);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+glm::mat4* Mesh::MapInstanceTransforms(unsigned int count)
+{
+    BindInstanceBuffer(count);
+    return static_cast<glm::mat4*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+}
+
+void Mesh::UnmapInstanceTransforms()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::RenderInstanced(unsigned int count)
+{
+    Bind();
+    DrawInstanced(count);
     glBindVertexArray(0);
 }
 
 void Mesh::ClearMesh()
 {
+    if (m_pPool)
+    {
+        m_pPool->Free(m_PoolHandle);
+        m_pPool = nullptr;
+        m_PoolHandle = INVALID_GEOMETRY;
+    }
+
+    m_DynamicBuffer.Destroy();
+    m_Dynamic = false;
+    m_IndexOffset = 0;
+    m_Lods = MeshLodChain{};
+
+    if (m_InstanceVBO)
+    {
+        glDeleteBuffers(1, &m_InstanceVBO);
+        m_InstanceVBO = 0;
+        m_InstanceCapacity = 0;
+    }
+
     if (m_IBO)
     {
         glDeleteBuffers(1, &m_IBO);
@@ -33,6 +33,14 @@
 #pragma once
 #include <string>
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "DynamicBuffer.h"
+#include "GeometryPool.h"
+#include "MeshLod.h"
+#include "VertexAttributes.h"
+#include "VertexLayout.h"
 
 class Mesh
 {
@@ -40,13 +48,111 @@ public:
 	Mesh();
 	~Mesh();
 
-	void CreateMesh(const GLfloat *vertices, unsigned int *indices, unsigned int numVertices, unsigned int numIndices);
+	void CreateMesh(const GLfloat *vertices, const unsigned int *indices, unsigned int numVertices, unsigned int numIndices);
+
+	// Vertices in any layout: pVertexData holds layout.GetBufferSize(numVertices)
+	// bytes, numVertices counts vertices, not floats. indexSize is 2 or 4
+	// bytes.
+	void CreateMesh(const VertexLayout& layout, const void* pVertexData, unsigned int numVertices,
+		const void* pIndexData, unsigned int indexSize, unsigned int numIndices, const AABB& bounds);
+
+	// Creates the mesh from a cooked .imesh file. The file is mapped and
+	// its vertex and index ranges go straight to glBufferData. The LODs
+	// stored in the file come with it.
+	bool LoadMeshFile(const std::string& path);
+
+	// Allocates the buffers without data so they can be filled piece by
+	// piece with UpdateVertices/UpdateIndices. Offsets and sizes are in
+	// bytes; vertex data is laid out as layout says.
+	void CreateEmptyMesh(const VertexLayout& layout, unsigned int numVertices, unsigned int indexSize, unsigned int numIndices, const AABB& bounds);
+	void UpdateVertices(size_t offset, const void* pData, size_t size);
+	void UpdateIndices(size_t offset, const void* pData, size_t size);
+
+	// Dynamic mode, for geometry rewritten every frame. Float3 positions
+	// only, like pooled meshes. Vertices and indices
+	// live in a DynamicBuffer sized for maxVertices floats and maxIndices
+	// indices; SetDynamicData writes straight into it, without creating
+	// buffers or copying through the driver. Call it once per frame, before
+	// drawing the mesh. forceFallback uses the GL 3.3 orphaning path even
+	// where buffer storage is available.
+	void CreateDynamicMesh(unsigned int maxVertices, unsigned int maxIndices, bool forceFallback = false);
+	bool SetDynamicData(const GLfloat* vertices, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices);
+	bool IsDynamic() const { return m_Dynamic; }
+
+	// Pooled mode: the data goes into a shared GeometryPool and the mesh
+	// uses the pool's VAO. Instanced draws of pooled meshes must go through
+	// GeometryPool::AddDraw, not MapInstanceTransforms/DrawInstanced.
+	bool CreateMeshInPool(GeometryPool& pool, const GLfloat* vertices, const unsigned int* indices, unsigned int numVertices, unsigned int numIndices);
+	GeometryPool* GetPool() const { return m_pPool; }
+	GeometryHandle GetPoolHandle() const { return m_PoolHandle; }
+	const DynamicBuffer& GetDynamicBuffer() const { return m_DynamicBuffer; }
 	void RenderMesh();
 	void ClearMesh();
 
+	// Per-instance model matrices, read by the shader from the
+	// ATTRIB_INSTANCE_MODEL attribute.
+	void SetInstanceTransforms(const glm::mat4* pTransforms, unsigned int count);
+	void RenderInstanced(unsigned int count);
+
+	// Writes the instance transforms in place instead of copying them.
+	// The pointer is valid until UnmapInstanceTransforms.
+	glm::mat4* MapInstanceTransforms(unsigned int count);
+	void UnmapInstanceTransforms();
+
+	// Split version of RenderMesh for callers that batch draws (Renderer):
+	// Bind once, Draw as many times as needed. lod indexes GetLods(), LODs
+	// past the last one draw the last one. Pooled meshes have no LODs.
+	void Bind();
+	void Draw(unsigned int lod = 0);
+	void DrawInstanced(unsigned int count, unsigned int lod = 0);
+
+	// Index ranges of the LODs, as generated by SimplifyMesh. Meshes
+	// created without them draw every index at any LOD.
+	void SetLods(const MeshLodChain& lods);
+	const MeshLodChain& GetLods() const { return m_Lods; }
+
+	// Indices drawn at lod, to count triangles.
+	unsigned int GetLodIndexCount(unsigned int lod) const;
+
+	GLuint GetVAO() const { return m_pPool ? m_pPool->GetVAO() : m_VAO; }
+
+	// Local space bounds, computed in CreateMesh.
+	const AABB& GetBounds() const { return m_Bounds; }
+
+	const VertexLayout& GetLayout() const { return m_Layout; }
+
 private:
 	GLuint m_VAO, m_VBO, m_IBO;
 	GLsizei m_IndexCount;
+	GLenum m_IndexType;
+	AABB m_Bounds;
+	VertexLayout m_Layout;
+	MeshLodChain m_Lods;
+
+	// Byte offset of the first index in the element buffer, changes every
+	// frame in dynamic mode.
+	GLintptr m_IndexOffset;
+	bool m_Dynamic;
+	DynamicBuffer m_DynamicBuffer;
+
+	GeometryPool* m_pPool;
+	GeometryHandle m_PoolHandle;
+
+	GLuint m_InstanceVBO;
+	unsigned int m_InstanceCapacity;
+
+	// CreateMesh without computing the bounds.
+	void CreateBuffers(const VertexLayout& layout, const void* pVertexData, unsigned int numVertices, const void* pIndexData, unsigned int indexSize, unsigned int numIndices);
+
+	// Points the attributes of the bound VAO at the streams of the bound
+	// GL_ARRAY_BUFFER, starting at baseOffset.
+	static void SetupLayout(const VertexLayout& layout, unsigned int numVertices, GLintptr baseOffset);
+
+	void GetLodRange(unsigned int lod, GLsizei& count, GLintptr& offset) const;
+
+	// Creates the instance buffer on first use and leaves it bound to
+	// GL_ARRAY_BUFFER with room for count matrices.
+	void BindInstanceBuffer(unsigned int count);
 
 };
 
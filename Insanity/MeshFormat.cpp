@@ -0,0 +1,142 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MeshFormat.h"
+
+#include <string.h>
+#include <iostream>
+
+static bool IsSectionValid(uint64_t offset, uint64_t bytes, size_t fileSize)
+{
+    return offset % MESH_FILE_ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+// Largest of numIndices indices, or 0 when there are none.
+template<typename Index>
+static uint32_t GetMaxIndex(const Index* pIndices, uint32_t numIndices)
+{
+    Index maxIndex = 0;
+    for (uint32_t i = 0; i < numIndices; i++)
+    {
+        maxIndex = pIndices[i] > maxIndex ? pIndices[i] : maxIndex;
+    }
+    return maxIndex;
+}
+
+const MeshFileHeader* ValidateMeshFile(const void* pData, size_t size)
+{
+    if (!pData || size < sizeof(MeshFileHeader))
+    {
+        std::cout << "ERROR: Mesh file too small." << std::endl;
+        return nullptr;
+    }
+
+    const MeshFileHeader* pHeader = static_cast<const MeshFileHeader*>(pData);
+    if (pHeader->m_Magic != MESH_FILE_MAGIC)
+    {
+        std::cout << "ERROR: Not a mesh file." << std::endl;
+        return nullptr;
+    }
+
+    if (pHeader->m_Version != MESH_FILE_VERSION)
+    {
+        std::cout << "ERROR: Mesh file version " << pHeader->m_Version << ", expected " << MESH_FILE_VERSION << ". Cook it again." << std::endl;
+        return nullptr;
+    }
+
+    if ((pHeader->m_IndexSize != sizeof(uint16_t) && pHeader->m_IndexSize != sizeof(uint32_t)) ||
+        pHeader->m_IndexDataSize != (uint64_t)pHeader->m_NumIndices * pHeader->m_IndexSize ||
+        !IsSectionValid(pHeader->m_IndexOffset, pHeader->m_IndexDataSize, size))
+    {
+        std::cout << "ERROR: Corrupt mesh file header." << std::endl;
+        return nullptr;
+    }
+
+    if (!pHeader->m_Layout.IsValid() || pHeader->m_VertexDataSize != pHeader->m_Layout.GetBufferSize(pHeader->m_NumVertices) ||
+        !IsSectionValid(pHeader->m_VertexOffset, pHeader->m_VertexDataSize, size))
+    {
+        std::cout << "ERROR: Corrupt mesh file vertex layout." << std::endl;
+        return nullptr;
+    }
+
+    if (pHeader->m_NumLods == 0 || pHeader->m_NumLods > MAX_MESH_LODS)
+    {
+        std::cout << "ERROR: Corrupt mesh file LODs." << std::endl;
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < pHeader->m_NumLods; i++)
+    {
+        const MeshLod& lod = pHeader->m_Lods[i];
+        if (lod.m_FirstIndex > pHeader->m_NumIndices || lod.m_NumIndices > pHeader->m_NumIndices - lod.m_FirstIndex || lod.m_NumIndices % 3 != 0)
+        {
+            std::cout << "ERROR: Corrupt mesh file LOD " << i << "." << std::endl;
+            return nullptr;
+        }
+    }
+
+    // An index past the vertices would make the GPU read outside the
+    // vertex buffer. One pass over the mapped section, no copy.
+    if (pHeader->m_NumIndices)
+    {
+        const void* pIndices = GetMeshFileSection(pData, pHeader->m_IndexOffset);
+        const uint32_t maxIndex = pHeader->m_IndexSize == sizeof(uint16_t) ?
+            GetMaxIndex(static_cast<const uint16_t*>(pIndices), pHeader->m_NumIndices) :
+            GetMaxIndex(static_cast<const uint32_t*>(pIndices), pHeader->m_NumIndices);
+        if (maxIndex >= pHeader->m_NumVertices)
+        {
+            std::cout << "ERROR: Mesh file index " << maxIndex << " is past its " << pHeader->m_NumVertices << " vertices." << std::endl;
+            return nullptr;
+        }
+    }
+
+    return pHeader;
+}
+
+uint32_t EncodeMeshIndices(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, TArray<unsigned char>& data)
+{
+    const uint32_t indexSize = numVertices < 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+    data.Resize(numIndices * indexSize);
+    if (indexSize == sizeof(uint16_t))
+    {
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            const uint16_t index = (uint16_t)pIndices[i];
+            memcpy(&data[i * sizeof(uint16_t)], &index, sizeof(uint16_t));
+        }
+    }
+    else if (numIndices)
+    {
+        memcpy(data.Data(), pIndices, numIndices * sizeof(uint32_t));
+    }
+    return indexSize;
+}
@@ -0,0 +1,99 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary mesh files written by InsanityCooker (.imesh). The layout matches
+// what the GL wants, so a loaded file is mapped and its ranges handed to the
+// GL directly, without parsing or copying:
+//
+//   MeshFileHeader
+//   vertex buffer, streams laid out as m_Layout describes
+//   index buffer, the ranges of every LOD one after the other
+//
+// Every section starts on a MESH_FILE_ALIGNMENT boundary. Little endian.
+
+#include "MeshLod.h"
+#include "TArray.h"
+#include "VertexLayout.h"
+
+static const uint32_t MESH_FILE_MAGIC = 0x48534D49; // "IMSH"
+static const uint32_t MESH_FILE_VERSION = 3;
+static const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+struct MeshFileHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	uint32_t m_NumVertices;
+	uint32_t m_NumIndices;
+	uint32_t m_IndexSize;	// Bytes per index, 2 or 4.
+	uint32_t m_NumLods;	// At least 1, ranges in m_Lods.
+	uint64_t m_VertexOffset;
+	uint64_t m_VertexDataSize;
+	uint64_t m_IndexOffset;
+	uint64_t m_IndexDataSize;
+	float m_BoundsMin[3];
+	float m_BoundsMax[3];
+	VertexLayout m_Layout;
+	MeshLod m_Lods[MAX_MESH_LODS];
+	uint32_t m_Padding[2];
+};
+
+static_assert(sizeof(MeshFileHeader) % MESH_FILE_ALIGNMENT == 0, "Sections after the header must stay aligned");
+static_assert(VERTEX_STREAM_ALIGNMENT <= MESH_FILE_ALIGNMENT, "Streams inside the vertex section must stay aligned");
+
+// Checks that pData is a mesh file this build can read, that every
+// section lies inside the size bytes and that every index names one of the
+// vertices. Returns the header, or nullptr.
+const MeshFileHeader* ValidateMeshFile(const void* pData, size_t size);
+
+// Start of a section of a validated file.
+inline const void* GetMeshFileSection(const void* pData, uint64_t offset)
+{
+	return static_cast<const unsigned char*>(pData) + offset;
+}
+
+// Rounds offset up to the next section boundary.
+inline uint64_t AlignMeshFileOffset(uint64_t offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+// Writes the index section of a mesh with numVertices vertices to data:
+// 16-bit indices when every vertex fits, keeping 0xFFFF free in case
+// primitive restart is ever turned on, 32-bit otherwise. Returns the bytes
+// per index, for MeshFileHeader::m_IndexSize.
+uint32_t EncodeMeshIndices(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, TArray<unsigned char>& data);
@@ -0,0 +1,84 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MeshLod.h"
+
+#include <math.h>
+
+LodSelector::LodSelector():
+	m_PixelsPerUnit{0.0f},
+	m_MaxPixelError{1.0f},
+	m_Enabled{false}
+{
+}
+
+void LodSelector::Setup(const glm::mat4& projection, float viewportHeight, float maxPixelError, bool enabled)
+{
+    // projection[1][1] is cot(fovy / 2): a unit at distance 1 covers half
+    // of it in NDC, and NDC is viewportHeight / 2 pixels tall per unit.
+    m_PixelsPerUnit = fabsf(projection[1][1]) * viewportHeight * 0.5f;
+    m_MaxPixelError = maxPixelError;
+    m_Enabled = enabled;
+}
+
+float LodSelector::GetProjectedSize(const AABB& bounds) const
+{
+    // Bounding sphere of the box, at its nearest distance to the eye.
+    const glm::vec3 center = bounds.GetCenter();
+    const glm::vec3 extent = bounds.GetExtent();
+    const float radius = sqrtf(glm::dot(extent, extent));
+    const float distance = sqrtf(glm::dot(center, center)) - radius;
+    if (distance <= radius * 0.01f)
+    {
+        // Around the eye, as big as it gets.
+        return INFINITY;
+    }
+    return radius * 2.0f * m_PixelsPerUnit / distance;
+}
+
+uint32_t LodSelector::Select(const MeshLodChain& lods, const AABB& bounds) const
+{
+    if (!m_Enabled || lods.m_NumLods < 2)
+    {
+        return 0;
+    }
+
+    // The errors are relative to the mesh diagonal and the bounds diagonal
+    // is the sphere diameter, so error * size is the error in pixels.
+    const float size = GetProjectedSize(bounds);
+    uint32_t lod = 0;
+    while (lod + 1 < lods.m_NumLods && lods.m_Lods[lod + 1].m_Error * size <= m_MaxPixelError)
+    {
+        lod++;
+    }
+    return lod;
+}
@@ -0,0 +1,82 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+static const uint32_t MAX_MESH_LODS = 8;
+
+// One level of detail: a range of the mesh's index buffer. Every LOD
+// indexes the same vertices. m_Error is how far the LOD strays from the
+// full mesh, as a fraction of the diagonal of the mesh bounds.
+struct MeshLod
+{
+	uint32_t m_FirstIndex;
+	uint32_t m_NumIndices;
+	float m_Error;
+};
+
+// LODs of one mesh, finest first, errors growing. A chain without LODs
+// means the mesh is drawn whole.
+struct MeshLodChain
+{
+	uint32_t m_NumLods = 0;
+	MeshLod m_Lods[MAX_MESH_LODS];
+};
+
+// Picks the coarsest LOD whose error covers at most m_MaxPixelError pixels
+// once the object is projected on screen. Needs no GL, the simulation uses
+// it to fill the frame packets.
+class LodSelector
+{
+public:
+	LodSelector();
+
+	// projection of the frame and height of the viewport in pixels.
+	// Disabled selectors always return LOD 0.
+	void Setup(const glm::mat4& projection, float viewportHeight, float maxPixelError, bool enabled);
+
+	// bounds of the object in view space.
+	uint32_t Select(const MeshLodChain& lods, const AABB& bounds) const;
+
+	// Diameter of the bounds on screen, in pixels.
+	float GetProjectedSize(const AABB& bounds) const;
+
+private:
+	float m_PixelsPerUnit;	// At distance 1.
+	float m_MaxPixelError;
+	bool m_Enabled;
+};
@@ -0,0 +1,1041 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "TArray.h"
+
+// Cache size the vertex cache optimizer scores for. Bigger than the FIFO
+// hardware is usually modelled with; orders good for it are good for
+// smaller caches too.
+static const uint32_t FORSYTH_CACHE_SIZE = 32;
+
+static const uint32_t FETCH_LINE_SIZE = 64;
+static const uint32_t FETCH_CACHE_LINES = 128;
+
+static uint64_t HashVertex(uint32_t vertex, const MeshStream* pStreams, uint32_t numStreams)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t s = 0; s < numStreams; s++)
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pStreams[s].m_pData) + vertex * pStreams[s].m_Stride;
+        for (size_t i = 0; i < pStreams[s].m_Stride; i++)
+        {
+            hash = (hash ^ pBytes[i]) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+static bool VerticesEqual(uint32_t a, uint32_t b, const MeshStream* pStreams, uint32_t numStreams)
+{
+    for (uint32_t s = 0; s < numStreams; s++)
+    {
+        const unsigned char* pData = static_cast<const unsigned char*>(pStreams[s].m_pData);
+        if (memcmp(pData + a * pStreams[s].m_Stride, pData + b * pStreams[s].m_Stride, pStreams[s].m_Stride) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t GenerateVertexRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, const MeshStream* pStreams, uint32_t numStreams)
+{
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        pRemap[i] = UNUSED_VERTEX;
+    }
+
+    // Open addressing, at most half full. Holds the first vertex seen with
+    // each content.
+    size_t tableSize = 1;
+    while (tableSize < (size_t)numVertices * 2)
+    {
+        tableSize *= 2;
+    }
+    TArray<uint32_t> table;
+    table.Resize(tableSize);
+    for (uint32_t& slot : table)
+    {
+        slot = UNUSED_VERTEX;
+    }
+
+    uint32_t numUnique = 0;
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        const uint32_t vertex = pIndices[i];
+        if (pRemap[vertex] != UNUSED_VERTEX)
+        {
+            continue;
+        }
+
+        size_t slot = (size_t)HashVertex(vertex, pStreams, numStreams) & (tableSize - 1);
+        while (table[slot] != UNUSED_VERTEX && !VerticesEqual(table[slot], vertex, pStreams, numStreams))
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == UNUSED_VERTEX)
+        {
+            table[slot] = vertex;
+            pRemap[vertex] = numUnique++;
+        }
+        else
+        {
+            pRemap[vertex] = pRemap[table[slot]];
+        }
+    }
+    return numUnique;
+}
+
+uint32_t GenerateVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices)
+{
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        pRemap[i] = UNUSED_VERTEX;
+    }
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        if (pRemap[pIndices[i]] == UNUSED_VERTEX)
+        {
+            pRemap[pIndices[i]] = next++;
+        }
+    }
+    return next;
+}
+
+void RemapIndices(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const uint32_t* pRemap)
+{
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        pDst[i] = pRemap[pIndices[i]];
+    }
+}
+
+void RemapVertices(void* pDst, const void* pSrc, uint32_t numVertices, size_t stride, const uint32_t* pRemap)
+{
+    unsigned char* pDstBytes = static_cast<unsigned char*>(pDst);
+    const unsigned char* pSrcBytes = static_cast<const unsigned char*>(pSrc);
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        if (pRemap[i] != UNUSED_VERTEX)
+        {
+            memcpy(pDstBytes + pRemap[i] * stride, pSrcBytes + i * stride, stride);
+        }
+    }
+}
+
+// Forsyth's scoring: vertices recently used score high (the last triangle's
+// a bit less, so strips don't turn back), and vertices with few triangles
+// left score high so they get finished and leave the cache.
+static float ForsythVertexScore(int32_t cachePosition, uint32_t remaining)
+{
+    if (remaining == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            score = 0.75f;
+        }
+        else
+        {
+            score = powf(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+    }
+    return score + 2.0f / sqrtf((float)remaining);
+}
+
+void OptimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices)
+{
+    const size_t numTriangles = numIndices / 3;
+
+    // Triangles of each vertex that haven't been emitted yet, packed:
+    // m_Adjacency[m_AdjacencyOffset[v] .. + m_Remaining[v]].
+    TArray<uint32_t> remaining, adjacencyOffset, adjacency;
+    remaining.Resize(numVertices);
+    adjacencyOffset.Resize(numVertices);
+    adjacency.Resize(numTriangles * 3);
+    for (uint32_t& count : remaining)
+    {
+        count = 0;
+    }
+    for (size_t i = 0; i < numTriangles * 3; i++)
+    {
+        remaining[pIndices[i]]++;
+    }
+
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        adjacencyOffset[v] = offset;
+        offset += remaining[v];
+        remaining[v] = 0;
+    }
+    for (size_t i = 0; i < numTriangles * 3; i++)
+    {
+        const uint32_t v = pIndices[i];
+        adjacency[adjacencyOffset[v] + remaining[v]++] = (uint32_t)(i / 3);
+    }
+
+    TArray<int32_t> cachePosition;
+    TArray<float> vertexScore;
+    TArray<bool> emitted;
+    cachePosition.Resize(numVertices);
+    vertexScore.Resize(numVertices);
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        cachePosition[v] = -1;
+        vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+    }
+
+    emitted.Resize(numTriangles);
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        emitted[t] = false;
+    }
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cacheSize = 0;
+
+    size_t cursor = 0;
+    int64_t best = -1;
+    for (size_t output = 0; output < numTriangles; output++)
+    {
+        // Nothing in the cache has triangles left: start over from the
+        // first triangle not emitted yet.
+        if (best < 0)
+        {
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = (int64_t)cursor;
+        }
+
+        const uint32_t* pTriangle = pIndices + best * 3;
+        memcpy(pDst + output * 3, pTriangle, sizeof(uint32_t) * 3);
+        emitted[best] = true;
+
+        for (int i = 0; i < 3; i++)
+        {
+            const uint32_t v = pTriangle[i];
+            uint32_t* pAdjacency = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                if (pAdjacency[j] == (uint32_t)best)
+                {
+                    pAdjacency[j] = pAdjacency[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // The triangle's vertices go to the front, the rest move back.
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCacheSize = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            if (std::find(newCache, newCache + newCacheSize, pTriangle[i]) == newCache + newCacheSize)
+            {
+                newCache[newCacheSize++] = pTriangle[i];
+            }
+        }
+        for (uint32_t i = 0; i < cacheSize; i++)
+        {
+            if (std::find(newCache, newCache + newCacheSize, cache[i]) == newCache + newCacheSize)
+            {
+                newCache[newCacheSize++] = cache[i];
+            }
+        }
+
+        for (uint32_t i = 0; i < newCacheSize; i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int32_t)i : -1;
+            vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Rescore the triangles that changed and pick the best of them.
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < newCacheSize; i++)
+        {
+            const uint32_t v = newCache[i];
+            const uint32_t* pAdjacency = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                const uint32_t t = pAdjacency[j];
+                const float score = vertexScore[pIndices[t * 3]] + vertexScore[pIndices[t * 3 + 1]] + vertexScore[pIndices[t * 3 + 2]];
+                if (i < FORSYTH_CACHE_SIZE && score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        cacheSize = newCacheSize < FORSYTH_CACHE_SIZE ? newCacheSize : FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, sizeof(uint32_t) * cacheSize);
+    }
+}
+
+// FIFO post-transform cache. Returns how many of the triangle's vertices
+// missed.
+class FifoCache
+{
+public:
+    FifoCache(uint32_t numVertices, uint32_t size):
+        m_Size{size},
+        m_Time{size + 1}
+    {
+        m_Timestamps.Resize(numVertices);
+        for (uint32_t& timestamp : m_Timestamps)
+        {
+            timestamp = 0;
+        }
+    }
+
+    uint32_t Access(const uint32_t* pTriangle)
+    {
+        uint32_t misses = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            // A vertex is cached if it was pushed less than m_Size pushes ago.
+            uint32_t& timestamp = m_Timestamps[pTriangle[i]];
+            if (m_Time - timestamp > m_Size)
+            {
+                timestamp = m_Time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    void Reset()
+    {
+        m_Time += m_Size + 1;
+    }
+
+private:
+    TArray<uint32_t> m_Timestamps;
+    uint32_t m_Size;
+    uint32_t m_Time;
+};
+
+struct OverdrawCluster
+{
+    size_t m_First, m_Count;	// Triangles.
+    float m_SortKey;
+};
+
+void OptimizeOverdraw(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const float* pPositions, size_t positionStride, uint32_t numVertices, float threshold)
+{
+    const size_t numTriangles = numIndices / 3;
+    const unsigned char* pPositionBytes = reinterpret_cast<const unsigned char*>(pPositions);
+    auto GetPosition = [&](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(pPositionBytes + vertex * positionStride);
+    };
+
+    // Hard boundaries: triangles that miss on all three vertices, where the
+    // cache order already starts over. Moving clusters around there costs
+    // no cache efficiency.
+    TArray<size_t> hardStarts;
+    {
+        FifoCache cache(numVertices, 16);
+        for (size_t t = 0; t < numTriangles; t++)
+        {
+            if (cache.Access(pIndices + t * 3) == 3 || t == 0)
+            {
+                hardStarts.PushBack(t);
+            }
+        }
+        hardStarts.PushBack(numTriangles);
+    }
+
+    // Soft boundaries: split a hard cluster again wherever the ACMR so far
+    // is already within threshold of the cluster's.
+    TArray<OverdrawCluster> clusters;
+    for (size_t h = 0; h + 1 < hardStarts.Size(); h++)
+    {
+        const size_t start = hardStarts[h], end = hardStarts[h + 1];
+
+        FifoCache cache(numVertices, 16);
+        uint32_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++)
+        {
+            clusterMisses += cache.Access(pIndices + t * 3);
+        }
+        const float limit = threshold * (float)clusterMisses / (float)(end - start);
+
+        cache.Reset();
+        size_t first = start;
+        uint32_t misses = 0;
+        for (size_t t = start; t < end; t++)
+        {
+            misses += cache.Access(pIndices + t * 3);
+            if (t + 1 == end || (float)misses / (float)(t + 1 - first) <= limit)
+            {
+                clusters.PushBack(OverdrawCluster{ first, t + 1 - first, 0.0f });
+                first = t + 1;
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+
+    // Area weighted centroid of the whole mesh, and of each cluster with
+    // its average normal. Clusters far out from the centre and facing away
+    // from it are likely to be in front of the rest from any view.
+    float meshCentroid[3] = {}, meshArea = 0.0f;
+    TArray<float> clusterData;
+    clusterData.Resize(clusters.Size() * 7);
+    for (size_t c = 0; c < clusters.Size(); c++)
+    {
+        float* pData = &clusterData[c * 7];
+        memset(pData, 0, sizeof(float) * 7);
+
+        for (size_t t = clusters[c].m_First; t < clusters[c].m_First + clusters[c].m_Count; t++)
+        {
+            const float* p0 = GetPosition(pIndices[t * 3]);
+            const float* p1 = GetPosition(pIndices[t * 3 + 1]);
+            const float* p2 = GetPosition(pIndices[t * 3 + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (int i = 0; i < 3; i++)
+            {
+                const float centroid = (p0[i] + p1[i] + p2[i]) / 3.0f;
+                pData[i] += centroid * area;
+                pData[3 + i] += normal[i];
+                meshCentroid[i] += centroid * area;
+            }
+            pData[6] += area;
+            meshArea += area;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        meshCentroid[i] = meshArea > 0.0f ? meshCentroid[i] / meshArea : 0.0f;
+    }
+
+    for (size_t c = 0; c < clusters.Size(); c++)
+    {
+        const float* pData = &clusterData[c * 7];
+        const float area = pData[6] > 0.0f ? pData[6] : 1.0f;
+        const float normalLength = sqrtf(pData[3] * pData[3] + pData[4] * pData[4] + pData[5] * pData[5]);
+
+        float key = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            key += (pData[i] / area - meshCentroid[i]) * (normalLength > 0.0f ? pData[3 + i] / normalLength : 0.0f);
+        }
+        clusters[c].m_SortKey = key;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster& a, const OverdrawCluster& b)
+    {
+        return a.m_SortKey > b.m_SortKey;
+    });
+
+    size_t output = 0;
+    for (const OverdrawCluster& cluster : clusters)
+    {
+        memcpy(pDst + output * 3, pIndices + cluster.m_First * 3, sizeof(uint32_t) * 3 * cluster.m_Count);
+        output += cluster.m_Count;
+    }
+}
+
+// Simplifier.
+
+enum SimplifyVertexKind
+{
+    SIMPLIFY_MANIFOLD,  // Collapses along any edge.
+    SIMPLIFY_BORDER,    // On an open border, collapses only along it.
+    SIMPLIFY_LOCKED,    // Seam, non-manifold or border corner, never moves.
+};
+
+// Weight of the planes that keep borders in place, relative to the area
+// weights of the triangle planes.
+static const float BORDER_WEIGHT = 10.0f;
+
+// A collapse is rejected when it turns a triangle more than this (cosine).
+static const float MAX_NORMAL_CHANGE = 0.25f;
+
+// A LOD must drop at least 1 / MIN_LOD_REDUCTION of the previous LOD's
+// triangles, or it isn't worth its index range.
+static const uint32_t MIN_LOD_REDUCTION = 10;
+
+// Sum of weighted squared distances to a set of planes: p'Ap + 2b'p + c,
+// with A symmetric.
+struct Quadric
+{
+    float m_A00, m_A11, m_A22, m_A01, m_A02, m_A12;
+    float m_B0, m_B1, m_B2;
+    float m_C;
+    float m_Weight;
+};
+
+struct SimplifyCollapse
+{
+    uint32_t m_From;
+    uint32_t m_To;
+    float m_Error;
+};
+
+static void AddPlane(Quadric& q, const float* pNormal, float distance, float weight)
+{
+    const float x = pNormal[0], y = pNormal[1], z = pNormal[2];
+    q.m_A00 += weight * x * x;
+    q.m_A11 += weight * y * y;
+    q.m_A22 += weight * z * z;
+    q.m_A01 += weight * x * y;
+    q.m_A02 += weight * x * z;
+    q.m_A12 += weight * y * z;
+    q.m_B0 += weight * x * distance;
+    q.m_B1 += weight * y * distance;
+    q.m_B2 += weight * z * distance;
+    q.m_C += weight * distance * distance;
+    q.m_Weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+    q.m_A00 += other.m_A00;
+    q.m_A11 += other.m_A11;
+    q.m_A22 += other.m_A22;
+    q.m_A01 += other.m_A01;
+    q.m_A02 += other.m_A02;
+    q.m_A12 += other.m_A12;
+    q.m_B0 += other.m_B0;
+    q.m_B1 += other.m_B1;
+    q.m_B2 += other.m_B2;
+    q.m_C += other.m_C;
+    q.m_Weight += other.m_Weight;
+}
+
+// Weighted mean squared distance from p to the planes.
+static float EvaluateQuadric(const Quadric& q, const float* p)
+{
+    const float x = p[0], y = p[1], z = p[2];
+    const float rx = q.m_A00 * x + q.m_A01 * y + q.m_A02 * z;
+    const float ry = q.m_A01 * x + q.m_A11 * y + q.m_A12 * z;
+    const float rz = q.m_A02 * x + q.m_A12 * y + q.m_A22 * z;
+    const float error = rx * x + ry * y + rz * z + 2.0f * (q.m_B0 * x + q.m_B1 * y + q.m_B2 * z) + q.m_C;
+    return q.m_Weight > 0.0f ? fabsf(error) / q.m_Weight : 0.0f;
+}
+
+static void Cross(float* pResult, const float* a, const float* b)
+{
+    pResult[0] = a[1] * b[2] - a[2] * b[1];
+    pResult[1] = a[2] * b[0] - a[0] * b[2];
+    pResult[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float Dot(const float* a, const float* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Unnormalized normal, its length is twice the area.
+static void TriangleNormal(float* pNormal, const float* p0, const float* p1, const float* p2)
+{
+    const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    Cross(pNormal, e0, e1);
+}
+
+// Triangles of each vertex, rebuilt from the current index buffer on every
+// pass.
+struct SimplifyAdjacency
+{
+    TArray<uint32_t> m_Offsets;
+    TArray<uint32_t> m_Counts;
+    TArray<uint32_t> m_Triangles;
+
+    void Build(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices)
+    {
+        m_Offsets.Resize(numVertices);
+        m_Counts.Resize(numVertices);
+        m_Triangles.Resize(numIndices);
+        for (uint32_t& count : m_Counts)
+        {
+            count = 0;
+        }
+
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            m_Counts[pIndices[i]]++;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < numVertices; v++)
+        {
+            m_Offsets[v] = offset;
+            offset += m_Counts[v];
+            m_Counts[v] = 0;
+        }
+
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            const uint32_t vertex = pIndices[i];
+            m_Triangles[m_Offsets[vertex] + m_Counts[vertex]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    // Triangles that have the directed edge a -> b.
+    uint32_t CountEdge(const uint32_t* pIndices, uint32_t a, uint32_t b) const
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < m_Counts[a]; i++)
+        {
+            const uint32_t* pTriangle = pIndices + m_Triangles[m_Offsets[a] + i] * 3;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (pTriangle[k] == a && pTriangle[(k + 1) % 3] == b)
+                {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+};
+
+static void ClassifyVertices(TArray<uint8_t>& kinds, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, const float* pPositions, const SimplifyAdjacency& adjacency)
+{
+    kinds.Resize(numVertices);
+    for (uint8_t& kind : kinds)
+    {
+        kind = SIMPLIFY_MANIFOLD;
+    }
+
+    // Moving one of the vertices of a seam would tear it open.
+    TArray<uint32_t> positionRemap, positionUses;
+    positionRemap.Resize(numVertices);
+    positionUses.Resize(numVertices);
+    const MeshStream positions = { pPositions, sizeof(float) * 3 };
+    GenerateVertexRemap(positionRemap.Data(), pIndices, numIndices, numVertices, &positions, 1);
+    for (uint32_t& uses : positionUses)
+    {
+        uses = 0;
+    }
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        if (positionRemap[v] != UNUSED_VERTEX)
+        {
+            positionUses[positionRemap[v]]++;
+        }
+    }
+
+    TArray<uint32_t> borderEdges;
+    borderEdges.Resize(numVertices);
+    for (uint32_t& count : borderEdges)
+    {
+        count = 0;
+    }
+
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        const uint32_t a = pIndices[i];
+        const uint32_t b = pIndices[i - i % 3 + (i + 1) % 3];
+        if (adjacency.CountEdge(pIndices, a, b) > 1)
+        {
+            kinds[a] = SIMPLIFY_LOCKED;
+            kinds[b] = SIMPLIFY_LOCKED;
+        }
+        else if (adjacency.CountEdge(pIndices, b, a) == 0)
+        {
+            borderEdges[a]++;
+        }
+    }
+
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        if (positionRemap[v] != UNUSED_VERTEX && positionUses[positionRemap[v]] > 1)
+        {
+            kinds[v] = SIMPLIFY_LOCKED;
+        }
+        else if (kinds[v] == SIMPLIFY_MANIFOLD && borderEdges[v] > 0)
+        {
+            // A vertex where two borders meet is a corner.
+            kinds[v] = borderEdges[v] == 1 ? SIMPLIFY_BORDER : SIMPLIFY_LOCKED;
+        }
+    }
+}
+
+// Whether moving from to the position of to flips or degenerates one of
+// the triangles around from.
+static bool FlipsTriangles(const uint32_t* pIndices, const SimplifyAdjacency& adjacency, const uint32_t* pRemap, const float* pPositions, uint32_t from, uint32_t to)
+{
+    for (uint32_t i = 0; i < adjacency.m_Counts[from]; i++)
+    {
+        const uint32_t* pTriangle = pIndices + adjacency.m_Triangles[adjacency.m_Offsets[from] + i] * 3;
+        const uint32_t v0 = pRemap[pTriangle[0]], v1 = pRemap[pTriangle[1]], v2 = pRemap[pTriangle[2]];
+        if (v0 == to || v1 == to || v2 == to)
+        {
+            // Goes away with the collapse.
+            continue;
+        }
+
+        float before[3], after[3];
+        TriangleNormal(before, pPositions + v0 * 3, pPositions + v1 * 3, pPositions + v2 * 3);
+        TriangleNormal(after,
+            pPositions + (v0 == from ? to : v0) * 3,
+            pPositions + (v1 == from ? to : v1) * 3,
+            pPositions + (v2 == from ? to : v2) * 3);
+
+        if (Dot(before, after) <= MAX_NORMAL_CHANGE * sqrtf(Dot(before, before) * Dot(after, after)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SimplifyMesh(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const float* pPositions, size_t positionStride, uint32_t numVertices,
+    size_t targetIndices, float targetError, float* pResultError)
+{
+    TArray<uint32_t> indices;
+    indices.Resize(numIndices);
+    memcpy(indices.Data(), pIndices, sizeof(uint32_t) * numIndices);
+
+    // Packed positions, scaled into the unit cube so the quadrics keep
+    // their precision whatever the size of the mesh.
+    TArray<float> positions;
+    positions.Resize((size_t)numVertices * 3);
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f }, boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        const float* pPosition = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(pPositions) + v * positionStride);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            positions[v * 3 + k] = pPosition[k];
+            boundsMin[k] = v == 0 ? pPosition[k] : std::min(boundsMin[k], pPosition[k]);
+            boundsMax[k] = v == 0 ? pPosition[k] : std::max(boundsMax[k], pPosition[k]);
+        }
+    }
+
+    // Before scaling: seams are found by exact position.
+    SimplifyAdjacency adjacency;
+    adjacency.Build(indices.Data(), numIndices, numVertices);
+    TArray<uint8_t> kinds;
+    ClassifyVertices(kinds, indices.Data(), numIndices, numVertices, positions.Data(), adjacency);
+
+    const float extent[3] = { boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] };
+    const float scale = std::max(std::max(extent[0], extent[1]), std::max(extent[2], 1e-20f));
+    const float diagonal = std::max(sqrtf(Dot(extent, extent)), 1e-20f);
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            positions[v * 3 + k] = (positions[v * 3 + k] - boundsMin[k]) / scale;
+        }
+    }
+
+    // Errors below are squared, in the scaled space.
+    const float toScaled = diagonal / scale;
+    const float maxError = targetError * toScaled * targetError * toScaled;
+
+    TArray<Quadric> quadrics;
+    quadrics.Resize(numVertices);
+    memset(quadrics.Data(), 0, sizeof(Quadric) * numVertices);
+
+    for (size_t t = 0; t < numIndices / 3; t++)
+    {
+        const uint32_t* pTriangle = indices.Data() + t * 3;
+        float normal[3];
+        TriangleNormal(normal, positions.Data() + pTriangle[0] * 3, positions.Data() + pTriangle[1] * 3, positions.Data() + pTriangle[2] * 3);
+        const float length = sqrtf(Dot(normal, normal));
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+
+        const float distance = -Dot(normal, positions.Data() + pTriangle[0] * 3);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            AddPlane(quadrics[pTriangle[k]], normal, distance, length * 0.5f);
+        }
+
+        // Borders get a plane through the edge, perpendicular to the
+        // triangle, so they don't shrink.
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t a = pTriangle[k], b = pTriangle[(k + 1) % 3];
+            if (adjacency.CountEdge(indices.Data(), b, a) != 0)
+            {
+                continue;
+            }
+
+            const float* pA = positions.Data() + a * 3;
+            const float* pB = positions.Data() + b * 3;
+            const float edge[3] = { pB[0] - pA[0], pB[1] - pA[1], pB[2] - pA[2] };
+            const float edgeLength = sqrtf(Dot(edge, edge));
+            float edgeNormal[3];
+            Cross(edgeNormal, edge, normal);
+            const float edgeNormalLength = sqrtf(Dot(edgeNormal, edgeNormal));
+            if (edgeNormalLength == 0.0f)
+            {
+                continue;
+            }
+            edgeNormal[0] /= edgeNormalLength;
+            edgeNormal[1] /= edgeNormalLength;
+            edgeNormal[2] /= edgeNormalLength;
+
+            const float edgeDistance = -Dot(edgeNormal, pA);
+            AddPlane(quadrics[a], edgeNormal, edgeDistance, edgeLength * edgeLength * BORDER_WEIGHT);
+            AddPlane(quadrics[b], edgeNormal, edgeDistance, edgeLength * edgeLength * BORDER_WEIGHT);
+        }
+    }
+
+    TArray<uint32_t> remap;
+    remap.Resize(numVertices);
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        remap[v] = v;
+    }
+
+    TArray<uint8_t> touched;
+    touched.Resize(numVertices);
+    TArray<SimplifyCollapse> collapses;
+
+    size_t numTriangles = numIndices / 3;
+    const size_t targetTriangles = targetIndices / 3;
+    float resultError = 0.0f;
+
+    // Each pass collapses the cheapest edges whose vertices no other
+    // collapse of the pass has touched.
+    while (numTriangles > targetTriangles)
+    {
+        if (numTriangles != numIndices / 3)
+        {
+            adjacency.Build(indices.Data(), numTriangles * 3, numVertices);
+        }
+
+        collapses.Clear();
+        for (size_t i = 0; i < numTriangles * 3; i++)
+        {
+            const uint32_t a = indices[i];
+            const uint32_t b = indices[i - i % 3 + (i + 1) % 3];
+            const bool border = adjacency.CountEdge(indices.Data(), b, a) == 0;
+
+            for (uint32_t direction = 0; direction < (border ? 2u : 1u); direction++)
+            {
+                const uint32_t from = direction ? b : a;
+                const uint32_t to = direction ? a : b;
+                if (kinds[from] == SIMPLIFY_LOCKED ||
+                    (kinds[from] == SIMPLIFY_BORDER && (!border || kinds[to] == SIMPLIFY_MANIFOLD)))
+                {
+                    continue;
+                }
+
+                Quadric quadric = quadrics[from];
+                AddQuadric(quadric, quadrics[to]);
+                const float error = EvaluateQuadric(quadric, positions.Data() + to * 3);
+                if (error <= maxError)
+                {
+                    collapses.PushBack(SimplifyCollapse{ from, to, error });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const SimplifyCollapse& a, const SimplifyCollapse& b)
+        {
+            return a.m_Error < b.m_Error;
+        });
+
+        memset(touched.Data(), 0, numVertices);
+        size_t remaining = numTriangles;
+        uint32_t numCollapsed = 0;
+        for (const SimplifyCollapse& collapse : collapses)
+        {
+            if (remaining <= targetTriangles)
+            {
+                break;
+            }
+
+            if (touched[collapse.m_From] || touched[collapse.m_To] ||
+                FlipsTriangles(indices.Data(), adjacency, remap.Data(), positions.Data(), collapse.m_From, collapse.m_To))
+            {
+                continue;
+            }
+
+            // The triangles on the edge disappear.
+            for (uint32_t i = 0; i < adjacency.m_Counts[collapse.m_From]; i++)
+            {
+                const uint32_t* pTriangle = indices.Data() + adjacency.m_Triangles[adjacency.m_Offsets[collapse.m_From] + i] * 3;
+                if (remap[pTriangle[0]] == collapse.m_To || remap[pTriangle[1]] == collapse.m_To || remap[pTriangle[2]] == collapse.m_To)
+                {
+                    remaining--;
+                }
+            }
+
+            remap[collapse.m_From] = collapse.m_To;
+            AddQuadric(quadrics[collapse.m_To], quadrics[collapse.m_From]);
+            touched[collapse.m_From] = 1;
+            touched[collapse.m_To] = 1;
+            resultError = std::max(resultError, collapse.m_Error);
+            numCollapsed++;
+        }
+
+        if (numCollapsed == 0)
+        {
+            break;
+        }
+
+        size_t output = 0;
+        for (size_t t = 0; t < numTriangles; t++)
+        {
+            const uint32_t v0 = remap[indices[t * 3 + 0]], v1 = remap[indices[t * 3 + 1]], v2 = remap[indices[t * 3 + 2]];
+            if (v0 != v1 && v1 != v2 && v0 != v2)
+            {
+                indices[output * 3 + 0] = v0;
+                indices[output * 3 + 1] = v1;
+                indices[output * 3 + 2] = v2;
+                output++;
+            }
+        }
+        numTriangles = output;
+    }
+
+    memcpy(pDst, indices.Data(), sizeof(uint32_t) * numTriangles * 3);
+    if (pResultError)
+    {
+        *pResultError = sqrtf(resultError) / toScaled;
+    }
+    return numTriangles * 3;
+}
+
+void GenerateLodChain(TArray<uint32_t>& indices, MeshLodChain& lods, const float* pPositions, size_t positionStride, uint32_t numVertices,
+    uint32_t maxLods, float maxError)
+{
+    const size_t numIndices = indices.Size();
+    lods.m_NumLods = 1;
+    lods.m_Lods[0] = MeshLod{ 0, (uint32_t)numIndices, 0.0f };
+
+    TArray<uint32_t> lodIndices;
+    lodIndices.Resize(numIndices);
+
+    size_t targetIndices = numIndices;
+    while (lods.m_NumLods < std::min(maxLods, MAX_MESH_LODS))
+    {
+        const MeshLod& previous = lods.m_Lods[lods.m_NumLods - 1];
+        targetIndices = targetIndices / 6 * 3;
+
+        float error = 0.0f;
+        const size_t lodSize = SimplifyMesh(lodIndices.Data(), indices.Data(), numIndices, pPositions, positionStride, numVertices, targetIndices, maxError, &error);
+        if (lodSize == 0 || lodSize > previous.m_NumIndices - previous.m_NumIndices / MIN_LOD_REDUCTION)
+        {
+            break;
+        }
+
+        lods.m_Lods[lods.m_NumLods++] = MeshLod{ (uint32_t)indices.Size(), (uint32_t)lodSize, error };
+        for (size_t i = 0; i < lodSize; i++)
+        {
+            indices.PushBack(lodIndices[i]);
+        }
+        targetIndices = lodSize;
+    }
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize)
+{
+    VertexCacheStats stats = {};
+    const size_t numTriangles = numIndices / 3;
+
+    FifoCache cache(numVertices, cacheSize);
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        stats.m_Misses += cache.Access(pIndices + t * 3);
+    }
+
+    TArray<uint32_t> remap;
+    remap.Resize(numVertices);
+    const uint32_t used = GenerateVertexFetchRemap(remap.Data(), pIndices, numIndices, numVertices);
+
+    stats.m_ACMR = numTriangles ? (float)stats.m_Misses / (float)numTriangles : 0.0f;
+    stats.m_ATVR = used ? (float)stats.m_Misses / (float)used : 0.0f;
+    return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, size_t vertexSize)
+{
+    VertexFetchStats stats = {};
+
+    // FIFO of cache lines, by line number.
+    uint64_t lines[FETCH_CACHE_LINES];
+    uint32_t numLines = 0, next = 0;
+
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        const uint64_t start = (uint64_t)pIndices[i] * vertexSize;
+        const uint64_t end = start + vertexSize;
+        for (uint64_t line = start / FETCH_LINE_SIZE; line * FETCH_LINE_SIZE < end; line++)
+        {
+            if (std::find(lines, lines + numLines, line) == lines + numLines)
+            {
+                lines[next] = line;
+                next = (next + 1) % FETCH_CACHE_LINES;
+                numLines = numLines < FETCH_CACHE_LINES ? numLines + 1 : numLines;
+                stats.m_BytesFetched += FETCH_LINE_SIZE;
+            }
+        }
+    }
+
+    TArray<uint32_t> remap;
+    remap.Resize(numVertices);
+    const uint32_t used = GenerateVertexFetchRemap(remap.Data(), pIndices, numIndices, numVertices);
+    stats.m_Overfetch = used ? (float)stats.m_BytesFetched / (float)((uint64_t)used * vertexSize) : 0.0f;
+    return stats;
+}
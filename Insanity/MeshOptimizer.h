@@ -0,0 +1,127 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MeshLod.h"
+#include "TArray.h"
+
+// Offline mesh processing used by InsanityCooker, and by the engine for
+// geometry it generates itself. Indexed triangle lists only; everything
+// works on 32-bit indices; narrowing to 16 bits happens when the file is
+// written. Functions that reorder write to pDst, which may be the same
+// buffer as the input unless noted.
+//
+// The usual order is: dedupe vertices, SimplifyMesh for the LODs,
+// OptimizeVertexCache and OptimizeOverdraw on each LOD, then reorder the
+// vertices with GenerateVertexFetchRemap.
+
+// Remap tables map old vertex indices to new ones. Vertices nothing uses
+// map to UNUSED_VERTEX.
+static const uint32_t UNUSED_VERTEX = 0xFFFFFFFF;
+
+// One vertex stream: numVertices elements, stride bytes apart.
+struct MeshStream
+{
+	const void* m_pData;
+	size_t m_Stride;
+};
+
+// Makes vertices whose bytes match in every stream share one index.
+// Returns the number of unique vertices.
+uint32_t GenerateVertexRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, const MeshStream* pStreams, uint32_t numStreams);
+
+// Vertex order of first use by the index buffer, the best order for
+// vertex fetch. Returns the number of vertices used.
+uint32_t GenerateVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices);
+
+void RemapIndices(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const uint32_t* pRemap);
+
+// pDst[pRemap[i]] = pSrc[i]. pDst must not overlap pSrc.
+void RemapVertices(void* pDst, const void* pSrc, uint32_t numVertices, size_t stride, const uint32_t* pRemap);
+
+// Reorders triangles so consecutive ones share vertices, for the
+// post-transform vertex cache (Forsyth's linear-speed algorithm). pDst must
+// not overlap pIndices.
+void OptimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, uint32_t numVertices);
+
+// Reorders clusters of an index buffer already optimized for the vertex
+// cache so that triangles likely to occlude others are drawn first (Sander
+// et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw"). threshold is how much worse the ACMR may get to allow
+// smaller clusters; 1.05 is a good value. pDst must not overlap pIndices.
+void OptimizeOverdraw(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const float* pPositions, size_t positionStride, uint32_t numVertices, float threshold);
+
+// Simplifies the mesh by collapsing edges in order of quadric error
+// (Garland and Heckbert, "Surface Simplification Using Quadric Error
+// Metrics") until it has at most targetIndices indices or the next collapse
+// would move the surface more than targetError. Collapses only merge a
+// vertex into another one, so the result indexes the same vertex buffer.
+// Vertices shared by several index values at one position (attribute seams)
+// and non-manifold vertices don't move; open borders only collapse along
+// themselves. Errors are fractions of the bounds diagonal, pResultError
+// (optional) gets the error of the result. Returns the number of indices
+// written to pDst, which may be pIndices.
+size_t SimplifyMesh(uint32_t* pDst, const uint32_t* pIndices, size_t numIndices, const float* pPositions, size_t positionStride, uint32_t numVertices,
+	size_t targetIndices, float targetError, float* pResultError = nullptr);
+
+// Builds a LOD chain with SimplifyMesh. indices holds LOD 0 and gets the
+// coarser LODs appended, each aiming for half the triangles of the previous
+// one. Each LOD simplifies LOD 0 rather than the previous LOD, so its error
+// is measured against the full mesh. The chain stops at maxLods, when the
+// error would pass maxError, or when a LOD removes less than a tenth of the
+// triangles.
+void GenerateLodChain(TArray<uint32_t>& indices, MeshLodChain& lods, const float* pPositions, size_t positionStride, uint32_t numVertices,
+	uint32_t maxLods, float maxError);
+
+struct VertexCacheStats
+{
+	uint32_t m_Misses;
+	float m_ACMR;	// Misses per triangle, 0.5 is the best possible.
+	float m_ATVR;	// Misses per vertex used, 1 is the best possible.
+};
+
+// Simulates a FIFO post-transform cache of cacheSize vertices.
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize = 16);
+
+struct VertexFetchStats
+{
+	uint64_t m_BytesFetched;
+	float m_Overfetch;	// Bytes fetched per byte of vertex data used, 1 is the best possible.
+};
+
+// Simulates a small cache of 64-byte lines in front of a vertex buffer with
+// vertexSize bytes per vertex.
+VertexFetchStats AnalyzeVertexFetch(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, size_t vertexSize);
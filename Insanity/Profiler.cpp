@@ -0,0 +1,411 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <GL/glew.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/writer.h>
+
+#include "TArray.h"
+
+// Events kept per thread. A longer capture keeps the most recent ones.
+static const uint64_t THREAD_EVENT_CAPACITY = 1 << 16;
+
+// Track the GPU scopes go to in the trace.
+static const uint32_t GPU_TRACK_ID = 0xFFFF;
+
+// A scope, or a counter sample when m_End is 0.
+struct ProfileEvent
+{
+	const char* m_pName;
+	uint64_t m_Start;
+	uint64_t m_End;
+	double m_Value;
+};
+
+// Ring of events only its own thread writes. m_Written counts every event
+// ever written and is published with release, so the reader sees the
+// events before it sees the count.
+struct ProfilerThread
+{
+	std::string m_Name;
+	uint32_t m_Id = 0;
+	std::unique_ptr<ProfileEvent[]> m_pEvents;
+	std::atomic<uint64_t> m_Written{0};
+
+	// m_Written when the capture started. Guarded by s_ThreadsMutex.
+	uint64_t m_CaptureStart = 0;
+};
+
+struct GpuFrame
+{
+	GLuint m_Queries[MAX_GPU_SCOPES * 2];
+	const char* m_pNames[MAX_GPU_SCOPES];
+	uint32_t m_NumScopes;
+	GLuint m_LastQuery;
+};
+
+std::atomic<bool> Profiler::s_Enabled{false};
+
+// Threads are never removed, a finished thread's events stay in the trace.
+static std::mutex s_ThreadsMutex;
+static TArray<std::unique_ptr<ProfilerThread>> s_Threads;
+static thread_local ProfilerThread* s_pThread = nullptr;
+
+static uint64_t s_CaptureStartTime = 0;
+static uint64_t s_CaptureEndTime = 0;
+
+// Render thread only.
+static GpuFrame s_GpuFrames[GPU_PROFILER_LATENCY];
+static uint32_t s_GpuFrame = 0;
+static bool s_GpuReady = false;
+static int64_t s_GpuClockOffset = 0;
+static TArray<ProfileEvent> s_GpuEvents;
+static uint32_t s_GpuFramesLost = 0;
+
+static ProfilerThread* GetThread()
+{
+    if (!s_pThread)
+    {
+        std::lock_guard<std::mutex> lock{ s_ThreadsMutex };
+        s_pThread = new ProfilerThread();
+        s_pThread->m_Id = (uint32_t)s_Threads.Size();
+        s_pThread->m_Name = "Thread " + std::to_string(s_pThread->m_Id);
+        s_Threads.PushBack(std::unique_ptr<ProfilerThread>{ s_pThread });
+    }
+    return s_pThread;
+}
+
+// GPU timestamps in the CPU time base: the offset between the two clocks
+// is measured now, good for a capture.
+static void CalibrateGpuClock()
+{
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    s_GpuClockOffset = (int64_t)Profiler::GetTime() - gpuTime;
+}
+
+uint64_t Profiler::GetTime()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock{ s_ThreadsMutex };
+        for (std::unique_ptr<ProfilerThread>& pThread : s_Threads)
+        {
+            pThread->m_CaptureStart = pThread->m_Written.load(std::memory_order_acquire);
+        }
+    }
+
+    s_GpuEvents.Clear();
+    s_GpuFramesLost = 0;
+    if (s_GpuReady)
+    {
+        CalibrateGpuClock();
+    }
+
+    s_CaptureStartTime = GetTime();
+    s_CaptureEndTime = s_CaptureStartTime;
+    s_Enabled.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::Stop()
+{
+    if (s_Enabled.exchange(false, std::memory_order_relaxed))
+    {
+        s_CaptureEndTime = GetTime();
+    }
+}
+
+void Profiler::SetThreadName(const char* pName)
+{
+    ProfilerThread* pThread = GetThread();
+    std::lock_guard<std::mutex> lock{ s_ThreadsMutex };
+    pThread->m_Name = pName;
+}
+
+static void RecordEvent(const ProfileEvent& event)
+{
+    ProfilerThread* pThread = GetThread();
+    if (!pThread->m_pEvents)
+    {
+        pThread->m_pEvents.reset(new ProfileEvent[THREAD_EVENT_CAPACITY]);
+    }
+
+    const uint64_t written = pThread->m_Written.load(std::memory_order_relaxed);
+    pThread->m_pEvents[written & (THREAD_EVENT_CAPACITY - 1)] = event;
+    pThread->m_Written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::RecordScope(const char* pName, uint64_t start, uint64_t end)
+{
+    RecordEvent(ProfileEvent{ pName, start, end, 0.0 });
+}
+
+void Profiler::RecordCounter(const char* pName, double value)
+{
+    RecordEvent(ProfileEvent{ pName, GetTime(), 0, value });
+}
+
+void Profiler::InitGpu()
+{
+    if (s_GpuReady)
+    {
+        return;
+    }
+
+    for (GpuFrame& frame : s_GpuFrames)
+    {
+        glGenQueries(MAX_GPU_SCOPES * 2, frame.m_Queries);
+        frame.m_NumScopes = 0;
+        frame.m_LastQuery = 0;
+    }
+    s_GpuFrame = 0;
+    s_GpuReady = true;
+    CalibrateGpuClock();
+}
+
+void Profiler::ShutdownGpu()
+{
+    if (!s_GpuReady)
+    {
+        return;
+    }
+
+    for (GpuFrame& frame : s_GpuFrames)
+    {
+        glDeleteQueries(MAX_GPU_SCOPES * 2, frame.m_Queries);
+    }
+    s_GpuReady = false;
+}
+
+void Profiler::BeginGpuFrame()
+{
+    if (!s_GpuReady)
+    {
+        return;
+    }
+
+    // The slot about to be reused was written GPU_PROFILER_LATENCY frames
+    // ago. Queries finish in order, so the last one tells about them all;
+    // if it isn't there yet the frame is lost rather than waited for.
+    s_GpuFrame = (s_GpuFrame + 1) % GPU_PROFILER_LATENCY;
+    GpuFrame& frame = s_GpuFrames[s_GpuFrame];
+    if (frame.m_NumScopes)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.m_LastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            for (uint32_t i = 0; i < frame.m_NumScopes; i++)
+            {
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(frame.m_Queries[i * 2], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(frame.m_Queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+                const uint64_t cpuStart = (uint64_t)((int64_t)start + s_GpuClockOffset);
+                if (cpuStart >= s_CaptureStartTime)
+                {
+                    s_GpuEvents.PushBack(ProfileEvent{ frame.m_pNames[i], cpuStart, (uint64_t)((int64_t)end + s_GpuClockOffset), 0.0 });
+                }
+            }
+        }
+        else
+        {
+            s_GpuFramesLost++;
+        }
+        frame.m_NumScopes = 0;
+    }
+}
+
+uint32_t Profiler::BeginGpuScope(const char* pName)
+{
+    GpuFrame& frame = s_GpuFrames[s_GpuFrame];
+    if (!s_GpuReady || frame.m_NumScopes == MAX_GPU_SCOPES)
+    {
+        return MAX_GPU_SCOPES;
+    }
+
+    const uint32_t scope = frame.m_NumScopes++;
+    frame.m_pNames[scope] = pName;
+    frame.m_LastQuery = frame.m_Queries[scope * 2];
+    glQueryCounter(frame.m_LastQuery, GL_TIMESTAMP);
+    return scope;
+}
+
+void Profiler::EndGpuScope(uint32_t scope)
+{
+    GpuFrame& frame = s_GpuFrames[s_GpuFrame];
+    frame.m_LastQuery = frame.m_Queries[scope * 2 + 1];
+    glQueryCounter(frame.m_LastQuery, GL_TIMESTAMP);
+}
+
+// Chrome wants microseconds.
+static double ToTraceTime(uint64_t time)
+{
+    return (double)(int64_t)(time - s_CaptureStartTime) / 1000.0;
+}
+
+template<typename Writer>
+static void WriteThreadName(Writer& writer, uint32_t id, const char* pName)
+{
+    writer.StartObject();
+    writer.Key("name");
+    writer.String("thread_name");
+    writer.Key("ph");
+    writer.String("M");
+    writer.Key("pid");
+    writer.Uint(1);
+    writer.Key("tid");
+    writer.Uint(id);
+    writer.Key("args");
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(pName);
+    writer.EndObject();
+    writer.EndObject();
+}
+
+template<typename Writer>
+static void WriteEvent(Writer& writer, uint32_t id, const ProfileEvent& event)
+{
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(event.m_pName);
+    writer.Key("pid");
+    writer.Uint(1);
+    writer.Key("tid");
+    writer.Uint(id);
+    writer.Key("ts");
+    writer.Double(ToTraceTime(event.m_Start));
+
+    if (event.m_End)
+    {
+        writer.Key("ph");
+        writer.String("X");
+        writer.Key("dur");
+        writer.Double((double)(int64_t)(event.m_End - event.m_Start) / 1000.0);
+    }
+    else
+    {
+        writer.Key("ph");
+        writer.String("C");
+        writer.Key("args");
+        writer.StartObject();
+        writer.Key("value");
+        writer.Double(event.m_Value);
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    FILE* pFile = fopen(path.c_str(), "wb");
+    if (!pFile)
+    {
+        std::cout << "ERROR: Creating " << path << "." << std::endl;
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    rapidjson::FileWriteStream stream{ pFile, buffer, sizeof(buffer) };
+    rapidjson::Writer<rapidjson::FileWriteStream> writer{ stream };
+
+    writer.StartObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.StartArray();
+
+    uint64_t numEvents = 0, numLost = 0;
+    {
+        std::lock_guard<std::mutex> lock{ s_ThreadsMutex };
+        for (const std::unique_ptr<ProfilerThread>& pThread : s_Threads)
+        {
+            WriteThreadName(writer, pThread->m_Id, pThread->m_Name.c_str());
+
+            // Only the newest THREAD_EVENT_CAPACITY events are still there.
+            const uint64_t written = pThread->m_Written.load(std::memory_order_acquire);
+            uint64_t first = pThread->m_CaptureStart;
+            if (written - first > THREAD_EVENT_CAPACITY)
+            {
+                numLost += written - first - THREAD_EVENT_CAPACITY;
+                first = written - THREAD_EVENT_CAPACITY;
+            }
+
+            for (uint64_t i = first; i < written; i++)
+            {
+                const ProfileEvent& event = pThread->m_pEvents[i & (THREAD_EVENT_CAPACITY - 1)];
+                if (event.m_Start >= s_CaptureStartTime && event.m_Start <= s_CaptureEndTime)
+                {
+                    WriteEvent(writer, pThread->m_Id, event);
+                    numEvents++;
+                }
+            }
+        }
+    }
+
+    if (!s_GpuEvents.IsEmpty())
+    {
+        WriteThreadName(writer, GPU_TRACK_ID, "GPU");
+        for (const ProfileEvent& event : s_GpuEvents)
+        {
+            WriteEvent(writer, GPU_TRACK_ID, event);
+        }
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+    stream.Flush();
+
+    const bool success = ferror(pFile) == 0;
+    fclose(pFile);
+    if (!success)
+    {
+        std::cout << "ERROR: Writing " << path << "." << std::endl;
+        return false;
+    }
+
+    std::cout << "Profile written to " << path << ": " << numEvents << " CPU events (" << numLost << " overwritten), " << s_GpuEvents.Size() << " GPU scopes ("
+        << s_GpuFramesLost << " frames not ready in time)." << std::endl;
+    return true;
+}
@@ -0,0 +1,159 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+// Frame profiler. CPU scopes go to a ring buffer per thread that only its
+// own thread writes, so recording takes no lock. GPU scopes are timestamp
+// queries read back GPU_PROFILER_LATENCY frames later, when they are done,
+// so the CPU never waits on them. Counters are values sampled over time.
+//
+// Nothing is recorded until Start; a disabled scope costs one relaxed
+// atomic load. Building with INSANITY_PROFILER=0 removes the macros
+// altogether. The capture is written in the Chrome trace event format
+// (chrome://tracing, ui.perfetto.dev).
+//
+//   PROFILE_SCOPE("Simulate");
+//   PROFILE_GPU_SCOPE("Scene");	// Render thread only.
+//   PROFILE_COUNTER("Draw calls", stats.m_DrawCalls);
+
+#ifndef INSANITY_PROFILER
+#define INSANITY_PROFILER 1
+#endif
+
+// Frames of latency between issuing GPU timestamps and reading them.
+static const uint32_t GPU_PROFILER_LATENCY = 4;
+
+// GPU scopes per frame, more are ignored.
+static const uint32_t MAX_GPU_SCOPES = 64;
+
+class Profiler
+{
+public:
+	static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	// Starts a new capture, dropping whatever was recorded before. Call
+	// both from the render thread when GPU scopes are used.
+	static void Start();
+	static void Stop();
+
+	// Names the calling thread in the trace. Cheap, call it once when a
+	// thread starts whether the profiler is on or not.
+	static void SetThreadName(const char* pName);
+
+	// Nanoseconds of a steady clock, the time base of every event.
+	static uint64_t GetTime();
+
+	// pName must outlive the capture: string literals.
+	static void RecordScope(const char* pName, uint64_t start, uint64_t end);
+	static void RecordCounter(const char* pName, double value);
+
+	// GPU side, render thread with the context current. InitGpu creates
+	// the queries, BeginGpuFrame reads back the oldest frame if it is done.
+	static void InitGpu();
+	static void ShutdownGpu();
+	static void BeginGpuFrame();
+	static uint32_t BeginGpuScope(const char* pName);
+	static void EndGpuScope(uint32_t scope);
+
+	// Writes everything recorded between Start and Stop. Call it after
+	// Stop, from the render thread if GPU scopes were used.
+	static bool WriteChromeTrace(const std::string& path);
+
+private:
+	static std::atomic<bool> s_Enabled;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* pName):
+		m_pName{pName},
+		m_Start{Profiler::IsEnabled() ? Profiler::GetTime() : 0}
+	{
+	}
+
+	~ProfileScope()
+	{
+		// Scopes open when the capture starts or stops are dropped.
+		if (m_Start && Profiler::IsEnabled())
+		{
+			Profiler::RecordScope(m_pName, m_Start, Profiler::GetTime());
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_pName;
+	uint64_t m_Start;
+};
+
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(const char* pName):
+		m_Scope{Profiler::IsEnabled() ? Profiler::BeginGpuScope(pName) : MAX_GPU_SCOPES}
+	{
+	}
+
+	~GpuProfileScope()
+	{
+		if (m_Scope != MAX_GPU_SCOPES)
+		{
+			Profiler::EndGpuScope(m_Scope);
+		}
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	uint32_t m_Scope;
+};
+
+#if INSANITY_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__){ name }
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__){ name }
+#define PROFILE_COUNTER(name, value) do { if (Profiler::IsEnabled()) { Profiler::RecordCounter(name, (double)(value)); } } while (0)
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_GPU_SCOPE(name) do {} while (0)
+#define PROFILE_COUNTER(name, value) do {} while (0)
+#endif
@@ -31,3 +31,462 @@
  */
 
 #include "Renderer.h"
+
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "GeometryPool.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "UniformBlocks.h"
+
+// Starting size of one frame in the uniform ring buffer. Grows on demand.
+static const size_t UNIFORM_FRAME_SIZE = 64 * 1024;
+
+// ObjectBlock offsets of draws whose program takes the model matrix as a
+// plain uniform, and of ones that read ObjectBlock but found the frame's
+// segment of the ring full.
+static const GLintptr OBJECT_OFFSET_UNIFORM = -1;
+static const GLintptr OBJECT_OFFSET_DROPPED = -2;
+
+// Bits of the sort key for the shader id, the mesh id, and the LOD, with
+// what is left for the depth. A frame with more distinct shaders or meshes
+// than the ids hold wraps around, which only groups its draws less well.
+static const uint32_t SORT_SHADER_BITS = 12;
+static const uint32_t SORT_MESH_BITS = 20;
+static const uint32_t SORT_LOD_BITS = 3;
+
+// Numbers the objects seen in one frame 0, 1, 2... in order of first use,
+// so GL names or addresses never have to be squeezed into a few bits.
+// Open addressing over the pointers, in memory from the frame allocator.
+class FrameIds
+{
+public:
+    FrameIds(FrameAllocator& allocator, size_t maxObjects):
+        m_NextId{0}
+    {
+        size_t capacity = 16;
+        while (capacity < maxObjects * 2)
+        {
+            capacity *= 2;
+        }
+        m_Mask = capacity - 1;
+        m_pObjects = static_cast<const void**>(allocator.Allocate(sizeof(const void*) * capacity, alignof(const void*)));
+        m_pIds = static_cast<uint32_t*>(allocator.Allocate(sizeof(uint32_t) * capacity, alignof(uint32_t)));
+        memset(m_pObjects, 0, sizeof(const void*) * capacity);
+    }
+
+    uint32_t GetId(const void* pObject)
+    {
+        size_t slot = ((uintptr_t)pObject >> 4) * 0x9E3779B97F4A7C15ull >> 20 & m_Mask;
+        while (m_pObjects[slot] && m_pObjects[slot] != pObject)
+        {
+            slot = (slot + 1) & m_Mask;
+        }
+
+        if (!m_pObjects[slot])
+        {
+            m_pObjects[slot] = pObject;
+            m_pIds[slot] = m_NextId++;
+        }
+        return m_pIds[slot];
+    }
+
+private:
+    const void** m_pObjects;
+    uint32_t* m_pIds;
+    size_t m_Mask;
+    uint32_t m_NextId;
+};
+
+Renderer::Renderer(FrameAllocator& frameAllocator):
+    m_FrameAllocator{frameAllocator},
+    m_Items{},
+    m_Projection{1.0f},
+    m_Stats{},
+    m_FrameBlockOffset{0},
+    m_FrameBlockValid{false}
+{
+}
+
+void Renderer::BeginFrame(const glm::mat4& projection, const glm::mat4& view)
+{
+    m_Projection = projection;
+    m_Items.Clear();
+
+    if (!m_UniformBuffer.IsCreated())
+    {
+        m_UniformBuffer.Create(UNIFORM_FRAME_SIZE);
+    }
+    m_UniformBuffer.BeginFrame();
+    for (GeometryPool* pPool : m_Pools)
+    {
+        pPool->BeginFrame();
+    }
+
+    FrameUniforms frame{ projection, view };
+    void* pFrame = m_UniformBuffer.Allocate(sizeof(FrameUniforms), m_FrameBlockOffset);
+    m_FrameBlockValid = pFrame != nullptr;
+    if (pFrame)
+    {
+        memcpy(pFrame, &frame, sizeof(frame));
+    }
+}
+
+void Renderer::Clear()
+{
+    m_UniformBuffer.Destroy();
+    m_Pools.Clear();
+    m_Items.Clear();
+}
+
+void Renderer::Submit(Mesh* pMesh, Shader* pShader, const glm::mat4& model, uint32_t lod)
+{
+    if (pMesh && pShader)
+    {
+        m_Items.PushBack(DrawItem{ pMesh, pShader, model, lod });
+    }
+}
+
+uint64_t Renderer::MakeSortKey(const DrawItem& item, uint32_t shaderId, uint32_t meshId)
+{
+    const uint32_t depthBits = 64 - SORT_SHADER_BITS - SORT_MESH_BITS - SORT_LOD_BITS;
+    const uint64_t key = ((uint64_t)(shaderId & ((1u << SORT_SHADER_BITS) - 1)) << (64 - SORT_SHADER_BITS)) |
+        ((uint64_t)(meshId & ((1u << SORT_MESH_BITS) - 1)) << (SORT_LOD_BITS + depthBits));
+
+    // A pool run becomes one multi-draw with a command per mesh, so its
+    // meshes only need to be together: the rest of the key is the mesh in
+    // the pool. Pooled draws don't use LODs.
+    if (item.m_pMesh->GetPool())
+    {
+        return key | item.m_pMesh->GetPoolHandle();
+    }
+
+    // The LOD goes under the mesh so instanced runs split by LOD.
+    const uint64_t lod = item.m_Lod < MAX_MESH_LODS ? item.m_Lod : MAX_MESH_LODS - 1;
+
+    // The camera looks down -Z. Positive floats keep their order when
+    // compared as integers, so the bits of the distance sort front to back.
+    // The sign bit is always clear and the lowest mantissa bits don't
+    // matter, the shift makes room for the ids.
+    float depth = -item.m_Model[3][2];
+    if (!(depth > 0.0f))
+    {
+        depth = 0.0f;
+    }
+    uint32_t depthFloatBits;
+    memcpy(&depthFloatBits, &depth, sizeof(depthFloatBits));
+
+    return key | (lod << depthBits) | (depthFloatBits >> (32 - 1 - depthBits) & ((1u << depthBits) - 1));
+}
+
+void Renderer::SortItems(uint32_t* pOrder)
+{
+    PROFILE_SCOPE("Renderer::SortItems");
+
+    const size_t count = m_Items.Size();
+
+    uint64_t* pKeys = static_cast<uint64_t*>(m_FrameAllocator.Allocate(sizeof(uint64_t) * count * 2, alignof(uint64_t)));
+    uint64_t* pTempKeys = pKeys + count;
+    uint32_t* pTempOrder = static_cast<uint32_t*>(m_FrameAllocator.Allocate(sizeof(uint32_t) * count, alignof(uint32_t)));
+
+    FrameIds shaderIds{ m_FrameAllocator, count };
+    FrameIds meshIds{ m_FrameAllocator, count };
+    for (size_t i = 0; i < count; i++)
+    {
+        const DrawItem& item = m_Items[i];
+        const void* pMeshGroup = item.m_pMesh->GetPool() ? static_cast<const void*>(item.m_pMesh->GetPool()) : item.m_pMesh;
+        pKeys[i] = MakeSortKey(item, shaderIds.GetId(item.m_pShader), meshIds.GetId(pMeshGroup));
+        pOrder[i] = (uint32_t)i;
+    }
+
+    // LSD radix sort, 8 bits per pass. Passes where every key has the same
+    // byte don't change the order and are skipped.
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            histogram[(pKeys[i] >> shift) & 0xFF]++;
+        }
+
+        if (histogram[(pKeys[0] >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < 256; bucket++)
+        {
+            const size_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t destination = histogram[(pKeys[i] >> shift) & 0xFF]++;
+            pTempKeys[destination] = pKeys[i];
+            pTempOrder[destination] = pOrder[i];
+        }
+
+        memcpy(pKeys, pTempKeys, sizeof(uint64_t) * count);
+        memcpy(pOrder, pTempOrder, sizeof(uint32_t) * count);
+    }
+}
+
+void Renderer::Flush()
+{
+    PROFILE_SCOPE("Renderer::Flush");
+
+    m_Stats = RenderStats{};
+    m_Stats.m_DrawItems = (uint32_t)m_Items.Size();
+
+    if (m_Items.IsEmpty())
+    {
+        EndPoolFrames();
+        return;
+    }
+
+    uint32_t* pOrder = static_cast<uint32_t*>(m_FrameAllocator.Allocate(sizeof(uint32_t) * m_Items.Size(), alignof(uint32_t)));
+    SortItems(pOrder);
+
+    // Per-object data of every draw that can read it from ObjectBlock,
+    // sent to the GL in one upload. Those programs have no model uniform to
+    // fall back on, so draws that don't fit are dropped this frame; the
+    // ring grows on the next BeginFrame.
+    GLintptr* pObjectOffsets = static_cast<GLintptr*>(m_FrameAllocator.Allocate(sizeof(GLintptr) * m_Items.Size(), alignof(GLintptr)));
+    uint32_t numDropped = 0;
+    for (size_t item = 0; item < m_Items.Size(); item++)
+    {
+        const DrawItem& drawItem = m_Items[item];
+        pObjectOffsets[item] = OBJECT_OFFSET_UNIFORM;
+        if (drawItem.m_pShader->IsInstanced() || !drawItem.m_pShader->HasUniformBlock(BLOCK_OBJECT))
+        {
+            continue;
+        }
+
+        GLintptr offset;
+        void* pObject = m_UniformBuffer.Allocate(sizeof(ObjectUniforms), offset);
+        if (pObject)
+        {
+            memcpy(pObject, &drawItem.m_Model, sizeof(ObjectUniforms));
+            pObjectOffsets[item] = offset;
+        }
+        else
+        {
+            pObjectOffsets[item] = OBJECT_OFFSET_DROPPED;
+            numDropped++;
+        }
+    }
+    m_UniformBuffer.Upload();
+
+    if (numDropped)
+    {
+        std::cout << "ERROR: Uniform ring buffer full, " << numDropped << " draws skipped this frame." << std::endl;
+    }
+
+    // Binding points are global state: one bind serves every program.
+    if (m_FrameBlockValid)
+    {
+        m_UniformBuffer.BindRange(BLOCK_FRAME, m_FrameBlockOffset, sizeof(FrameUniforms));
+    }
+
+    Shader* pCurrentShader = nullptr;
+    Mesh* pCurrentMesh = nullptr;
+
+    // Programs that already got the projection this frame. Uniform values
+    // belong to the program, so they survive switching to another one.
+    TArray<Shader*, TAllocatorRef<FrameAllocator>> projectionSet{ m_FrameAllocator };
+
+    size_t i = 0;
+    while (i < m_Items.Size())
+    {
+        const DrawItem& item = m_Items[pOrder[i]];
+
+        if (item.m_pShader != pCurrentShader)
+        {
+            pCurrentShader = item.m_pShader;
+            pCurrentShader->UseShader();
+            m_Stats.m_ProgramBinds++;
+
+            // Programs with FrameBlock already see the projection.
+            bool projectionUploaded = m_FrameBlockValid && pCurrentShader->HasUniformBlock(BLOCK_FRAME);
+            for (Shader* pShader : projectionSet)
+            {
+                projectionUploaded |= pShader == pCurrentShader;
+            }
+
+            if (!projectionUploaded)
+            {
+                glUniformMatrix4fv(pCurrentShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(m_Projection));
+                projectionSet.PushBack(pCurrentShader);
+                m_Stats.m_UniformUploads++;
+                m_Stats.m_BytesUploaded += sizeof(glm::mat4);
+            }
+            else
+            {
+                m_Stats.m_UniformUploadsSkipped++;
+            }
+        }
+        else
+        {
+            m_Stats.m_ProgramBindsSkipped++;
+        }
+
+        GeometryPool* pPool = item.m_pMesh->GetPool();
+        if (pCurrentShader->IsInstanced() && pPool)
+        {
+            // Pooled meshes share a VAO and sort next to each other: the
+            // whole run, whatever the mesh, becomes one multi-draw.
+            size_t last = i;
+            while (last < m_Items.Size() && m_Items[pOrder[last]].m_pShader == item.m_pShader && m_Items[pOrder[last]].m_pMesh->GetPool() == pPool)
+            {
+                last++;
+            }
+
+            // A pool seen for the first time starts its frame late, from
+            // the next one on BeginFrame does it.
+            if (std::find(m_Pools.begin(), m_Pools.end(), pPool) == m_Pools.end())
+            {
+                m_Pools.PushBack(pPool);
+                pPool->BeginFrame();
+            }
+
+            pPool->BeginDraws();
+            size_t first = i;
+            while (first < last)
+            {
+                Mesh* pMesh = m_Items[pOrder[first]].m_pMesh;
+                size_t end = first;
+                while (end < last && m_Items[pOrder[end]].m_pMesh == pMesh)
+                {
+                    end++;
+                }
+
+                m_Stats.m_Triangles += pMesh->GetLodIndexCount(0) / 3 * (uint32_t)(end - first);
+                glm::mat4* pInstances = pPool->AddDraw(pMesh->GetPoolHandle(), (uint32_t)(end - first));
+                if (pInstances)
+                {
+                    for (size_t instance = first; instance < end; instance++)
+                    {
+                        *pInstances++ = m_Items[pOrder[instance]].m_Model;
+                    }
+                }
+                m_Stats.m_BytesUploaded += sizeof(glm::mat4) * (end - first);
+                first = end;
+            }
+            m_Stats.m_InstanceUploads++;
+
+            m_Stats.m_DrawCalls += pPool->SubmitDraws();
+            m_Stats.m_VAOBinds++;
+            m_Stats.m_ProgramBindsSkipped += (uint32_t)(last - i - 1);
+            m_Stats.m_VAOBindsSkipped += (uint32_t)(last - i - 1);
+
+            // SubmitDraws bound the pool VAO behind our back.
+            pCurrentMesh = nullptr;
+
+            i = last;
+            continue;
+        }
+
+        if (pCurrentShader->IsInstanced())
+        {
+            // Every consecutive item with the same shader, mesh and LOD goes
+            // into a single instanced draw.
+            size_t last = i;
+            while (last < m_Items.Size() && m_Items[pOrder[last]].m_pShader == item.m_pShader && m_Items[pOrder[last]].m_pMesh == item.m_pMesh &&
+                m_Items[pOrder[last]].m_Lod == item.m_Lod)
+            {
+                last++;
+            }
+            const unsigned int instanceCount = (unsigned int)(last - i);
+
+            // Creating the instance buffer the first time changes the bound
+            // VAO, so always bind after the upload.
+            glm::mat4* pInstances = item.m_pMesh->MapInstanceTransforms(instanceCount);
+            if (pInstances)
+            {
+                for (size_t instance = i; instance < last; instance++)
+                {
+                    *pInstances++ = m_Items[pOrder[instance]].m_Model;
+                }
+                item.m_pMesh->UnmapInstanceTransforms();
+            }
+            m_Stats.m_InstanceUploads++;
+            m_Stats.m_BytesUploaded += sizeof(glm::mat4) * instanceCount;
+
+            pCurrentMesh = item.m_pMesh;
+            pCurrentMesh->Bind();
+            m_Stats.m_VAOBinds++;
+
+            pCurrentMesh->DrawInstanced(instanceCount, item.m_Lod);
+            m_Stats.m_DrawCalls++;
+            m_Stats.m_Triangles += pCurrentMesh->GetLodIndexCount(item.m_Lod) / 3 * instanceCount;
+
+            // Draws folded into the instanced call didn't need any binding.
+            m_Stats.m_ProgramBindsSkipped += (uint32_t)(last - i - 1);
+            m_Stats.m_VAOBindsSkipped += (uint32_t)(last - i - 1);
+
+            i = last;
+            continue;
+        }
+
+        const GLintptr objectOffset = pObjectOffsets[pOrder[i]];
+        if (objectOffset == OBJECT_OFFSET_DROPPED)
+        {
+            i++;
+            continue;
+        }
+
+        if (item.m_pMesh != pCurrentMesh)
+        {
+            pCurrentMesh = item.m_pMesh;
+            pCurrentMesh->Bind();
+            m_Stats.m_VAOBinds++;
+        }
+        else
+        {
+            m_Stats.m_VAOBindsSkipped++;
+        }
+
+        if (objectOffset != OBJECT_OFFSET_UNIFORM)
+        {
+            m_UniformBuffer.BindRange(BLOCK_OBJECT, objectOffset, sizeof(ObjectUniforms));
+        }
+        else
+        {
+            glUniformMatrix4fv(pCurrentShader->GetModelLocation(), 1, GL_FALSE, glm::value_ptr(item.m_Model));
+            m_Stats.m_UniformUploads++;
+            m_Stats.m_BytesUploaded += sizeof(glm::mat4);
+        }
+
+        pCurrentMesh->Draw(item.m_Lod);
+        m_Stats.m_DrawCalls++;
+        m_Stats.m_Triangles += pCurrentMesh->GetLodIndexCount(item.m_Lod) / 3;
+
+        i++;
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    EndPoolFrames();
+
+    m_Stats.m_BufferUploads = m_UniformBuffer.GetUploads();
+    m_Stats.m_BufferBinds = m_UniformBuffer.GetBinds();
+    m_Stats.m_BytesUploaded += m_UniformBuffer.GetBytesUploaded();
+    m_Stats.m_StateChanges = m_Stats.m_ProgramBinds + m_Stats.m_VAOBinds + m_Stats.m_BufferBinds;
+    m_Stats.m_DriverCalls = m_Stats.m_ProgramBinds + m_Stats.m_VAOBinds + m_Stats.m_UniformUploads + m_Stats.m_InstanceUploads +
+        m_Stats.m_BufferUploads + m_Stats.m_BufferBinds + m_Stats.m_DrawCalls;
+}
+
+void Renderer::EndPoolFrames()
+{
+    for (GeometryPool* pPool : m_Pools)
+    {
+        pPool->EndFrame();
+    }
+}
@@ -31,7 +31,101 @@
  */
 
 #pragma once
-class Renderer
+
+#include <stdint.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Allocator.h"
+#include "TArray.h"
+#include "UniformRingBuffer.h"
+
+class GeometryPool;
+
+class Mesh;
+class Shader;
+
+struct RenderStats
 {
+	uint32_t m_DrawItems;
+	uint32_t m_DrawCalls;
+	uint32_t m_ProgramBinds;
+	uint32_t m_ProgramBindsSkipped;
+	uint32_t m_VAOBinds;
+	uint32_t m_VAOBindsSkipped;
+	uint32_t m_UniformUploads;
+	uint32_t m_UniformUploadsSkipped;
+	uint32_t m_InstanceUploads;
+	uint32_t m_BufferUploads;
+	uint32_t m_BufferBinds;
+
+	// Triangles of every draw, at the LOD it was drawn with.
+	uint32_t m_Triangles;
+
+	// Uniform and instance data sent to the GL.
+	uint64_t m_BytesUploaded;
+
+	// Program, VAO and uniform buffer binds actually made.
+	uint32_t m_StateChanges;
+
+	// Every GL call above, the number to watch as draw counts grow.
+	uint32_t m_DriverCalls;
 };
 
+// Render queue. Draw items are collected during the frame, sorted by a 64-bit
+// key (shader, then mesh and LOD, then depth) and submitted in that order so that
+// consecutive draws sharing a program or VAO don't rebind them. Pooled meshes
+// sort by pool, then by mesh within it.
+//
+// Per-frame and per-object uniforms of programs that declare FrameBlock and
+// ObjectBlock (see UniformBlocks.h) are written once per frame to a uniform
+// ring buffer; draws only move the ObjectBlock range. Programs without the
+// blocks still get glUniform calls.
+//
+// Instanced draws of meshes living in a GeometryPool are merged into one
+// multi-draw per pool and shader. Every pool drawn from once gets its
+// frame begun in BeginFrame and ended in Flush, so the batches of a frame
+// share one segment of its instance and command rings.
+class Renderer
+{
+public:
+	explicit Renderer(FrameAllocator& frameAllocator);
+
+	void BeginFrame(const glm::mat4& projection, const glm::mat4& view = glm::mat4(1.0f));
+	// lod is picked by the caller (see LodSelector), the renderer draws
+	// that range of the mesh. Draws without a mesh or shader (handles to
+	// freed resources) are dropped.
+	void Submit(Mesh* pMesh, Shader* pShader, const glm::mat4& model, uint32_t lod = 0);
+	void Flush();
+
+	// Deletes the GL objects. Must run while the context is still alive.
+	void Clear();
+
+	// Stats of the last Flush.
+	const RenderStats& GetStats() const { return m_Stats; }
+
+private:
+	struct DrawItem
+	{
+		Mesh* m_pMesh;
+		Shader* m_pShader;
+		glm::mat4 m_Model;
+		uint32_t m_Lod;
+	};
+
+	FrameAllocator& m_FrameAllocator;
+	TArray<DrawItem> m_Items;
+	glm::mat4 m_Projection;
+	RenderStats m_Stats;
+
+	UniformRingBuffer m_UniformBuffer;
+	TArray<GeometryPool*> m_Pools;
+	GLintptr m_FrameBlockOffset;
+	bool m_FrameBlockValid;
+
+	// shaderId and meshId are dense ids numbered per frame; pooled meshes
+	// take the id of their pool.
+	static uint64_t MakeSortKey(const DrawItem& item, uint32_t shaderId, uint32_t meshId);
+	void SortItems(uint32_t* pOrder);
+	void EndPoolFrames();
+};
@@ -0,0 +1,192 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ResourceManager.h"
+
+#include <string.h>
+#include <iostream>
+
+#include "Mesh.h"
+#include "Profiler.h"
+#include "Shader.h"
+
+// FNV-1a, as the shader cache keys. Never returns 0, which keeps a
+// resource out of the index.
+static uint64_t HashContent(const TArray<unsigned char>& content)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (unsigned char byte : content)
+    {
+        hash ^= byte;
+        hash *= 0x100000001B3ull;
+    }
+    return hash ? hash : 1;
+}
+
+static void AppendBytes(TArray<unsigned char>& content, const void* pData, size_t size)
+{
+    const size_t offset = content.Size();
+    content.Resize(offset + size);
+    if (size)
+    {
+        memcpy(&content[offset], pData, size);
+    }
+}
+
+static void AppendString(TArray<unsigned char>& content, const std::string& text)
+{
+    // The terminator keeps "ab" + "c" apart from "a" + "bc".
+    AppendBytes(content, text.c_str(), text.size() + 1);
+}
+
+static void MakeShaderContent(const std::string& vCode, const std::string& fCode, const std::string& defines, TArray<unsigned char>& content)
+{
+    content.Reserve(defines.size() + vCode.size() + fCode.size() + 3);
+    AppendString(content, defines);
+    AppendString(content, vCode);
+    AppendString(content, fCode);
+}
+
+ResourceManager::ResourceManager():
+	m_Frame{0},
+	m_Sharing{true}
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+    Clear();
+}
+
+MeshHandle ResourceManager::CreateMesh(const GLfloat* vertices, const unsigned int* indices, unsigned int numVertices, unsigned int numIndices,
+    const MeshLodChain* pLods, GeometryPool* pPool)
+{
+    const size_t bytes = numVertices * sizeof(GLfloat) + numIndices * sizeof(unsigned int);
+
+    uint64_t hash = 0;
+    TArray<unsigned char> content;
+    if (m_Sharing)
+    {
+        PROFILE_SCOPE("ResourceManager::HashMesh");
+
+        content.Reserve(sizeof(unsigned int) * 2 + sizeof(pPool) + sizeof(MeshLodChain) + bytes);
+        AppendBytes(content, &numVertices, sizeof(numVertices));
+        AppendBytes(content, &numIndices, sizeof(numIndices));
+        AppendBytes(content, &pPool, sizeof(pPool));
+        if (pLods)
+        {
+            AppendBytes(content, &pLods->m_NumLods, sizeof(pLods->m_NumLods));
+            AppendBytes(content, pLods->m_Lods, pLods->m_NumLods * sizeof(MeshLod));
+        }
+        AppendBytes(content, vertices, numVertices * sizeof(GLfloat));
+        AppendBytes(content, indices, numIndices * sizeof(unsigned int));
+        hash = HashContent(content);
+
+        const MeshHandle handle = m_Meshes.Find(hash, content, bytes);
+        if (handle.IsValid())
+        {
+            return handle;
+        }
+    }
+
+    Mesh* pMesh = m_Meshes.m_Pool.Create();
+    if (pPool)
+    {
+        if (!pMesh->CreateMeshInPool(*pPool, vertices, indices, numVertices, numIndices))
+        {
+            m_Meshes.m_Pool.Destroy(pMesh);
+            return MeshHandle{};
+        }
+    }
+    else
+    {
+        pMesh->CreateMesh(vertices, indices, numVertices, numIndices);
+        if (pLods)
+        {
+            pMesh->SetLods(*pLods);
+        }
+    }
+    return m_Meshes.Add(pMesh, hash, std::move(content), bytes);
+}
+
+ShaderHandle ResourceManager::LoadShader(const std::string& vertexFile, const std::string& fragmentFile, ShaderCache* pCache, const std::string& defines)
+{
+    std::string vCode, fCode;
+    if (!Shader::ReadFile(vertexFile, vCode) || !Shader::ReadFile(fragmentFile, fCode))
+    {
+        std::cout << "ERROR: Reading " << vertexFile << " or " << fragmentFile << "." << std::endl;
+        return ShaderHandle{};
+    }
+
+    uint64_t hash = 0;
+    TArray<unsigned char> content;
+    if (m_Sharing)
+    {
+        MakeShaderContent(vCode, fCode, defines, content);
+        hash = HashContent(content);
+
+        const ShaderHandle handle = m_Shaders.Find(hash, content, 0);
+        if (handle.IsValid())
+        {
+            return handle;
+        }
+    }
+
+    Shader* pShader = m_Shaders.m_Pool.Create();
+    pShader->CreateFromString(vCode, fCode, pCache, defines);
+    return m_Shaders.Add(pShader, hash, std::move(content), 0);
+}
+
+void ResourceManager::UpdateShader(ShaderHandle handle, const std::string& vCode, const std::string& fCode, const std::string& defines)
+{
+    TArray<unsigned char> content;
+    MakeShaderContent(vCode, fCode, defines, content);
+    const uint64_t hash = HashContent(content);
+    m_Shaders.SetContent(handle, hash, std::move(content));
+}
+
+void ResourceManager::CollectGarbage()
+{
+    // Frees what was released FREE_DELAY_FRAMES calls ago or earlier.
+    m_Frame++;
+    if (m_Frame >= FREE_DELAY_FRAMES)
+    {
+        m_Meshes.Collect(m_Frame - FREE_DELAY_FRAMES, false);
+        m_Shaders.Collect(m_Frame - FREE_DELAY_FRAMES, false);
+    }
+}
+
+void ResourceManager::Clear()
+{
+    m_Meshes.Collect(0, true);
+    m_Shaders.Collect(0, true);
+}
@@ -0,0 +1,425 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "MeshLod.h"
+#include "TArray.h"
+
+class GeometryPool;
+class Mesh;
+class Shader;
+class ShaderCache;
+
+// Handles pack a slot index in the low bits and its generation in the
+// rest, so they fit where a 32 bit index used to.
+static const uint32_t RESOURCE_INDEX_BITS = 20;
+static const uint32_t RESOURCE_INDEX_MASK = (1u << RESOURCE_INDEX_BITS) - 1;
+static const uint32_t RESOURCE_GENERATION_MASK = (1u << (32 - RESOURCE_INDEX_BITS)) - 1;
+
+// Generational handle to a resource of type T. Once the resource is freed
+// its slot is reused with another generation, and old handles stop
+// resolving instead of reaching the new owner. The generation wraps after
+// 4095 reuses of a slot.
+template<typename T>
+struct ResourceHandle
+{
+	uint32_t m_Value = 0;	// Generation 0 is never alive.
+
+	uint32_t GetIndex() const { return m_Value & RESOURCE_INDEX_MASK; }
+	uint32_t GetGeneration() const { return m_Value >> RESOURCE_INDEX_BITS; }
+	bool IsValid() const { return GetGeneration() != 0; }
+
+	bool operator==(const ResourceHandle& other) const { return m_Value == other.m_Value; }
+	bool operator!=(const ResourceHandle& other) const { return m_Value != other.m_Value; }
+};
+
+typedef ResourceHandle<Mesh> MeshHandle;
+typedef ResourceHandle<Shader> ShaderHandle;
+
+struct ResourceStats
+{
+	// Create/Load calls, and how many of them got an existing resource.
+	uint64_t m_Requests = 0;
+	uint64_t m_Shared = 0;
+
+	// Resources alive, including those waiting to be freed, and their GPU
+	// memory (meshes only; the driver doesn't report program sizes).
+	uint32_t m_Live = 0;
+	size_t m_Bytes = 0;
+
+	// GPU memory the shared requests would have allocated on their own.
+	size_t m_BytesSaved = 0;
+
+	uint64_t m_Freed = 0;
+	uint64_t m_FreeBatches = 0;
+};
+
+// Slots, reference counts and the content hash index of one resource type.
+// Only used by ResourceManager.
+template<typename T>
+class TResourceTable
+{
+public:
+	// The live resource with this hash and exactly this content, with one
+	// more reference, or an invalid handle.
+	ResourceHandle<T> Find(uint64_t hash, const TArray<unsigned char>& content, size_t bytes);
+
+	// Takes ownership of pResource with one reference, and keeps content
+	// to compare later requests with. hash 0 keeps it out of the index, so
+	// it is never shared.
+	ResourceHandle<T> Add(T* pResource, uint64_t hash, TArray<unsigned char>&& content, size_t bytes);
+
+	void AddRef(ResourceHandle<T> handle);
+	void Release(ResourceHandle<T> handle, uint64_t frame);
+	T* Get(ResourceHandle<T> handle) const;
+
+	// Replaces what a live resource is matched by, once it was rebuilt in
+	// place from new content. Resources kept out of the index stay out.
+	void SetContent(ResourceHandle<T> handle, uint64_t hash, TArray<unsigned char>&& content);
+
+	// Frees resources released at or before frame that nobody took back
+	// since.
+	// force frees everything, referenced or not.
+	void Collect(uint64_t frame, bool force);
+
+	const ResourceStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Slot
+	{
+		T* m_pResource;
+		uint64_t m_Hash;
+		TArray<unsigned char> m_Content;
+		size_t m_Bytes;
+		uint32_t m_RefCount;
+		uint32_t m_Generation;
+	};
+
+	struct PendingFree
+	{
+		ResourceHandle<T> m_Handle;
+		uint64_t m_Frame;
+	};
+
+	TArray<Slot> m_Slots;
+	TArray<uint32_t> m_FreeIndices;
+	TArray<PendingFree> m_PendingFrees;
+	std::unordered_map<uint64_t, uint32_t> m_Index;
+	TPool<T> m_Pool;
+	ResourceStats m_Stats;
+
+	bool IsAlive(ResourceHandle<T> handle) const;
+	void Free(uint32_t index);
+
+	// Drops the pending free of a slot whose last reference was released
+	// and is now taken again, so a later release starts a full delay.
+	void CancelFree(uint32_t index);
+
+	friend class ResourceManager;
+};
+
+// Owns the meshes and shaders of the scene and hands out handles to them.
+// Requests for geometry or shader sources (with the same defines) equal to
+// a live resource get that resource with one more reference instead of new
+// GPU objects. Content is looked up by a 64 bit hash and then compared
+// byte for byte, against a CPU copy each shared resource keeps of it.
+//
+// Releasing the last reference doesn't free the resource at once: frees
+// wait FREE_DELAY_FRAMES calls to CollectGarbage, so packets still in the
+// pipeline can draw it, and happen together between frames instead of in
+// the middle of one. A request for the same content in the meantime takes
+// the resource back.
+//
+// Render thread only. GetMesh/GetShader pointers are good until the next
+// CollectGarbage.
+class ResourceManager
+{
+public:
+	static const uint64_t FREE_DELAY_FRAMES = 2;
+
+	ResourceManager();
+	~ResourceManager();
+
+	ResourceManager(const ResourceManager&) = delete;
+	ResourceManager& operator=(const ResourceManager&) = delete;
+
+	// Off, every request creates its own resource, to measure what sharing
+	// saves or to benchmark many distinct meshes.
+	void SetSharing(bool enabled) { m_Sharing = enabled; }
+
+	// numVertices counts floats, as in Mesh::CreateMesh. New meshes go into
+	// pPool when given and get pLods otherwise; both are part of the
+	// content, so pooled and unpooled copies are never shared.
+	MeshHandle CreateMesh(const GLfloat* vertices, const unsigned int* indices, unsigned int numVertices, unsigned int numIndices,
+		const MeshLodChain* pLods = nullptr, GeometryPool* pPool = nullptr);
+
+	// Invalid handle when the files can't be read.
+	ShaderHandle LoadShader(const std::string& vertexFile, const std::string& fragmentFile, ShaderCache* pCache = nullptr, const std::string& defines = "");
+
+	// After the shader was rebuilt in place from these sources (hot
+	// reload), so later requests are compared with what it runs now.
+	void UpdateShader(ShaderHandle handle, const std::string& vCode, const std::string& fCode, const std::string& defines);
+
+	void AddRef(MeshHandle handle) { m_Meshes.AddRef(handle); }
+	void AddRef(ShaderHandle handle) { m_Shaders.AddRef(handle); }
+	void Release(MeshHandle handle) { m_Meshes.Release(handle, m_Frame); }
+	void Release(ShaderHandle handle) { m_Shaders.Release(handle, m_Frame); }
+
+	// nullptr once the resource is freed.
+	Mesh* GetMesh(MeshHandle handle) const { return m_Meshes.Get(handle); }
+	Shader* GetShader(ShaderHandle handle) const { return m_Shaders.Get(handle); }
+
+	// Once per frame, between frames.
+	void CollectGarbage();
+
+	// Frees everything, referenced or not. Needs the context.
+	void Clear();
+
+	const ResourceStats& GetMeshStats() const { return m_Meshes.GetStats(); }
+	const ResourceStats& GetShaderStats() const { return m_Shaders.GetStats(); }
+
+private:
+	TResourceTable<Mesh> m_Meshes;
+	TResourceTable<Shader> m_Shaders;
+	uint64_t m_Frame;
+	bool m_Sharing;
+};
+
+template<typename T>
+ResourceHandle<T> TResourceTable<T>::Find(uint64_t hash, const TArray<unsigned char>& content, size_t bytes)
+{
+	const auto it = m_Index.find(hash);
+	if (it == m_Index.end())
+	{
+		return ResourceHandle<T>{};
+	}
+
+	// A different resource with the same hash isn't shared, it replaces
+	// this one in the index when added.
+	Slot& slot = m_Slots[it->second];
+	if (slot.m_Content.Size() != content.Size() || memcmp(slot.m_Content.Data(), content.Data(), content.Size()) != 0)
+	{
+		return ResourceHandle<T>{};
+	}
+
+	if (slot.m_RefCount++ == 0)
+	{
+		CancelFree(it->second);
+	}
+	m_Stats.m_Requests++;
+	m_Stats.m_Shared++;
+	m_Stats.m_BytesSaved += bytes;
+	return ResourceHandle<T>{ it->second | (slot.m_Generation << RESOURCE_INDEX_BITS) };
+}
+
+template<typename T>
+ResourceHandle<T> TResourceTable<T>::Add(T* pResource, uint64_t hash, TArray<unsigned char>&& content, size_t bytes)
+{
+	uint32_t index;
+	if (!m_FreeIndices.IsEmpty())
+	{
+		index = m_FreeIndices.Back();
+		m_FreeIndices.PopBack();
+	}
+	else
+	{
+		index = (uint32_t)m_Slots.Size();
+		m_Slots.PushBack(Slot{ nullptr, 0, TArray<unsigned char>{}, 0, 0, 1 });
+	}
+
+	Slot& slot = m_Slots[index];
+	slot.m_pResource = pResource;
+	slot.m_Hash = hash;
+	slot.m_Bytes = bytes;
+	slot.m_RefCount = 1;
+	if (hash)
+	{
+		slot.m_Content = std::move(content);
+		m_Index[hash] = index;
+	}
+
+	m_Stats.m_Requests++;
+	m_Stats.m_Live++;
+	m_Stats.m_Bytes += bytes;
+	return ResourceHandle<T>{ index | (slot.m_Generation << RESOURCE_INDEX_BITS) };
+}
+
+template<typename T>
+bool TResourceTable<T>::IsAlive(ResourceHandle<T> handle) const
+{
+	return handle.IsValid() && handle.GetIndex() < m_Slots.Size() && m_Slots[handle.GetIndex()].m_Generation == handle.GetGeneration()
+		&& m_Slots[handle.GetIndex()].m_pResource;
+}
+
+template<typename T>
+void TResourceTable<T>::AddRef(ResourceHandle<T> handle)
+{
+	if (IsAlive(handle) && m_Slots[handle.GetIndex()].m_RefCount++ == 0)
+	{
+		CancelFree(handle.GetIndex());
+	}
+}
+
+template<typename T>
+void TResourceTable<T>::Release(ResourceHandle<T> handle, uint64_t frame)
+{
+	if (!IsAlive(handle) || !m_Slots[handle.GetIndex()].m_RefCount)
+	{
+		return;
+	}
+
+	if (--m_Slots[handle.GetIndex()].m_RefCount == 0)
+	{
+		m_PendingFrees.PushBack(PendingFree{ handle, frame });
+	}
+}
+
+template<typename T>
+T* TResourceTable<T>::Get(ResourceHandle<T> handle) const
+{
+	return IsAlive(handle) ? m_Slots[handle.GetIndex()].m_pResource : nullptr;
+}
+
+template<typename T>
+void TResourceTable<T>::SetContent(ResourceHandle<T> handle, uint64_t hash, TArray<unsigned char>&& content)
+{
+	if (!IsAlive(handle) || !m_Slots[handle.GetIndex()].m_Hash)
+	{
+		return;
+	}
+
+	const uint32_t index = handle.GetIndex();
+	Slot& slot = m_Slots[index];
+	const auto it = m_Index.find(slot.m_Hash);
+	if (it != m_Index.end() && it->second == index)
+	{
+		m_Index.erase(it);
+	}
+
+	slot.m_Hash = hash;
+	slot.m_Content = std::move(content);
+	m_Index[hash] = index;
+}
+
+template<typename T>
+void TResourceTable<T>::Collect(uint64_t frame, bool force)
+{
+	if (force)
+	{
+		for (uint32_t i = 0; i < m_Slots.Size(); i++)
+		{
+			if (m_Slots[i].m_pResource)
+			{
+				Free(i);
+			}
+		}
+		m_PendingFrees.Clear();
+		return;
+	}
+
+	// Released in order, so the ones old enough are at the front. Those
+	// taken back, or already freed through an earlier entry, are skipped.
+	size_t numDone = 0;
+	uint64_t numFreed = 0;
+	while (numDone < m_PendingFrees.Size() && m_PendingFrees[numDone].m_Frame <= frame)
+	{
+		const ResourceHandle<T> handle = m_PendingFrees[numDone++].m_Handle;
+		if (IsAlive(handle) && !m_Slots[handle.GetIndex()].m_RefCount)
+		{
+			Free(handle.GetIndex());
+			numFreed++;
+		}
+	}
+
+	for (size_t i = numDone; i < m_PendingFrees.Size(); i++)
+	{
+		m_PendingFrees[i - numDone] = m_PendingFrees[i];
+	}
+	m_PendingFrees.Resize(m_PendingFrees.Size() - numDone);
+	if (numFreed)
+	{
+		m_Stats.m_FreeBatches++;
+	}
+}
+
+template<typename T>
+void TResourceTable<T>::Free(uint32_t index)
+{
+	Slot& slot = m_Slots[index];
+	if (slot.m_Hash)
+	{
+		const auto it = m_Index.find(slot.m_Hash);
+		if (it != m_Index.end() && it->second == index)
+		{
+			m_Index.erase(it);
+		}
+	}
+
+	m_Pool.Destroy(slot.m_pResource);
+	slot.m_pResource = nullptr;
+	slot.m_Content = TArray<unsigned char>{};
+	m_Stats.m_Live--;
+	m_Stats.m_Bytes -= slot.m_Bytes;
+	m_Stats.m_Freed++;
+
+	// Skips 0 when it wraps around, that generation is never alive.
+	slot.m_Generation = (slot.m_Generation + 1) & RESOURCE_GENERATION_MASK;
+	slot.m_Generation = slot.m_Generation ? slot.m_Generation : 1;
+	m_FreeIndices.PushBack(index);
+}
+
+template<typename T>
+void TResourceTable<T>::CancelFree(uint32_t index)
+{
+	for (size_t i = 0; i < m_PendingFrees.Size(); i++)
+	{
+		if (m_PendingFrees[i].m_Handle.GetIndex() == index)
+		{
+			// Keeps the rest in release order, Collect relies on it.
+			for (size_t next = i + 1; next < m_PendingFrees.Size(); next++)
+			{
+				m_PendingFrees[next - 1] = m_PendingFrees[next];
+			}
+			m_PendingFrees.PopBack();
+			return;
+		}
+	}
+}
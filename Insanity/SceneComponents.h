@@ -0,0 +1,81 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Bounds.h"
+
+// Components of the objects GameApplication puts in the scene.
+
+struct Transform
+{
+	glm::vec3 m_Position;
+	glm::quat m_Rotation;
+	glm::vec3 m_Scale;
+};
+
+// Derived from Transform and the mesh bounds when transforms change.
+struct WorldTransform
+{
+	glm::mat4 m_Matrix;
+};
+
+struct WorldBounds
+{
+	AABB m_Bounds;
+};
+
+// Turns the object around m_Axis (unit length), one simulation step at a
+// time.
+struct Spin
+{
+	glm::vec3 m_Axis;
+	float m_RadiansPerSecond;
+};
+
+// Transform before the last simulation step, for objects that move: they
+// are drawn between it and Transform, where the frame falls between steps.
+struct PreviousTransform
+{
+	Transform m_Value;
+};
+
+// Indices into the application's mesh and shader lists.
+struct Renderable
+{
+	uint32_t m_MeshIndex;
+	uint32_t m_ShaderIndex;
+};
@@ -32,12 +32,54 @@
 
 #include "Shader.h"
 
+#include <cstring>
+#include <utility>
+
+#include "ShaderCache.h"
+
+static const char* s_UniformNames[NUM_SHADER_UNIFORMS] = {
+    "model",
+    "projection",
+};
+
+// 32 bit FNV-1a, enough to tell apart the names in one program.
+static uint32_t HashName(const char* pName)
+{
+    uint32_t hash = 0x811C9DC5u;
+    for (; *pName; pName++)
+    {
+        hash ^= (unsigned char)*pName;
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+static GLint FindVariable(const TArray<ShaderVariable>& variables, const char* pName)
+{
+    const uint32_t hash = HashName(pName);
+    for (const ShaderVariable& variable : variables)
+    {
+        if (variable.m_NameHash == hash)
+        {
+            return variable.m_Location;
+        }
+    }
+    return -1;
+}
 
 Shader::Shader():
     m_ShaderID{0},
-    m_UniformModel{0},
-    m_UniformProjection{0}
+    m_UniformBlocks{0},
+    m_Instanced{false},
+    m_PendingShaders{0, 0},
+    m_pCache{nullptr},
+    m_CacheKey{0},
+    m_FromCache{false}
 {
+    for (GLint& location : m_UniformLocations)
+    {
+        location = -1;
+    }
 }
 
 Shader::~Shader()
@@ -45,7 +87,19 @@ Shader::~Shader()
     ClearShader();
 }
 
-void Shader::CompileShader(const std::string& vCode, const std::string& fCode)
+bool Shader::EnableParallelCompile()
+{
+    if (!GLEW_KHR_parallel_shader_compile)
+    {
+        return false;
+    }
+
+    // 0xFFFFFFFF lets the driver pick the number of threads.
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    return true;
+}
+
+void Shader::CompileShader(const std::string& vCode, const std::string& fCode, bool retrievable)
 {
     m_ShaderID = glCreateProgram();
 
@@ -56,20 +110,70 @@ void Shader::CompileShader(const std::string& vCode, const std::string& fCode)
         return;
     }
 
-    AddShader(vCode, GL_VERTEX_SHADER);
+    m_PendingShaders[0] = AddShader(vCode, GL_VERTEX_SHADER);
+
+    m_PendingShaders[1] = AddShader(fCode, GL_FRAGMENT_SHADER);
+
+    // Fixed locations so any program can be used with any Mesh VAO.
+    glBindAttribLocation(m_ShaderID, ATTRIB_POSITION, "pos");
+    glBindAttribLocation(m_ShaderID, ATTRIB_INSTANCE_MODEL, "instanceModel");
+    glBindAttribLocation(m_ShaderID, ATTRIB_NORMAL, "normal");
+    glBindAttribLocation(m_ShaderID, ATTRIB_TEXCOORD, "texCoord");
+    glBindAttribLocation(m_ShaderID, ATTRIB_TANGENT, "tangent");
+    glBindAttribLocation(m_ShaderID, ATTRIB_COLOR, "color");
+
+    if (retrievable)
+    {
+        glProgramParameteri(m_ShaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // No status queries here, they would wait for the compile to finish.
+    glLinkProgram(m_ShaderID);
+}
+
+GLuint Shader::AddShader(const std::string& shaderCode, GLenum shaderType)
+{
+    const GLchar* pCode[1];
+
+    pCode[0] = shaderCode.c_str();
+
+    GLint codeLength[1];
+    codeLength[0] = strlen(shaderCode.c_str());
 
-    AddShader(fCode, GL_FRAGMENT_SHADER);
+    GLuint currentShader = glCreateShader(shaderType);
 
+    glShaderSource(currentShader, 1, pCode, codeLength);
+    glCompileShader(currentShader);
+
+    glAttachShader(m_ShaderID, currentShader);
+    return currentShader;
+}
+
+bool Shader::CheckProgram()
+{
     GLint errorCode = 0;
     GLchar buffer[1024];
 
-    glLinkProgram(m_ShaderID);
     glGetProgramiv(m_ShaderID, GL_LINK_STATUS, &errorCode);
     if (!errorCode)
     {
+        // A failed compile shows up as a failed link, report it first.
+        for (GLuint shader : m_PendingShaders)
+        {
+            GLint compiled = 0;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+            if (!compiled)
+            {
+                GLint shaderType = 0;
+                glGetShaderiv(shader, GL_SHADER_TYPE, &shaderType);
+                glGetShaderInfoLog(shader, sizeof(buffer), nullptr, buffer);
+                std::cout << "ERROR (COMPILER (" << shaderType << ")): " << buffer << std::endl;
+            }
+        }
+
         glGetProgramInfoLog(m_ShaderID, sizeof(buffer), nullptr, buffer);
         std::cout << "ERROR (LINKER): " << buffer << std::endl;
-        return;
+        return false;
     }
 
     glValidateProgram(m_ShaderID);
@@ -78,73 +182,241 @@ void Shader::CompileShader(const std::string& vCode, const std::string& fCode)
     {
         glGetProgramInfoLog(m_ShaderID, sizeof(buffer), nullptr, buffer);
         std::cout << "ERROR (VALIDATE): " << buffer << std::endl;
-        return;
+        return false;
+    }
+
+    return true;
+}
+
+void Shader::DeletePendingShaders()
+{
+    for (GLuint& shader : m_PendingShaders)
+    {
+        if (shader)
+        {
+            // The program keeps the linked code.
+            if (m_ShaderID)
+            {
+                glDetachShader(m_ShaderID, shader);
+            }
+            glDeleteShader(shader);
+            shader = 0;
+        }
+    }
+}
+
+void Shader::Reflect()
+{
+    GLchar name[256];
+    GLint count = 0;
+
+    m_Uniforms.Clear();
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        ShaderVariable variable;
+        glGetActiveUniform(m_ShaderID, (GLuint)i, sizeof(name), &length, &variable.m_Size, &variable.m_Type, name);
+
+        // Arrays are reported as "name[0]", store them as "name".
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+        {
+            name[length - 3] = '\0';
+        }
+
+        // Uniforms inside blocks have no location.
+        variable.m_Location = glGetUniformLocation(m_ShaderID, name);
+        variable.m_NameHash = HashName(name);
+        m_Uniforms.PushBack(variable);
+    }
+
+    m_Attributes.Clear();
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        ShaderVariable variable;
+        glGetActiveAttrib(m_ShaderID, (GLuint)i, sizeof(name), nullptr, &variable.m_Size, &variable.m_Type, name);
+        variable.m_Location = glGetAttribLocation(m_ShaderID, name);
+        variable.m_NameHash = HashName(name);
+        m_Attributes.PushBack(variable);
     }
 
     // Cogemos el valor de la variable uniform declarada en el shader.
-    m_UniformModel = glGetUniformLocation(m_ShaderID, "model");
-    m_UniformProjection = glGetUniformLocation(m_ShaderID, "projection");
+    for (int uniform = 0; uniform < NUM_SHADER_UNIFORMS; uniform++)
+    {
+        m_UniformLocations[uniform] = FindVariable(m_Uniforms, s_UniformNames[uniform]);
+    }
+    m_Instanced = FindVariable(m_Attributes, "instanceModel") != -1;
+
+    // GLSL 330 can't set the binding in the shader, so do it here. Also
+    // needed for programs from the cache.
+    m_UniformBlocks = 0;
+    for (int block = 0; block < NUM_UNIFORM_BLOCKS; block++)
+    {
+        const GLuint index = glGetUniformBlockIndex(m_ShaderID, UNIFORM_BLOCK_NAMES[block]);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(m_ShaderID, index, (GLuint)block);
+            m_UniformBlocks |= 1u << block;
+        }
+    }
 }
 
-void Shader::AddShader(const std::string& shaderCode, GLenum shaderType)
+std::string Shader::InsertDefines(const std::string& code, const std::string& defines)
 {
-    GLint errorCode = 0;
-    GLchar buffer[1024];
-    const GLchar* pCode[1];
+    if (defines.empty())
+    {
+        return code;
+    }
 
-    pCode[0] = shaderCode.c_str();
+    // #version has to stay the first line.
+    size_t position = 0;
+    const size_t version = code.find("#version");
+    if (version != std::string::npos)
+    {
+        const size_t lineEnd = code.find('\n', version);
+        position = lineEnd == std::string::npos ? code.size() : lineEnd + 1;
+    }
 
-    GLint codeLength[1];
-    codeLength[0] = strlen(shaderCode.c_str());
+    std::string result = code.substr(0, position);
+    if (!result.empty() && result.back() != '\n')
+    {
+        result += '\n';
+    }
+    result += defines;
+    if (result.back() != '\n')
+    {
+        result += '\n';
+    }
+    result += code.substr(position);
+    return result;
+}
 
-    GLuint currentShader = glCreateShader(shaderType);
+void Shader::BeginCreate(const std::string& vCode, const std::string& fCode, ShaderCache* pCache, const std::string& defines)
+{
+    ClearShader();
 
-    glShaderSource(currentShader, 1, pCode, codeLength);
-    glCompileShader(currentShader);
+    m_pCache = pCache && pCache->IsEnabled() ? pCache : nullptr;
+    m_FromCache = false;
 
-    glGetShaderiv(currentShader, GL_COMPILE_STATUS, &errorCode);
-    if (!errorCode)
+    if (m_pCache)
     {
-        glGetShaderInfoLog(currentShader, sizeof(buffer), nullptr, buffer);
-        std::cout << "ERROR (COMPILER (" << shaderType << ")): " << buffer << std::endl;
-        return;
+        m_CacheKey = m_pCache->MakeKey(vCode, fCode, defines);
+        m_ShaderID = m_pCache->Load(m_CacheKey);
+        if (m_ShaderID)
+        {
+            m_FromCache = true;
+            return;
+        }
     }
 
-    glAttachShader(m_ShaderID, currentShader);
+    CompileShader(InsertDefines(vCode, defines), InsertDefines(fCode, defines), m_pCache != nullptr);
+}
+
+bool Shader::IsCompileDone() const
+{
+    if (!m_ShaderID || m_FromCache || !GLEW_KHR_parallel_shader_compile)
+    {
+        return true;
+    }
+
+    GLint done = GL_TRUE;
+    glGetProgramiv(m_ShaderID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
 }
 
-void Shader::CreateFromString(const std::string& vCode, const std::string& fCode)
+void Shader::Swap(Shader& other)
 {
-    CompileShader(vCode, fCode);
+    std::swap(m_ShaderID, other.m_ShaderID);
+    std::swap(m_UniformLocations, other.m_UniformLocations);
+    std::swap(m_UniformBlocks, other.m_UniformBlocks);
+    std::swap(m_Instanced, other.m_Instanced);
+    std::swap(m_Uniforms, other.m_Uniforms);
+    std::swap(m_Attributes, other.m_Attributes);
 }
 
-void Shader::CreateFromFile(const std::string& vertexFile, const std::string& fragmentFile)
+bool Shader::FinishCreate()
 {
-    std::ifstream vFile{ vertexFile };
-    std::ifstream fFile{ fragmentFile };
-    if (vFile.is_open() && fFile.is_open())
+    if (!m_ShaderID)
     {
-        std::stringstream ss1, ss2;
-        ss1 << vFile.rdbuf();
-        ss2 << fFile.rdbuf();
+        return false;
+    }
 
-        CreateFromString(ss1.str(), ss2.str());
+    const bool linked = m_FromCache || CheckProgram();
+    DeletePendingShaders();
 
+    if (!linked)
+    {
+        return false;
+    }
+
+    if (m_pCache && !m_FromCache)
+    {
+        m_pCache->Store(m_CacheKey, m_ShaderID);
+    }
+    m_pCache = nullptr;
+
+    Reflect();
+    return true;
+}
+
+void Shader::CreateFromString(const std::string& vCode, const std::string& fCode, ShaderCache* pCache, const std::string& defines)
+{
+    BeginCreate(vCode, fCode, pCache, defines);
+    FinishCreate();
+}
+
+bool Shader::ReadFile(const std::string& fileName, std::string& contents)
+{
+    // One read straight into the string instead of going through a stringstream.
+    std::ifstream file{ fileName, std::ios::binary | std::ios::ate };
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    contents.resize((size_t)file.tellg());
+    file.seekg(0);
+    return (bool)file.read(&contents[0], contents.size());
+}
+
+void Shader::CreateFromFile(const std::string& vertexFile, const std::string& fragmentFile, ShaderCache* pCache, const std::string& defines)
+{
+    std::string vCode, fCode;
+    if (ReadFile(vertexFile, vCode) && ReadFile(fragmentFile, fCode))
+    {
+        CreateFromString(vCode, fCode, pCache, defines);
     }
     else
     {
         // TODO: Handle error
+        std::cout << "ERROR: Reading " << vertexFile << " or " << fragmentFile << "." << std::endl;
     }
 }
 
 GLuint Shader::GetProjectionLocation()
 {
-    return m_UniformProjection;
+    return m_UniformLocations[UNIFORM_PROJECTION];
 }
 
 GLuint Shader::GetModelLocation()
 {
-    return m_UniformModel;
+    return m_UniformLocations[UNIFORM_MODEL];
+}
+
+GLint Shader::FindUniform(const char* pName) const
+{
+    return FindVariable(m_Uniforms, pName);
+}
+
+GLint Shader::FindAttribute(const char* pName) const
+{
+    return FindVariable(m_Attributes, pName);
+}
+
+bool Shader::IsInstanced()
+{
+    return m_Instanced;
 }
 
 void Shader::UseShader()
@@ -154,12 +426,20 @@ void Shader::UseShader()
 
 void Shader::ClearShader()
 {
+    DeletePendingShaders();
+
     if (m_ShaderID)
     {
         glDeleteProgram(m_ShaderID);
         m_ShaderID = 0;
     }
 
-    m_UniformProjection = 0;
-    m_UniformModel = 0;
+    for (GLint& location : m_UniformLocations)
+    {
+        location = -1;
+    }
+    m_Uniforms.Clear();
+    m_Attributes.Clear();
+    m_UniformBlocks = 0;
+    m_Instanced = false;
 }
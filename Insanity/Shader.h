@@ -32,6 +32,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -39,25 +40,109 @@
 
 #include "GL/glew.h"
 
+#include "TArray.h"
+#include "UniformBlocks.h"
+#include "VertexAttributes.h"
+
+class ShaderCache;
+
+// Uniforms the engine sets itself. Their locations are reflected into a
+// fixed table once, after linking, so drawing never looks a name up.
+enum ShaderUniform
+{
+	UNIFORM_MODEL,
+	UNIFORM_PROJECTION,
+
+	NUM_SHADER_UNIFORMS
+};
+
+// One active uniform or attribute, as reported by the driver.
+struct ShaderVariable
+{
+	uint32_t m_NameHash;
+	GLint m_Location;
+	GLenum m_Type;
+	GLint m_Size;
+};
+
 class Shader
 {
 public:
 	Shader();
 	~Shader();
 
-	void CreateFromString(const std::string&vCode, const std::string &fCode);
-	void CreateFromFile(const std::string& vertexFile, const std::string& fragmentFile);
+	// With a cache the linked program is loaded from disk when the sources
+	// haven't changed since it was stored. defines is a block of #define
+	// lines inserted right after #version.
+	void CreateFromString(const std::string&vCode, const std::string &fCode, ShaderCache* pCache = nullptr, const std::string& defines = "");
+	void CreateFromFile(const std::string& vertexFile, const std::string& fragmentFile, ShaderCache* pCache = nullptr, const std::string& defines = "");
+
+	// CreateFromString split in two so many programs can compile at once:
+	// BeginCreate submits the compile and link without waiting for them,
+	// FinishCreate waits, checks the result and reflects the program.
+	void BeginCreate(const std::string& vCode, const std::string& fCode, ShaderCache* pCache, const std::string& defines);
+	bool FinishCreate();
+
+	// True when FinishCreate won't block. Always true without
+	// GL_KHR_parallel_shader_compile.
+	bool IsCompileDone() const;
+
+	// Exchanges the programs and everything reflected from them, so one
+	// rebuilt in a scratch Shader takes this one's place without whoever
+	// points at this one noticing. Neither may be between BeginCreate and
+	// FinishCreate.
+	void Swap(Shader& other);
+
+	// Lets the driver compile on as many threads as it wants. Call once
+	// after the context is created. False when the extension is missing.
+	static bool EnableParallelCompile();
+
+	// Whole file into contents. False when it can't be read.
+	static bool ReadFile(const std::string& fileName, std::string& contents);
 
 	GLuint GetProjectionLocation();
 	GLuint GetModelLocation();
+	GLint GetUniformLocation(ShaderUniform uniform) const { return m_UniformLocations[uniform]; }
+	GLuint GetShaderID() const { return m_ShaderID; }
+
+	// Slow path for uniforms outside ShaderUniform: searches the reflected
+	// table, no GL call. -1 when the program doesn't use it.
+	GLint FindUniform(const char* pName) const;
+	GLint FindAttribute(const char* pName) const;
+
+	const TArray<ShaderVariable>& GetUniforms() const { return m_Uniforms; }
+	const TArray<ShaderVariable>& GetAttributes() const { return m_Attributes; }
+
+	// True when the program declares the block, already bound to its
+	// UniformBlockBinding point.
+	bool HasUniformBlock(UniformBlockBinding block) const { return (m_UniformBlocks & (1u << block)) != 0; }
+
+	// True when the program reads the model matrix from the per-instance
+	// attribute instead of the model uniform.
+	bool IsInstanced();
 
 	void UseShader();
 	void ClearShader();
 
 private:
-	GLuint m_ShaderID, m_UniformProjection, m_UniformModel;
+	GLuint m_ShaderID;
+	GLint m_UniformLocations[NUM_SHADER_UNIFORMS];
+	uint32_t m_UniformBlocks;
+	bool m_Instanced;
 
-	void CompileShader(const std::string& vCode, const std::string& fCode);
-	void AddShader(const std::string& shaderCode, GLenum shaderType);
-};
+	TArray<ShaderVariable> m_Uniforms;
+	TArray<ShaderVariable> m_Attributes;
 
+	// State between BeginCreate and FinishCreate.
+	GLuint m_PendingShaders[2];
+	ShaderCache* m_pCache;
+	uint64_t m_CacheKey;
+	bool m_FromCache;
+
+	void CompileShader(const std::string& vCode, const std::string& fCode, bool retrievable);
+	GLuint AddShader(const std::string& shaderCode, GLenum shaderType);
+	bool CheckProgram();
+	void DeletePendingShaders();
+	void Reflect();
+	static std::string InsertDefines(const std::string& code, const std::string& defines);
+};
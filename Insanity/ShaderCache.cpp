@@ -0,0 +1,240 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ShaderCache.h"
+
+#include <stdio.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "TArray.h"
+
+// Bump when the entry layout changes.
+static const uint32_t SHADER_CACHE_MAGIC = 0x48435349; // "ISCH"
+static const uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheEntryHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	uint64_t m_Key;
+	uint32_t m_Format;
+	uint32_t m_Length;
+};
+
+// 64 bit FNV-1a.
+static uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+{
+    const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const std::string& text)
+{
+    // Include the terminator so "ab" + "c" and "a" + "bc" differ.
+    return HashBytes(hash, text.c_str(), text.size() + 1);
+}
+
+static std::string GetGLString(GLenum name)
+{
+    const GLubyte* pString = glGetString(name);
+    return pString ? reinterpret_cast<const char*>(pString) : "";
+}
+
+ShaderCache::ShaderCache(const std::string& directory):
+    m_Directory{directory},
+    m_Enabled{false},
+    m_Hits{0},
+    m_Misses{0}
+{
+}
+
+void ShaderCache::Init()
+{
+    GLint numFormats = 0;
+    if (GLEW_ARB_get_program_binary)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    }
+
+    if (numFormats <= 0)
+    {
+        std::cout << "Shader cache disabled: the driver has no program binary formats." << std::endl;
+        m_Enabled = false;
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+    if (error)
+    {
+        std::cout << "ERROR: Creating shader cache " << m_Directory << ": " << error.message() << std::endl;
+        m_Enabled = false;
+        return;
+    }
+
+    m_Driver = GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION);
+    m_Enabled = true;
+}
+
+void ShaderCache::Clear()
+{
+    std::error_code error;
+    std::filesystem::remove_all(m_Directory, error);
+    std::filesystem::create_directories(m_Directory, error);
+}
+
+uint64_t ShaderCache::MakeKey(const std::string& vCode, const std::string& fCode, const std::string& defines) const
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = HashBytes(hash, &SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+    hash = HashString(hash, m_Driver);
+    hash = HashString(hash, defines);
+    hash = HashString(hash, vCode);
+    hash = HashString(hash, fCode);
+    return hash;
+}
+
+std::string ShaderCache::GetEntryPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return m_Directory + "/" + name;
+}
+
+GLuint ShaderCache::Load(uint64_t key)
+{
+    if (!m_Enabled)
+    {
+        return 0;
+    }
+
+    const std::string path = GetEntryPath(key);
+    std::ifstream file{ path, std::ios::binary };
+    if (!file.is_open())
+    {
+        m_Misses++;
+        return 0;
+    }
+
+    // Entries are written whole, so the binary is exactly the rest of the
+    // file. A length that says otherwise is a corrupt entry, not something
+    // to allocate.
+    std::error_code sizeError;
+    const uintmax_t fileSize = std::filesystem::file_size(path, sizeError);
+
+    ShaderCacheEntryHeader header;
+    TArray<char> binary;
+    bool valid = !sizeError && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        header.m_Magic == SHADER_CACHE_MAGIC && header.m_Version == SHADER_CACHE_VERSION && header.m_Key == key &&
+        header.m_Length > 0 && header.m_Length == fileSize - sizeof(header);
+    if (valid)
+    {
+        binary.Resize(header.m_Length);
+        valid = (bool)file.read(binary.Data(), header.m_Length);
+    }
+    file.close();
+
+    GLuint program = 0;
+    if (valid)
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, header.m_Format, binary.Data(), (GLsizei)binary.Size());
+
+        // Drivers are free to reject a binary (e.g. after an update that
+        // kept the version string), that shows up as a failed link.
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program)
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        m_Misses++;
+        return 0;
+    }
+
+    m_Hits++;
+    return program;
+}
+
+void ShaderCache::Store(uint64_t key, GLuint program)
+{
+    if (!m_Enabled || !program)
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    TArray<char> binary;
+    binary.Resize((size_t)length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.Data());
+
+    ShaderCacheEntryHeader header{ SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, format, (uint32_t)length };
+
+    // Write to a temporary name first so a crash never leaves a truncated
+    // entry behind.
+    const std::string path = GetEntryPath(key);
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.Data(), length);
+        if (!file)
+        {
+            std::cout << "ERROR: Writing shader cache entry " << tempPath << "." << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+}
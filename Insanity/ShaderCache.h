@@ -0,0 +1,77 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "GL/glew.h"
+
+// On-disk cache of linked program binaries (glGetProgramBinary). Entries
+// are keyed by a hash of the shader sources, the defines and the driver
+// (vendor, renderer, version), so editing a shader or updating the driver
+// just misses and the program is compiled from source again.
+class ShaderCache
+{
+public:
+	explicit ShaderCache(const std::string& directory);
+
+	// Needs a current context. Disables the cache when the driver can't
+	// give program binaries back.
+	void Init();
+
+	// Deletes every cached program, the next launch starts cold.
+	void Clear();
+
+	bool IsEnabled() const { return m_Enabled; }
+
+	uint64_t MakeKey(const std::string& vCode, const std::string& fCode, const std::string& defines) const;
+
+	// Linked program for key, or 0 when there is no valid entry. Stale or
+	// rejected entries are deleted.
+	GLuint Load(uint64_t key);
+
+	// Saves a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	void Store(uint64_t key, GLuint program);
+
+	uint32_t GetHits() const { return m_Hits; }
+	uint32_t GetMisses() const { return m_Misses; }
+
+private:
+	std::string m_Directory;
+	std::string m_Driver;
+	bool m_Enabled;
+	uint32_t m_Hits, m_Misses;
+
+	std::string GetEntryPath(uint64_t key) const;
+};
@@ -0,0 +1,179 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ShaderPermutations.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "Shader.h"
+
+ShaderPermutations::ShaderPermutations()
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    Clear();
+}
+
+bool ShaderPermutations::Create(const std::string& vertexFile, const std::string& fragmentFile, const TArray<std::string>& features, const TArray<uint32_t>& masks, ShaderCache* pCache)
+{
+    Clear();
+
+    if (features.Size() > MAX_FEATURES)
+    {
+        std::cout << "ERROR: " << vertexFile << " has " << features.Size() << " features, at most " << MAX_FEATURES << " are supported." << std::endl;
+        return false;
+    }
+
+    std::string vCode, fCode;
+    if (!Shader::ReadFile(vertexFile, vCode) || !Shader::ReadFile(fragmentFile, fCode))
+    {
+        std::cout << "ERROR: Reading " << vertexFile << " or " << fragmentFile << "." << std::endl;
+        return false;
+    }
+
+    m_Features = features;
+    if (masks.IsEmpty())
+    {
+        const uint32_t numVariants = 1u << features.Size();
+        for (uint32_t mask = 0; mask < numVariants; mask++)
+        {
+            m_Masks.PushBack(mask);
+        }
+    }
+    else
+    {
+        m_Masks = masks;
+    }
+
+    // Submit everything first...
+    for (uint32_t mask : m_Masks)
+    {
+        Shader* pShader = m_ShaderPool.Create();
+        pShader->BeginCreate(vCode, fCode, pCache, GetDefines(mask));
+        m_Variants.PushBack(pShader);
+    }
+
+    // ...then collect them in whatever order they finish. Without
+    // GL_KHR_parallel_shader_compile every variant reports done and
+    // FinishCreate simply waits for it.
+    bool success = true;
+    TArray<bool> finished;
+    finished.Resize(m_Variants.Size());
+
+    size_t remaining = m_Variants.Size();
+    while (remaining)
+    {
+        size_t collected = 0;
+        for (size_t i = 0; i < m_Variants.Size(); i++)
+        {
+            if (finished[i] || !m_Variants[i]->IsCompileDone())
+            {
+                continue;
+            }
+
+            if (!m_Variants[i]->FinishCreate())
+            {
+                std::cout << "ERROR: Variant " << m_Masks[i] << " of " << vertexFile << " (" << GetDefines(m_Masks[i]) << ")" << std::endl;
+                m_ShaderPool.Destroy(m_Variants[i]);
+                m_Variants[i] = nullptr;
+                success = false;
+            }
+
+            finished[i] = true;
+            collected++;
+        }
+
+        remaining -= collected;
+        if (remaining && !collected)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    return success;
+}
+
+void ShaderPermutations::Clear()
+{
+    for (Shader* pShader : m_Variants)
+    {
+        if (pShader)
+        {
+            m_ShaderPool.Destroy(pShader);
+        }
+    }
+
+    m_Variants.Clear();
+    m_Masks.Clear();
+    m_Features.Clear();
+}
+
+Shader* ShaderPermutations::GetVariant(uint32_t mask) const
+{
+    for (size_t i = 0; i < m_Masks.Size(); i++)
+    {
+        if (m_Masks[i] == mask)
+        {
+            return m_Variants[i];
+        }
+    }
+    return nullptr;
+}
+
+uint32_t ShaderPermutations::GetFeatureMask(const std::string& feature) const
+{
+    for (size_t i = 0; i < m_Features.Size(); i++)
+    {
+        if (m_Features[i] == feature)
+        {
+            return 1u << i;
+        }
+    }
+    return 0;
+}
+
+std::string ShaderPermutations::GetDefines(uint32_t mask) const
+{
+    std::string defines;
+    for (size_t i = 0; i < m_Features.Size(); i++)
+    {
+        if (mask & (1u << i))
+        {
+            defines += "#define " + m_Features[i] + "\n";
+        }
+    }
+    return defines;
+}
@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "Allocator.h"
+#include "TArray.h"
+
+class Shader;
+class ShaderCache;
+
+// One vertex/fragment source pair compiled once per combination of feature
+// defines. A variant is named by a bit mask over the features: bit i set
+// means features[i] is #defined.
+class ShaderPermutations
+{
+public:
+	static const uint32_t MAX_FEATURES = 16;
+
+	ShaderPermutations();
+	~ShaderPermutations();
+
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+	// Compiles the variants in masks, or every combination when masks is
+	// empty. All of them are submitted before waiting on any, so the
+	// driver can compile them in parallel. Returns false if any failed.
+	bool Create(const std::string& vertexFile, const std::string& fragmentFile, const TArray<std::string>& features, const TArray<uint32_t>& masks, ShaderCache* pCache = nullptr);
+	void Clear();
+
+	// nullptr when the variant wasn't requested or failed to build.
+	Shader* GetVariant(uint32_t mask) const;
+
+	uint32_t GetFeatureMask(const std::string& feature) const;
+	size_t GetNumVariants() const { return m_Variants.Size(); }
+
+	// The #define lines of variant mask, for rebuilding it elsewhere (hot
+	// reload).
+	std::string GetDefines(uint32_t mask) const;
+
+private:
+	TArray<std::string> m_Features;
+	TArray<uint32_t> m_Masks;
+	TArray<Shader*> m_Variants;
+	TPool<Shader> m_ShaderPool;
+};
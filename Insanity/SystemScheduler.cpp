@@ -0,0 +1,102 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SystemScheduler.h"
+
+#include "Profiler.h"
+
+static bool Conflicts(ComponentMask readsA, ComponentMask writesA, ComponentMask readsB, ComponentMask writesB)
+{
+    return (writesA & (readsB | writesB)) || (writesB & readsA);
+}
+
+void SystemScheduler::AddSystem(const char* pName, ComponentMask reads, ComponentMask writes, SystemFunction function, void* pData)
+{
+    uint32_t phase = 0;
+    for (const System& system : m_Systems)
+    {
+        if (Conflicts(reads, writes, system.m_Reads, system.m_Writes) && system.m_Phase + 1 > phase)
+        {
+            phase = system.m_Phase + 1;
+        }
+    }
+
+    m_Systems.PushBack(System{ pName, reads, writes, function, pData, phase });
+    m_NumPhases = phase + 1 > m_NumPhases ? phase + 1 : m_NumPhases;
+}
+
+void SystemScheduler::Clear()
+{
+    m_Systems.Clear();
+    m_NumPhases = 0;
+}
+
+void SystemScheduler::RunSystemJob(void* pData, uint32_t begin, uint32_t end)
+{
+    SystemJob* pJobs = static_cast<SystemJob*>(pData);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        PROFILE_SCOPE(pJobs[i].m_pSystem->m_pName);
+        pJobs[i].m_pSystem->m_Function(pJobs[i].m_pSystem->m_pData, *pJobs[i].m_pWorld, *pJobs[i].m_pJobSystem);
+    }
+}
+
+void SystemScheduler::Run(World& world, JobSystem& jobSystem)
+{
+    m_Jobs.Reserve(m_Systems.Size());
+
+    for (uint32_t phase = 0; phase < m_NumPhases; phase++)
+    {
+        m_Jobs.Clear();
+        for (const System& system : m_Systems)
+        {
+            if (system.m_Phase == phase)
+            {
+                m_Jobs.PushBack(SystemJob{ &system, &world, &jobSystem });
+            }
+        }
+
+        // A phase of one runs here, no point going through the queue.
+        if (m_Jobs.Size() == 1)
+        {
+            RunSystemJob(m_Jobs.Data(), 0, 1);
+            continue;
+        }
+
+        JobCounter counter;
+        for (uint32_t i = 0; i < (uint32_t)m_Jobs.Size(); i++)
+        {
+            jobSystem.Run(&SystemScheduler::RunSystemJob, m_Jobs.Data(), &counter, i, i + 1);
+        }
+        jobSystem.Wait(counter);
+    }
+}
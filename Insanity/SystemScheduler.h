@@ -0,0 +1,90 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Entity.h"
+#include "JobSystem.h"
+#include "TArray.h"
+#include "World.h"
+
+typedef void (*SystemFunction)(void* pData, World& world, JobSystem& jobSystem);
+
+// Runs systems over a World, in parallel where it is safe. Each system
+// declares the components it reads and writes; two systems conflict when
+// one writes something the other touches. Systems are grouped into phases
+// in the order they were added: a system goes into the first phase after
+// every earlier system it conflicts with, so conflicting systems keep
+// their order and the others run side by side as jobs.
+//
+// Systems may use the job system themselves (ParallelForEachChunk), but
+// must not create or destroy entities or change their components' set.
+class SystemScheduler
+{
+public:
+	void AddSystem(const char* pName, ComponentMask reads, ComponentMask writes, SystemFunction function, void* pData);
+	void Clear();
+
+	// Not reentrant: one Run at a time per scheduler.
+	void Run(World& world, JobSystem& jobSystem);
+
+	uint32_t GetNumPhases() const { return m_NumPhases; }
+
+private:
+	struct System
+	{
+		const char* m_pName;
+		ComponentMask m_Reads;
+		ComponentMask m_Writes;
+		SystemFunction m_Function;
+		void* m_pData;
+		uint32_t m_Phase;
+	};
+
+	struct SystemJob
+	{
+		const System* m_pSystem;
+		World* m_pWorld;
+		JobSystem* m_pJobSystem;
+	};
+
+	TArray<System> m_Systems;
+	uint32_t m_NumPhases = 0;
+
+	// One phase's jobs, kept between runs so Run doesn't allocate once it
+	// has grown to the largest phase.
+	TArray<SystemJob> m_Jobs;
+
+	static void RunSystemJob(void* pData, uint32_t begin, uint32_t end);
+};
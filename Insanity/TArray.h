@@ -35,47 +35,310 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <stdlib.h>
+#include <new>
+#include <utility>
+#include <type_traits>
 
-template<typename T>
+#include "Allocator.h"
+
+// Growth policies. They receive the current capacity and the minimum capacity
+// required and return the new capacity to allocate.
+struct TArrayGeometricGrowth
+{
+	static size_t Grow(size_t capacity, size_t required)
+	{
+		size_t newCapacity = capacity + capacity / 2;
+		if (newCapacity < 4)
+		{
+			newCapacity = 4;
+		}
+		return newCapacity < required ? required : newCapacity;
+	}
+};
+
+struct TArrayDoublingGrowth
+{
+	static size_t Grow(size_t capacity, size_t required)
+	{
+		size_t newCapacity = capacity ? capacity * 2 : 4;
+		return newCapacity < required ? required : newCapacity;
+	}
+};
+
+template<typename T, typename Allocator = HeapAllocator, typename Growth = TArrayGeometricGrowth>
 class TArray
 {
 private:
+	Allocator m_Allocator;
 	T* m_pElem;
 	size_t m_Size;
-	size_t m_CurrentIndex;
-	size_t m_Growth;
+	size_t m_Capacity;
+
+	T* AllocateStorage(size_t capacity)
+	{
+		return capacity ? static_cast<T*>(m_Allocator.Allocate(capacity * sizeof(T), alignof(T))) : nullptr;
+	}
+
+	void FreeStorage(T* pElem, size_t capacity)
+	{
+		if (pElem)
+		{
+			m_Allocator.Free(pElem, capacity * sizeof(T), alignof(T));
+		}
+	}
+
+	static void DestroyRange(T* first, T* last)
+	{
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			for (; first != last; ++first)
+			{
+				first->~T();
+			}
+		}
+	}
+
+	// Moves (or copies, if T can throw while moving) the live elements into
+	// newElem and releases the old buffer.
+	void Relocate(T* newElem, size_t newCapacity)
+	{
+		for (size_t i = 0; i < m_Size; i++)
+		{
+			new (newElem + i) T(std::move_if_noexcept(m_pElem[i]));
+		}
+		DestroyRange(m_pElem, m_pElem + m_Size);
+		FreeStorage(m_pElem, m_Capacity);
+
+		m_pElem = newElem;
+		m_Capacity = newCapacity;
+	}
+
+	template<typename... Args>
+	T& EmplaceBackSlow(Args&&... args)
+	{
+		const size_t newCapacity = Growth::Grow(m_Capacity, m_Size + 1);
+		T* newElem = AllocateStorage(newCapacity);
+
+		// Construct the new element first: args may reference an element
+		// of the buffer that is about to be relocated.
+		new (newElem + m_Size) T(std::forward<Args>(args)...);
+		Relocate(newElem, newCapacity);
+
+		return m_pElem[m_Size++];
+	}
 
 public:
-	TArray(size_t size = 1, size_t growth = 1):
-		m_pElem{new T[size]},
-		m_Size{size},
-		m_CurrentIndex{0},
-		m_Growth{growth}
+	TArray():
+		TArray(0)
+	{
+	}
+
+	explicit TArray(size_t capacity, const Allocator& allocator = Allocator()):
+		m_Allocator{allocator},
+		m_pElem{AllocateStorage(capacity)},
+		m_Size{0},
+		m_Capacity{capacity}
 	{
 		
 	}
 
+	explicit TArray(const Allocator& allocator):
+		TArray(0, allocator)
+	{
+	}
+
+	TArray(const TArray& other):
+		m_Allocator{other.m_Allocator},
+		m_pElem{AllocateStorage(other.m_Size)},
+		m_Size{0},
+		m_Capacity{other.m_Size}
+	{
+		for (; m_Size < other.m_Size; m_Size++)
+		{
+			new (m_pElem + m_Size) T(other.m_pElem[m_Size]);
+		}
+	}
+
+	TArray(TArray&& other) noexcept:
+		m_Allocator{other.m_Allocator},
+		m_pElem{other.m_pElem},
+		m_Size{other.m_Size},
+		m_Capacity{other.m_Capacity}
+	{
+		other.m_pElem = nullptr;
+		other.m_Size = 0;
+		other.m_Capacity = 0;
+	}
+
+	~TArray()
+	{
+		DestroyRange(m_pElem, m_pElem + m_Size);
+		FreeStorage(m_pElem, m_Capacity);
+	}
+
+	TArray& operator=(const TArray& other)
+	{
+		if (this != &other)
+		{
+			TArray copy{ other };
+			Swap(copy);
+		}
+		return *this;
+	}
+
+	TArray& operator=(TArray&& other) noexcept
+	{
+		if (this != &other)
+		{
+			DestroyRange(m_pElem, m_pElem + m_Size);
+			FreeStorage(m_pElem, m_Capacity);
+
+			m_Allocator = other.m_Allocator;
+			m_pElem = other.m_pElem;
+			m_Size = other.m_Size;
+			m_Capacity = other.m_Capacity;
+
+			other.m_pElem = nullptr;
+			other.m_Size = 0;
+			other.m_Capacity = 0;
+		}
+		return *this;
+	}
+
+	void Swap(TArray& other) noexcept
+	{
+		std::swap(m_Allocator, other.m_Allocator);
+		std::swap(m_pElem, other.m_pElem);
+		std::swap(m_Size, other.m_Size);
+		std::swap(m_Capacity, other.m_Capacity);
+	}
+
 	T& operator[](size_t i)
 	{
 		return m_pElem[i];
 	}
 
-	void Append(const int index, const T& data)
+	const T& operator[](size_t i) const
+	{
+		return m_pElem[i];
+	}
+
+	T* Data() { return m_pElem; }
+	const T* Data() const { return m_pElem; }
+
+	T* begin() { return m_pElem; }
+	T* end() { return m_pElem + m_Size; }
+	const T* begin() const { return m_pElem; }
+	const T* end() const { return m_pElem + m_Size; }
+
+	T& Back() { return m_pElem[m_Size - 1]; }
+	const T& Back() const { return m_pElem[m_Size - 1]; }
+
+	size_t Size() const { return m_Size; }
+	size_t Capacity() const { return m_Capacity; }
+	bool IsEmpty() const { return m_Size == 0; }
+
+	template<typename... Args>
+	T& EmplaceBack(Args&&... args)
 	{
-		if (index < m_CurrentIndex - 1)
+		if (m_Size == m_Capacity)
+		{
+			return EmplaceBackSlow(std::forward<Args>(args)...);
+		}
+
+		new (m_pElem + m_Size) T(std::forward<Args>(args)...);
+		return m_pElem[m_Size++];
+	}
+
+	void PushBack(const T& data)
+	{
+		EmplaceBack(data);
+	}
+
+	void PushBack(T&& data)
+	{
+		EmplaceBack(std::move(data));
+	}
+
+	void PopBack()
+	{
+		m_Size--;
+		DestroyRange(m_pElem + m_Size, m_pElem + m_Size + 1);
+	}
+
+	// Makes sure there is room for at least capacity elements without
+	// reallocating. Never shrinks the buffer.
+	void Reserve(size_t capacity)
+	{
+		if (capacity > m_Capacity)
+		{
+			Relocate(AllocateStorage(capacity), capacity);
+		}
+	}
+
+	// Releases the capacity that is not in use.
+	void Shrink()
+	{
+		if (m_Capacity > m_Size)
+		{
+			Relocate(AllocateStorage(m_Size), m_Size);
+		}
+	}
+
+	void Resize(size_t size)
+	{
+		if (size < m_Size)
+		{
+			DestroyRange(m_pElem + size, m_pElem + m_Size);
+			m_Size = size;
+			return;
+		}
+
+		if (size > m_Capacity)
+		{
+			const size_t newCapacity = Growth::Grow(m_Capacity, size);
+			Relocate(AllocateStorage(newCapacity), newCapacity);
+		}
+
+		for (; m_Size < size; m_Size++)
+		{
+			new (m_pElem + m_Size) T();
+		}
+	}
+
+	void Clear()
+	{
+		DestroyRange(m_pElem, m_pElem + m_Size);
+		m_Size = 0;
+	}
+
+	// Stores data at index, growing the array (and default constructing the
+	// gap) when index is past the end.
+	void Append(const size_t index, const T& data)
+	{
+		if (index < m_Size)
 		{
 			m_pElem[index] = data;
 		}
 		else
 		{
-			const size_t lastSize = m_CurrentIndex;
-			T* newData = new T[index + 1];
-			std::copy(m_pElem, m_pElem + lastSize, newData);
-			delete[] m_pElem;
-			m_pElem = newData;
-			m_pElem[index] = data;
-			m_CurrentIndex = index + 1;
+			if (index >= m_Capacity)
+			{
+				const size_t newCapacity = Growth::Grow(m_Capacity, index + 1);
+				T* newElem = AllocateStorage(newCapacity);
+				new (newElem + index) T(data);
+				Relocate(newElem, newCapacity);
+			}
+			else
+			{
+				new (m_pElem + index) T(data);
+			}
+
+			for (; m_Size < index; m_Size++)
+			{
+				new (m_pElem + m_Size) T();
+			}
+			m_Size = index + 1;
 		}
 	}
 };
-
@@ -0,0 +1,172 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Texture.h"
+
+#include <iostream>
+
+static GLenum GetInternalFormat(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_BC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        return GL_RGBA8;
+    }
+}
+
+Texture::Texture():
+	m_Texture{0},
+	m_Format{TEXTURE_RGBA8},
+	m_Width{0},
+	m_Height{0},
+	m_NumMips{0},
+	m_ResidentBytes{0}
+{
+}
+
+Texture::~Texture()
+{
+    Destroy();
+}
+
+bool Texture::IsFormatSupported(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_BC1:
+    case TEXTURE_BC3:
+        return GLEW_EXT_texture_compression_s3tc;
+    case TEXTURE_BC7:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    default:
+        return true;
+    }
+}
+
+bool Texture::Create(TextureFormat format, uint32_t width, uint32_t height, uint32_t numMips)
+{
+    Destroy();
+
+    if (!IsFormatSupported(format))
+    {
+        std::cout << "ERROR: The driver doesn't support " << GetTextureFormatName(format) << " textures." << std::endl;
+        return false;
+    }
+
+    m_Format = format;
+    m_Width = width;
+    m_Height = height;
+    m_NumMips = numMips;
+
+    const GLenum internalFormat = GetInternalFormat(format);
+    glGenTextures(1, &m_Texture);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    if (GLEW_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, (GLsizei)numMips, internalFormat, (GLsizei)width, (GLsizei)height);
+    }
+    else
+    {
+        // Same result, one level at a time. The level range keeps the
+        // texture complete without the levels nobody allocated.
+        for (uint32_t mip = 0; mip < numMips; mip++)
+        {
+            const uint32_t mipWidth = GetTextureMipDimension(width, mip), mipHeight = GetTextureMipDimension(height, mip);
+            if (IsBlockCompressed(format))
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)mip, internalFormat, (GLsizei)mipWidth, (GLsizei)mipHeight, 0,
+                    (GLsizei)GetTextureMipSize(format, mipWidth, mipHeight), nullptr);
+            }
+            else
+            {
+                glTexImage2D(GL_TEXTURE_2D, (GLint)mip, internalFormat, (GLsizei)mipWidth, (GLsizei)mipHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)numMips - 1);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, numMips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_ResidentBytes = 0;
+    for (uint32_t mip = 0; mip < numMips; mip++)
+    {
+        m_ResidentBytes += GetTextureMipSize(format, GetTextureMipDimension(width, mip), GetTextureMipDimension(height, mip));
+    }
+    return true;
+}
+
+void Texture::Destroy()
+{
+    if (m_Texture)
+    {
+        glDeleteTextures(1, &m_Texture);
+        m_Texture = 0;
+    }
+    m_Width = 0;
+    m_Height = 0;
+    m_NumMips = 0;
+    m_ResidentBytes = 0;
+}
+
+void Texture::Upload(uint32_t mip, uint32_t firstRow, uint32_t numRows, const void* pData)
+{
+    const uint32_t width = GetTextureMipDimension(m_Width, mip);
+
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    if (IsBlockCompressed(m_Format))
+    {
+        const uint32_t blockRows = (numRows + 3) / 4;
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)mip, 0, (GLint)firstRow, (GLsizei)width, (GLsizei)numRows, GetInternalFormat(m_Format),
+            (GLsizei)(GetTextureRowSize(m_Format, width) * blockRows), pData);
+    }
+    else
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, (GLint)mip, 0, (GLint)firstRow, (GLsizei)width, (GLsizei)numRows, GL_RGBA, GL_UNSIGNED_BYTE, pData);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture::Bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+}
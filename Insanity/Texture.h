@@ -0,0 +1,84 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#include "TextureFormat.h"
+
+// 2D texture with immutable storage (glTexStorage2D where the driver has
+// it) for a chain of mips. Storage is allocated once by Create; the
+// contents go in afterwards with Upload, as many rows at a time as the
+// caller wants, so big textures can be spread over several frames.
+class Texture
+{
+public:
+	Texture();
+	~Texture();
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// Whether the driver can sample format: BC1 and BC3 need
+	// EXT_texture_compression_s3tc, BC7 needs ARB_texture_compression_bptc.
+	static bool IsFormatSupported(TextureFormat format);
+
+	// Needs a current context. numMips levels starting at width x height.
+	bool Create(TextureFormat format, uint32_t width, uint32_t height, uint32_t numMips);
+	void Destroy();
+
+	// Pixel rows [firstRow, firstRow + numRows) of a level, laid out as in
+	// a texture file. For compressed formats both must be multiples of 4,
+	// except for the last rows of the level.
+	void Upload(uint32_t mip, uint32_t firstRow, uint32_t numRows, const void* pData);
+
+	void Bind(GLuint unit) const;
+
+	GLuint GetId() const { return m_Texture; }
+	TextureFormat GetFormat() const { return m_Format; }
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+	uint32_t GetNumMips() const { return m_NumMips; }
+
+	// GPU memory taken by every level.
+	size_t GetResidentBytes() const { return m_ResidentBytes; }
+
+private:
+	GLuint m_Texture;
+	TextureFormat m_Format;
+	uint32_t m_Width, m_Height;
+	uint32_t m_NumMips;
+	size_t m_ResidentBytes;
+};
@@ -0,0 +1,618 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TextureEncoder.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// Power iterations spent looking for the principal axis of a block.
+static const int AXIS_ITERATIONS = 8;
+
+// BC7 4-bit index interpolation weights, out of 64.
+static const int s_Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+typedef float BlockPixels[16][4];
+
+uint32_t GenerateMipChain(const unsigned char* pPixels, uint32_t width, uint32_t height, TArray<unsigned char>& chain, TextureMip* pMips)
+{
+    const uint32_t numMips = std::min(GetTextureMipCount(width, height), MAX_TEXTURE_MIPS);
+
+    size_t size = 0;
+    for (uint32_t mip = 0; mip < numMips; mip++)
+    {
+        pMips[mip].m_Offset = size;
+        pMips[mip].m_Size = GetTextureMipSize(TEXTURE_RGBA8, GetTextureMipDimension(width, mip), GetTextureMipDimension(height, mip));
+        size += (size_t)pMips[mip].m_Size;
+    }
+
+    chain.Resize(size);
+    memcpy(chain.Data(), pPixels, (size_t)pMips[0].m_Size);
+
+    for (uint32_t mip = 1; mip < numMips; mip++)
+    {
+        const uint32_t srcWidth = GetTextureMipDimension(width, mip - 1);
+        const uint32_t srcHeight = GetTextureMipDimension(height, mip - 1);
+        const uint32_t dstWidth = GetTextureMipDimension(width, mip);
+        const uint32_t dstHeight = GetTextureMipDimension(height, mip);
+        const unsigned char* pSrc = &chain[(size_t)pMips[mip - 1].m_Offset];
+        unsigned char* pDst = &chain[(size_t)pMips[mip].m_Offset];
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            // A side that is already 1 pixel wide is sampled twice.
+            const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    const uint32_t sum = pSrc[((size_t)y0 * srcWidth + x0) * 4 + c] + pSrc[((size_t)y0 * srcWidth + x1) * 4 + c] +
+                        pSrc[((size_t)y1 * srcWidth + x0) * 4 + c] + pSrc[((size_t)y1 * srcWidth + x1) * 4 + c];
+                    pDst[((size_t)y * dstWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return numMips;
+}
+
+static void LoadBlock(const unsigned char* pPixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockPixels& block)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const uint32_t x = std::min(blockX * 4 + i % 4, width - 1);
+        const uint32_t y = std::min(blockY * 4 + i / 4, height - 1);
+        const unsigned char* pPixel = &pPixels[((size_t)y * width + x) * 4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            block[i][c] = pPixel[c];
+        }
+    }
+}
+
+// Ends of the line through the block's pixels along their principal axis,
+// over the first numChannels channels.
+static void FindEndpoints(const BlockPixels& block, uint32_t numChannels, float* pLow, float* pHigh)
+{
+    float mean[4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t c = 0; c < numChannels; c++)
+        {
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t a = 0; a < numChannels; a++)
+        {
+            for (uint32_t b = 0; b < numChannels; b++)
+            {
+                covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < AXIS_ITERATIONS; iteration++)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < numChannels; a++)
+        {
+            for (uint32_t b = 0; b < numChannels; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+
+        if (length < 1e-12f)
+        {
+            // Flat block: every pixel is the mean.
+            for (uint32_t c = 0; c < numChannels; c++)
+            {
+                pLow[c] = pHigh[c] = mean[c];
+            }
+            return;
+        }
+
+        length = sqrtf(length);
+        for (uint32_t c = 0; c < numChannels; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minT = 0.0f, maxT = 0.0f;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (uint32_t c = 0; c < numChannels; c++)
+        {
+            t += (block[i][c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (uint32_t c = 0; c < numChannels; c++)
+    {
+        pLow[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+        pHigh[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+    }
+}
+
+// Palette entry nearest to the pixel, over the first numChannels channels.
+static uint32_t FindNearest(const float* pPixel, const int (*pPalette)[4], uint32_t paletteSize, uint32_t numChannels)
+{
+    uint32_t best = 0;
+    float bestError = 1e30f;
+    for (uint32_t i = 0; i < paletteSize; i++)
+    {
+        float error = 0.0f;
+        for (uint32_t c = 0; c < numChannels; c++)
+        {
+            const float difference = pPixel[c] - (float)pPalette[i][c];
+            error += difference * difference;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static uint16_t PackRgb565(const float* pColor)
+{
+    const uint32_t r = (uint32_t)(pColor[0] * 31.0f / 255.0f + 0.5f);
+    const uint32_t g = (uint32_t)(pColor[1] * 63.0f / 255.0f + 0.5f);
+    const uint32_t b = (uint32_t)(pColor[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRgb565(uint16_t color, int* pColor)
+{
+    const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    pColor[0] = (r << 3) | (r >> 2);
+    pColor[1] = (g << 2) | (g >> 4);
+    pColor[2] = (b << 3) | (b >> 2);
+    pColor[3] = 255;
+}
+
+// 8 bytes: two RGB565 endpoints, then 2-bit indices. The first endpoint
+// is always the greater, which selects the 4-colour mode that BC3 assumes.
+static void EncodeColorBlock(const BlockPixels& block, unsigned char* pDst)
+{
+    float low[4], high[4];
+    FindEndpoints(block, 3, low, high);
+
+    uint16_t color0 = PackRgb565(high), color1 = PackRgb565(low);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][4];
+        UnpackRgb565(color0, palette[0]);
+        UnpackRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            indices |= FindNearest(block[i], palette, 4, 3) << (i * 2);
+        }
+    }
+
+    pDst[0] = (unsigned char)(color0 & 0xFF);
+    pDst[1] = (unsigned char)(color0 >> 8);
+    pDst[2] = (unsigned char)(color1 & 0xFF);
+    pDst[3] = (unsigned char)(color1 >> 8);
+    for (int i = 0; i < 4; i++)
+    {
+        pDst[4 + i] = (unsigned char)(indices >> (i * 8));
+    }
+}
+
+// 8 bytes: two alpha endpoints, greater first for the 8-value mode, then
+// 3-bit indices.
+static void EncodeAlphaBlock(const BlockPixels& block, unsigned char* pDst)
+{
+    float minAlpha = 255.0f, maxAlpha = 0.0f;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        minAlpha = std::min(minAlpha, block[i][3]);
+        maxAlpha = std::max(maxAlpha, block[i][3]);
+    }
+
+    const int alpha0 = (int)(maxAlpha + 0.5f), alpha1 = (int)(minAlpha + 0.5f);
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        int palette[8][4] = {};
+        palette[0][0] = alpha0;
+        palette[1][0] = alpha1;
+        for (int i = 2; i < 8; i++)
+        {
+            palette[i][0] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            indices |= (uint64_t)FindNearest(&block[i][3], palette, 8, 1) << (i * 3);
+        }
+    }
+
+    pDst[0] = (unsigned char)alpha0;
+    pDst[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 6; i++)
+    {
+        pDst[2 + i] = (unsigned char)(indices >> (i * 8));
+    }
+}
+
+static void WriteBits(unsigned char* pDst, uint32_t& position, uint32_t value, uint32_t bits)
+{
+    for (uint32_t i = 0; i < bits; i++, position++)
+    {
+        pDst[position / 8] |= (unsigned char)(((value >> i) & 1) << (position % 8));
+    }
+}
+
+// 16 bytes, mode 6: 7-bit RGBA endpoints with a shared low bit each, and
+// 4-bit indices, the first one's top bit implied 0.
+static void EncodeBc7Block(const BlockPixels& block, unsigned char* pDst)
+{
+    float ends[2][4];
+    FindEndpoints(block, 4, ends[0], ends[1]);
+
+    // The low bit that brings each endpoint closest to where it should be.
+    int quantized[2][4], pBits[2];
+    for (int end = 0; end < 2; end++)
+    {
+        float bestError = 1e30f;
+        for (int pBit = 0; pBit < 2; pBit++)
+        {
+            int values[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                values[c] = std::min(std::max((int)((ends[end][c] - pBit) / 2.0f + 0.5f), 0), 127);
+                const float difference = (float)(values[c] * 2 + pBit) - ends[end][c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBits[end] = pBit;
+                memcpy(quantized[end], values, sizeof(values));
+            }
+        }
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            const int end0 = (quantized[0][c] << 1) | pBits[0];
+            const int end1 = (quantized[1][c] << 1) | pBits[1];
+            palette[i][c] = ((64 - s_Bc7Weights[i]) * end0 + s_Bc7Weights[i] * end1 + 32) >> 6;
+        }
+    }
+
+    uint32_t indices[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        indices[i] = FindNearest(block[i], palette, 16, 4);
+    }
+
+    // The first index has no top bit: swap the ends if it needs one.
+    if (indices[0] & 8)
+    {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint32_t& index : indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    memset(pDst, 0, 16);
+    uint32_t position = 0;
+    WriteBits(pDst, position, 1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        WriteBits(pDst, position, quantized[0][c], 7);
+        WriteBits(pDst, position, quantized[1][c], 7);
+    }
+    WriteBits(pDst, position, pBits[0], 1);
+    WriteBits(pDst, position, pBits[1], 1);
+    WriteBits(pDst, position, indices[0], 3);
+    for (uint32_t i = 1; i < 16; i++)
+    {
+        WriteBits(pDst, position, indices[i], 4);
+    }
+}
+
+void CompressTexture(TextureFormat format, const unsigned char* pPixels, uint32_t width, uint32_t height, unsigned char* pDst)
+{
+    if (!IsBlockCompressed(format))
+    {
+        memcpy(pDst, pPixels, GetTextureMipSize(format, width, height));
+        return;
+    }
+
+    const uint32_t blockSize = GetTextureBlockSize(format);
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            BlockPixels block;
+            LoadBlock(pPixels, width, height, blockX, blockY, block);
+
+            unsigned char* pBlock = pDst + ((size_t)blockY * blocksX + blockX) * blockSize;
+            switch (format)
+            {
+            case TEXTURE_BC1:
+                EncodeColorBlock(block, pBlock);
+                break;
+            case TEXTURE_BC3:
+                EncodeAlphaBlock(block, pBlock);
+                EncodeColorBlock(block, pBlock + 8);
+                break;
+            default:
+                EncodeBc7Block(block, pBlock);
+                break;
+            }
+        }
+    }
+}
+
+// Decodes the colour of a BC1 block, or the colour half of a BC3 one,
+// which is always in 4-colour mode.
+static void DecodeColorBlock(const unsigned char* pSrc, bool bc3, int (*pPixels)[4])
+{
+    const uint16_t color0 = (uint16_t)(pSrc[0] | (pSrc[1] << 8));
+    const uint16_t color1 = (uint16_t)(pSrc[2] | (pSrc[3] << 8));
+
+    int palette[4][4];
+    UnpackRgb565(color0, palette[0]);
+    UnpackRgb565(color1, palette[1]);
+    if (color0 > color1 || bc3)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    }
+    else
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+
+    const uint32_t indices = pSrc[4] | (pSrc[5] << 8) | (pSrc[6] << 16) | ((uint32_t)pSrc[7] << 24);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        memcpy(pPixels[i], palette[(indices >> (i * 2)) & 3], sizeof(palette[0]));
+    }
+}
+
+static void DecodeAlphaBlock(const unsigned char* pSrc, int (*pPixels)[4])
+{
+    const int alpha0 = pSrc[0], alpha1 = pSrc[1];
+    int palette[8] = { alpha0, alpha1 };
+    for (int i = 2; i < 8; i++)
+    {
+        if (alpha0 > alpha1)
+        {
+            palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+        }
+        else
+        {
+            // 6 interpolated values, then 0 and 255.
+            palette[i] = i < 6 ? ((6 - i) * alpha0 + (i - 1) * alpha1) / 5 : (i == 6 ? 0 : 255);
+        }
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= (uint64_t)pSrc[2 + i] << (i * 8);
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        pPixels[i][3] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+static uint32_t ReadBits(const unsigned char* pSrc, uint32_t& position, uint32_t bits)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bits; i++, position++)
+    {
+        value |= (uint32_t)((pSrc[position / 8] >> (position % 8)) & 1) << i;
+    }
+    return value;
+}
+
+static bool DecodeBc7Block(const unsigned char* pSrc, int (*pPixels)[4])
+{
+    uint32_t position = 0;
+    if (ReadBits(pSrc, position, 7) != 1 << 6)
+    {
+        memset(pPixels, 0, sizeof(int) * 16 * 4);
+        return false;
+    }
+
+    int ends[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        ends[0][c] = (int)ReadBits(pSrc, position, 7) << 1;
+        ends[1][c] = (int)ReadBits(pSrc, position, 7) << 1;
+    }
+    const int pBit0 = (int)ReadBits(pSrc, position, 1), pBit1 = (int)ReadBits(pSrc, position, 1);
+    for (int c = 0; c < 4; c++)
+    {
+        ends[0][c] |= pBit0;
+        ends[1][c] |= pBit1;
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const uint32_t index = ReadBits(pSrc, position, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+        {
+            pPixels[i][c] = ((64 - s_Bc7Weights[index]) * ends[0][c] + s_Bc7Weights[index] * ends[1][c] + 32) >> 6;
+        }
+    }
+    return true;
+}
+
+bool DecompressTexture(TextureFormat format, const unsigned char* pSrc, uint32_t width, uint32_t height, unsigned char* pPixels)
+{
+    if (!IsBlockCompressed(format))
+    {
+        memcpy(pPixels, pSrc, GetTextureMipSize(format, width, height));
+        return true;
+    }
+
+    bool success = true;
+    const uint32_t blockSize = GetTextureBlockSize(format);
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            const unsigned char* pBlock = pSrc + ((size_t)blockY * blocksX + blockX) * blockSize;
+            int block[16][4];
+            switch (format)
+            {
+            case TEXTURE_BC1:
+                DecodeColorBlock(pBlock, false, block);
+                break;
+            case TEXTURE_BC3:
+                DecodeColorBlock(pBlock + 8, true, block);
+                DecodeAlphaBlock(pBlock, block);
+                break;
+            default:
+                success &= DecodeBc7Block(pBlock, block);
+                break;
+            }
+
+            // Only the pixels inside the image.
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const uint32_t x = blockX * 4 + i % 4, y = blockY * 4 + i / 4;
+                if (x < width && y < height)
+                {
+                    unsigned char* pPixel = &pPixels[((size_t)y * width + x) * 4];
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        pPixel[c] = (unsigned char)block[i][c];
+                    }
+                }
+            }
+        }
+    }
+    return success;
+}
+
+bool HasTranslucentPixels(const unsigned char* pPixels, size_t numPixels)
+{
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        if (pPixels[i * 4 + 3] != 255)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EncodeTextureFile(const unsigned char* pPixels, uint32_t width, uint32_t height, TextureFormat format, TArray<unsigned char>& file)
+{
+    TArray<unsigned char> chain;
+    TextureMip sourceMips[MAX_TEXTURE_MIPS];
+    const uint32_t numMips = GenerateMipChain(pPixels, width, height, chain, sourceMips);
+
+    TextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_Magic = TEXTURE_FILE_MAGIC;
+    header.m_Version = TEXTURE_FILE_VERSION;
+    header.m_Format = format;
+    header.m_Width = width;
+    header.m_Height = height;
+    header.m_NumMips = numMips;
+
+    uint64_t offset = sizeof(header);
+    for (uint32_t mip = 0; mip < numMips; mip++)
+    {
+        header.m_Mips[mip].m_Offset = AlignTextureFileOffset(offset);
+        header.m_Mips[mip].m_Size = GetTextureMipSize(format, GetTextureMipDimension(width, mip), GetTextureMipDimension(height, mip));
+        offset = header.m_Mips[mip].m_Offset + header.m_Mips[mip].m_Size;
+    }
+
+    file.Clear();
+    file.Resize((size_t)offset);
+    memcpy(file.Data(), &header, sizeof(header));
+    for (uint32_t mip = 0; mip < numMips; mip++)
+    {
+        CompressTexture(format, &chain[(size_t)sourceMips[mip].m_Offset], GetTextureMipDimension(width, mip), GetTextureMipDimension(height, mip),
+            &file[(size_t)header.m_Mips[mip].m_Offset]);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TArray.h"
+#include "TextureFormat.h"
+
+// Offline texture processing used by InsanityCooker, and by the engine for
+// images it loads without cooking. Input is always 8-bit RGBA, rows tightly
+// packed, top row first.
+
+// Builds the mip chain of an image down to 1x1 (or MAX_TEXTURE_MIPS
+// levels), each level a 2x2 box filter of the previous one. The levels go
+// one after the other in chain, with their ranges in pMips. Returns the
+// number of levels.
+uint32_t GenerateMipChain(const unsigned char* pPixels, uint32_t width, uint32_t height, TArray<unsigned char>& chain, TextureMip* pMips);
+
+// Compresses one level into GetTextureMipSize(format, width, height) bytes
+// at pDst. Blocks that run past the edge repeat the last row and column.
+// BC1 ignores alpha. BC7 only uses mode 6 (one subset, RGBA endpoints):
+// fast, and good enough for most textures, though edges between two
+// colours look better with the partitioned modes.
+void CompressTexture(TextureFormat format, const unsigned char* pPixels, uint32_t width, uint32_t height, unsigned char* pDst);
+
+// The reverse of CompressTexture, to RGBA pixels, for checking what the
+// encoder wrote. BC7 blocks in other modes than 6 come out black, and
+// make it return false.
+bool DecompressTexture(TextureFormat format, const unsigned char* pSrc, uint32_t width, uint32_t height, unsigned char* pPixels);
+
+// Whether any pixel has alpha under 255, to pick BC1 or BC3.
+bool HasTranslucentPixels(const unsigned char* pPixels, size_t numPixels);
+
+// A whole .itex file in memory: the mip chain of the image, compressed to
+// format.
+void EncodeTextureFile(const unsigned char* pPixels, uint32_t width, uint32_t height, TextureFormat format, TArray<unsigned char>& file);
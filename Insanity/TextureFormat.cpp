@@ -0,0 +1,94 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TextureFormat.h"
+
+#include <iostream>
+
+const TextureFileHeader* ValidateTextureFile(const void* pData, size_t size)
+{
+    if (!pData || size < sizeof(TextureFileHeader))
+    {
+        std::cout << "ERROR: Texture file too small." << std::endl;
+        return nullptr;
+    }
+
+    const TextureFileHeader* pHeader = static_cast<const TextureFileHeader*>(pData);
+    if (pHeader->m_Magic != TEXTURE_FILE_MAGIC)
+    {
+        std::cout << "ERROR: Not a texture file." << std::endl;
+        return nullptr;
+    }
+
+    if (pHeader->m_Version != TEXTURE_FILE_VERSION)
+    {
+        std::cout << "ERROR: Texture file version " << pHeader->m_Version << ", expected " << TEXTURE_FILE_VERSION << ". Cook it again." << std::endl;
+        return nullptr;
+    }
+
+    if (pHeader->m_Format >= TEXTURE_FORMAT_COUNT || pHeader->m_Width == 0 || pHeader->m_Height == 0 ||
+        pHeader->m_NumMips == 0 || pHeader->m_NumMips > MAX_TEXTURE_MIPS || pHeader->m_NumMips > GetTextureMipCount(pHeader->m_Width, pHeader->m_Height))
+    {
+        std::cout << "ERROR: Corrupt texture file header." << std::endl;
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < pHeader->m_NumMips; i++)
+    {
+        const TextureMip& mip = pHeader->m_Mips[i];
+        const size_t expected = GetTextureMipSize(pHeader->m_Format, GetTextureMipDimension(pHeader->m_Width, i), GetTextureMipDimension(pHeader->m_Height, i));
+        if (mip.m_Size != expected || mip.m_Offset % TEXTURE_FILE_ALIGNMENT != 0 || mip.m_Offset > size || mip.m_Size > size - mip.m_Offset)
+        {
+            std::cout << "ERROR: Corrupt texture file mip " << i << "." << std::endl;
+            return nullptr;
+        }
+    }
+
+    return pHeader;
+}
+
+const char* GetTextureFormatName(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_RGBA8:
+        return "RGBA8";
+    case TEXTURE_BC1:
+        return "BC1";
+    case TEXTURE_BC3:
+        return "BC3";
+    case TEXTURE_BC7:
+        return "BC7";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooked texture files written by InsanityCooker (.itex). Every mip level
+// is stored ready for the GL, block compressed or not, so a loaded file is
+// mapped and its levels handed to the GL directly:
+//
+//   TextureFileHeader
+//   mip 0, mip 1, ... down to 1x1
+//
+// Every level starts on a TEXTURE_FILE_ALIGNMENT boundary. Little endian.
+
+static const uint32_t TEXTURE_FILE_MAGIC = 0x58455449; // "ITEX"
+static const uint32_t TEXTURE_FILE_VERSION = 1;
+static const uint32_t TEXTURE_FILE_ALIGNMENT = 16;
+
+// Enough for a 32768x32768 texture.
+static const uint32_t MAX_TEXTURE_MIPS = 16;
+
+enum TextureFormat : uint32_t
+{
+	TEXTURE_RGBA8,
+	TEXTURE_BC1,	// RGB, 8 bytes per 4x4 block.
+	TEXTURE_BC3,	// RGBA, 16 bytes per 4x4 block.
+	TEXTURE_BC7,	// RGBA, 16 bytes per 4x4 block, better quality than BC3.
+	TEXTURE_FORMAT_COUNT
+};
+
+struct TextureMip
+{
+	uint64_t m_Offset;
+	uint64_t m_Size;
+};
+
+struct TextureFileHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	TextureFormat m_Format;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_NumMips;
+	uint32_t m_Padding[2];
+	TextureMip m_Mips[MAX_TEXTURE_MIPS];
+};
+
+static_assert(sizeof(TextureFileHeader) % TEXTURE_FILE_ALIGNMENT == 0, "Mips after the header must stay aligned");
+
+// Checks that pData is a texture file this build can read and that every
+// mip lies inside the size bytes. Returns the header, or nullptr.
+const TextureFileHeader* ValidateTextureFile(const void* pData, size_t size);
+
+inline bool IsBlockCompressed(TextureFormat format)
+{
+	return format != TEXTURE_RGBA8;
+}
+
+// Bytes per 4x4 block, or per pixel for uncompressed formats.
+inline uint32_t GetTextureBlockSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1:
+		return 8;
+	case TEXTURE_BC3:
+	case TEXTURE_BC7:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+// Pixel rows stored together: 4 for block compressed formats.
+inline uint32_t GetTextureRowHeight(TextureFormat format)
+{
+	return IsBlockCompressed(format) ? 4 : 1;
+}
+
+// Bytes of one row of pixels, or of blocks.
+inline size_t GetTextureRowSize(TextureFormat format, uint32_t width)
+{
+	const uint32_t blocks = IsBlockCompressed(format) ? (width + 3) / 4 : width;
+	return (size_t)blocks * GetTextureBlockSize(format);
+}
+
+inline size_t GetTextureMipSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+	const uint32_t rowHeight = GetTextureRowHeight(format);
+	return GetTextureRowSize(format, width) * ((height + rowHeight - 1) / rowHeight);
+}
+
+inline uint32_t GetTextureMipDimension(uint32_t size, uint32_t mip)
+{
+	size >>= mip;
+	return size ? size : 1;
+}
+
+// Levels of a full chain down to 1x1.
+inline uint32_t GetTextureMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t size = width > height ? width : height;
+	uint32_t count = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		count++;
+	}
+	return count;
+}
+
+inline uint64_t AlignTextureFileOffset(uint64_t offset)
+{
+	return (offset + TEXTURE_FILE_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_FILE_ALIGNMENT - 1);
+}
+
+const char* GetTextureFormatName(TextureFormat format);
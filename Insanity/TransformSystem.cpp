@@ -0,0 +1,342 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TransformSystem.h"
+
+#include <string.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__AVX2__)
+#define INSANITY_TRANSFORM_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INSANITY_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// One float stream per transform field, indexed by object. Both the
+// TransformSystem arrays and a block of chunk transforms are read through
+// it, so they share the kernels below.
+struct TransformStreams
+{
+    const float* m_pPositionX;
+    const float* m_pPositionY;
+    const float* m_pPositionZ;
+    const float* m_pRotationX;
+    const float* m_pRotationY;
+    const float* m_pRotationZ;
+    const float* m_pRotationW;
+    const float* m_pScaleX;
+    const float* m_pScaleY;
+    const float* m_pScaleZ;
+};
+
+static void ComputeScalar(const TransformStreams& streams, const float* pViewProjection, uint8_t* pOut, size_t stride, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++, pOut += stride)
+    {
+        const float x = streams.m_pRotationX[i], y = streams.m_pRotationY[i], z = streams.m_pRotationZ[i], w = streams.m_pRotationW[i];
+        const float sx = streams.m_pScaleX[i], sy = streams.m_pScaleY[i], sz = streams.m_pScaleZ[i];
+
+        // T * R * S, column-major.
+        const float model[16] = {
+            (1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f,
+            2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f,
+            2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f,
+            streams.m_pPositionX[i], streams.m_pPositionY[i], streams.m_pPositionZ[i], 1.0f
+        };
+
+        if (pViewProjection)
+        {
+            float mvp[16];
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    mvp[column * 4 + row] =
+                        pViewProjection[0 * 4 + row] * model[column * 4 + 0] +
+                        pViewProjection[1 * 4 + row] * model[column * 4 + 1] +
+                        pViewProjection[2 * 4 + row] * model[column * 4 + 2] +
+                        pViewProjection[3 * 4 + row] * model[column * 4 + 3];
+                }
+            }
+            memcpy(pOut, mvp, sizeof(mvp));
+        }
+        else
+        {
+            memcpy(pOut, model, sizeof(model));
+        }
+    }
+}
+
+#if defined(INSANITY_TRANSFORM_AVX2) || defined(INSANITY_TRANSFORM_SSE)
+
+#if defined(INSANITY_TRANSFORM_AVX2)
+typedef __m256 FloatN;
+static const uint32_t LANES = 8;
+#define LoadN(p) _mm256_loadu_ps(p)
+#define SetN(v) _mm256_set1_ps(v)
+#define AddN(a, b) _mm256_add_ps(a, b)
+#define SubN(a, b) _mm256_sub_ps(a, b)
+#define MulN(a, b) _mm256_mul_ps(a, b)
+#else
+typedef __m128 FloatN;
+static const uint32_t LANES = 4;
+#define LoadN(p) _mm_loadu_ps(p)
+#define SetN(v) _mm_set1_ps(v)
+#define AddN(a, b) _mm_add_ps(a, b)
+#define SubN(a, b) _mm_sub_ps(a, b)
+#define MulN(a, b) _mm_mul_ps(a, b)
+#endif
+
+// Each register holds one matrix element for LANES objects. Transpose them
+// back to one column per object and store.
+static void StoreMatrices(const FloatN element[16], uint8_t* pOut, size_t stride)
+{
+    for (uint32_t group = 0; group < LANES / 4; group++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+#if defined(INSANITY_TRANSFORM_AVX2)
+            __m128 r0 = group ? _mm256_extractf128_ps(element[column * 4 + 0], 1) : _mm256_castps256_ps128(element[column * 4 + 0]);
+            __m128 r1 = group ? _mm256_extractf128_ps(element[column * 4 + 1], 1) : _mm256_castps256_ps128(element[column * 4 + 1]);
+            __m128 r2 = group ? _mm256_extractf128_ps(element[column * 4 + 2], 1) : _mm256_castps256_ps128(element[column * 4 + 2]);
+            __m128 r3 = group ? _mm256_extractf128_ps(element[column * 4 + 3], 1) : _mm256_castps256_ps128(element[column * 4 + 3]);
+#else
+            __m128 r0 = element[column * 4 + 0];
+            __m128 r1 = element[column * 4 + 1];
+            __m128 r2 = element[column * 4 + 2];
+            __m128 r3 = element[column * 4 + 3];
+#endif
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            uint8_t* pObject = pOut + group * 4 * stride;
+            _mm_storeu_ps(reinterpret_cast<float*>(pObject + 0 * stride) + column * 4, r0);
+            _mm_storeu_ps(reinterpret_cast<float*>(pObject + 1 * stride) + column * 4, r1);
+            _mm_storeu_ps(reinterpret_cast<float*>(pObject + 2 * stride) + column * 4, r2);
+            _mm_storeu_ps(reinterpret_cast<float*>(pObject + 3 * stride) + column * 4, r3);
+        }
+    }
+}
+
+static void Compute(const TransformStreams& streams, const float* pViewProjection, uint8_t* pOut, size_t stride, uint32_t begin, uint32_t end)
+{
+    const FloatN one = SetN(1.0f);
+    const FloatN two = SetN(2.0f);
+    const FloatN zero = SetN(0.0f);
+
+    uint32_t i = begin;
+    for (; i + LANES <= end; i += LANES, pOut += LANES * stride)
+    {
+        const FloatN x = LoadN(&streams.m_pRotationX[i]);
+        const FloatN y = LoadN(&streams.m_pRotationY[i]);
+        const FloatN z = LoadN(&streams.m_pRotationZ[i]);
+        const FloatN w = LoadN(&streams.m_pRotationW[i]);
+        const FloatN sx = LoadN(&streams.m_pScaleX[i]);
+        const FloatN sy = LoadN(&streams.m_pScaleY[i]);
+        const FloatN sz = LoadN(&streams.m_pScaleZ[i]);
+
+        const FloatN xx = MulN(x, x), yy = MulN(y, y), zz = MulN(z, z);
+        const FloatN xy = MulN(x, y), xz = MulN(x, z), yz = MulN(y, z);
+        const FloatN wx = MulN(w, x), wy = MulN(w, y), wz = MulN(w, z);
+
+        const FloatN model[16] = {
+            MulN(SubN(one, MulN(two, AddN(yy, zz))), sx), MulN(MulN(two, AddN(xy, wz)), sx), MulN(MulN(two, SubN(xz, wy)), sx), zero,
+            MulN(MulN(two, SubN(xy, wz)), sy), MulN(SubN(one, MulN(two, AddN(xx, zz))), sy), MulN(MulN(two, AddN(yz, wx)), sy), zero,
+            MulN(MulN(two, AddN(xz, wy)), sz), MulN(MulN(two, SubN(yz, wx)), sz), MulN(SubN(one, MulN(two, AddN(xx, yy))), sz), zero,
+            LoadN(&streams.m_pPositionX[i]), LoadN(&streams.m_pPositionY[i]), LoadN(&streams.m_pPositionZ[i]), one
+        };
+
+        if (pViewProjection)
+        {
+            FloatN mvp[16];
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    // Row 3 of the model matrix is (0, 0, 0, 1) except in
+                    // the last column, the zero terms are skipped.
+                    FloatN sum = MulN(SetN(pViewProjection[0 * 4 + row]), model[column * 4 + 0]);
+                    sum = AddN(sum, MulN(SetN(pViewProjection[1 * 4 + row]), model[column * 4 + 1]));
+                    sum = AddN(sum, MulN(SetN(pViewProjection[2 * 4 + row]), model[column * 4 + 2]));
+                    if (column == 3)
+                    {
+                        sum = AddN(sum, SetN(pViewProjection[3 * 4 + row]));
+                    }
+                    mvp[column * 4 + row] = sum;
+                }
+            }
+            StoreMatrices(mvp, pOut, stride);
+        }
+        else
+        {
+            StoreMatrices(model, pOut, stride);
+        }
+    }
+
+    // Leftovers that don't fill a register.
+    ComputeScalar(streams, pViewProjection, pOut, stride, i, end);
+}
+
+#else
+
+static const uint32_t LANES = 4;
+
+static void Compute(const TransformStreams& streams, const float* pViewProjection, uint8_t* pOut, size_t stride, uint32_t begin, uint32_t end)
+{
+    ComputeScalar(streams, pViewProjection, pOut, stride, begin, end);
+}
+
+#endif
+
+uint32_t TransformSystem::Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    m_PositionX.PushBack(position.x);
+    m_PositionY.PushBack(position.y);
+    m_PositionZ.PushBack(position.z);
+    m_RotationX.PushBack(rotation.x);
+    m_RotationY.PushBack(rotation.y);
+    m_RotationZ.PushBack(rotation.z);
+    m_RotationW.PushBack(rotation.w);
+    m_ScaleX.PushBack(scale.x);
+    m_ScaleY.PushBack(scale.y);
+    m_ScaleZ.PushBack(scale.z);
+
+    return Size() - 1;
+}
+
+void TransformSystem::Clear()
+{
+    m_PositionX.Clear();
+    m_PositionY.Clear();
+    m_PositionZ.Clear();
+    m_RotationX.Clear();
+    m_RotationY.Clear();
+    m_RotationZ.Clear();
+    m_RotationW.Clear();
+    m_ScaleX.Clear();
+    m_ScaleY.Clear();
+    m_ScaleZ.Clear();
+}
+
+void TransformSystem::SetPosition(uint32_t index, const glm::vec3& position)
+{
+    m_PositionX[index] = position.x;
+    m_PositionY[index] = position.y;
+    m_PositionZ[index] = position.z;
+}
+
+void TransformSystem::SetRotation(uint32_t index, const glm::quat& rotation)
+{
+    m_RotationX[index] = rotation.x;
+    m_RotationY[index] = rotation.y;
+    m_RotationZ[index] = rotation.z;
+    m_RotationW[index] = rotation.w;
+}
+
+void TransformSystem::SetScale(uint32_t index, const glm::vec3& scale)
+{
+    m_ScaleX[index] = scale.x;
+    m_ScaleY[index] = scale.y;
+    m_ScaleZ[index] = scale.z;
+}
+
+glm::vec3 TransformSystem::GetPosition(uint32_t index) const
+{
+    return glm::vec3(m_PositionX[index], m_PositionY[index], m_PositionZ[index]);
+}
+
+void TransformSystem::ComputeModelMatrices(void* pOut, size_t stride, uint32_t begin, uint32_t end) const
+{
+    Compute(nullptr, static_cast<uint8_t*>(pOut), stride, begin, end);
+}
+
+void TransformSystem::ComputeMVPMatrices(const glm::mat4& viewProjection, void* pOut, size_t stride, uint32_t begin, uint32_t end) const
+{
+    Compute(glm::value_ptr(viewProjection), static_cast<uint8_t*>(pOut), stride, begin, end);
+}
+
+void TransformSystem::Compute(const float* pViewProjection, uint8_t* pOut, size_t stride, uint32_t begin, uint32_t end) const
+{
+    const TransformStreams streams{ m_PositionX.Data(), m_PositionY.Data(), m_PositionZ.Data(),
+        m_RotationX.Data(), m_RotationY.Data(), m_RotationZ.Data(), m_RotationW.Data(),
+        m_ScaleX.Data(), m_ScaleY.Data(), m_ScaleZ.Data() };
+    ::Compute(streams, pViewProjection, pOut, stride, begin, end);
+}
+
+// A register's worth of chunk transforms as structure of arrays.
+struct TransformBlock
+{
+    float m_PositionX[LANES], m_PositionY[LANES], m_PositionZ[LANES];
+    float m_RotationX[LANES], m_RotationY[LANES], m_RotationZ[LANES], m_RotationW[LANES];
+    float m_ScaleX[LANES], m_ScaleY[LANES], m_ScaleZ[LANES];
+};
+
+void ComputeModelMatrices(const Transform* pTransforms, uint32_t count, void* pOut, size_t stride)
+{
+    TransformBlock block;
+    const TransformStreams streams{ block.m_PositionX, block.m_PositionY, block.m_PositionZ,
+        block.m_RotationX, block.m_RotationY, block.m_RotationZ, block.m_RotationW,
+        block.m_ScaleX, block.m_ScaleY, block.m_ScaleZ };
+
+    uint8_t* pBytes = static_cast<uint8_t*>(pOut);
+    for (uint32_t i = 0; i < count; i += LANES, pBytes += LANES * stride)
+    {
+        const uint32_t numLanes = count - i < LANES ? count - i : LANES;
+        for (uint32_t lane = 0; lane < numLanes; lane++)
+        {
+            const Transform& transform = pTransforms[i + lane];
+            block.m_PositionX[lane] = transform.m_Position.x;
+            block.m_PositionY[lane] = transform.m_Position.y;
+            block.m_PositionZ[lane] = transform.m_Position.z;
+            block.m_RotationX[lane] = transform.m_Rotation.x;
+            block.m_RotationY[lane] = transform.m_Rotation.y;
+            block.m_RotationZ[lane] = transform.m_Rotation.z;
+            block.m_RotationW[lane] = transform.m_Rotation.w;
+            block.m_ScaleX[lane] = transform.m_Scale.x;
+            block.m_ScaleY[lane] = transform.m_Scale.y;
+            block.m_ScaleZ[lane] = transform.m_Scale.z;
+        }
+        Compute(streams, nullptr, pBytes, stride, 0, numLanes);
+    }
+}
+
+glm::mat4 MakeModelMatrix(const Transform& transform)
+{
+    const TransformStreams streams{ &transform.m_Position.x, &transform.m_Position.y, &transform.m_Position.z,
+        &transform.m_Rotation.x, &transform.m_Rotation.y, &transform.m_Rotation.z, &transform.m_Rotation.w,
+        &transform.m_Scale.x, &transform.m_Scale.y, &transform.m_Scale.z };
+
+    glm::mat4 model;
+    ComputeScalar(streams, nullptr, reinterpret_cast<uint8_t*>(&model), sizeof(model), 0, 1);
+    return model;
+}
@@ -0,0 +1,83 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "SceneComponents.h"
+#include "TArray.h"
+
+// Object transforms stored as structure of arrays so that matrices can be
+// built several objects at a time with SSE/AVX2. Output matrices are written
+// column-major (same layout as glm::mat4) with a configurable stride, so they
+// can go straight into a mapped instance/uniform buffer or into an array of
+// structs that holds a matrix.
+class TransformSystem
+{
+public:
+	uint32_t Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	void Clear();
+
+	void SetPosition(uint32_t index, const glm::vec3& position);
+	void SetRotation(uint32_t index, const glm::quat& rotation);
+	void SetScale(uint32_t index, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(uint32_t index) const;
+
+	uint32_t Size() const { return (uint32_t)m_PositionX.Size(); }
+
+	// Model matrices of the transforms in [begin, end). Matrix i is written
+	// at pOut + (i - begin) * stride bytes.
+	void ComputeModelMatrices(void* pOut, size_t stride, uint32_t begin, uint32_t end) const;
+
+	// Same, premultiplied by viewProjection.
+	void ComputeMVPMatrices(const glm::mat4& viewProjection, void* pOut, size_t stride, uint32_t begin, uint32_t end) const;
+
+private:
+	TArray<float> m_PositionX, m_PositionY, m_PositionZ;
+	TArray<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+	TArray<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+
+	void Compute(const float* pViewProjection, uint8_t* pOut, size_t stride, uint32_t begin, uint32_t end) const;
+};
+
+// Model matrices of Transform components as the ECS chunks hold them, with
+// the same kernel: each block of transforms is transposed to structure of
+// arrays on the stack first. Matrix i is written at pOut + i * stride bytes.
+void ComputeModelMatrices(const Transform* pTransforms, uint32_t count, void* pOut, size_t stride);
+
+// Same for a single transform, without SIMD.
+glm::mat4 MakeModelMatrix(const Transform& transform);
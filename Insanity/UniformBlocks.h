@@ -0,0 +1,73 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Uniform block binding points. Shader binds any block it finds with one of
+// the names below to its point after linking, so every program reads the
+// same buffer ranges and nothing has to be uploaded per program.
+enum UniformBlockBinding
+{
+	BLOCK_FRAME = 0,
+	BLOCK_OBJECT = 1,
+
+	NUM_UNIFORM_BLOCKS
+};
+
+// Names of the blocks in GLSL, indexed by UniformBlockBinding.
+static const char* const UNIFORM_BLOCK_NAMES[NUM_UNIFORM_BLOCKS] = {
+	"FrameBlock",
+	"ObjectBlock",
+};
+
+// The structs below mirror the GLSL declarations with layout(std140):
+//
+//   layout(std140) uniform FrameBlock  { mat4 projection; mat4 view; };
+//   layout(std140) uniform ObjectBlock { mat4 model; };
+//
+// Only mat4/vec4 members, so the std140 layout is the C++ one.
+
+struct FrameUniforms
+{
+	glm::mat4 m_Projection;
+	glm::mat4 m_View;
+};
+
+struct ObjectUniforms
+{
+	glm::mat4 m_Model;
+};
+
+static_assert(sizeof(FrameUniforms) == 128, "FrameUniforms must match the std140 FrameBlock");
+static_assert(sizeof(ObjectUniforms) == 64, "ObjectUniforms must match the std140 ObjectBlock");
@@ -0,0 +1,149 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UniformRingBuffer.h"
+
+#include <iostream>
+
+UniformRingBuffer::UniformRingBuffer():
+    m_Buffer{0},
+    m_FrameSize{0},
+    m_Alignment{256},
+    m_Used{0},
+    m_NumFrames{0},
+    m_Frame{0},
+    m_Overflow{false},
+    m_Uploads{0},
+    m_Binds{0},
+    m_BytesUploaded{0}
+{
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    Destroy();
+}
+
+void UniformRingBuffer::Create(size_t frameSize, uint32_t numFrames)
+{
+    Destroy();
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_Alignment = alignment > 0 ? (size_t)alignment : 256;
+
+    m_FrameSize = (frameSize + m_Alignment - 1) & ~(m_Alignment - 1);
+    m_NumFrames = numFrames ? numFrames : 1;
+    m_Frame = 0;
+    m_Used = 0;
+    m_Overflow = false;
+
+    glGenBuffers(1, &m_Buffer);
+    AllocateStorage();
+}
+
+void UniformRingBuffer::AllocateStorage()
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)(m_FrameSize * m_NumFrames), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_Staging.Resize(m_FrameSize);
+}
+
+void UniformRingBuffer::Destroy()
+{
+    if (m_Buffer)
+    {
+        glDeleteBuffers(1, &m_Buffer);
+        m_Buffer = 0;
+    }
+    m_Staging.Clear();
+    m_FrameSize = 0;
+}
+
+void UniformRingBuffer::BeginFrame()
+{
+    if (m_Overflow)
+    {
+        // Reallocating orphans the old storage, frames still in flight
+        // keep reading it.
+        m_FrameSize *= 2;
+        AllocateStorage();
+        m_Overflow = false;
+    }
+
+    m_Frame = (m_Frame + 1) % m_NumFrames;
+    m_Used = 0;
+    m_Uploads = 0;
+    m_Binds = 0;
+    m_BytesUploaded = 0;
+}
+
+void* UniformRingBuffer::Allocate(size_t size, GLintptr& offset)
+{
+    const size_t aligned = (size + m_Alignment - 1) & ~(m_Alignment - 1);
+    if (m_Used + aligned > m_FrameSize)
+    {
+        if (!m_Overflow)
+        {
+            std::cout << "WARNING: Uniform ring buffer full (" << m_FrameSize << " bytes per frame), growing next frame." << std::endl;
+        }
+        m_Overflow = true;
+        return nullptr;
+    }
+
+    void* pData = &m_Staging[m_Used];
+    offset = (GLintptr)(m_FrameSize * m_Frame + m_Used);
+    m_Used += aligned;
+    return pData;
+}
+
+void UniformRingBuffer::Upload()
+{
+    if (!m_Used)
+    {
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)(m_FrameSize * m_Frame), (GLsizeiptr)m_Used, m_Staging.Data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_Uploads++;
+    m_BytesUploaded += m_Used;
+}
+
+void UniformRingBuffer::BindRange(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer, offset, size);
+    m_Binds++;
+}
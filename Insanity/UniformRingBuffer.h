@@ -0,0 +1,89 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#include "TArray.h"
+
+// One uniform buffer split in numFrames segments used round robin. Data for
+// a frame is packed in CPU memory, at offsets aligned for glBindBufferRange,
+// and sent with a single upload. Draws then only rebind ranges.
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer();
+	~UniformRingBuffer();
+
+	UniformRingBuffer(const UniformRingBuffer&) = delete;
+	UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+	// Needs a current context.
+	void Create(size_t frameSize, uint32_t numFrames = 3);
+	void Destroy();
+	bool IsCreated() const { return m_Buffer != 0; }
+
+	// Moves to the next segment. Grows the buffer if the last frame ran
+	// out of space.
+	void BeginFrame();
+
+	// size bytes to fill before Upload. offset is where they'll be in the
+	// buffer, ready for BindRange. nullptr when the frame is full.
+	void* Allocate(size_t size, GLintptr& offset);
+
+	// Sends everything allocated this frame in one call.
+	void Upload();
+
+	void BindRange(GLuint binding, GLintptr offset, GLsizeiptr size);
+
+	// Driver calls made by Upload and BindRange since the last BeginFrame.
+	uint32_t GetUploads() const { return m_Uploads; }
+	uint32_t GetBinds() const { return m_Binds; }
+	size_t GetBytesUploaded() const { return m_BytesUploaded; }
+
+private:
+	GLuint m_Buffer;
+	TArray<unsigned char> m_Staging;
+	size_t m_FrameSize;
+	size_t m_Alignment;
+	size_t m_Used;
+	uint32_t m_NumFrames;
+	uint32_t m_Frame;
+	bool m_Overflow;
+	uint32_t m_Uploads, m_Binds;
+	size_t m_BytesUploaded;
+
+	void AllocateStorage();
+};
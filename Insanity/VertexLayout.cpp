@@ -0,0 +1,181 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "VertexLayout.h"
+
+#include <string.h>
+
+static const VertexFormatInfo s_FormatInfo[NUM_VERTEX_FORMATS] =
+{
+    { 8, 2, "float2" },
+    { 12, 3, "float3" },
+    { 16, 4, "float4" },
+    { 4, 2, "half2" },
+    { 8, 4, "half4" },
+    { 4, 2, "unorm16x2" },
+    { 4, 4, "unorm8x4" },
+    { 4, 4, "oct10" },
+};
+
+static const char* s_AttributeNames[] =
+{
+    "POSITION", nullptr, nullptr, nullptr, nullptr, "NORMAL", "TEXCOORD", "TANGENT", "COLOR",
+};
+
+const VertexFormatInfo& GetVertexFormatInfo(VertexFormat format)
+{
+    return s_FormatInfo[format];
+}
+
+void VertexLayout::Clear()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+bool VertexLayout::Add(VertexAttribute attribute, VertexFormat format, uint32_t stream)
+{
+    if (m_NumElements == MAX_VERTEX_ELEMENTS || stream >= MAX_VERTEX_STREAMS || stream > m_NumStreams)
+    {
+        return false;
+    }
+
+    // Every format is a multiple of 4 bytes, so elements stay aligned.
+    VertexElement& element = m_Elements[m_NumElements++];
+    element.m_Attribute = (uint8_t)attribute;
+    element.m_Format = (uint8_t)format;
+    element.m_Stream = (uint8_t)stream;
+    element.m_Offset = (uint8_t)m_Strides[stream];
+
+    m_Strides[stream] += s_FormatInfo[format].m_Size;
+    if (stream == m_NumStreams)
+    {
+        m_NumStreams++;
+    }
+    return true;
+}
+
+const VertexElement* VertexLayout::Find(VertexAttribute attribute) const
+{
+    for (uint32_t i = 0; i < m_NumElements; i++)
+    {
+        if (m_Elements[i].m_Attribute == attribute)
+        {
+            return &m_Elements[i];
+        }
+    }
+    return nullptr;
+}
+
+uint64_t VertexLayout::GetStreamOffset(uint32_t stream, uint32_t numVertices) const
+{
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < stream; i++)
+    {
+        offset += (uint64_t)m_Strides[i] * numVertices;
+        offset = (offset + VERTEX_STREAM_ALIGNMENT - 1) & ~(uint64_t)(VERTEX_STREAM_ALIGNMENT - 1);
+    }
+    return offset;
+}
+
+uint64_t VertexLayout::GetBufferSize(uint32_t numVertices) const
+{
+    return m_NumStreams ? GetStreamOffset(m_NumStreams - 1, numVertices) + (uint64_t)m_Strides[m_NumStreams - 1] * numVertices : 0;
+}
+
+uint32_t VertexLayout::GetVertexSize() const
+{
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < m_NumStreams; i++)
+    {
+        size += m_Strides[i];
+    }
+    return size;
+}
+
+bool VertexLayout::IsValid() const
+{
+    if (m_NumElements > MAX_VERTEX_ELEMENTS || m_NumStreams > MAX_VERTEX_STREAMS || !Find(ATTRIB_POSITION))
+    {
+        return false;
+    }
+
+    uint32_t used[MAX_VERTEX_STREAMS] = {};
+    for (uint32_t i = 0; i < m_NumElements; i++)
+    {
+        const VertexElement& element = m_Elements[i];
+        const bool known = element.m_Attribute < sizeof(s_AttributeNames) / sizeof(s_AttributeNames[0]) && s_AttributeNames[element.m_Attribute];
+        if (!known || element.m_Format >= NUM_VERTEX_FORMATS || element.m_Stream >= m_NumStreams ||
+            element.m_Offset + s_FormatInfo[element.m_Format].m_Size > m_Strides[element.m_Stream])
+        {
+            return false;
+        }
+        used[element.m_Stream] += s_FormatInfo[element.m_Format].m_Size;
+    }
+
+    for (uint32_t i = 0; i < m_NumStreams; i++)
+    {
+        if (used[i] != m_Strides[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string VertexLayout::GetShaderDefines() const
+{
+    std::string defines;
+    for (uint32_t i = 0; i < m_NumElements; i++)
+    {
+        const VertexElement& element = m_Elements[i];
+        if (element.m_Attribute == ATTRIB_POSITION)
+        {
+            continue;
+        }
+
+        const std::string name = std::string("VERTEX_") + s_AttributeNames[element.m_Attribute];
+        defines += "#define " + name + "\n";
+        if (element.m_Format == VERTEX_OCT10)
+        {
+            defines += "#define " + name + "_OCT\n";
+        }
+    }
+    return defines;
+}
+
+VertexLayout VertexLayout::PositionOnly()
+{
+    VertexLayout layout;
+    layout.Clear();
+    layout.Add(ATTRIB_POSITION, VERTEX_FLOAT3);
+    return layout;
+}
@@ -0,0 +1,127 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "VertexAttributes.h"
+
+static const uint32_t MAX_VERTEX_ELEMENTS = 8;
+static const uint32_t MAX_VERTEX_STREAMS = 4;
+
+// Each stream starts on this boundary inside the vertex buffer.
+static const uint32_t VERTEX_STREAM_ALIGNMENT = 16;
+
+// How an attribute is stored. Everything except VERTEX_OCT10 is expanded by
+// the vertex fetch hardware, the shader sees plain floats.
+enum VertexFormat
+{
+	VERTEX_FLOAT2,
+	VERTEX_FLOAT3,
+	VERTEX_FLOAT4,
+	VERTEX_HALF2,
+	VERTEX_HALF4,		// Half float xyz, w is 1.
+	VERTEX_UNORM16X2,	// [0, 1] in 16 bits.
+	VERTEX_UNORM8X4,	// [0, 1] in 8 bits, for colours.
+
+	// Unit vector, octahedral encoded into x and y of a normalized
+	// GL_INT_2_10_10_10_REV. z is unused and w holds the sign (tangents).
+	// The shader decodes it (see GetShaderDefines):
+	//
+	//   vec3 OctDecode(vec2 e)
+	//   {
+	//       vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	//       if (v.z < 0.0)
+	//           v.xy = (1.0 - abs(v.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(v.xy, vec2(0.0)));
+	//       return normalize(v);
+	//   }
+	VERTEX_OCT10,
+
+	NUM_VERTEX_FORMATS
+};
+
+struct VertexFormatInfo
+{
+	uint32_t m_Size;		// Bytes.
+	uint32_t m_Components;	// What the GL sees.
+	const char* m_pName;
+};
+
+const VertexFormatInfo& GetVertexFormatInfo(VertexFormat format);
+
+struct VertexElement
+{
+	uint8_t m_Attribute;	// VertexAttribute
+	uint8_t m_Format;		// VertexFormat
+	uint8_t m_Stream;
+	uint8_t m_Offset;		// Bytes from the start of the vertex in its stream.
+};
+
+// Describes where each attribute of a vertex buffer lives. Attributes in the
+// same stream are interleaved; streams are stored one after another in the
+// buffer, each one VERTEX_STREAM_ALIGNMENT aligned, so a layout and a vertex
+// count are enough to find everything. Plain data, mesh files store it as is.
+struct VertexLayout
+{
+	uint32_t m_NumElements;
+	uint32_t m_NumStreams;
+	VertexElement m_Elements[MAX_VERTEX_ELEMENTS];
+	uint32_t m_Strides[MAX_VERTEX_STREAMS];
+
+	void Clear();
+
+	// Appends the attribute to stream, after what is already there. Streams
+	// must be used in order. Returns false if the layout is full.
+	bool Add(VertexAttribute attribute, VertexFormat format, uint32_t stream = 0);
+
+	const VertexElement* Find(VertexAttribute attribute) const;
+
+	// Byte offset of a stream inside the vertex buffer.
+	uint64_t GetStreamOffset(uint32_t stream, uint32_t numVertices) const;
+	uint64_t GetBufferSize(uint32_t numVertices) const;
+
+	// Sum of the strides, the memory a vertex takes.
+	uint32_t GetVertexSize() const;
+
+	// Checks a layout read from a file.
+	bool IsValid() const;
+
+	// "#define VERTEX_NORMAL_OCT\n" and friends, so shaders (through the
+	// defines of Shader::CreateFromFile) know which attributes they get and
+	// which need decoding.
+	std::string GetShaderDefines() const;
+
+	// Float3 positions only, what meshes used before layouts existed.
+	static VertexLayout PositionOnly();
+};
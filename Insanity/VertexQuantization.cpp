@@ -0,0 +1,484 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "VertexQuantization.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Bounds.h"
+
+// Formats tried for each attribute, smallest first. The last one is lossless.
+static const VertexFormat s_PositionFormats[] = { VERTEX_HALF4, VERTEX_FLOAT3 };
+static const VertexFormat s_NormalFormats[] = { VERTEX_OCT10, VERTEX_FLOAT3 };
+static const VertexFormat s_TangentFormats[] = { VERTEX_OCT10, VERTEX_FLOAT4 };
+static const VertexFormat s_TexCoordFormats[] = { VERTEX_UNORM16X2, VERTEX_HALF2, VERTEX_FLOAT2 };
+static const VertexFormat s_ColorFormats[] = { VERTEX_UNORM8X4, VERTEX_FLOAT4 };
+
+static const float DEGREES_PER_RADIAN = 57.2957795f;
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t floatExponent = (bits >> 23) & 0xFF;
+    const int32_t exponent = (int32_t)floatExponent - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (floatExponent == 0xFF)
+    {
+        // Inf and NaN.
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        return (uint16_t)(sign | 0x7C00);
+    }
+
+    // Round to nearest even in both cases. A carry out of the mantissa
+    // correctly bumps the exponent.
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+
+        mantissa |= 0x800000;
+        const uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    const uint32_t exponent = (value >> 10) & 0x1F;
+    const uint32_t mantissa = value & 0x3FF;
+
+    float result;
+    if (exponent == 0)
+    {
+        result = ldexpf((float)mantissa, -24);
+    }
+    else if (exponent == 31)
+    {
+        result = mantissa ? NAN : INFINITY;
+    }
+    else
+    {
+        result = ldexpf((float)(mantissa | 0x400), (int)exponent - 25);
+    }
+    return (value & 0x8000) ? -result : result;
+}
+
+static float SignNotZero(float value)
+{
+    return value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Unit vector to the [-1, 1] square: project on the octahedron and fold
+// the lower half over the upper one.
+static void OctEncode(const float* pVector, float& u, float& v)
+{
+    const float length = fabsf(pVector[0]) + fabsf(pVector[1]) + fabsf(pVector[2]);
+    if (length == 0.0f)
+    {
+        u = v = 0.0f;
+        return;
+    }
+
+    u = pVector[0] / length;
+    v = pVector[1] / length;
+    if (pVector[2] < 0.0f)
+    {
+        const float foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+        const float foldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+        u = foldedU;
+        v = foldedV;
+    }
+}
+
+static void OctDecode(float u, float v, float* pVector)
+{
+    float x = u, y = v;
+    const float z = 1.0f - fabsf(u) - fabsf(v);
+    if (z < 0.0f)
+    {
+        x = (1.0f - fabsf(v)) * SignNotZero(u);
+        y = (1.0f - fabsf(u)) * SignNotZero(v);
+    }
+
+    const float length = sqrtf(x * x + y * y + z * z);
+    pVector[0] = x / length;
+    pVector[1] = y / length;
+    pVector[2] = z / length;
+}
+
+static int32_t SignExtend10(uint32_t bits)
+{
+    return (int32_t)(bits << 22) >> 22;
+}
+
+static float Dot3(const float* a, const float* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static uint32_t PackOct10(int32_t u, int32_t v, int32_t w)
+{
+    return ((uint32_t)u & 0x3FF) | (((uint32_t)v & 0x3FF) << 10) | ((uint32_t)w << 30);
+}
+
+static void UnpackOct10(uint32_t packed, float* pOut)
+{
+    // Current GL snorm rule: c / 511, clamped to -1.
+    const float u = fmaxf((float)SignExtend10(packed) / 511.0f, -1.0f);
+    const float v = fmaxf((float)SignExtend10(packed >> 10) / 511.0f, -1.0f);
+    OctDecode(u, v, pOut);
+    pOut[3] = (float)((int32_t)packed >> 30);
+}
+
+// Rounding u and v separately isn't the closest encoding, so try the four
+// neighbours and keep the one that decodes nearest to the input.
+static uint32_t EncodeOct10(const float* pValue, uint32_t components)
+{
+    float unit[3] = { pValue[0], pValue[1], pValue[2] };
+    const float length = sqrtf(Dot3(unit, unit));
+    if (length > 0.0f)
+    {
+        unit[0] /= length;
+        unit[1] /= length;
+        unit[2] /= length;
+    }
+
+    float u, v;
+    OctEncode(unit, u, v);
+
+    const int32_t sign = components > 3 && pValue[3] < 0.0f ? -1 : 1;
+    const int32_t baseU = (int32_t)floorf(u * 511.0f);
+    const int32_t baseV = (int32_t)floorf(v * 511.0f);
+
+    uint32_t best = 0;
+    float bestDot = -2.0f;
+    for (int32_t i = 0; i < 4; i++)
+    {
+        const int32_t qu = baseU + (i & 1);
+        const int32_t qv = baseV + (i >> 1);
+        if (qu < -511 || qu > 511 || qv < -511 || qv > 511)
+        {
+            continue;
+        }
+
+        const uint32_t packed = PackOct10(qu, qv, sign);
+        float decoded[4];
+        UnpackOct10(packed, decoded);
+        const float dot = Dot3(decoded, unit);
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            best = packed;
+        }
+    }
+    return best;
+}
+
+static float Saturate(float value)
+{
+    return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+void EncodeVertexElement(VertexFormat format, const float* pValue, uint32_t components, void* pOut)
+{
+    float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (uint32_t i = 0; i < components && i < 4; i++)
+    {
+        value[i] = pValue[i];
+    }
+
+    switch (format)
+    {
+    case VERTEX_FLOAT2:
+    case VERTEX_FLOAT3:
+    case VERTEX_FLOAT4:
+        memcpy(pOut, value, GetVertexFormatInfo(format).m_Size);
+        break;
+
+    case VERTEX_HALF2:
+    case VERTEX_HALF4:
+    {
+        uint16_t half[4];
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            half[i] = FloatToHalf(value[i]);
+        }
+        memcpy(pOut, half, GetVertexFormatInfo(format).m_Size);
+        break;
+    }
+
+    case VERTEX_UNORM16X2:
+    {
+        const uint16_t unorm[2] = { (uint16_t)lrintf(Saturate(value[0]) * 65535.0f), (uint16_t)lrintf(Saturate(value[1]) * 65535.0f) };
+        memcpy(pOut, unorm, sizeof(unorm));
+        break;
+    }
+
+    case VERTEX_UNORM8X4:
+    {
+        uint8_t unorm[4];
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            unorm[i] = (uint8_t)lrintf(Saturate(value[i]) * 255.0f);
+        }
+        memcpy(pOut, unorm, sizeof(unorm));
+        break;
+    }
+
+    case VERTEX_OCT10:
+    {
+        const uint32_t packed = EncodeOct10(value, components);
+        memcpy(pOut, &packed, sizeof(packed));
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void DecodeVertexElement(VertexFormat format, const void* pIn, float* pOut)
+{
+    pOut[0] = pOut[1] = pOut[2] = 0.0f;
+    pOut[3] = 1.0f;
+
+    switch (format)
+    {
+    case VERTEX_FLOAT2:
+    case VERTEX_FLOAT3:
+    case VERTEX_FLOAT4:
+        memcpy(pOut, pIn, GetVertexFormatInfo(format).m_Size);
+        break;
+
+    case VERTEX_HALF2:
+    case VERTEX_HALF4:
+    {
+        uint16_t half[4];
+        const uint32_t components = GetVertexFormatInfo(format).m_Components;
+        memcpy(half, pIn, GetVertexFormatInfo(format).m_Size);
+        for (uint32_t i = 0; i < components; i++)
+        {
+            pOut[i] = HalfToFloat(half[i]);
+        }
+        break;
+    }
+
+    case VERTEX_UNORM16X2:
+    {
+        uint16_t unorm[2];
+        memcpy(unorm, pIn, sizeof(unorm));
+        pOut[0] = unorm[0] / 65535.0f;
+        pOut[1] = unorm[1] / 65535.0f;
+        break;
+    }
+
+    case VERTEX_UNORM8X4:
+    {
+        uint8_t unorm[4];
+        memcpy(unorm, pIn, sizeof(unorm));
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            pOut[i] = unorm[i] / 255.0f;
+        }
+        break;
+    }
+
+    case VERTEX_OCT10:
+    {
+        uint32_t packed;
+        memcpy(&packed, pIn, sizeof(packed));
+        UnpackOct10(packed, pOut);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// Largest error of storing values in format: degrees for unit vectors,
+// the biggest component difference for the rest.
+static float MeasureError(VertexFormat format, bool unitVector, const float* pValues, uint32_t components, uint32_t numVertices)
+{
+    float maxError = 0.0f;
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        const float* pValue = pValues + (size_t)i * components;
+
+        unsigned char encoded[16];
+        float decoded[4];
+        EncodeVertexElement(format, pValue, components, encoded);
+        DecodeVertexElement(format, encoded, decoded);
+
+        float error = 0.0f;
+        if (unitVector)
+        {
+            const float length = sqrtf(Dot3(pValue, pValue));
+            if (length > 0.0f)
+            {
+                const float cosine = Dot3(pValue, decoded) / length;
+                error = acosf(cosine > 1.0f ? 1.0f : cosine) * DEGREES_PER_RADIAN;
+            }
+            if (components > 3 && (pValue[3] < 0.0f) != (decoded[3] < 0.0f))
+            {
+                error = 180.0f;
+            }
+        }
+        else
+        {
+            for (uint32_t c = 0; c < components; c++)
+            {
+                const float difference = fabsf(pValue[c] - decoded[c]);
+                if (!(difference <= error))
+                {
+                    error = difference;
+                }
+            }
+        }
+
+        // NaN (overflowing half floats) never passes.
+        if (!(error <= maxError))
+        {
+            maxError = error;
+        }
+    }
+    return maxError;
+}
+
+template<size_t N>
+static VertexFormat ChooseFormat(const VertexFormat (&formats)[N], bool enabled, float tolerance, bool unitVector,
+    const float* pValues, uint32_t components, uint32_t numVertices)
+{
+    if (enabled)
+    {
+        for (size_t i = 0; i + 1 < N; i++)
+        {
+            if (MeasureError(formats[i], unitVector, pValues, components, numVertices) <= tolerance)
+            {
+                return formats[i];
+            }
+        }
+    }
+    return formats[N - 1];
+}
+
+VertexLayout ChooseVertexLayout(const VertexSource& source, const VertexQuantization& quantization, VertexStreamMode mode)
+{
+    const AABB bounds = AABB::FromPoints(source.m_pPositions, source.m_NumVertices);
+    const float positionTolerance = quantization.m_PositionError * glm::length(bounds.m_Max - bounds.m_Min);
+
+    VertexLayout layout;
+    layout.Clear();
+    layout.Add(ATTRIB_POSITION, ChooseFormat(s_PositionFormats, quantization.m_Enabled, positionTolerance, false, source.m_pPositions, 3, source.m_NumVertices));
+
+    const uint32_t stream = mode == VERTEX_SPLIT_POSITIONS ? 1 : 0;
+    if (source.m_pNormals)
+    {
+        layout.Add(ATTRIB_NORMAL, ChooseFormat(s_NormalFormats, quantization.m_Enabled, quantization.m_NormalError, true, source.m_pNormals, 3, source.m_NumVertices), stream);
+    }
+    if (source.m_pTangents)
+    {
+        layout.Add(ATTRIB_TANGENT, ChooseFormat(s_TangentFormats, quantization.m_Enabled, quantization.m_NormalError, true, source.m_pTangents, 4, source.m_NumVertices), stream);
+    }
+    if (source.m_pTexCoords)
+    {
+        layout.Add(ATTRIB_TEXCOORD, ChooseFormat(s_TexCoordFormats, quantization.m_Enabled, quantization.m_TexCoordError, false, source.m_pTexCoords, 2, source.m_NumVertices), stream);
+    }
+    if (source.m_pColors)
+    {
+        layout.Add(ATTRIB_COLOR, ChooseFormat(s_ColorFormats, quantization.m_Enabled, quantization.m_ColorError, false, source.m_pColors, 4, source.m_NumVertices), stream);
+    }
+    return layout;
+}
+
+static const float* GetSourceAttribute(const VertexSource& source, uint32_t attribute, uint32_t& components)
+{
+    switch (attribute)
+    {
+    case ATTRIB_POSITION: components = 3; return source.m_pPositions;
+    case ATTRIB_NORMAL: components = 3; return source.m_pNormals;
+    case ATTRIB_TANGENT: components = 4; return source.m_pTangents;
+    case ATTRIB_TEXCOORD: components = 2; return source.m_pTexCoords;
+    case ATTRIB_COLOR: components = 4; return source.m_pColors;
+    default: components = 0; return nullptr;
+    }
+}
+
+void EncodeVertices(const VertexSource& source, const VertexLayout& layout, void* pOut)
+{
+    unsigned char* pBytes = static_cast<unsigned char*>(pOut);
+    memset(pBytes, 0, (size_t)layout.GetBufferSize(source.m_NumVertices));
+
+    for (uint32_t e = 0; e < layout.m_NumElements; e++)
+    {
+        const VertexElement& element = layout.m_Elements[e];
+
+        uint32_t components;
+        const float* pValues = GetSourceAttribute(source, element.m_Attribute, components);
+        if (!pValues)
+        {
+            continue;
+        }
+
+        const uint32_t stride = layout.m_Strides[element.m_Stream];
+        unsigned char* pElement = pBytes + layout.GetStreamOffset(element.m_Stream, source.m_NumVertices) + element.m_Offset;
+        for (uint32_t i = 0; i < source.m_NumVertices; i++)
+        {
+            EncodeVertexElement((VertexFormat)element.m_Format, pValues + (size_t)i * components, components, pElement + (size_t)i * stride);
+        }
+    }
+}
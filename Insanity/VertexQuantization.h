@@ -0,0 +1,92 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "VertexLayout.h"
+
+// Unquantized vertex data, one array per attribute. Only positions are
+// required, the rest may be nullptr.
+struct VertexSource
+{
+	const float* m_pPositions;	// float3
+	const float* m_pNormals;	// float3
+	const float* m_pTangents;	// float4, bitangent sign in w.
+	const float* m_pTexCoords;	// float2
+	const float* m_pColors;		// float4
+	uint32_t m_NumVertices;
+};
+
+// Largest error each attribute may get when a compact format is picked for
+// it. When no format is within the tolerance the attribute stays float.
+struct VertexQuantization
+{
+	bool m_Enabled = true;
+
+	// Fraction of the diagonal of the mesh bounds.
+	float m_PositionError = 1.0f / 4096.0f;
+
+	// Degrees, for normals and tangents.
+	float m_NormalError = 0.5f;
+
+	float m_TexCoordError = 1.0f / 4096.0f;
+	float m_ColorError = 1.0f / 255.0f;
+};
+
+enum VertexStreamMode
+{
+	// Every attribute in one stream.
+	VERTEX_INTERLEAVED,
+
+	// Positions alone in stream 0, the rest interleaved in stream 1, so
+	// depth only passes fetch just the positions.
+	VERTEX_SPLIT_POSITIONS,
+};
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// Writes components floats (missing ones are 0, 0, 0, 1) in the given format.
+void EncodeVertexElement(VertexFormat format, const float* pValue, uint32_t components, void* pOut);
+
+// Reads an element back as four floats, decoding octahedral vectors.
+void DecodeVertexElement(VertexFormat format, const void* pIn, float* pOut);
+
+// Picks the smallest format for each attribute present in source that
+// stays within the quantization tolerances.
+VertexLayout ChooseVertexLayout(const VertexSource& source, const VertexQuantization& quantization, VertexStreamMode mode);
+
+// Fills pOut, layout.GetBufferSize(source.m_NumVertices) bytes, with the
+// source data encoded as layout says.
+void EncodeVertices(const VertexSource& source, const VertexLayout& layout, void* pOut);
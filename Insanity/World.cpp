@@ -0,0 +1,293 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "World.h"
+
+#include <stdlib.h>
+#include <iostream>
+#include <mutex>
+
+// Component arrays in a chunk start at least this aligned, for SIMD loads.
+static const size_t ECS_ARRAY_ALIGNMENT = 16;
+
+// Chunks are taken from the heap this many at a time.
+static const size_t ECS_CHUNKS_PER_PAGE = 16;
+
+static ComponentInfo s_ComponentInfos[MAX_COMPONENT_TYPES];
+static uint32_t s_NumComponentTypes = 0;
+static std::mutex s_RegistryMutex;
+
+uint32_t ComponentRegistry::Register(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock{ s_RegistryMutex };
+    if (s_NumComponentTypes == MAX_COMPONENT_TYPES)
+    {
+        std::cout << "ERROR: More than " << MAX_COMPONENT_TYPES << " component types." << std::endl;
+        abort();
+    }
+
+    s_ComponentInfos[s_NumComponentTypes] = ComponentInfo{ size, alignment };
+    return s_NumComponentTypes++;
+}
+
+const ComponentInfo& ComponentRegistry::GetInfo(uint32_t id)
+{
+    return s_ComponentInfos[id];
+}
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Places the arrays of capacity rows one after the other, entities first.
+// False if they don't fit in a chunk.
+static bool LayoutChunk(ComponentMask mask, uint32_t capacity, uint32_t* pOffsets)
+{
+    size_t offset = sizeof(Entity) * capacity;
+    for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++)
+    {
+        if (mask & (ComponentMask{1} << id))
+        {
+            const ComponentInfo& info = ComponentRegistry::GetInfo(id);
+            offset = AlignUp(offset, info.m_Alignment > ECS_ARRAY_ALIGNMENT ? info.m_Alignment : ECS_ARRAY_ALIGNMENT);
+            pOffsets[id] = (uint32_t)offset;
+            offset += info.m_Size * capacity;
+        }
+    }
+    return offset <= ECS_CHUNK_SIZE;
+}
+
+World::World():
+    m_ChunkAllocator{ECS_CHUNK_SIZE, 64, ECS_CHUNKS_PER_PAGE},
+    m_NumEntities{0}
+{
+}
+
+World::~World()
+{
+    Clear();
+    for (Archetype* pArchetype : m_Archetypes)
+    {
+        delete pArchetype;
+    }
+}
+
+void World::Clear()
+{
+    // Archetypes stay, the next scene probably uses the same ones.
+    for (Archetype* pArchetype : m_Archetypes)
+    {
+        for (uint8_t* pChunk : pArchetype->m_Chunks)
+        {
+            m_ChunkAllocator.Free(pChunk);
+        }
+        pArchetype->m_Chunks.Clear();
+        pArchetype->m_NumEntities = 0;
+    }
+
+    // Records stay too, with the generations moved on like Destroy does,
+    // so handles from before the Clear never come back to life. Walked
+    // backwards so the lowest indices are reused first.
+    for (uint32_t index = (uint32_t)m_Records.Size(); index-- > 0;)
+    {
+        EntityRecord& record = m_Records[index];
+        if (record.m_pArchetype)
+        {
+            record.m_pArchetype = nullptr;
+            record.m_Generation = record.m_Generation + 1 ? record.m_Generation + 1 : 1;
+            m_FreeIndices.PushBack(index);
+        }
+    }
+    m_NumEntities = 0;
+}
+
+Archetype* World::GetArchetype(ComponentMask mask)
+{
+    for (Archetype* pArchetype : m_Archetypes)
+    {
+        if (pArchetype->m_Mask == mask)
+        {
+            return pArchetype;
+        }
+    }
+
+    Archetype* pArchetype = new Archetype();
+    pArchetype->m_Mask = mask;
+
+    // As many rows as the sizes allow, minus what alignment padding eats.
+    size_t bytesPerEntity = sizeof(Entity);
+    for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++)
+    {
+        if (mask & (ComponentMask{1} << id))
+        {
+            bytesPerEntity += ComponentRegistry::GetInfo(id).m_Size;
+        }
+    }
+
+    uint32_t capacity = (uint32_t)(ECS_CHUNK_SIZE / bytesPerEntity);
+    while (capacity && !LayoutChunk(mask, capacity, pArchetype->m_Offsets))
+    {
+        capacity--;
+    }
+
+    if (!capacity)
+    {
+        std::cout << "ERROR: Components of " << bytesPerEntity << " bytes don't fit in a chunk." << std::endl;
+        abort();
+    }
+
+    pArchetype->m_Capacity = capacity;
+    m_Archetypes.PushBack(pArchetype);
+    return pArchetype;
+}
+
+Entity World::CreateEntity(ComponentMask mask)
+{
+    uint32_t index;
+    if (!m_FreeIndices.IsEmpty())
+    {
+        index = m_FreeIndices.Back();
+        m_FreeIndices.PopBack();
+    }
+    else
+    {
+        index = (uint32_t)m_Records.Size();
+        m_Records.PushBack(EntityRecord{ nullptr, 0, 1 });
+    }
+
+    const Entity entity{ index, m_Records[index].m_Generation };
+    Archetype* pArchetype = GetArchetype(mask);
+    m_Records[index].m_pArchetype = pArchetype;
+    m_Records[index].m_Row = AddRow(*pArchetype, entity);
+    m_NumEntities++;
+    return entity;
+}
+
+void World::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    EntityRecord& record = m_Records[entity.m_Index];
+    RemoveRow(*record.m_pArchetype, record.m_Row);
+    record.m_pArchetype = nullptr;
+
+    // Skips 0 when it wraps around, that generation is never alive.
+    record.m_Generation = record.m_Generation + 1 ? record.m_Generation + 1 : 1;
+    m_FreeIndices.PushBack(entity.m_Index);
+    m_NumEntities--;
+}
+
+bool World::IsAlive(Entity entity) const
+{
+    return entity.m_Index < m_Records.Size() && m_Records[entity.m_Index].m_Generation == entity.m_Generation && m_Records[entity.m_Index].m_pArchetype;
+}
+
+uint32_t World::AddRow(Archetype& archetype, Entity entity)
+{
+    const uint32_t row = archetype.m_NumEntities;
+    if (row == archetype.m_Chunks.Size() * archetype.m_Capacity)
+    {
+        archetype.m_Chunks.PushBack(static_cast<uint8_t*>(m_ChunkAllocator.Allocate()));
+    }
+
+    archetype.m_NumEntities++;
+    archetype.GetEntity(row) = entity;
+    return row;
+}
+
+void World::RemoveRow(Archetype& archetype, uint32_t row)
+{
+    // The last row fills the hole, so chunks stay packed.
+    const uint32_t last = archetype.m_NumEntities - 1;
+    if (row != last)
+    {
+        for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++)
+        {
+            if (archetype.m_Mask & (ComponentMask{1} << id))
+            {
+                memcpy(archetype.GetComponent(row, id), archetype.GetComponent(last, id), ComponentRegistry::GetInfo(id).m_Size);
+            }
+        }
+
+        const Entity moved = archetype.GetEntity(last);
+        archetype.GetEntity(row) = moved;
+        m_Records[moved.m_Index].m_Row = row;
+    }
+
+    archetype.m_NumEntities--;
+    if (archetype.m_NumEntities <= (archetype.m_Chunks.Size() - 1) * archetype.m_Capacity)
+    {
+        m_ChunkAllocator.Free(archetype.m_Chunks.Back());
+        archetype.m_Chunks.PopBack();
+    }
+}
+
+void World::MoveEntity(Entity entity, ComponentMask mask)
+{
+    Archetype* pOld = m_Records[entity.m_Index].m_pArchetype;
+    const uint32_t oldRow = m_Records[entity.m_Index].m_Row;
+
+    Archetype* pNew = GetArchetype(mask);
+    const uint32_t newRow = AddRow(*pNew, entity);
+
+    const ComponentMask shared = pOld->m_Mask & mask;
+    for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++)
+    {
+        if (shared & (ComponentMask{1} << id))
+        {
+            memcpy(pNew->GetComponent(newRow, id), pOld->GetComponent(oldRow, id), ComponentRegistry::GetInfo(id).m_Size);
+        }
+    }
+
+    RemoveRow(*pOld, oldRow);
+    m_Records[entity.m_Index].m_pArchetype = pNew;
+    m_Records[entity.m_Index].m_Row = newRow;
+}
+
+uint8_t* World::GetComponent(Entity entity, uint32_t id) const
+{
+    if (!IsAlive(entity))
+    {
+        return nullptr;
+    }
+
+    const EntityRecord& record = m_Records[entity.m_Index];
+    if (!(record.m_pArchetype->m_Mask & (ComponentMask{1} << id)))
+    {
+        return nullptr;
+    }
+    return record.m_pArchetype->GetComponent(record.m_Row, id);
+}
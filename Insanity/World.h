@@ -0,0 +1,274 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2020, DebugBSD
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "Allocator.h"
+#include "Entity.h"
+#include "JobSystem.h"
+#include "TArray.h"
+
+// Bytes per chunk. Small enough that a chunk of a few components stays in
+// L1/L2 while a system walks it.
+static const size_t ECS_CHUNK_SIZE = 16 * 1024;
+
+// Every entity with exactly the same set of components. They are stored in
+// chunks of ECS_CHUNK_SIZE bytes that hold an array per component type
+// (structure of arrays) plus the entities themselves, and every chunk but
+// the last is full, so row r lives in chunk r / capacity.
+class Archetype
+{
+public:
+	ComponentMask GetMask() const { return m_Mask; }
+	uint32_t GetChunkCapacity() const { return m_Capacity; }
+	uint32_t GetNumEntities() const { return m_NumEntities; }
+	uint32_t GetNumChunks() const { return (uint32_t)m_Chunks.Size(); }
+
+	uint32_t GetChunkSize(uint32_t chunk) const
+	{
+		const uint32_t first = chunk * m_Capacity;
+		return m_NumEntities - first < m_Capacity ? m_NumEntities - first : m_Capacity;
+	}
+
+	Entity* GetEntities(uint32_t chunk) const { return reinterpret_cast<Entity*>(m_Chunks[chunk]); }
+
+	// Array of a component in a chunk. The type must be in the archetype.
+	template<typename T>
+	T* GetComponents(uint32_t chunk) const
+	{
+		return reinterpret_cast<T*>(m_Chunks[chunk] + m_Offsets[ComponentRegistry::GetId<std::remove_const_t<T>>()]);
+	}
+
+private:
+	friend class World;
+
+	ComponentMask m_Mask = 0;
+	uint32_t m_Capacity = 0;
+	uint32_t m_NumEntities = 0;
+	uint32_t m_Offsets[MAX_COMPONENT_TYPES] = {};
+	TArray<uint8_t*> m_Chunks;
+
+	uint8_t* GetComponent(uint32_t row, uint32_t id) const
+	{
+		return m_Chunks[row / m_Capacity] + m_Offsets[id] + (size_t)(row % m_Capacity) * ComponentRegistry::GetInfo(id).m_Size;
+	}
+
+	Entity& GetEntity(uint32_t row) const { return GetEntities(row / m_Capacity)[row % m_Capacity]; }
+};
+
+// Entity-component storage. Components are plain data (trivially
+// copyable) and an entity is whatever set of them it has; adding or
+// removing one moves it to another archetype.
+//
+// Queries walk the chunks of every archetype that has the requested
+// components:
+//
+//   world.ForEachChunk<const Velocity, Position>([](uint32_t count, const Entity* pEntities, const Velocity* pVelocities, Position* pPositions)
+//   {
+//       for (uint32_t i = 0; i < count; i++) ...
+//   });
+//
+// Structural changes (Create, Destroy, Add, Remove) invalidate component
+// pointers and must not happen while a query runs. Component data may be
+// written from several threads as long as they touch different entities or
+// components, which is what SystemScheduler arranges.
+class World
+{
+public:
+	World();
+	~World();
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Components>
+	Entity Create(const Components&... components);
+
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	// Destroys every entity. Indices start from 0 again, so handles from
+	// before may resolve to new entities.
+	void Clear();
+
+	// nullptr when the entity is gone or doesn't have the component.
+	template<typename T>
+	T* Get(Entity entity) const;
+
+	template<typename T>
+	bool Has(Entity entity) const { return Get<T>(entity) != nullptr; }
+
+	// Adds the component, or overwrites it if the entity already has it.
+	template<typename T>
+	void Add(Entity entity, const T& component);
+
+	template<typename T>
+	void Remove(Entity entity);
+
+	// Calls function(count, pEntities, pComponents...) for every chunk with
+	// all the components. Const components are passed as const pointers.
+	template<typename... Components, typename Function>
+	void ForEachChunk(const Function& function) const;
+
+	// Same, with the chunks spread over the job system.
+	template<typename... Components, typename Function>
+	void ParallelForEachChunk(JobSystem& jobSystem, const Function& function) const;
+
+	uint32_t GetNumEntities() const { return m_NumEntities; }
+	size_t GetNumArchetypes() const { return m_Archetypes.Size(); }
+
+private:
+	struct EntityRecord
+	{
+		Archetype* m_pArchetype;
+		uint32_t m_Row;
+		uint32_t m_Generation;
+	};
+
+	TArray<EntityRecord> m_Records;
+	TArray<uint32_t> m_FreeIndices;
+	TArray<Archetype*> m_Archetypes;
+	PoolAllocator m_ChunkAllocator;
+	uint32_t m_NumEntities;
+
+	Archetype* GetArchetype(ComponentMask mask);
+	Entity CreateEntity(ComponentMask mask);
+	uint32_t AddRow(Archetype& archetype, Entity entity);
+	void RemoveRow(Archetype& archetype, uint32_t row);
+	void MoveEntity(Entity entity, ComponentMask mask);
+	uint8_t* GetComponent(Entity entity, uint32_t id) const;
+};
+
+template<typename... Components>
+Entity World::Create(const Components&... components)
+{
+	const Entity entity = CreateEntity(MakeComponentMask<Components...>());
+	(memcpy(GetComponent(entity, ComponentRegistry::GetId<Components>()), &components, sizeof(Components)), ...);
+	return entity;
+}
+
+template<typename T>
+T* World::Get(Entity entity) const
+{
+	return reinterpret_cast<T*>(GetComponent(entity, ComponentRegistry::GetId<std::remove_const_t<T>>()));
+}
+
+template<typename T>
+void World::Add(Entity entity, const T& component)
+{
+	if (!IsAlive(entity))
+	{
+		return;
+	}
+
+	const ComponentMask bit = ComponentMask{1} << ComponentRegistry::GetId<T>();
+	const ComponentMask mask = m_Records[entity.m_Index].m_pArchetype->GetMask();
+	if (!(mask & bit))
+	{
+		MoveEntity(entity, mask | bit);
+	}
+	memcpy(GetComponent(entity, ComponentRegistry::GetId<T>()), &component, sizeof(T));
+}
+
+template<typename T>
+void World::Remove(Entity entity)
+{
+	if (!IsAlive(entity))
+	{
+		return;
+	}
+
+	const ComponentMask bit = ComponentMask{1} << ComponentRegistry::GetId<T>();
+	const ComponentMask mask = m_Records[entity.m_Index].m_pArchetype->GetMask();
+	if (mask & bit)
+	{
+		MoveEntity(entity, mask & ~bit);
+	}
+}
+
+template<typename... Components, typename Function>
+void World::ForEachChunk(const Function& function) const
+{
+	const ComponentMask mask = MakeComponentMask<Components...>();
+	for (const Archetype* pArchetype : m_Archetypes)
+	{
+		if ((pArchetype->GetMask() & mask) != mask)
+		{
+			continue;
+		}
+
+		for (uint32_t chunk = 0; chunk < pArchetype->GetNumChunks(); chunk++)
+		{
+			function(pArchetype->GetChunkSize(chunk), pArchetype->GetEntities(chunk), pArchetype->GetComponents<Components>(chunk)...);
+		}
+	}
+}
+
+template<typename... Components, typename Function>
+void World::ParallelForEachChunk(JobSystem& jobSystem, const Function& function) const
+{
+	struct ChunkRef
+	{
+		const Archetype* m_pArchetype;
+		uint32_t m_Chunk;
+	};
+
+	const ComponentMask mask = MakeComponentMask<Components...>();
+	TArray<ChunkRef> chunks;
+	for (const Archetype* pArchetype : m_Archetypes)
+	{
+		if ((pArchetype->GetMask() & mask) == mask)
+		{
+			for (uint32_t chunk = 0; chunk < pArchetype->GetNumChunks(); chunk++)
+			{
+				chunks.PushBack(ChunkRef{ pArchetype, chunk });
+			}
+		}
+	}
+
+	// A job per chunk: chunks are already sized to be a worthwhile piece
+	// of work, whatever the components.
+	jobSystem.ParallelFor((uint32_t)chunks.Size(), 1, [&chunks, &function](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Archetype* pArchetype = chunks[i].m_pArchetype;
+			const uint32_t chunk = chunks[i].m_Chunk;
+			function(pArchetype->GetChunkSize(chunk), pArchetype->GetEntities(chunk), pArchetype->GetComponents<Components>(chunk)...);
+		}
+	});
+}
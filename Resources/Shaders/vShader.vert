@@ -0,0 +1,47 @@
+#version 330
+
+// Built as permutations (see ShaderPermutations):
+// INSTANCED: the model matrix comes per instance, as an attribute.
+// UNIFORM_BLOCKS: the matrices come from FrameBlock and ObjectBlock
+// instead of plain uniforms.
+
+layout (location = 0) in vec3 pos;
+#ifdef INSTANCED
+layout (location = 1) in mat4 instanceModel;
+#endif
+
+out vec4 vCol;
+
+#ifdef UNIFORM_BLOCKS
+layout (std140) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+};
+#ifndef INSTANCED
+layout (std140) uniform ObjectBlock
+{
+    mat4 model;
+};
+#endif
+#else
+uniform mat4 projection;
+#ifndef INSTANCED
+uniform mat4 model;
+#endif
+#endif
+
+void main()
+{
+#ifdef INSTANCED
+    mat4 world = instanceModel;
+#else
+    mat4 world = model;
+#endif
+#ifdef UNIFORM_BLOCKS
+    gl_Position = projection * view * world * vec4(pos, 1.0);
+#else
+    gl_Position = projection * world * vec4(pos, 1.0);
+#endif
+    vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+}